@@ -1,5 +1,6 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 
+#include <algorithm>
 #include <map>
 #include <unistd.h>
 #include <getopt.h>
@@ -335,6 +336,16 @@ int main(int argc, char *argv[])
     printf("Total operations: %d\n", total_stats.queries);
     printf("Total keys inserted minus keys deleted: %d\n", total_inserts_minus_deletes);
 
+    /* Latency percentiles, if we were collecting latency samples. Compare these between
+    runs to see what a server setting (such as busy-polling) does to latency. */
+    if (total_stats.latency_samples.size() > 0) {
+        std::vector<ticks_t> samples(total_stats.latency_samples.samples,
+                                     total_stats.latency_samples.samples + total_stats.latency_samples.size());
+        std::sort(samples.begin(), samples.end());
+        printf("Latency p50: %.2f us\n", ticks_to_us(samples[samples.size() * 50 / 100]));
+        printf("Latency p99: %.2f us\n", ticks_to_us(samples[samples.size() * 99 / 100]));
+    }
+
     // Dump key vectors if we have an out file
     if(config.out_file[0] != 0) {
         FILE *out_file = fopen(config.out_file, "w");
@@ -51,14 +51,16 @@ _complete_rethinkdb_admin() {
 _complete_rethinkdb() {
     local io_backend=("--io-backend")
     local io_backends=("native" "pool")
+    local cluster_compression=("--cluster-compression")
+    local cluster_compressions=("none" "bulk" "all")
     local commands=("create" "help" "serve" "admin" "proxy" "import")
     local file_args=("--input-file" "--pid-file")
     local directory_args=("-d" "--directory" "-l" "--log-file")
-    local numb_args=("-c" "--cores" "--client-port" "--cluster-port" "--driver-port" "-o" "--port-offset" "--http-port")
+    local numb_args=("-c" "--cores" "--busy-poll-usec" "--busy-poll-threads" "--client-port" "--cluster-port" "--cluster-lanes" "--driver-port" "-o" "--port-offset" "--http-port" "--stats-snapshot-interval")
     local help_tokens=("create" "serve" "admin" "proxy" "import")
     local create_tokens=("-d" "--directory" "-n" "--machine-name" "--io-backend")
-    local serve_tokens=("-d" "--directory" "--cluster-port" "--driver-port" "-o" "--port-offset" "-j" "--join" "--http-port" "-c" "--cores" "--pid-file" "--io-backend")
-    local proxy_tokens=("--log-file" "--cluster-port" "--driver-port" "-o" "--port-offset" "-j" "--join" "--http-port" "--pid-file" "--io-backend")
+    local serve_tokens=("-d" "--directory" "--cluster-port" "--cluster-lanes" "--cluster-compression" "--driver-port" "-o" "--port-offset" "-j" "--join" "--http-port" "--stats-snapshot-interval" "-c" "--cores" "--busy-poll-usec" "--busy-poll-threads" "--pid-file" "--io-backend")
+    local proxy_tokens=("--log-file" "--cluster-port" "--cluster-lanes" "--cluster-compression" "--driver-port" "-o" "--port-offset" "-j" "--join" "--http-port" "--stats-snapshot-interval" "--pid-file" "--io-backend")
     local import_tokens=("-j" "--join" "--table" "--datacenter" "--primary-key" "-s" "--separators" "--input-file")
 
     local cur=${COMP_WORDS[COMP_CWORD]}
@@ -94,6 +96,12 @@ _complete_rethinkdb() {
             return
         fi
 
+        if _rethinkdb_value_in_array "$prev" "${cluster_compression[@]}"; then
+            use="${cluster_compressions[@]}"
+            COMPREPLY=( $( compgen -W "$use" -- "$cur" ) )
+            return
+        fi
+
         case "$command" in
             help) use="${help_tokens[@]}" ;;
             create) use="${create_tokens[@]}" ;;
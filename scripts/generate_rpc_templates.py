@@ -105,10 +105,10 @@ def generate_async_message_template(nargs):
     print
     print "private:"
     if nargs == 0:
-        print "    friend void send(mailbox_manager_t*, address_t);"
+        print "    friend void send(mailbox_manager_t*, message_priority_t, address_t);"
     else:
         print "    template<" + csep("class a#_t") + ">"
-        print "    friend void send(mailbox_manager_t*, typename mailbox_t< void(" + csep("a#_t") + ") >::address_t" + cpre("const a#_t&") + ");"
+        print "    friend void send(mailbox_manager_t*, message_priority_t, typename mailbox_t< void(" + csep("a#_t") + ") >::address_t" + cpre("const a#_t&") + ");"
     print
     print "    boost::function< void(" + csep("arg#_t") + ") > fun;"
     print "    mailbox_callback_mode_t callback_mode;"
@@ -119,12 +119,20 @@ def generate_async_message_template(nargs):
         print "inline"
     else:
         print "template<" + csep("class arg#_t") + ">"
-    print "void send(mailbox_manager_t *src, " + ("typename " if nargs > 0 else "") + "mailbox_t< void(" + csep("arg#_t") + ") >::address_t dest" + cpre("const arg#_t &arg#") + ") {"
+    print "void send(mailbox_manager_t *src, message_priority_t priority, " + ("typename " if nargs > 0 else "") + "mailbox_t< void(" + csep("arg#_t") + ") >::address_t dest" + cpre("const arg#_t &arg#") + ") {"
     if nargs == 0:
         print "    mailbox_t< void(" + csep("arg#_t") + ") >::write_impl_t writer;"
     else:
         print "    typename mailbox_t< void(" + csep("arg#_t") + ") >::write_impl_t writer(" + csep("arg#") + ");"
-    print "    send(src, dest.addr, &writer);"
+    print "    send(src, dest.addr, &writer, priority);"
+    print "}"
+    print
+    if nargs == 0:
+        print "inline"
+    else:
+        print "template<" + csep("class arg#_t") + ">"
+    print "void send(mailbox_manager_t *src, " + ("typename " if nargs > 0 else "") + "mailbox_t< void(" + csep("arg#_t") + ") >::address_t dest" + cpre("const arg#_t &arg#") + ") {"
+    print "    send(src, MESSAGE_PRIORITY_DEFAULT, dest" + cpre("arg#") + ");"
     print "}"
     print
 
@@ -157,6 +165,10 @@ if __name__ == "__main__":
     print "    mailbox_callback_mode_inline"
     print "};"
     print
+    print "/* `send()` optionally takes a `message_priority_t` right after the "
+    print "`mailbox_manager_t`. Without one, the message goes out at the priority "
+    print "of the mailbox manager's message service. */"
+    print
     print "template <class> class mailbox_t;"
     print
     print "template <class T>"
@@ -170,10 +182,10 @@ if __name__ == "__main__":
     print "    RDB_MAKE_ME_SERIALIZABLE_1(addr);"
     print
     print "private:"
-    print "    friend void send(mailbox_manager_t *, mailbox_addr_t<void()>);"
+    print "    friend void send(mailbox_manager_t *, message_priority_t, mailbox_addr_t<void()>);"
     for nargs in xrange(1,15):
         print "    template <" + ncsep("class a#_t", nargs) + ">"
-        print "    friend void send(mailbox_manager_t *, typename mailbox_t< void(" + ncsep("a#_t", nargs) + ") >::address_t" + ncpre("const a#_t&", nargs) + ");"
+        print "    friend void send(mailbox_manager_t *, message_priority_t, typename mailbox_t< void(" + ncsep("a#_t", nargs) + ") >::address_t" + ncpre("const a#_t&", nargs) + ");"
     print
     print "    raw_mailbox_t::address_t addr;"
     print "};"
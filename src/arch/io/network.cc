@@ -4,6 +4,7 @@
 #include <arpa/inet.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/tcp.h>
@@ -25,6 +26,26 @@
 #include "logger.hpp"
 #include "perfmon/perfmon.hpp"
 
+/* If the current thread busy-polls, asks the kernel to busy-poll the device for
+`sock` too when we read from it. Raising the limit past `net.core.busy_read` needs
+CAP_NET_ADMIN, so failure here isn't an error. */
+static void maybe_set_busy_poll(fd_t sock) {
+#ifdef SO_BUSY_POLL
+    int usec = get_busy_poll_usec();
+    if (usec > 0) {
+        if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) != 0) {
+            static bool warned = false;
+            if (!warned) {
+                logWRN("Could not set SO_BUSY_POLL on socket: %s", errno_string(errno).c_str());
+                warned = true;
+            }
+        }
+    }
+#else
+    (void) sock;
+#endif
+}
+
 /* Network connection object */
 
 linux_tcp_conn_t::linux_tcp_conn_t(const ip_address_t &host, int port, signal_t *interruptor, int local_port) THROWS_ONLY(connect_failed_exc_t, interrupted_exc_t) :
@@ -36,6 +57,7 @@ linux_tcp_conn_t::linux_tcp_conn_t(const ip_address_t &host, int port, signal_t
         write_queue_limiter(WRITE_QUEUE_MAX_SIZE),
         write_coro_pool(1, &write_queue, &write_handler),
         current_write_buffer(get_write_buffer()),
+        popped_bytes(0),
         drainer(new auto_drainer_t) {
 
     struct sockaddr_in addr;
@@ -58,6 +80,7 @@ linux_tcp_conn_t::linux_tcp_conn_t(const ip_address_t &host, int port, signal_t
     bzero(addr.sin_zero, sizeof(addr.sin_zero));
 
     guarantee_err(fcntl(sock.get(), F_SETFL, O_NONBLOCK) == 0, "Could not make socket non-blocking");
+    maybe_set_busy_poll(sock.get());
 
     int res;
     do {
@@ -92,12 +115,14 @@ linux_tcp_conn_t::linux_tcp_conn_t(fd_t s) :
     write_queue_limiter(WRITE_QUEUE_MAX_SIZE),
     write_coro_pool(1, &write_queue, &write_handler),
     current_write_buffer(get_write_buffer()),
+    popped_bytes(0),
     drainer(new auto_drainer_t)
 {
     rassert(sock.get() != INVALID_FD);
 
     int res = fcntl(sock.get(), F_SETFL, O_NONBLOCK);
     guarantee_err(res == 0, "Could not make socket non-blocking");
+    maybe_set_busy_poll(sock.get());
 }
 
 linux_tcp_conn_t::write_buffer_t * linux_tcp_conn_t::get_write_buffer() {
@@ -181,11 +206,10 @@ size_t linux_tcp_conn_t::read_some(void *buf, size_t size, signal_t *closer) THR
     rassert(size > 0);
     read_op_wrapper_t sentry(this, closer);
 
-    if (read_buffer.size()) {
+    if (read_buffer.size() > popped_bytes) {
         /* Return the data from the peek buffer */
-        size_t read_buffer_bytes = std::min(read_buffer.size(), size);
-        memcpy(buf, read_buffer.data(), read_buffer_bytes);
-        read_buffer.erase(read_buffer.begin(), read_buffer.begin() + read_buffer_bytes);
+        size_t read_buffer_bytes = memcpy_from_read_buffer(buf, size);
+        pop_read_buffer(read_buffer_bytes);
         return read_buffer_bytes;
     } else {
         /* Go to the kernel _once_. */
@@ -197,9 +221,8 @@ void linux_tcp_conn_t::read(void *buf, size_t size, signal_t *closer) THROWS_ONL
     read_op_wrapper_t sentry(this, closer);
 
     /* First, consume any data in the peek buffer */
-    int read_buffer_bytes = std::min(read_buffer.size(), size);
-    memcpy(buf, read_buffer.data(), read_buffer_bytes);
-    read_buffer.erase(read_buffer.begin(), read_buffer.begin() + read_buffer_bytes);
+    size_t read_buffer_bytes = memcpy_from_read_buffer(buf, size);
+    pop_read_buffer(read_buffer_bytes);
     buf = reinterpret_cast<void *>(reinterpret_cast<char *>(buf) + read_buffer_bytes);
     size -= read_buffer_bytes;
 
@@ -227,14 +250,14 @@ const_charslice linux_tcp_conn_t::peek() const THROWS_ONLY(tcp_conn_read_closed_
     rassert(!read_in_progress);   // Is there a read already in progress?
     if (read_closed.is_pulsed()) throw tcp_conn_read_closed_exc_t();
 
-    return const_charslice(read_buffer.data(), read_buffer.data() + read_buffer.size());
+    return const_charslice(read_buffer.data() + popped_bytes, read_buffer.data() + read_buffer.size());
 }
 
 const_charslice linux_tcp_conn_t::peek(size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_read_closed_exc_t) {
-    while (read_buffer.size() < size) {
+    while (read_buffer.size() - popped_bytes < size) {
         read_more_buffered(closer);
     }
-    return const_charslice(read_buffer.data(), read_buffer.data() + size);
+    return const_charslice(read_buffer.data() + popped_bytes, read_buffer.data() + popped_bytes + size);
 }
 
 void linux_tcp_conn_t::pop(size_t len, signal_t *closer) THROWS_ONLY(tcp_conn_read_closed_exc_t) {
@@ -243,7 +266,29 @@ void linux_tcp_conn_t::pop(size_t len, signal_t *closer) THROWS_ONLY(tcp_conn_re
     if (read_closed.is_pulsed()) throw tcp_conn_read_closed_exc_t();
 
     peek(len, closer);
-    read_buffer.erase(read_buffer.begin(), read_buffer.begin() + len);  // INEFFICIENT
+    pop_read_buffer(len);
+}
+
+size_t linux_tcp_conn_t::memcpy_from_read_buffer(void *buf, const size_t n) {
+    size_t bytes = std::min(read_buffer.size() - popped_bytes, n);
+    memcpy(buf, read_buffer.data() + popped_bytes, bytes);
+    return bytes;
+}
+
+void linux_tcp_conn_t::pop_read_buffer(const size_t n) {
+    rassert(popped_bytes + n <= read_buffer.size());
+    popped_bytes += n;
+    if (popped_bytes == read_buffer.size()) {
+        /* The common case: the client is waiting for our reply, so we've consumed
+        everything we read. Keeps the capacity around for the next request. */
+        read_buffer.clear();
+        popped_bytes = 0;
+    } else if (popped_bytes >= POP_THRESHOLD && popped_bytes >= read_buffer.size() - popped_bytes) {
+        /* We move at most as many bytes as were popped since the last time, so this
+        stays linear in the amount of data read. */
+        read_buffer.erase(read_buffer.begin(), read_buffer.begin() + popped_bytes);
+        popped_bytes = 0;
+    }
 }
 
 void linux_tcp_conn_t::shutdown_read() {
@@ -271,7 +316,9 @@ linux_tcp_conn_t::write_handler_t::write_handler_t(linux_tcp_conn_t *_parent) :
 { }
 
 void linux_tcp_conn_t::write_handler_t::coro_pool_callback(write_queue_op_t *operation, UNUSED signal_t *interruptor) {
-    if (operation->buffer != NULL) {
+    if (operation->iov != NULL) {
+        parent->perform_writev(operation->iov, operation->iovcnt);
+    } else if (operation->buffer != NULL) {
         parent->perform_write(operation->buffer, operation->size);
         if (operation->dealloc != NULL) {
             parent->release_write_buffer(operation->dealloc);
@@ -297,6 +344,7 @@ void linux_tcp_conn_t::internal_flush_write_buffer() {
     op->buffer = current_write_buffer->buffer;
     op->size = current_write_buffer->size;
     op->dealloc = current_write_buffer.release();
+    op->iov = NULL;
     op->cond = NULL;
     op->keepalive = auto_drainer_t::lock_t(drainer.get());
     current_write_buffer.init(get_write_buffer());
@@ -311,6 +359,13 @@ void linux_tcp_conn_t::internal_flush_write_buffer() {
 }
 
 void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
+    struct iovec iov;
+    iov.iov_base = const_cast<void *>(buf);
+    iov.iov_len = size;
+    perform_writev(&iov, 1);
+}
+
+void linux_tcp_conn_t::perform_writev(struct iovec *iov, int iovcnt) {
     assert_thread();
 
     if (write_closed.is_pulsed()) {
@@ -320,9 +375,15 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         return;
     }
 
-    while (size > 0) {
-        ssize_t res = ::write(sock.get(), buf, size);
+    /* Skip over any empty buffers at the front so that a return value of 0
+    below really means something is wrong. */
+    while (iovcnt > 0 && iov->iov_len == 0) {
+        ++iov;
+        --iovcnt;
+    }
 
+    while (iovcnt > 0) {
+        ssize_t res = ::writev(sock.get(), iov, std::min(iovcnt, IOV_MAX));
         if (res == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
             /* Wait for a notification from the event queue, or for an order to
             shut down */
@@ -354,15 +415,23 @@ void linux_tcp_conn_t::perform_write(const void *buf, size_t size) {
         } else if (res == 0) {
             /* This should never happen either, but it's better to write an error message than to
                crash completely. */
-            logERR("Didn't expect write() to return 0.");
+            logERR("Didn't expect writev() to return 0.");
             on_shutdown_write();
             break;
 
         } else {
-            rassert(res <= static_cast<ssize_t>(size));
-            buf = reinterpret_cast<const void *>(reinterpret_cast<const char *>(buf) + res);
-            size -= res;
             if (write_perfmon) write_perfmon->record(res);
+            size_t written = res;
+            while (iovcnt > 0 && written >= iov->iov_len) {
+                written -= iov->iov_len;
+                ++iov;
+                --iovcnt;
+            }
+            if (written > 0) {
+                rassert(iovcnt > 0);
+                iov->iov_base = reinterpret_cast<char *>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
         }
     }
 }
@@ -382,6 +451,7 @@ void linux_tcp_conn_t::write(const void *buf, size_t size, signal_t *closer) THR
     /* Enqueue the write so it will happen eventually */
     op.buffer = buf;
     op.size = size;
+    op.iov = NULL;
     op.dealloc = NULL;
     op.cond = &to_signal_when_done;
     write_queue.push(&op);
@@ -417,6 +487,29 @@ void linux_tcp_conn_t::write_buffered(const void *vbuf, size_t size, signal_t *c
     if (write_closed.is_pulsed()) throw tcp_conn_write_closed_exc_t();
 }
 
+void linux_tcp_conn_t::writev(struct iovec *iov, int iovcnt, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    write_op_wrapper_t sentry(this, closer);
+
+    write_queue_op_t op;
+    cond_t to_signal_when_done;
+
+    /* As in `write()`, flush out any buffered data first and then block until
+    the write is done, so we don't need the write semaphore. */
+    if (current_write_buffer->size > 0) internal_flush_write_buffer();
+
+    op.buffer = NULL;
+    op.size = 0;
+    op.iov = iov;
+    op.iovcnt = iovcnt;
+    op.dealloc = NULL;
+    op.cond = &to_signal_when_done;
+    write_queue.push(&op);
+
+    to_signal_when_done.wait();
+
+    if (write_closed.is_pulsed()) throw tcp_conn_write_closed_exc_t();
+}
+
 void linux_tcp_conn_t::writef(signal_t *closer, const char *format, ...) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
     va_list ap;
     va_start(ap, format);
@@ -441,6 +534,7 @@ void linux_tcp_conn_t::flush_buffer(signal_t *closer) THROWS_ONLY(tcp_conn_write
     write_queue_op_t op;
     cond_t to_signal_when_done;
     op.buffer = NULL;
+    op.iov = NULL;
     op.dealloc = NULL;
     op.cond = &to_signal_when_done;
     write_queue.push(&op);
@@ -5,6 +5,7 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <ifaddrs.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -109,6 +110,11 @@ public:
     buffered writes; this may improve performance. */
     void write_buffered(const void *buf, size_t size, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
 
+    /* writev() is like write(), but gathers the data from `iovcnt` separate
+    buffers, handing as many of them to the kernel at once as it can. The
+    contents of `iov` are clobbered. */
+    void writev(struct iovec *iov, int iovcnt, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);
+
     void writef(signal_t *closer, const char *format, ...) THROWS_ONLY(tcp_conn_write_closed_exc_t) __attribute__ ((format (printf, 3, 4)));
 
     void flush_buffer(signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t);   // Blocks until flush is done
@@ -223,7 +229,8 @@ private:
     /* These are pulsed if and only if the read/write end of the connection has been closed. */
     cond_t read_closed, write_closed;
 
-    /* Holds data that we read from the socket but hasn't been consumed yet */
+    /* Holds data that we read from the socket but hasn't been consumed yet, starting
+    at `popped_bytes`. */
     std::vector<char> read_buffer;
 
     /* Reads up to the given number of bytes, but not necessarily that many. Simple wrapper around
@@ -243,6 +250,9 @@ private:
         write_buffer_t *dealloc;
         const void *buffer;
         size_t size;
+        /* If non-NULL, the operation writes these instead of `buffer`. */
+        struct iovec *iov;
+        int iovcnt;
         cond_t *cond;
         auto_drainer_t::lock_t keepalive;
     };
@@ -301,16 +311,20 @@ private:
     `size` bytes from `buffer` to the socket. */
     void perform_write(const void *buffer, size_t size);
 
+    /* Like `perform_write()`, but for a gather list. Advances through `iov` as
+    the kernel accepts data. */
+    void perform_writev(struct iovec *iov, int iovcnt);
+
     /* memcpy up to n bytes from read_buffer into dest. Returns the number of bytes
     copied. Then pop_read_buffer() can be used to remove the fetched bytes from the read buffer.
     */
-    // TODO ! Recover that to make pop() fast again
-    //size_t memcpy_from_read_buffer(void *buf, const size_t n);
-    //void pop_read_buffer(const size_t n);
+    size_t memcpy_from_read_buffer(void *buf, const size_t n);
+    void pop_read_buffer(const size_t n);
 
     /* To make pop() more efficient, we only actually erase part of the read_buffer
     when POP_THRESHOLD bytes can be popped of. Before that point, we accumulate
-    the length of popped bytes in popped_bytes. */
+    the length of popped bytes in popped_bytes; the unconsumed data is
+    `read_buffer[popped_bytes, read_buffer.size())`. */
     static const size_t POP_THRESHOLD = 1024;
     size_t popped_bytes;
 
@@ -33,12 +33,18 @@ bool context_ref_t::is_nil() {
 
 artificial_stack_t::artificial_stack_t(void (*initial_fun)(void), size_t _stack_size)
     : stack_size(_stack_size) {
-    /* Allocate the stack */
-    stack = malloc_aligned(stack_size, getpagesize());
+    /* Reserve the stack. The OS only commits the pages that actually get
+    touched, so a deep stack costs nothing until it is used. */
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+    flags |= MAP_NORESERVE;
+#endif
+    stack = mmap(NULL, stack_size, PROT_READ | PROT_WRITE, flags, -1, 0);
+    guarantee_err(stack != MAP_FAILED, "could not allocate coroutine stack");
 
     /* Protect the end of the stack so that we crash when we get a stack
     overflow instead of corrupting memory. */
-    mprotect(stack, getpagesize(), PROT_NONE);
+    guarantee_err(0 == mprotect(stack, getpagesize(), PROT_NONE), "could not protect coroutine stack");
 
     /* Register our stack with Valgrind so that it understands what's going on
     and doesn't create spurious errors */
@@ -124,11 +130,17 @@ artificial_stack_t::~artificial_stack_t() {
 #endif
 #endif
 
-    /* Undo protections changes */
-    mprotect(stack, getpagesize(), PROT_READ | PROT_WRITE);
+    /* Release the stack we allocated, guard page and all */
+    guarantee_err(0 == munmap(stack, stack_size), "could not free coroutine stack");
+}
 
-    /* Release the stack we allocated */
-    free(stack);
+void artificial_stack_t::release_unused_pages(size_t bytes_to_keep) {
+    uintptr_t bottom = uintptr_t(stack) + getpagesize();
+    uintptr_t top = floor_aligned(uintptr_t(get_stack_base()) - bytes_to_keep, getpagesize());
+    if (top > bottom) {
+        guarantee_err(0 == madvise(reinterpret_cast<void *>(bottom), top - bottom, MADV_DONTNEED),
+                      "could not release coroutine stack pages");
+    }
 }
 
 bool artificial_stack_t::address_in_stack(void *addr) {
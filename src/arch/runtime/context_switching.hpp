@@ -58,6 +58,12 @@ public:
     /* Returns the end of the stack */
     void* get_stack_bound() { return stack; }
 
+    /* Gives the memory of the stack back to the OS, except for the top
+    `bytes_to_keep` bytes. The address range stays reserved, so the pages are
+    simply faulted back in (zeroed) if the stack grows into them again. Only
+    call this when nothing below the top `bytes_to_keep` bytes is in use. */
+    void release_unused_pages(size_t bytes_to_keep);
+
 private:
     void *stack;
     size_t stack_size;
@@ -4,6 +4,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <vector>
+
 #ifndef NDEBUG
 #include <stack>   /* the data structure, not the run-time concept */
 #endif
@@ -14,20 +16,57 @@
 #include "arch/runtime/context_switching.hpp"
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/spinlock.hpp"
 #include "config/args.hpp"
 #include "do_on_thread.hpp"
 
 #include "perfmon/perfmon.hpp"
 #include "utils.hpp"
 
-static perfmon_counter_t pm_active_coroutines, pm_allocated_coroutines;
+/* Every coroutine has a stack of its own, so "active_coroutines" is also how many
+stacks are in use. "allocated_coroutines" counts the stacks that have been
+reserved, including the idle ones on the free lists. "resident_coroutine_stacks"
+counts the stacks whose memory is still committed: the ones in use, plus the
+up to `COROUTINE_IDLE_STACKS_RESIDENT` idle ones per thread that are kept warm.
+Idle stacks past that have their pages given back and aren't counted. */
+static perfmon_counter_t pm_active_coroutines, pm_allocated_coroutines, pm_resident_coroutine_stacks;
 static perfmon_multi_membership_t pm_coroutines_membership(&get_global_perfmon_collection(),
     &pm_active_coroutines, "active_coroutines",
     &pm_allocated_coroutines, "allocated_coroutines",
+    &pm_resident_coroutine_stacks, "resident_coroutine_stacks",
     NULLPTR);
 
+/* An idle coroutine is parked in `coro_t::run()`, right at the top of its
+stack; everything below this many bytes from the top is dead. */
+static const size_t IDLE_CORO_STACK_BYTES = 8 * KILOBYTE;
+
 size_t coro_stack_size = COROUTINE_STACK_SIZE; //Default, setable by command-line parameter
 
+/* Every `coroutine_type_t` there is, indexed by id. Types are never destroyed. */
+static spinlock_t coroutine_types_lock;
+static std::vector<coroutine_type_t *> coroutine_types;
+
+coroutine_type_t::coroutine_type_t(const char *spawn_function) {
+    /* `spawn_function` is the `__PRETTY_FUNCTION__` of
+    `coro_t::get_and_init_coro()`, which ends with "[with Callable = ...]". */
+    static const char marker[] = "Callable = ";
+    const char *start = strstr(spawn_function, marker);
+    if (start != NULL) {
+        start += strlen(marker);
+        size_t length = strlen(start);
+        if (length > 0 && start[length - 1] == ']') {
+            --length;
+        }
+        name.assign(start, length);
+    } else {
+        name.assign(spawn_function);
+    }
+
+    spinlock_acq_t acq(&coroutine_types_lock);
+    id = coroutine_types.size();
+    coroutine_types.push_back(this);
+}
+
 /* `coro_globals_t` holds all of the thread-local variables that coroutines need
 to operate. There is one per thread; it is constructed by the constructor for
 `coro_runtime_t` and destroyed by the destructor. If one exists, you can find
@@ -44,9 +83,15 @@ struct coro_globals_t {
     /* The previous context. */
     coro_t *prev_coro;
 
-    /* A list of coro_t objects that are not in use. */
+    /* A list of coro_t objects that are not in use. The ones at the back
+    still have their stack pages; we reuse those first. */
     intrusive_list_t<coro_t> free_coros;
 
+    /* Cycles spent running coroutines of each type, indexed by the type's
+    id, and when the last context switch happened. */
+    std::vector<uint64_t> cycles_by_type;
+    uint64_t last_switch_cycles;
+
 #ifndef NDEBUG
 
     /* An integer counting the number of coros on this thread */
@@ -72,6 +117,7 @@ struct coro_globals_t {
     coro_globals_t()
         : current_coro(NULL)
         , prev_coro(NULL)
+        , last_switch_cycles(get_clock_cycles())
 #ifndef NDEBUG
         , coro_count(0)
         , assert_no_coro_waiting_counter(0)
@@ -105,6 +151,15 @@ coro_runtime_t::~coro_runtime_t() {
     cglobals = NULL;
 }
 
+void get_coroutine_cycles(std::map<std::string, uint64_t> *cycles_out) {
+    spinlock_acq_t acq(&coroutine_types_lock);
+    for (size_t i = 0; i < cglobals->cycles_by_type.size(); ++i) {
+        if (cglobals->cycles_by_type[i] != 0) {
+            (*cycles_out)[coroutine_types[i]->name] += cglobals->cycles_by_type[i];
+        }
+    }
+}
+
 #ifndef NDEBUG
 void coro_runtime_t::get_coroutine_counts(std::map<std::string, size_t> *dest) {
     dest->clear();
@@ -120,14 +175,19 @@ static __thread int64_t coro_selfname_counter = 0;
 
 coro_t::coro_t() :
     stack(&coro_t::run, coro_stack_size),
+    stack_released_(false),
     current_thread_(linux_thread_pool_t::thread_id),
     notified_(false),
-    waiting_(false)
+    waiting_(false),
+    type_(NULL),
+    trace_(NULL),
+    io_wait_ticks_(0)
 #ifndef NDEBUG
     , selfname_number(get_thread_id() + MAX_THREADS * ++coro_selfname_counter)
 #endif
 {
     ++pm_allocated_coroutines;
+    ++pm_resident_coroutine_stacks;
 
 #ifndef NDEBUG
     cglobals->coro_count++;
@@ -138,7 +198,16 @@ coro_t::coro_t() :
 }
 
 void coro_t::return_coro_to_free_list(coro_t *coro) {
-    cglobals->free_coros.push_back(coro);
+    if (cglobals->free_coros.size() < COROUTINE_IDLE_STACKS_RESIDENT) {
+        cglobals->free_coros.push_back(coro);
+    } else {
+        /* We have plenty of warm stacks already; keep this one's address
+        space and guard page, but not its memory. */
+        coro->stack.release_unused_pages(IDLE_CORO_STACK_BYTES);
+        coro->stack_released_ = true;
+        --pm_resident_coroutine_stacks;
+        cglobals->free_coros.push_front(coro);
+    }
 }
 
 coro_t::~coro_t() {
@@ -149,6 +218,9 @@ coro_t::~coro_t() {
     cglobals->coro_count--;
 #endif
     --pm_allocated_coroutines;
+    if (!stack_released_) {
+        --pm_resident_coroutine_stacks;
+    }
 }
 
 void coro_t::run() {
@@ -157,6 +229,8 @@ void coro_t::run() {
 #ifndef NDEBUG
     char dummy;  /* Make sure we're on the right stack. */
     rassert(coro->stack.address_in_stack(&dummy));
+    /* ...and that `release_unused_pages()` can't free our frame. */
+    rassert(static_cast<char *>(coro->stack.get_stack_base()) - &dummy < static_cast<ptrdiff_t>(IDLE_CORO_STACK_BYTES / 2));
 #endif
 
     while (true) {
@@ -213,6 +287,60 @@ coro_t *coro_t::self() {   /* class method */
     return cglobals->current_coro;
 }
 
+const char *coro_t::current_type_name() {   /* class method */
+    if (cglobals == NULL || cglobals->current_coro == NULL || cglobals->current_coro->type_ == NULL) {
+        return NULL;
+    }
+    return cglobals->current_coro->type_->name.c_str();
+}
+
+bool coro_t::current_stack_bounds(void **bound_out, void **base_out) {   /* class method */
+    if (cglobals == NULL || cglobals->current_coro == NULL) {
+        return false;
+    }
+    *bound_out = cglobals->current_coro->stack.get_stack_bound();
+    *base_out = cglobals->current_coro->stack.get_stack_base();
+    return true;
+}
+
+trace_t *coro_t::current_trace() {   /* class method */
+    coro_t *coro = self();
+    return coro != NULL ? coro->trace_ : NULL;
+}
+
+void coro_t::set_current_trace(trace_t *trace) {   /* class method */
+    coro_t *coro = self();
+    rassert(coro != NULL || trace == NULL, "Only coroutines can be traced");
+    if (coro != NULL) {
+        coro->trace_ = trace;
+    }
+}
+
+ticks_t coro_t::io_wait_ticks() {   /* class method */
+    coro_t *coro = self();
+    return coro != NULL ? coro->io_wait_ticks_ : 0;
+}
+
+void coro_t::add_io_wait_ticks(ticks_t ticks) {   /* class method */
+    coro_t *coro = self();
+    if (coro != NULL) {
+        coro->io_wait_ticks_ += ticks;
+    }
+}
+
+void coro_t::charge_running_coro() {   /* class method */
+    uint64_t now = get_clock_cycles();
+    coro_t *running = cglobals->current_coro;
+    if (running != NULL && running->type_ != NULL) {
+        std::vector<uint64_t> *cycles = &cglobals->cycles_by_type;
+        if (running->type_->id >= cycles->size()) {
+            cycles->resize(running->type_->id + 1, 0);
+        }
+        (*cycles)[running->type_->id] += now - cglobals->last_switch_cycles;
+    }
+    cglobals->last_switch_cycles = now;
+}
+
 void coro_t::wait() {   /* class method */
     rassert(self(), "Not in a coroutine context");
     rassert(cglobals->assert_finite_coro_waiting_counter == 0,
@@ -264,6 +392,11 @@ void coro_t::notify_now_deprecated() {
     cglobals->assert_finite_coro_waiting_counter = 0;
 #endif
 
+    /* Whatever ran until now is charged for it, and when the coroutine we're
+    switching to gives control back, it gets charged for its turn. Every switch
+    into a coroutine comes through here, so this covers all of them. */
+    charge_running_coro();
+
     coro_t *prev_prev_coro = cglobals->prev_coro;
     cglobals->prev_coro = cglobals->current_coro;
     cglobals->current_coro = this;
@@ -280,6 +413,7 @@ void coro_t::notify_now_deprecated() {
     }
 
     rassert(cglobals->current_coro == this);
+    charge_running_coro();
     cglobals->current_coro = cglobals->prev_coro;
     cglobals->prev_coro = prev_prev_coro;
 
@@ -357,11 +491,17 @@ coro_t * coro_t::get_coro() {
     } else {
         coro = cglobals->free_coros.tail();
         cglobals->free_coros.remove(coro);
+        if (coro->stack_released_) {
+            coro->stack_released_ = false;
+            ++pm_resident_coroutine_stacks;
+        }
     }
 
     rassert(!coro->intrusive_list_node_t<coro_t>::in_a_list());
 
     coro->current_thread_ = get_thread_id();
+    coro->trace_ = NULL;
+    coro->io_wait_ticks_ = 0;
     coro->notified_ = false;
     coro->waiting_ = true;
 
@@ -2,9 +2,8 @@
 #ifndef ARCH_RUNTIME_COROUTINES_HPP_
 #define ARCH_RUNTIME_COROUTINES_HPP_
 
-#ifndef NDEBUG
+#include <map>
 #include <string>
-#endif
 
 #include "arch/runtime/runtime_utils.hpp"
 #include "arch/runtime/context_switching.hpp"
@@ -14,6 +13,24 @@ const size_t MAX_COROUTINE_STACK_SIZE = 8*1024*1024;
 
 int get_thread_id();
 struct coro_globals_t;
+class trace_t;
+
+/* There is one `coroutine_type_t` for every type of callable that coroutines
+are spawned with, which in practice means one for every place that spawns
+coroutines. The time coroutines spend running is charged to their type; see
+`get_coroutine_cycles()`. */
+class coroutine_type_t {
+public:
+    explicit coroutine_type_t(const char *spawn_function);
+
+    /* The callable's type, as a string. */
+    std::string name;
+    /* Types are numbered from 0, in the order they're first spawned. */
+    size_t id;
+
+private:
+    DISABLE_COPYING(coroutine_type_t);
+};
 
 /* A coro_t represents a fiber of execution within a thread. Create one with spawn_*(). Within a
 coroutine, call wait() to return control to the scheduler; the coroutine will be resumed when
@@ -106,6 +123,26 @@ public:
 
     static void set_coroutine_stack_size(size_t size);
 
+    /* The name of the running coroutine's type, or NULL if we aren't in a
+    coroutine. Safe to call from a signal handler. */
+    static const char *current_type_name();
+
+    /* Sets `*bound_out` and `*base_out` to the low and high ends of the running
+    coroutine's stack and returns true, or returns false if we aren't in a
+    coroutine. Safe to call from a signal handler. */
+    static bool current_stack_bounds(void **bound_out, void **base_out);
+
+    /* The trace (see perfmon/trace.hpp) the running coroutine's work is
+    recorded in, or NULL. Use `trace_scope_t` rather than setting it directly. */
+    static trace_t *current_trace();
+    static void set_current_trace(trace_t *trace);
+
+    /* How many ticks the running coroutine has spent waiting for blocks to come
+    off disk, as reported by the buffer cache. Only the difference between two
+    calls means anything. */
+    static ticks_t io_wait_ticks();
+    static void add_io_wait_ticks(ticks_t ticks);
+
     artificial_stack_t * get_stack();
 
 private:
@@ -122,7 +159,9 @@ private:
     // If this function footprint ever changes, you may need to update the parse_coroutine_info function
     template<class Callable>
     static coro_t * get_and_init_coro(const Callable &action) {
+        static coroutine_type_t type(__PRETTY_FUNCTION__);
         coro_t *coro = get_coro();
+        coro->type_ = &type;
 #ifndef NDEBUG
         coro->parse_coroutine_type(__PRETTY_FUNCTION__);
 #endif
@@ -136,6 +175,10 @@ private:
 
     static void run() NORETURN;
 
+    /* Charges the cycles since the last context switch on this thread to the
+    type of the coroutine that was running, if any. */
+    static void charge_running_coro();
+
     friend struct coro_globals_t;
     ~coro_t();
 
@@ -143,6 +186,10 @@ private:
 
     artificial_stack_t stack;
 
+    /* True while the coroutine is idle and its stack pages have been given
+    back to the OS. */
+    bool stack_released_;
+
     int current_thread_;
 
     // Sanity check variables
@@ -151,6 +198,12 @@ private:
 
     callable_action_wrapper_t action_wrapper;
 
+    coroutine_type_t *type_;
+
+    trace_t *trace_;
+
+    ticks_t io_wait_ticks_;
+
 #ifndef NDEBUG
     int64_t selfname_number;
     std::string coroutine_type;
@@ -160,6 +213,12 @@ private:
     DISABLE_COPYING(coro_t);
 };
 
+/* Adds how many clock cycles (see `get_clock_cycles()`) coroutines of each
+type have spent running on the current thread, by type name, to `cycles_out`.
+This is wall-clock time between context switches, so a coroutine that blocks
+the whole thread in a system call is charged for it. */
+void get_coroutine_cycles(std::map<std::string, uint64_t> *cycles_out);
+
 /* Returns true if the given address is in the protection page of the current coroutine. */
 bool is_coroutine_stack_overflow(void *addr);
 bool coroutines_have_been_initialized();
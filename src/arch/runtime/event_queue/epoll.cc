@@ -59,7 +59,17 @@ void epoll_event_queue_t::run() {
     // Now, start the loop
     while (!parent->should_shut_down()) {
         // Grab the events from the kernel!
-        res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+        ticks_t wait_start = get_ticks();
+        res = 0;
+        bool may_block = true;
+        uint64_t spin_ticks = parent->busy_poll_ticks();
+        if (spin_ticks > 0) {
+            res = busy_poll(spin_ticks, &may_block);
+        }
+        if (res == 0 && may_block) {
+            res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, -1);
+        }
+        parent->record_wait_time(get_ticks() - wait_start);
 
         // epoll_wait might return with EINTR in some cases (in
         // particular under GDB), we just need to retry.
@@ -122,6 +132,27 @@ void epoll_event_queue_t::run() {
     }
 }
 
+int epoll_event_queue_t::busy_poll(uint64_t spin_ticks, bool *may_block_out) {
+    // Other threads needn't write to our eventfd while we're spinning; we'll see
+    // their messages anyway.
+    parent->set_busy_polling(true);
+
+    const ticks_t deadline = get_ticks() + spin_ticks;
+    int res;
+    do {
+        res = epoll_wait(epoll_fd, events, MAX_IO_EVENT_PROCESSING_BATCH_SIZE, 0);
+        if (res != 0 || parent->has_pending_work()) {
+            break;
+        }
+    } while (get_ticks() < deadline);
+
+    // A message may have been sent after we last looked, by a thread that still
+    // thought we were spinning.
+    parent->set_busy_polling(false);
+    *may_block_out = !parent->has_pending_work();
+    return res;
+}
+
 epoll_event_queue_t::~epoll_event_queue_t() {
     DEBUG_VAR int res = close(epoll_fd);
     rassert_err(res == 0, "Could not close epoll_fd");
@@ -20,6 +20,12 @@ public:
     ~epoll_event_queue_t();
 
 private:
+    /* Looks for events without blocking, until some show up, there's other work to
+    do, or `spin_ticks` have passed. Returns what `epoll_wait()` last returned. Sets
+    `*may_block_out` to false if the caller should go on to pump the parent instead
+    of waiting for events. */
+    int busy_poll(uint64_t spin_ticks, bool *may_block_out);
+
     linux_queue_parent_t *parent;
 
     fd_t epoll_fd;
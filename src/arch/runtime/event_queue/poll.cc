@@ -100,6 +100,7 @@ void poll_event_queue_t::run() {
     // Now, start the loop
     while (!parent->should_shut_down()) {
         // Grab the events from the kernel!
+        ticks_t wait_start = get_ticks();
 #ifndef RDB_TIMER_PROVIDER
 #error "RDB_TIMER_PROVIDER not defined."
 #elif RDB_TIMER_PROVIDER == RDB_TIMER_PROVIDER_SIGNAL
@@ -107,6 +108,7 @@ void poll_event_queue_t::run() {
 #else
         res = poll(&watched_fds[0], watched_fds.size(), -1);
 #endif
+        parent->record_wait_time(get_ticks() - wait_start);
         // ppoll might return with EINTR in some cases (in particular
         // under GDB), we just need to retry.
         if (res == -1 && errno == EINTR) {
@@ -3,6 +3,7 @@
 #define ARCH_RUNTIME_EVENT_QUEUE_TYPES_HPP_
 
 #include <signal.h>
+#include <stdint.h>
 
 // Types that are used, in particular, by poll.hpp and epoll.hpp.
 
@@ -15,6 +16,18 @@ struct linux_event_callback_t {
 struct linux_queue_parent_t {
     virtual void pump() = 0;
     virtual bool should_shut_down() = 0;
+    // Told how long (in ticks) the event queue just spent blocked in the kernel
+    // waiting for events.
+    virtual void record_wait_time(uint64_t ticks) = 0;
+
+    // In busy-poll mode, how long (in ticks) the event queue should keep looking
+    // for events before it blocks; zero if it should block right away.
+    virtual uint64_t busy_poll_ticks() = 0;
+    // Told when the event queue starts and stops busy-polling.
+    virtual void set_busy_polling(bool busy_polling) = 0;
+    // Whether there's something to do besides handling events (such as messages
+    // from other threads), so the event queue shouldn't block.
+    virtual bool has_pending_work() = 0;
     virtual ~linux_queue_parent_t() {}
 };
 
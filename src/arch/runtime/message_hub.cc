@@ -14,32 +14,26 @@
 #define RDB_RELOOP_MESSAGES 0
 #endif
 
-linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue, linux_thread_pool_t *thread_pool, int current_thread)
-    : queue_(queue), thread_pool_(thread_pool), current_thread_(current_thread) {
-
-    // We have to do this through dynamically, otherwise we might
-    // allocate far too many file descriptors since this is what the
-    // constructor of the system_event_t object (which is a member of
-    // notify_t) does.
-    notify_ = new notify_t[thread_pool_->n_threads];
+/* How many times `pump()` goes back for more messages before it lets the event queue
+look at file descriptors again. */
+static const int MAX_PUMP_ROUNDS = 4;
 
-    for (int i = 0; i < thread_pool_->n_threads; i++) {
-        // Create notify fd for other cores that send work to us
-        notify_[i].notifier_thread = i;
-        notify_[i].parent = this;
+linux_message_hub_t::linux_message_hub_t(linux_event_queue_t *queue, linux_thread_pool_t *thread_pool, int current_thread)
+    : queue_(queue), thread_pool_(thread_pool), sleeping_(1), current_thread_(current_thread) {
 
-        queue_->watch_resource(notify_[i].event.get_notify_fd(), poll_event_in, &notify_[i]);
+    for (int i = 0; i < MAX_THREADS; i++) {
+        incoming_[i].head = NULL;
     }
+
+    wakeup_.parent = this;
+    queue_->watch_resource(wakeup_.event.get_notify_fd(), poll_event_in, &wakeup_);
 }
 
 linux_message_hub_t::~linux_message_hub_t() {
     for (int i = 0; i < thread_pool_->n_threads; i++) {
         guarantee(queues_[i].msg_local_list.empty());
+        guarantee(incoming_[i].head == NULL);
     }
-
-    guarantee(incoming_messages_.empty());
-
-    delete[] notify_;
 }
 
 void linux_message_hub_t::do_store_message(unsigned int nthread, linux_thread_message_t *msg) {
@@ -82,79 +76,153 @@ void linux_message_hub_t::store_message_sometime(unsigned int nthread, linux_thr
 
 
 void linux_message_hub_t::insert_external_message(linux_thread_message_t *msg) {
-    {
-        spinlock_acq_t acq(&incoming_messages_lock_);
-        incoming_messages_.push_back(msg);
-    }
-
-    // Wakey wakey eggs and bakey
-    notify_[current_thread_].event.write(1);
+    msg_list_t msgs;
+    msgs.push_back(msg);
+    push_incoming(current_thread_, &msgs);
 }
 
-void linux_message_hub_t::notify_t::on_event(int events) {
+void linux_message_hub_t::push_incoming(unsigned int source, msg_list_t *msgs) {
+    rassert(source < (unsigned)MAX_THREADS);
 
-    if (events != poll_event_in) {
-        logERR("Unexpected event mask: %d", events);
+    // Link the batch up newest first, the way it sits on the stack.
+    linux_thread_message_t *newest = NULL, *oldest = NULL;
+    while (linux_thread_message_t *m = msgs->head()) {
+        msgs->remove(m);
+        m->next_incoming_ = newest;
+        if (oldest == NULL) {
+            oldest = m;
+        }
+        newest = m;
+    }
+    if (newest == NULL) {
+        return;
     }
 
-    // Read from the event so level-triggered mechanism such as poll
-    // don't pester us and use 100% cpu
-    event.read();
-
-    msg_list_t msg_list;
+    incoming_queue_t *q = &incoming_[source];
+    linux_thread_message_t *old_head;
+    do {
+        old_head = q->head;
+        oldest->next_incoming_ = old_head;
+    } while (!__sync_bool_compare_and_swap(&q->head, old_head, newest));
+
+    // The compare-and-swap is a full barrier, so either we see that the thread went
+    // to sleep or it sees our messages before it does.
+    if (sleeping_) {
+        // Wakey wakey eggs and bakey
+        wakeup_.event.write(1);
+    }
+}
 
-    // Pull the messages
-    {
-        spinlock_acq_t acq(&parent->incoming_messages_lock_);
-        msg_list.append_and_clear(&parent->incoming_messages_);
+bool linux_message_hub_t::has_incoming_messages() {
+    for (int i = 0; i < thread_pool_->n_threads; i++) {
+        if (incoming_[i].head != NULL) {
+            return true;
+        }
     }
+    return false;
+}
+
+bool linux_message_hub_t::deliver_messages() {
+    bool delivered_any = false;
 
 #ifndef NDEBUG
     start_watchdog(); // Initialize watchdog before handling messages
 #endif
 
-    while (linux_thread_message_t *m = msg_list.head()) {
-        msg_list.remove(m);
-#ifndef NDEBUG
-        if (m->reloop_count_ > 0) {
-            --m->reloop_count_;
-            parent->do_store_message(parent->current_thread_, m);
+    for (int i = 0; i < thread_pool_->n_threads; i++) {
+        if (incoming_[i].head == NULL) {
             continue;
         }
+
+        // Take the whole stack; reversing it puts the messages back in the order
+        // they were sent.
+        linux_thread_message_t *m = __sync_lock_test_and_set(&incoming_[i].head, static_cast<linux_thread_message_t *>(NULL));
+        msg_list_t msg_list;
+        while (m != NULL) {
+            linux_thread_message_t *next = m->next_incoming_;
+            m->next_incoming_ = NULL;
+            msg_list.push_front(m);
+            m = next;
+        }
+        delivered_any = true;
+
+        while (linux_thread_message_t *msg = msg_list.head()) {
+            msg_list.remove(msg);
+#ifndef NDEBUG
+            if (msg->reloop_count_ > 0) {
+                --msg->reloop_count_;
+                do_store_message(current_thread_, msg);
+                continue;
+            }
 #endif
 
-        m->on_thread_switch();
+            msg->on_thread_switch();
 
 #ifndef NDEBUG
-        pet_watchdog(); // Verify that each message completes in the acceptable time range
+            pet_watchdog(); // Verify that each message completes in the acceptable time range
 #endif
+        }
+    }
+
+    return delivered_any;
+}
+
+void linux_message_hub_t::notify_t::on_event(int events) {
+
+    if (events != poll_event_in) {
+        logERR("Unexpected event mask: %d", events);
     }
+
+    // Read from the event so level-triggered mechanism such as poll
+    // don't pester us and use 100% cpu
+    event.read();
+
+    parent->sleeping_ = 0;
+    parent->deliver_messages();
 }
 
-// Pushes messages collected locally global lists available to all
-// threads.
+// Pushes messages collected locally to the queues of the threads they're
+// going to.
 void linux_message_hub_t::push_messages() {
     for (int i = 0; i < thread_pool_->n_threads; i++) {
-        // Append the local list for ith thread to that thread's global
-        // message list.
         thread_queue_t *queue = &queues_[i];
         if (!queue->msg_local_list.empty()) {
             // Transfer messages to the other core
+            thread_pool_->threads[i]->message_hub.push_incoming(current_thread_, &queue->msg_local_list);
+        }
+    }
+}
 
-            bool do_wake_up;
-            {
-                spinlock_acq_t acq(&thread_pool_->threads[i]->message_hub.incoming_messages_lock_);
-
-                //We only need to do a wake up if the global
-                do_wake_up = thread_pool_->threads[i]->message_hub.incoming_messages_.empty();
+bool linux_message_hub_t::pump() {
+    push_messages();
 
-                thread_pool_->threads[i]->message_hub.incoming_messages_.append_and_clear(&queue->msg_local_list);
-            }
+    for (int round = 0; ; ++round) {
+        // Announce that we're going to sleep, then look again, so that a sender
+        // racing with us either sees the flag or is seen by us.
+        sleeping_ = 1;
+        __sync_synchronize();
+        if (!has_incoming_messages()) {
+            return true;
+        }
+        sleeping_ = 0;
 
-            // Wakey wakey, perhaps eggs and bakey
-            if (do_wake_up) {
-                thread_pool_->threads[i]->message_hub.notify_[current_thread_].event.write(1);
-            }
+        if (round == MAX_PUMP_ROUNDS) {
+            // Don't starve the file descriptors; make the event queue come
+            // straight back to us instead.
+            wake_up();
+            return false;
         }
+
+        deliver_messages();
+        push_messages();
     }
 }
+
+void linux_message_hub_t::wake_up() {
+    wakeup_.event.write(1);
+}
+
+void linux_message_hub_t::set_busy_polling(bool busy_polling) {
+    sleeping_ = busy_polling ? 0 : 1;
+    __sync_synchronize();
+}
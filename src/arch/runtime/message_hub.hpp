@@ -8,7 +8,6 @@
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/runtime_utils.hpp"
 #include "arch/runtime/system_event.hpp"
-#include "arch/spinlock.hpp"
 #include "config/args.hpp"
 #include "containers/intrusive_list.hpp"
 #include "utils.hpp"
@@ -21,7 +20,13 @@ class linux_thread_pool_t;
 /* There is one message hub per thread, NOT one message hub for the entire program.
 
 Each message hub stores messages that are going from that message hub's home thread to
-other threads. It keeps a separate queue for messages destined for each other thread. */
+other threads. It keeps a separate queue for messages destined for each other thread.
+
+Messages travel between threads through lock-free queues, one for each pair of threads
+(plus messages from outside the thread pool, which share the destination thread's own
+queue). Senders only write to the destination's eventfd if it might be asleep in the
+event queue; a thread that is busy picks up its messages at the end of each turn of the
+event loop, in `pump()`. */
 
 class linux_message_hub_t {
 public:
@@ -29,10 +34,30 @@ public:
 
     linux_message_hub_t(linux_event_queue_t *queue, linux_thread_pool_t *thread_pool, int current_thread);
 
-    /* For each thread, transfer messages from our msg_local_list for that thread to our
-    msg_global_list for that thread */
+    /* For each thread, transfer messages from our msg_local_list for that thread to that
+    thread's incoming queue for messages from us */
     void push_messages();
 
+    /* Called by the thread at the end of each turn of its event loop: sends the messages
+    we collected, delivers the ones other threads sent us, and announces that we're about
+    to sleep. Returns true if we're out of messages, so that the event queue may block;
+    false if we stopped early and asked the event queue to come straight back. */
+    bool pump();
+
+    /* Whether we may be blocked waiting for events. Can be called from any thread. */
+    bool is_sleeping() const { return sleeping_ != 0; }
+
+    /* Makes the event queue come back to us even if nothing else happens. Can be called
+    from any thread. */
+    void wake_up();
+
+    /* While busy-polling, the thread looks for messages itself, so senders don't need
+    to wake it up. */
+    void set_busy_polling(bool busy_polling);
+
+    /* Returns true if some thread has sent us messages we haven't delivered yet. */
+    bool has_incoming_messages();
+
     /* Schedules the given message to be sent to the given thread by pushing it onto our
     msg_local_list for that thread */
     void store_message(unsigned int nthread, linux_thread_message_t *msg);
@@ -52,12 +77,13 @@ private:
     // debug mode.
     void do_store_message(unsigned int nthread, linux_thread_message_t *msg);
 
+    /* Appends `msgs` to our queue for messages from thread `source`, and wakes us up if
+    we might be asleep. Can be called from any thread. */
+    void push_incoming(unsigned int source, msg_list_t *msgs);
 
-    /* pull_messages should be called on thread N with N as its argument. (The argument is
-    partially redundant.) It will cause the actual delivery of messages that originated
-    on this->current_thread and are destined for thread N. It is (almost) the only method on
-    linux_message_hub_t that is not called on the thread that the message hub belongs to. */
-    void pull_messages(int thread);
+    /* Runs the messages other threads have sent us. Returns false if there weren't
+    any. */
+    bool deliver_messages();
 
     linux_event_queue_t *const queue_;
     linux_thread_pool_t *const thread_pool_;
@@ -66,34 +92,34 @@ private:
     struct thread_queue_t {
         //TODO this doesn't need to be a class anymore
 
-        /* Messages are cached here before being pushed to the global list so that we don't
-        have to acquire the spinlock as often */
+        /* Messages are cached here before being pushed to the other thread, so that we
+        touch its queue once per turn of the event loop instead of once per message */
         msg_list_t msg_local_list;
     } queues_[MAX_THREADS];
 
-    msg_list_t incoming_messages_;
-    spinlock_t incoming_messages_lock_;
+    /* Messages for this->current_thread, one queue for each thread that sends them.
+    Each is a lock-free stack of messages linked through `next_incoming_`, newest first;
+    senders push whole batches with a compare-and-swap, and we take everything at once
+    and reverse it. Each sits on its own cache line. */
+    struct incoming_queue_t {
+        linux_thread_message_t *volatile head;
+        char padding[CACHE_LINE_SIZE - sizeof(linux_thread_message_t *)];
+    } incoming_[MAX_THREADS];
+
+    /* Nonzero while we may be blocked waiting for events. Senders only write to
+    `wakeup_` if this is set. */
+    volatile int32_t sleeping_;
 
-    /* We keep one notify_t for each other message hub that we interact with. When it has
-    messages for us, it signals the appropriate notify_t from our set of notify_ts. We get
-    the notification and call push_messages on the sender in reply. */
+    /* Written to wake us up when messages arrive while we're asleep. */
     struct notify_t : public linux_event_callback_t
     {
     public:
-        /* message_hubs[i]->notify[j].on_event() is called when thread #j has messages for
-        thread #i. */
         void on_event(int events);
 
-    public:
-        /* hub->notify[j].notifier_thread == j */
-        int notifier_thread;
-
         system_event_t event;                    // the eventfd to notify
 
-        /* hub->notify[i].parent = hub */
         linux_message_hub_t *parent;
-    };
-    notify_t *notify_;
+    } wakeup_;
 
     /* The thread that we queue messages originating from. (Recall that there is one
     message_hub_t per thread.) */
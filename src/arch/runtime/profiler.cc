@@ -0,0 +1,200 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "arch/runtime/profiler.hpp"
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/runtime_utils.hpp"
+#include "backtrace.hpp"
+#include "config/args.hpp"
+#include "errors.hpp"
+
+static const int MAX_SAMPLED_FRAMES = 32;
+
+struct stack_sample_t {
+    const char *coroutine_type;
+    int num_frames;
+    void *frames[MAX_SAMPLED_FRAMES];
+};
+
+/* The signal handler can run on any thread at any time, so all of these are only
+accessed with atomic operations. `samples` is only allocated and freed while
+`sampling` is 0 and no handler is running. */
+static volatile int profile_in_progress = 0;
+static volatile int sampling = 0;
+static volatile int handlers_running = 0;
+static volatile int next_sample = 0;
+static stack_sample_t *samples = NULL;
+
+/* The high end of the calling thread's own stack, or NULL if it never called
+`register_thread_for_profiling()`. */
+static __thread char *thread_stack_base = NULL;
+
+void register_thread_for_profiling() {
+    pthread_attr_t attr;
+    int res = pthread_getattr_np(pthread_self(), &attr);
+    guarantee_xerr(res == 0, res, "Could not get the thread's attributes");
+    void *stack;
+    size_t stack_size;
+    res = pthread_attr_getstack(&attr, &stack, &stack_size);
+    guarantee_xerr(res == 0, res, "Could not get the thread's stack");
+    res = pthread_attr_destroy(&attr);
+    guarantee_xerr(res == 0, res, "Could not destroy the thread's attributes");
+    thread_stack_base = static_cast<char *>(stack) + stack_size;
+}
+
+/* Follows the chain of saved frame pointers from the interrupted context. Each
+frame holds the caller's frame pointer and then the return address. Anything
+that isn't a word-aligned address above the last one and within the stack we
+were interrupted on ends the walk, so this never reads outside of that stack,
+even when the code doesn't keep frame pointers. */
+static int walk_frames(const ucontext_t *context, void **frames, int max_frames) {
+#if defined(__x86_64__)
+    uintptr_t pc = context->uc_mcontext.gregs[REG_RIP];
+    uintptr_t sp = context->uc_mcontext.gregs[REG_RSP];
+    uintptr_t fp = context->uc_mcontext.gregs[REG_RBP];
+#elif defined(__i386__)
+    uintptr_t pc = context->uc_mcontext.gregs[REG_EIP];
+    uintptr_t sp = context->uc_mcontext.gregs[REG_ESP];
+    uintptr_t fp = context->uc_mcontext.gregs[REG_EBP];
+#else
+#error "The sampling profiler doesn't know how to walk the stack on this architecture."
+#endif
+
+    int num_frames = 0;
+    frames[num_frames++] = reinterpret_cast<void *>(pc);
+
+    void *bound, *base;
+    if (!coro_t::current_stack_bounds(&bound, &base)) {
+        bound = NULL;
+        base = thread_stack_base;
+    }
+    /* While a coroutine is being switched to or from, the stack pointer may
+    not be on the stack we think it is. */
+    if (base == NULL || sp < reinterpret_cast<uintptr_t>(bound) || sp >= reinterpret_cast<uintptr_t>(base)) {
+        return num_frames;
+    }
+
+    const uintptr_t top = reinterpret_cast<uintptr_t>(base);
+    while (num_frames < max_frames &&
+           fp >= sp && fp % sizeof(void *) == 0 && fp <= top - 2 * sizeof(void *)) {
+        void *const *frame = reinterpret_cast<void *const *>(fp);
+        void *return_address = frame[1];
+        if (return_address == NULL) {
+            break;
+        }
+        frames[num_frames++] = return_address;
+        uintptr_t caller_fp = reinterpret_cast<uintptr_t>(frame[0]);
+        if (caller_fp <= fp) {
+            break;
+        }
+        fp = caller_fp;
+    }
+    return num_frames;
+}
+
+static void profile_signal_handler(int, siginfo_t *, void *context) {
+    int saved_errno = errno;
+    __sync_fetch_and_add(&handlers_running, 1);
+    if (sampling) {
+        int i = __sync_fetch_and_add(&next_sample, 1);
+        if (i < PROFILER_MAX_SAMPLES) {
+            stack_sample_t *sample = &samples[i];
+            sample->coroutine_type = coro_t::current_type_name();
+            sample->num_frames = walk_frames(static_cast<const ucontext_t *>(context),
+                                             sample->frames, MAX_SAMPLED_FRAMES);
+        }
+    }
+    __sync_fetch_and_sub(&handlers_running, 1);
+    errno = saved_errno;
+}
+
+bool start_sampling_profiler(int samples_per_sec) {
+    guarantee(samples_per_sec > 0);
+    if (!__sync_bool_compare_and_swap(&profile_in_progress, 0, 1)) {
+        return false;
+    }
+
+    samples = new stack_sample_t[PROFILER_MAX_SAMPLES];
+    next_sample = 0;
+
+    /* The handler stays installed after the profile is done, so that a late
+    signal doesn't kill the process. */
+    struct sigaction sa = make_sa_sigaction(SA_SIGINFO | SA_RESTART, &profile_signal_handler);
+    int res = sigaction(SIGPROF, &sa, NULL);
+    guarantee_err(res == 0, "Could not install SIGPROF handler");
+
+    __sync_synchronize();
+    sampling = 1;
+    __sync_synchronize();
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = std::max<long>(1, MILLION / samples_per_sec);
+    timer.it_value = timer.it_interval;
+    res = setitimer(ITIMER_PROF, &timer, NULL);
+    guarantee_err(res == 0, "Could not start the profiling timer");
+
+    return true;
+}
+
+static bool more_common(const sampled_stack_t &a, const sampled_stack_t &b) {
+    return a.count > b.count;
+}
+
+size_t stop_sampling_profiler(std::vector<sampled_stack_t> *stacks_out) {
+    rassert(profile_in_progress);
+
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    int res = setitimer(ITIMER_PROF, &timer, NULL);
+    guarantee_err(res == 0, "Could not stop the profiling timer");
+
+    sampling = 0;
+    __sync_synchronize();
+    while (handlers_running != 0) {
+        /* Some other thread is in the middle of recording a sample. It may have
+        been preempted in the handler, so let it run instead of spinning. */
+        sched_yield();
+    }
+
+    int num_samples = std::min(static_cast<int>(next_sample), PROFILER_MAX_SAMPLES);
+    size_t dropped = next_sample - num_samples;
+
+    typedef std::map<std::pair<const char *, std::vector<void *> >, size_t> stack_counts_t;
+    stack_counts_t counts;
+    for (int i = 0; i < num_samples; ++i) {
+        const stack_sample_t &sample = samples[i];
+        std::vector<void *> frames(sample.frames, sample.frames + sample.num_frames);
+        ++counts[std::make_pair(sample.coroutine_type, frames)];
+    }
+
+    delete[] samples;
+    samples = NULL;
+    __sync_synchronize();
+    profile_in_progress = 0;
+
+    stacks_out->clear();
+    for (stack_counts_t::iterator it = counts.begin(); it != counts.end(); ++it) {
+        std::vector<void *> frames = it->first.second;
+        sampled_stack_t stack;
+        stack.count = it->second;
+        stack.coroutine_type = it->first.first != NULL ? it->first.first : "";
+        stack.frames = print_frames(&frames[0], frames.size(), false);
+        stacks_out->push_back(stack);
+    }
+    std::sort(stacks_out->begin(), stacks_out->end(), &more_common);
+
+    return dropped;
+}
@@ -0,0 +1,44 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_PROFILER_HPP_
+#define ARCH_RUNTIME_PROFILER_HPP_
+
+#include <string>
+#include <vector>
+
+/* A sampling profiler, so that we can find out where a running server spends its
+CPU time without attaching an external profiler to it. While a profile is being
+taken, a `SIGPROF` timer interrupts whichever thread is using the CPU every so
+often, and the signal handler records the thread's stack and the type of the
+coroutine it's running (see `coroutine_type_t`). Only one profile can be taken at
+a time in a process.
+
+The stack is found by following frame pointers, because nothing that unwinds
+with debug info is safe to use in a signal handler. Builds that omit frame
+pointers (release builds without `NO_OMIT_FRAME_POINTER=1`) only get the
+innermost frame and whatever callers happen to keep them. */
+
+struct sampled_stack_t {
+    /* How many samples had exactly this stack. */
+    size_t count;
+    /* The type of the coroutine that was running, or empty if none was. */
+    std::string coroutine_type;
+    /* The stack, innermost frame first, as formatted by `print_frames()`. */
+    std::string frames;
+};
+
+/* Remembers where the calling thread's stack is, so that samples taken outside
+of a coroutine can be walked. Every thread that lets `SIGPROF` through calls it
+when it starts. */
+void register_thread_for_profiling();
+
+/* Starts sampling `samples_per_sec` times per second of CPU time used by the
+process. Returns false if a profile is already being taken. */
+bool start_sampling_profiler(int samples_per_sec);
+
+/* Stops sampling and fills `stacks_out` with the stacks that were sampled, most
+common first. Returns how many samples were dropped because there were more than
+`PROFILER_MAX_SAMPLES`. Must only be called after `start_sampling_profiler()`
+returned true. */
+size_t stop_sampling_profiler(std::vector<sampled_stack_t> *stacks_out);
+
+#endif  // ARCH_RUNTIME_PROFILER_HPP_
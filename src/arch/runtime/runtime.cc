@@ -17,6 +17,21 @@ int get_num_threads() {
     return linux_thread_pool_t::thread_pool->n_threads;
 }
 
+void set_busy_poll_usec(int usec) {
+    rassert(usec >= 0);
+    linux_thread_pool_t::thread->busy_poll_usec = usec;
+}
+
+int get_busy_poll_usec() {
+    return linux_thread_pool_t::thread->busy_poll_usec;
+}
+
+void get_thread_wait_time(ticks_t *waited_out, ticks_t *elapsed_out) {
+    linux_thread_t *thread = linux_thread_pool_t::thread;
+    *waited_out = thread->wait_ticks;
+    *elapsed_out = get_ticks() - thread->start_ticks;
+}
+
 #ifndef NDEBUG
 void assert_good_thread_id(int thread) {
     rassert(thread >= 0, "(thread = %d)", thread);
@@ -11,6 +11,17 @@ int get_thread_id();
 
 int get_num_threads();
 
+// Sets `*waited_out` to how long the current thread has spent blocked waiting for
+// events, and `*elapsed_out` to how long it has been running, both in ticks.
+void get_thread_wait_time(ticks_t *waited_out, ticks_t *elapsed_out);
+
+// In busy-poll mode the current thread's (epoll) event queue keeps looking for events and
+// messages for `usec` microseconds before it goes to sleep, and sockets created on
+// the thread ask the kernel to busy-poll the device (SO_BUSY_POLL). This trades CPU
+// for latency. Zero turns it off.
+void set_busy_poll_usec(int usec);
+int get_busy_poll_usec();
+
 #ifndef NDEBUG
 void assert_good_thread_id(int thread);
 #else
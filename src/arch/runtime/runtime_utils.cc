@@ -2,14 +2,13 @@
 #define __STDC_FORMAT_MACROS
 #include "arch/runtime/runtime_utils.hpp"
 
+#include <time.h>
 #include <unistd.h>
 
 #include "arch/runtime/context_switching.hpp"
 #include "arch/runtime/coroutines.hpp"
 #include "logger.hpp"
 
-#ifndef NDEBUG
-
 uint64_t get_clock_cycles() {
 #if defined(__i386__) || defined(__x86_64__)
     // uintptr_t matches the native register/word size on Linux on i386 and amd64.
@@ -22,11 +21,16 @@ uint64_t get_clock_cycles() {
     ret <<= 32;
     ret |= low;
 #else
-#error "Unsupported architecture."
+    // Not cycles, but it's monotonic and only ever used for differences.
+    struct timespec now;
+    int res = clock_gettime(CLOCK_MONOTONIC, &now);
+    guarantee_err(res == 0, "clock_gettime failed");
+    uint64_t ret = static_cast<uint64_t>(now.tv_sec) * BILLION + now.tv_nsec;
 #endif
     return ret;
 }
 
+#ifndef NDEBUG
 bool watchdog_check_enabled = false;
 __thread uint64_t watchdog_start_time = 0;
 const uint64_t MAX_WATCHDOG_DELTA = 100 * MILLION;
@@ -14,9 +14,10 @@ typedef int fd_t;
 
 class linux_thread_message_t : public intrusive_list_node_t<linux_thread_message_t> {
 public:
-    linux_thread_message_t() 
+    linux_thread_message_t()
+        : next_incoming_(NULL)
 #ifndef NDEBUG
-        : reloop_count_(0) 
+        , reloop_count_(0)
 #endif
         { }
     virtual void on_thread_switch() = 0;
@@ -24,6 +25,8 @@ protected:
     virtual ~linux_thread_message_t() {}
 private:
     friend class linux_message_hub_t;
+    /* Link in the lock-free queue of the thread the message is going to. */
+    linux_thread_message_t *next_incoming_;
 #ifndef NDEBUG
     int reloop_count_;
 #endif
@@ -33,6 +36,9 @@ typedef linux_thread_message_t thread_message_t;
 
 int get_cpu_count();
 
+/* Reads the CPU's cycle counter. Cheap enough to call on every context switch. */
+uint64_t get_clock_cycles();
+
 /* The below classes may be used to create a generic callable object without
   boost::function so as to avoid the heap allocation that boost::functions use.
   Allocate a callable_action_wrapper_t (preferrably on the stack), then assign
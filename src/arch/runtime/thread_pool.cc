@@ -10,7 +10,9 @@
 #include "arch/barrier.hpp"
 #include "arch/io/timer_provider.hpp"
 #include "arch/runtime/event_queue.hpp"
+#include "arch/runtime/profiler.hpp"
 #include "arch/runtime/runtime.hpp"
+#include "arch/runtime/work_stealing.hpp"
 #include "errors.hpp"
 #include "logger.hpp"
 
@@ -61,8 +63,9 @@ struct thread_data_t {
 };
 
 void *linux_thread_pool_t::start_thread(void *arg) {
-    // Block all signals but `SIGSEGV` (will be unblocked by the event queue in
-    // case of poll).
+    // Block all signals but `SIGSEGV` and `SIGPROF` (will be unblocked by the
+    // event queue in case of poll). `SIGPROF` is for the sampling profiler,
+    // which has to interrupt whichever thread is using the CPU.
     {
         sigset_t sigmask;
         int res = sigfillset(&sigmask);
@@ -71,6 +74,9 @@ void *linux_thread_pool_t::start_thread(void *arg) {
         res = sigdelset(&sigmask, SIGSEGV);
         guarantee_err(res == 0, "Could not remove SIGSEGV from sigmask");
 
+        res = sigdelset(&sigmask, SIGPROF);
+        guarantee_err(res == 0, "Could not remove SIGPROF from sigmask");
+
         res = pthread_sigmask(SIG_SETMASK, &sigmask, NULL);
         guarantee_xerr(res == 0, res, "Could not block signal");
     }
@@ -81,6 +87,8 @@ void *linux_thread_pool_t::start_thread(void *arg) {
     linux_thread_pool_t::thread_pool = tdata->thread_pool;
     linux_thread_pool_t::thread_id = tdata->current_thread;
 
+    register_thread_for_profiling();
+
     // Use a separate block so that it's very clear how long the thread lives for
     // It's not really necessary, but I like it.
     {
@@ -355,6 +363,10 @@ linux_thread_t::linux_thread_t(linux_thread_pool_t *parent_pool, int thread_id)
     : queue(this),
       message_hub(&queue, parent_pool, thread_id),
       timer_handler(&queue),
+      stealable_work_size(0),
+      start_ticks(get_ticks()),
+      wait_ticks(0),
+      busy_poll_usec(0),
       do_shutdown(false)
 #ifndef NDEBUG
       , coroutine_counts_at_shutdown(NULL)
@@ -377,12 +389,44 @@ linux_thread_t::~linux_thread_t() {
     coro_runtime.get_coroutine_counts(coroutine_counts_at_shutdown);
 #endif
 
+    // Nothing can be stealing from us any more; see the second barrier in
+    // `start_thread()`.
+    for (size_t i = 0; i < stealable_work.size(); ++i) {
+        delete stealable_work[i];
+    }
+
     int res = pthread_mutex_destroy(&do_shutdown_mutex);
     guarantee_xerr(res == 0, res, "could not destroy do_shutdown_mutex");
 }
 
 void linux_thread_t::pump() {
-    message_hub.push_messages();
+    // Once we're out of messages, help threads that have a backlog of stealable
+    // work before going to sleep.
+    int steals = 0;
+    while (message_hub.pump() && steal_stealable_work()) {
+        if (++steals == MAX_STEALS_PER_PUMP) {
+            // Let the event queue look at file descriptors, then come back.
+            message_hub.pump();
+            message_hub.wake_up();
+            break;
+        }
+    }
+}
+
+void linux_thread_t::record_wait_time(uint64_t ticks) {
+    wait_ticks += ticks;
+}
+
+uint64_t linux_thread_t::busy_poll_ticks() {
+    return static_cast<uint64_t>(busy_poll_usec) * THOUSAND;
+}
+
+void linux_thread_t::set_busy_polling(bool busy_polling) {
+    message_hub.set_busy_polling(busy_polling);
+}
+
+bool linux_thread_t::has_pending_work() {
+    return message_hub.has_incoming_messages();
 }
 
 void linux_thread_t::on_event(int events) {
@@ -4,9 +4,13 @@
 
 #include <pthread.h>
 
+#include <deque>
 #include <map>
 #include <string>
 
+#include "errors.hpp"
+#include <boost/function.hpp>
+
 #include "config/args.hpp"
 #include "arch/runtime/event_queue.hpp"
 #include "arch/runtime/system_event.hpp"
@@ -14,6 +18,7 @@
 #include "arch/runtime/coroutines.hpp"
 #include "arch/io/blocker_pool.hpp"
 #include "arch/io/timer_provider.hpp"
+#include "arch/spinlock.hpp"
 #include "arch/timer.hpp"
 
 class linux_thread_t;
@@ -161,6 +166,10 @@ public:
 
     void pump();   // Called by the event queue
     bool should_shut_down();   // Called by the event queue
+    void record_wait_time(uint64_t ticks);   // Called by the event queue
+    uint64_t busy_poll_ticks();   // Called by the event queue
+    void set_busy_polling(bool busy_polling);   // Called by the event queue
+    bool has_pending_work();   // Called by the event queue
 #ifndef NDEBUG
     void initiate_shut_down(std::map<std::string, size_t> *coroutine_counts); // Can be called from any thread
 #else
@@ -168,6 +177,22 @@ public:
 #endif
     void on_event(int events);
 
+    /* Work passed to `spawn_stealable()` on this thread that hasn't started yet. We
+    take it from the front; idle threads steal it from the back. `stealable_work_size`
+    lets them see that there's nothing to steal without taking the lock. */
+    spinlock_t stealable_lock;
+    std::deque<boost::function<void()> *> stealable_work;
+    volatile int stealable_work_size;
+
+    /* When the thread started, and how long it has spent since then blocked in the
+    event queue with nothing to do. Only touched on this thread. */
+    ticks_t start_ticks;
+    ticks_t wait_ticks;
+
+    /* How long the event queue spins looking for events before it sleeps, in
+    microseconds; see `set_busy_poll_usec()`. Only touched on this thread. */
+    int busy_poll_usec;
+
 private:
     volatile bool do_shutdown;
     pthread_mutex_t do_shutdown_mutex;
@@ -0,0 +1,102 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "arch/runtime/work_stealing.hpp"
+
+#include <boost/bind.hpp>
+
+#include "arch/runtime/runtime.hpp"
+#include "arch/runtime/thread_pool.hpp"
+#include "perfmon/perfmon.hpp"
+
+static perfmon_counter_t pm_stolen_coroutines;
+static perfmon_multi_membership_t pm_work_stealing_membership(&get_global_perfmon_collection(),
+    &pm_stolen_coroutines, "stolen_coroutines",
+    NULLPTR);
+
+static void run_and_delete(boost::function<void()> *fun) {
+    (*fun)();
+    delete fun;
+}
+
+/* Takes the oldest piece of work off `thread`'s queue, or returns NULL if another
+thread got to it first. */
+static boost::function<void()> *pop_front(linux_thread_t *thread) {
+    spinlock_acq_t acq(&thread->stealable_lock);
+    if (thread->stealable_work.empty()) {
+        return NULL;
+    }
+    boost::function<void()> *fun = thread->stealable_work.front();
+    thread->stealable_work.pop_front();
+    --thread->stealable_work_size;
+    return fun;
+}
+
+static boost::function<void()> *pop_back(linux_thread_t *thread) {
+    spinlock_acq_t acq(&thread->stealable_lock);
+    if (thread->stealable_work.empty()) {
+        return NULL;
+    }
+    boost::function<void()> *fun = thread->stealable_work.back();
+    thread->stealable_work.pop_back();
+    --thread->stealable_work_size;
+    return fun;
+}
+
+/* One of these is posted to the spawning thread for every piece of work, so that
+if nobody steals it the spawning thread runs it itself. */
+class stealable_runner_t : public linux_thread_message_t {
+public:
+    void on_thread_switch() {
+        boost::function<void()> *fun = pop_front(linux_thread_pool_t::thread);
+        if (fun != NULL) {
+            coro_t::spawn_now_dangerously(boost::bind(&run_and_delete, fun));
+        }
+        delete this;
+    }
+};
+
+void spawn_stealable(const boost::function<void()> &fun) {
+    linux_thread_t *thread = linux_thread_pool_t::thread;
+    {
+        spinlock_acq_t acq(&thread->stealable_lock);
+        thread->stealable_work.push_back(new boost::function<void()>(fun));
+        ++thread->stealable_work_size;
+    }
+    call_later_on_this_thread(new stealable_runner_t);
+
+    // Make sure someone who could take it is awake.
+    linux_thread_pool_t *pool = linux_thread_pool_t::thread_pool;
+    for (int i = 1; i < pool->n_threads; ++i) {
+        linux_thread_t *other = pool->threads[(linux_thread_pool_t::thread_id + i) % pool->n_threads];
+        if (other != NULL && other->message_hub.is_sleeping()) {
+            other->message_hub.wake_up();
+            break;
+        }
+    }
+}
+
+static void run_and_notify(const boost::function<void()> &fun, coro_t *waiter) {
+    fun();
+    waiter->notify_sometime();
+}
+
+void run_stealable(const boost::function<void()> &fun) {
+    spawn_stealable(boost::bind(&run_and_notify, fun, coro_t::self()));
+    coro_t::wait();
+}
+
+bool steal_stealable_work() {
+    linux_thread_pool_t *pool = linux_thread_pool_t::thread_pool;
+    for (int i = 1; i < pool->n_threads; ++i) {
+        linux_thread_t *victim = pool->threads[(linux_thread_pool_t::thread_id + i) % pool->n_threads];
+        if (victim == NULL || victim->stealable_work_size == 0) {
+            continue;
+        }
+        boost::function<void()> *fun = pop_back(victim);
+        if (fun != NULL) {
+            ++pm_stolen_coroutines;
+            coro_t::spawn_now_dangerously(boost::bind(&run_and_delete, fun));
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,33 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#ifndef ARCH_RUNTIME_WORK_STEALING_HPP_
+#define ARCH_RUNTIME_WORK_STEALING_HPP_
+
+#include "errors.hpp"
+#include <boost/function.hpp>
+
+/* Normally a coroutine runs on the thread that spawned it until it moves itself
+with on_thread_t, because most of what it touches belongs to that thread. Some work
+doesn't care where it runs: it only looks at memory nobody else is using for the
+duration (decoding a buffer, say). Such work can be spawned as "stealable", which
+means it goes into a queue on the current thread, and a thread that runs out of
+things to do will take it and run it instead of going to sleep. That way one thread
+with a burst of CPU-heavy requests doesn't sit on them while the others are idle.
+
+Stealable work must not touch per-thread state (caches, perfmon counters other than
+through their thread-safe interfaces, anything with a home thread), must not assume
+which thread it's on, and must not throw. */
+
+/* Runs `fun` in a new coroutine, on this thread or any other one, some time after
+`spawn_stealable()` returns. */
+void spawn_stealable(const boost::function<void()> &fun);
+
+/* Runs `fun` as stealable work and waits for it to finish. Must be called from a
+coroutine. */
+void run_stealable(const boost::function<void()> &fun);
+
+/* Takes one piece of stealable work from another thread and starts it here. Returns
+false if there wasn't any. Called by the thread pool when the current thread is
+idle. */
+bool steal_stealable_work();
+
+#endif  // ARCH_RUNTIME_WORK_STEALING_HPP_
@@ -55,3 +55,30 @@ progress_completion_fraction_t traversal_progress_combiner_t::guess_completion()
 
     return progress_completion_fraction_t(released, total);
 }
+
+void traversal_progress_combiner_t::add_bytes_sent(int64_t bytes) {
+    assert_thread();
+    rassert(bytes >= 0);
+    bytes_sent += bytes;
+}
+
+int64_t traversal_progress_combiner_t::get_bytes_sent() const {
+    assert_thread();
+    return bytes_sent;
+}
+
+double traversal_progress_combiner_t::guess_bytes_per_sec() const {
+    assert_thread();
+    double secs = ticks_to_secs(get_ticks() - start_ticks);
+    return secs > 0 ? bytes_sent / secs : 0;
+}
+
+double traversal_progress_combiner_t::guess_secs_remaining(const progress_completion_fraction_t &fraction) const {
+    assert_thread();
+    if (fraction.invalid() || fraction.estimate_of_released_nodes == 0) {
+        return -1;
+    }
+    double secs = ticks_to_secs(get_ticks() - start_ticks);
+    int unreleased = fraction.estimate_of_total_nodes - fraction.estimate_of_released_nodes;
+    return secs * unreleased / fraction.estimate_of_released_nodes;
+}
@@ -44,14 +44,27 @@ private:
 
 class traversal_progress_combiner_t : public traversal_progress_t {
 public:
-    explicit traversal_progress_combiner_t(int specified_home_thread) : traversal_progress_t(specified_home_thread), is_destructing(false) { }
-    traversal_progress_combiner_t() : is_destructing(false) { }
+    explicit traversal_progress_combiner_t(int specified_home_thread)
+        : traversal_progress_t(specified_home_thread), is_destructing(false), bytes_sent(0), start_ticks(get_ticks()) { }
+    traversal_progress_combiner_t() : is_destructing(false), bytes_sent(0), start_ticks(get_ticks()) { }
     ~traversal_progress_combiner_t();
 
     // The constituent is welcome to have a different home thread.
     void add_constituent(scoped_ptr_t<traversal_progress_t> *constituent);
     progress_completion_fraction_t guess_completion() const;
 
+    // The backfiller calls this for every chunk it sends, so that progress can
+    // also be reported as a transfer rate and an ETA.
+    void add_bytes_sent(int64_t bytes);
+    int64_t get_bytes_sent() const;
+
+    // The average rate since this object was created.
+    double guess_bytes_per_sec() const;
+
+    // Extrapolates from the time taken so far and `fraction`, which should
+    // have come from `guess_completion()`. Returns -1 if that's not possible.
+    double guess_secs_remaining(const progress_completion_fraction_t &fraction) const;
+
 private:
     // Used in a pmap by the destructor.
     void destroy_constituent(int i);
@@ -65,6 +78,9 @@ private:
 
     bool is_destructing;
 
+    int64_t bytes_sent;
+    ticks_t start_ticks;
+
     DISABLE_COPYING(traversal_progress_combiner_t);
 };
 
@@ -2,6 +2,7 @@
 #include "btree/backfill.hpp"
 
 #include <algorithm>
+#include <vector>
 
 #include "errors.hpp"
 #include <boost/bind.hpp>
@@ -21,12 +22,7 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
         rassert(*population_change_out == 0);
         const leaf_node_t *data = reinterpret_cast<const leaf_node_t *>(leaf_node_buf->get_data_read());
 
-        key_range_t clipped_range(
-            left_exclusive_or_null ? key_range_t::open : key_range_t::none,
-            left_exclusive_or_null ? store_key_t(left_exclusive_or_null) : store_key_t(),
-            right_inclusive_or_null ? key_range_t::closed : key_range_t::none,
-            right_inclusive_or_null ? store_key_t(right_inclusive_or_null) : store_key_t());
-        clipped_range = clipped_range.intersection(key_range_);
+        key_range_t clipped_range = clip_to_key_range(left_exclusive_or_null, right_inclusive_or_null);
 
         struct : public leaf::entry_reception_callback_t {
             void lost_deletions() {
@@ -56,6 +52,10 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
         x.interruptor = interruptor;
 
         leaf::dump_entries_since_time(sizer_, data, since_when_, leaf_node_buf->get_recency(), &x);
+
+        if (!clipped_range.is_empty()) {
+            callback_->on_range_done(clipped_range, interruptor);
+        }
     }
 
     void postprocess_internal_node(UNUSED buf_lock_t *internal_node_buf) {
@@ -71,6 +71,7 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
         scoped_array_t<block_id_t> block_ids;
         scoped_array_t<repli_timestamp_t> recencies;
         repli_timestamp_t since_when;
+        std::vector<int> *skipped_out;
         cond_t *done_cond;
 
         void got_subtree_recencies() {
@@ -81,8 +82,12 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
             rassert(coro_t::self());
 
             for (int i = 0, e = block_ids.size(); i < e; ++i) {
-                if (block_ids[i] != NULL_BLOCK_ID && recencies[i] >= since_when) {
-                    cb->receive_interesting_child(i);
+                if (block_ids[i] != NULL_BLOCK_ID) {
+                    if (recencies[i] >= since_when) {
+                        cb->receive_interesting_child(i);
+                    } else {
+                        skipped_out->push_back(i);
+                    }
                 }
             }
 
@@ -99,12 +104,14 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
         annoying_t *fsm = new annoying_t;
         int num_block_ids = ids_source->num_block_ids();
         fsm->block_ids.init(num_block_ids);
+        std::vector<key_range_t> child_ranges(num_block_ids);
         for (int i = 0; i < num_block_ids; ++i) {
             const btree_key_t *left, *right;
             block_id_t id;
             ids_source->get_block_id_and_bounding_interval(i, &id, &left, &right);
             if (overlaps(left, right, key_range_.left, key_range_.right)) {
                 fsm->block_ids[i] = id;
+                child_ranges[i] = clip_to_key_range(left, right);
             } else {
                 fsm->block_ids[i] = NULL_BLOCK_ID;
             }
@@ -114,10 +121,32 @@ struct backfill_traversal_helper_t : public btree_traversal_helper_t, public hom
         fsm->cb = cb;
         fsm->since_when = since_when_;
         fsm->recencies.init(num_block_ids);
+        std::vector<int> skipped;
+        fsm->skipped_out = &skipped;
         fsm->done_cond = &done_cond;
 
         txn->get_subtree_recencies(fsm->block_ids.data(), num_block_ids, fsm->recencies.data(), fsm);
         done_cond.wait();
+
+        // Subtrees that haven't changed since `since_when_` have nothing to
+        // send, so they're done already.
+        cond_t non_interruptor;
+        for (std::vector<int>::iterator it = skipped.begin(); it != skipped.end(); ++it) {
+            if (!child_ranges[*it].is_empty()) {
+                callback_->on_range_done(child_ranges[*it], &non_interruptor);
+            }
+        }
+    }
+
+    // The part of `key_range_` in the interval (left_exclusive, right_inclusive],
+    // where NULL means unbounded.
+    key_range_t clip_to_key_range(const btree_key_t *left_exclusive_or_null, const btree_key_t *right_inclusive_or_null) const {
+        key_range_t range(
+            left_exclusive_or_null ? key_range_t::open : key_range_t::none,
+            left_exclusive_or_null ? store_key_t(left_exclusive_or_null) : store_key_t(),
+            right_inclusive_or_null ? key_range_t::closed : key_range_t::none,
+            right_inclusive_or_null ? store_key_t(right_inclusive_or_null) : store_key_t());
+        return range.intersection(key_range_);
     }
 
     // Checks if (x_left, x_right] intersects [y_left, y_right).  If
@@ -20,6 +20,10 @@ public:
     virtual void on_delete_range(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_deletion(const btree_key_t *key, repli_timestamp_t recency, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_pair(transaction_t *txn, repli_timestamp_t recency, const btree_key_t *key, const void *value, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
+    /* Called once everything in `range` has been passed to the other methods.
+    The ranges passed here never overlap; by the end of the backfill they
+    cover the whole key range. */
+    virtual void on_range_done(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual ~agnostic_backfill_callback_t() { }
 };
 
@@ -1,6 +1,7 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "btree/btree_store.hpp"
 
+#include "arch/runtime/coroutines.hpp"
 #include "btree/operations.hpp"
 #include "serializer/config.hpp"
 #include "containers/archive/vector_stream.hpp"
@@ -75,8 +76,11 @@ void btree_store_t<protocol_t>::read(
     scoped_ptr_t<transaction_t> txn;
     scoped_ptr_t<real_superblock_t> superblock;
 
+    ticks_t start = get_ticks();
+    ticks_t io_wait_start = coro_t::io_wait_ticks();
     acquire_superblock_for_read(rwi_read, token, &txn, &superblock, interruptor,
                                 read.use_snapshot());
+    ticks_t superblock_acquired = get_ticks();
 
     check_metainfo(DEBUG_ONLY(metainfo_checker, ) txn.get(), superblock.get());
 
@@ -85,6 +89,9 @@ void btree_store_t<protocol_t>::read(
     superblock2.init(superblock.release());
 
     protocol_read(read, response, btree.get(), txn.get(), superblock2.get(), interruptor);
+
+    btree->stats.hot_keys.record_op(false, read.get_region().inner, start, superblock_acquired,
+                                    get_ticks(), coro_t::io_wait_ticks() - io_wait_start);
 }
 
 template <class protocol_t>
@@ -103,10 +110,16 @@ void btree_store_t<protocol_t>::write(
     scoped_ptr_t<transaction_t> txn;
     scoped_ptr_t<real_superblock_t> superblock;
     const int expected_change_count = 2; // FIXME: this is incorrect, but will do for now
+    ticks_t start = get_ticks();
+    ticks_t io_wait_start = coro_t::io_wait_ticks();
     acquire_superblock_for_write(rwi_write, timestamp.to_repli_timestamp(), expected_change_count, token, &txn, &superblock, interruptor);
+    ticks_t superblock_acquired = get_ticks();
 
     check_and_update_metainfo(DEBUG_ONLY(metainfo_checker, ) new_metainfo, txn.get(), superblock.get());
     protocol_write(write, response, timestamp, btree.get(), txn.get(), superblock.get(), interruptor);
+
+    btree->stats.hot_keys.record_op(true, write.get_region().inner, start, superblock_acquired,
+                                    get_ticks(), coro_t::io_wait_ticks() - io_wait_start);
 }
 
 // TODO: Figure out wtf does the backfill filtering, figure out wtf constricts delete range operations to hit only a certain hash-interval, figure out what filters keys.
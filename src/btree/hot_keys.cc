@@ -0,0 +1,148 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "btree/hot_keys.hpp"
+
+#include <algorithm>
+
+/* 64-bit FNV-1a. The sketch's rows use `h1 + i * h2`, where `h1` and `h2` are
+the two halves of the hash, which is as good as `depth` independent hashes for
+a count-min sketch. */
+static uint64_t hash_key(const uint8_t *key, int size) {
+    uint64_t h = 14695981039346656037ULL;
+    for (int i = 0; i < size; ++i) {
+        h ^= key[i];
+        h *= 1099511628211ULL;
+    }
+    // FNV's low bits are poorly mixed, and we take the hash modulo a power of two.
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+top_keys_t::top_keys_t() : until_decay(HOT_KEYS_DECAY_INTERVAL), min_count(0) {
+    memset(sketch, 0, sizeof(sketch));
+    candidates.reserve(HOT_KEYS_TRACKED);
+}
+
+void top_keys_t::record(const uint8_t *key, int size) {
+    if (--until_decay == 0) {
+        decay();
+    }
+
+    uint64_t h = hash_key(key, size);
+    uint32_t h1 = h, h2 = (h >> 32) | 1;
+    uint32_t estimate = UINT32_MAX;
+    for (int i = 0; i < depth; ++i) {
+        uint32_t *counter = &sketch[i][(h1 + i * h2) % width];
+        if (*counter != UINT32_MAX) {
+            ++*counter;
+        }
+        estimate = std::min(estimate, *counter);
+    }
+
+    if (estimate < min_count) {
+        return;
+    }
+
+    size_t least = 0;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (sized_strcmp(candidates[i].key.contents(), candidates[i].key.size(), key, size) == 0) {
+            candidates[i].count = estimate;
+            return;
+        }
+        if (candidates[i].count < candidates[least].count) {
+            least = i;
+        }
+    }
+
+    if (candidates.size() < HOT_KEYS_TRACKED) {
+        candidate_t c;
+        c.key.assign(size, key);
+        c.count = estimate;
+        candidates.push_back(c);
+        if (candidates.size() < HOT_KEYS_TRACKED) {
+            return;
+        }
+    } else if (estimate > candidates[least].count) {
+        candidates[least].key.assign(size, key);
+        candidates[least].count = estimate;
+    } else {
+        return;
+    }
+
+    min_count = UINT32_MAX;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        min_count = std::min(min_count, candidates[i].count);
+    }
+}
+
+void top_keys_t::decay() {
+    for (int i = 0; i < depth; ++i) {
+        for (int j = 0; j < width; ++j) {
+            sketch[i][j] /= 2;
+        }
+    }
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        candidates[i].count /= 2;
+    }
+    min_count /= 2;
+    until_decay = HOT_KEYS_DECAY_INTERVAL;
+}
+
+static bool more_frequent(const hot_key_t &a, const hot_key_t &b) {
+    return a.count > b.count;
+}
+
+void top_keys_t::get_top(size_t limit, std::vector<hot_key_t> *out) const {
+    out->clear();
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (candidates[i].count > 0) {
+            hot_key_t hot;
+            hot.key = candidates[i].key;
+            hot.count = candidates[i].count;
+            out->push_back(hot);
+        }
+    }
+    std::sort(out->begin(), out->end(), &more_frequent);
+    if (out->size() > limit) {
+        out->resize(limit);
+    }
+}
+
+void hot_key_tracker_t::record_read(const btree_key_t *key) {
+    read_keys.record(key->contents, key->size);
+    read_prefixes.record(key->contents, std::min<int>(key->size, HOT_KEY_PREFIX_BYTES));
+}
+
+void hot_key_tracker_t::record_write(const btree_key_t *key) {
+    write_keys.record(key->contents, key->size);
+    write_prefixes.record(key->contents, std::min<int>(key->size, HOT_KEY_PREFIX_BYTES));
+}
+
+void hot_key_tracker_t::record_op(bool is_write, const key_range_t &range, ticks_t start,
+                                  ticks_t superblock_acquired, ticks_t end, ticks_t io_wait) {
+    if (end - start < secs_to_ticks(BTREE_SLOW_OP_MS) / 1000) {
+        return;
+    }
+
+    slow_op_t op;
+    op.is_write = is_write;
+    op.range = range;
+    op.finished = current_microtime();
+    op.duration = ticks_to_secs(end - start);
+    op.lock_wait = ticks_to_secs(superblock_acquired - start);
+    op.io = ticks_to_secs(io_wait);
+
+    slow_ops.push_back(op);
+    if (slow_ops.size() > SLOW_OP_LOG_SIZE) {
+        slow_ops.pop_front();
+    }
+}
+
+void hot_key_tracker_t::get_report(size_t limit, hot_keys_report_t *out) const {
+    read_keys.get_top(limit, &out->read_keys);
+    write_keys.get_top(limit, &out->write_keys);
+    read_prefixes.get_top(limit, &out->read_prefixes);
+    write_prefixes.get_top(limit, &out->write_prefixes);
+    out->slow_ops.assign(slow_ops.begin(), slow_ops.end());
+}
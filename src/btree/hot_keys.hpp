@@ -0,0 +1,112 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#ifndef BTREE_HOT_KEYS_HPP_
+#define BTREE_HOT_KEYS_HPP_
+
+#include <deque>
+#include <vector>
+
+#include "btree/keys.hpp"
+#include "config/args.hpp"
+#include "rpc/serialize_macros.hpp"
+#include "utils.hpp"
+
+struct hot_key_t {
+    store_key_t key;
+    /* Roughly how many times it was accessed, with older accesses counting for
+    less; only meaningful relative to the other hot keys. */
+    uint64_t count;
+
+    RDB_MAKE_ME_SERIALIZABLE_2(key, count);
+};
+
+struct slow_op_t {
+    bool is_write;
+    /* A single key for point operations. */
+    key_range_t range;
+    /* When the operation finished, from `current_microtime()`. */
+    microtime_t finished;
+    /* All in seconds. `lock_wait` is the time spent waiting for earlier
+    operations to let go of the btree's superblock, and `io` is the time spent
+    waiting for blocks to come off disk. */
+    double duration;
+    double lock_wait;
+    double io;
+
+    RDB_MAKE_ME_SERIALIZABLE_6(is_write, range, finished, duration, lock_wait, io);
+};
+
+/* What a `hot_key_tracker_t` has seen. */
+struct hot_keys_report_t {
+    std::vector<hot_key_t> read_keys;
+    std::vector<hot_key_t> write_keys;
+    std::vector<hot_key_t> read_prefixes;
+    std::vector<hot_key_t> write_prefixes;
+    /* Oldest first. */
+    std::vector<slow_op_t> slow_ops;
+
+    RDB_MAKE_ME_SERIALIZABLE_5(read_keys, write_keys, read_prefixes, write_prefixes, slow_ops);
+};
+
+/* `top_keys_t` keeps an approximate list of the `HOT_KEYS_TRACKED` keys it has
+been shown most often, in constant space. Every key is counted in a count-min
+sketch, which may overestimate but never underestimates how often a key was
+seen; a key whose estimate beats the least frequent key on the list takes its
+place. Counts are halved every `HOT_KEYS_DECAY_INTERVAL` keys, so that keys that
+stop being hot eventually drop off the list. */
+class top_keys_t {
+public:
+    top_keys_t();
+
+    void record(const uint8_t *key, int size);
+
+    /* Most frequent first. */
+    void get_top(size_t limit, std::vector<hot_key_t> *out) const;
+
+private:
+    static const int width = 512;
+    static const int depth = 4;
+
+    void decay();
+
+    uint32_t sketch[depth][width];
+    int until_decay;
+
+    struct candidate_t {
+        store_key_t key;
+        uint32_t count;
+    };
+    std::vector<candidate_t> candidates;
+    /* The smallest count in `candidates`, or 0 if it isn't full yet. A key
+    whose estimate is below this can't be on the list, so we don't look. */
+    uint32_t min_count;
+
+    DISABLE_COPYING(top_keys_t);
+};
+
+/* Each `btree_slice_t` has a `hot_key_tracker_t` (in its `btree_stats_t`) that
+remembers which keys and key prefixes are read and written most, and the most
+recent operations that took at least `BTREE_SLOW_OP_MS` milliseconds, so that we
+can find out what is keeping the slice's thread busy. It must only be used on
+the slice's home thread. */
+class hot_key_tracker_t {
+public:
+    hot_key_tracker_t() { }
+
+    void record_read(const btree_key_t *key);
+    void record_write(const btree_key_t *key);
+
+    /* `start`, `superblock_acquired` and `end` are `get_ticks()` values;
+    `io_wait` is in ticks. Does nothing unless the operation was slow. */
+    void record_op(bool is_write, const key_range_t &range, ticks_t start,
+                   ticks_t superblock_acquired, ticks_t end, ticks_t io_wait);
+
+    void get_report(size_t limit, hot_keys_report_t *out) const;
+
+private:
+    top_keys_t read_keys, write_keys, read_prefixes, write_prefixes;
+    std::deque<slow_op_t> slow_ops;
+
+    DISABLE_COPYING(hot_key_tracker_t);
+};
+
+#endif  // BTREE_HOT_KEYS_HPP_
@@ -21,6 +21,8 @@
 
 template <class Value>
 void find_keyvalue_location_for_write(transaction_t *txn, superblock_t *superblock, const btree_key_t *key, keyvalue_location_t<Value> *keyvalue_location_out, eviction_priority_t *root_eviction_priority, btree_stats_t *stats) {
+    block_pm_duration traversal_timer(&stats->pm_write_traversals);
+    stats->hot_keys.record_write(key);
     value_sizer_t<Value> sizer(txn->get_cache()->get_block_size());
 
     keyvalue_location_out->superblock = superblock;
@@ -83,6 +85,8 @@ void find_keyvalue_location_for_write(transaction_t *txn, superblock_t *superblo
 template <class Value>
 void find_keyvalue_location_for_read(transaction_t *txn, superblock_t *superblock, const btree_key_t *key, keyvalue_location_t<Value> *keyvalue_location_out, eviction_priority_t root_eviction_priority, btree_stats_t *stats) {
     stats->pm_keys_read.record();
+    stats->hot_keys.record_read(key);
+    block_pm_duration traversal_timer(&stats->pm_read_traversals);
     value_sizer_t<Value> sizer(txn->get_cache()->get_block_size());
 
     block_id_t node_id = superblock->get_root_block_id();
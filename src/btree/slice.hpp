@@ -2,6 +2,7 @@
 #ifndef BTREE_SLICE_HPP_
 #define BTREE_SLICE_HPP_
 
+#include "btree/hot_keys.hpp"
 #include "buffer_cache/types.hpp"
 #include "concurrency/fifo_checker.hpp"
 #include "containers/scoped.hpp"
@@ -24,6 +25,12 @@ public:
               &pm_keys_read, "keys_read",
               &pm_keys_set, "keys_set",
               &pm_keys_expired, "keys_expired",
+              NULLPTR),
+          pm_read_traversals(secs_to_ticks(1)),
+          pm_write_traversals(secs_to_ticks(1)),
+          pm_traversals_membership(&btree_collection,
+              &pm_read_traversals, "read_traversals",
+              &pm_write_traversals, "write_traversals",
               NULLPTR)
     { }
 
@@ -34,6 +41,15 @@ public:
         pm_keys_set,
         pm_keys_expired;
     perfmon_multi_membership_t pm_keys_membership;
+    /* How long it takes to find a key's leaf, including waiting for blocks to
+    come off disk. */
+    perfmon_duration_sampler_t
+        pm_read_traversals,
+        pm_write_traversals;
+    perfmon_multi_membership_t pm_traversals_membership;
+    /* Which keys are read and written most, and which operations were slow;
+    served by `hot_keys_app_t`. */
+    hot_key_tracker_t hot_keys;
 };
 
 /* btree_slice_t is a thin wrapper around cache_t that handles initializing the buffer
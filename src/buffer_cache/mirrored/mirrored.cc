@@ -7,6 +7,7 @@
 
 #include "arch/arch.hpp"
 #include "do_on_thread.hpp"
+#include "perfmon/trace.hpp"
 #include "serializer/serializer.hpp"
 
 /**
@@ -520,6 +521,12 @@ mc_buf_lock_t::mc_buf_lock_t(mc_transaction_t *transaction,
     // unloaded), or else inner_buf could be selected for deletion from the cache, then recreated,
     // and we'd have two inner_bufs corresponding to the same block id floating around.
 
+    // If the block isn't in memory, the time it takes to come off disk shows up in
+    // the current query's trace, if there is one, and in the coroutine's IO wait.
+    const bool cache_miss = !inner_buf || !inner_buf->data.has();
+    traced_span_t cache_miss_span("cache miss", cache_miss);
+    ticks_t miss_start = cache_miss ? get_ticks() : 0;
+
     if (!inner_buf) {
         /* The buf isn't in the cache and must be loaded from disk */
         // We are either not snapshotted or our snapshot is consistent with the latest version;
@@ -547,6 +554,10 @@ mc_buf_lock_t::mc_buf_lock_t(mc_transaction_t *transaction,
 
     initialize(transaction->snapshot_version, transaction->get_io_account(), call_when_in_line);
 
+    if (cache_miss) {
+        coro_t::add_io_wait_ticks(get_ticks() - miss_start);
+    }
+
     if (is_write_mode(mode)) {
         touch_recency(transaction->recency_timestamp);
     }
@@ -46,5 +46,5 @@ http_res_t combining_http_app_t::handle(const http_req_t &req) {
         json.AddItemToObject(it->first.c_str(), child_json.release());
     }
 
-    return http_json_res(json.get());
+    return http_json_res(&json);
 }
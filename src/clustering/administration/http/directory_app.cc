@@ -81,14 +81,14 @@ http_res_t directory_http_app_t::handle(const http_req_t &req) {
                 std::string machine_id = uuid_to_str(metadata.machine_id);
                 body.AddItemToObject(machine_id.c_str(), get_metadata_json(&metadata, it, req.resource.end()));
             }
-            return http_json_res(body.get());
+            return http_cacheable_json_res(req, &body);
         } else {
             for (std::map<peer_id_t, cluster_directory_metadata_t>::const_iterator i = md.begin(); i != md.end(); ++i) {
                 cluster_directory_metadata_t metadata = i->second;
                 std::string machine_id = uuid_to_str(metadata.machine_id);
                 if (*requested_machine_id == machine_id) {
                     scoped_cJSON_t machine_json = scoped_cJSON_t(get_metadata_json(&metadata, it, req.resource.end()));
-                    return http_json_res(machine_json.get());
+                    return http_cacheable_json_res(req, &machine_json);
                 }
             }
             return http_error_res("Machine not found", HTTP_NOT_FOUND);
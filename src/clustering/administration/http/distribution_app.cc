@@ -68,7 +68,7 @@ http_res_t distribution_app_t::handle(const http_req_t &req) {
                                                         &interrupt);
 
             scoped_cJSON_t data(render_as_json(&boost::get<distribution_result_t>(db_res.result).key_counts));
-            return http_json_res(data.get());
+            return http_json_res(&data);
         } catch (cannot_perform_query_exc_t &) {
             return http_res_t(HTTP_INTERNAL_SERVER_ERROR);
         }
@@ -85,7 +85,7 @@ http_res_t distribution_app_t::handle(const http_req_t &req) {
                                                             &interrupt);
 
             scoped_cJSON_t data(render_as_json(&boost::get<rdb_protocol_t::distribution_read_response_t>(db_res.response).key_counts));
-            return http_json_res(data.get());
+            return http_json_res(&data);
         } catch (cannot_perform_query_exc_t &) {
             return http_res_t(HTTP_INTERNAL_SERVER_ERROR);
         }
@@ -0,0 +1,130 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "clustering/administration/http/hot_keys_app.hpp"
+
+#include "errors.hpp"
+#include <boost/variant.hpp>
+
+#include "btree/hot_keys.hpp"
+#include "containers/uuid.hpp"
+#include "memcached/protocol.hpp"
+#include "memcached/protocol_json_adapter.hpp"
+#include "rdb_protocol/protocol.hpp"
+#include "stl_utils.hpp"
+
+#define DEFAULT_LIMIT 10
+
+hot_keys_app_t::hot_keys_app_t(boost::shared_ptr<semilattice_read_view_t<cow_ptr_t<namespaces_semilattice_metadata_t<memcached_protocol_t> > > > _namespaces_sl_metadata,
+                               namespace_repo_t<memcached_protocol_t> *_ns_repo,
+                               boost::shared_ptr<semilattice_read_view_t<cow_ptr_t<namespaces_semilattice_metadata_t<rdb_protocol_t> > > > _rdb_namespaces_sl_metadata,
+                               namespace_repo_t<rdb_protocol_t> *_rdb_ns_repo)
+    : namespaces_sl_metadata(_namespaces_sl_metadata),
+      ns_repo(_ns_repo),
+      rdb_namespaces_sl_metadata(_rdb_namespaces_sl_metadata),
+      rdb_ns_repo(_rdb_ns_repo)
+{ }
+
+static cJSON *render_hot_keys(const std::vector<hot_key_t> &keys) {
+    scoped_cJSON_t res(cJSON_CreateArray());
+    for (std::vector<hot_key_t>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        store_key_t key = it->key;
+        scoped_cJSON_t entry(cJSON_CreateObject());
+        entry.AddItemToObject("key", render_as_json(&key));
+        entry.AddItemToObject("count", cJSON_CreateNumber(it->count));
+        res.AddItemToArray(entry.release());
+    }
+    return res.release();
+}
+
+static cJSON *render_slow_ops(const std::vector<slow_op_t> &ops) {
+    scoped_cJSON_t res(cJSON_CreateArray());
+    for (std::vector<slow_op_t>::const_iterator it = ops.begin(); it != ops.end(); ++it) {
+        key_range_t range = it->range;
+        scoped_cJSON_t entry(cJSON_CreateObject());
+        entry.AddItemToObject("type", cJSON_CreateString(it->is_write ? "write" : "read"));
+        if (range == key_range_t(key_range_t::closed, range.left, key_range_t::closed, range.left)) {
+            entry.AddItemToObject("key", render_as_json(&range.left));
+        } else {
+            entry.AddItemToObject("range", render_as_json(&range));
+        }
+        entry.AddItemToObject("finished", cJSON_CreateNumber(it->finished / 1e6));
+        entry.AddItemToObject("duration", cJSON_CreateNumber(it->duration));
+        entry.AddItemToObject("lock_wait", cJSON_CreateNumber(it->lock_wait));
+        entry.AddItemToObject("io", cJSON_CreateNumber(it->io));
+        res.AddItemToArray(entry.release());
+    }
+    return res.release();
+}
+
+static http_res_t render_reports(const std::vector<std::pair<hash_region_t<key_range_t>, hot_keys_report_t> > &reports) {
+    scoped_cJSON_t body(cJSON_CreateObject());
+    for (size_t i = 0; i < reports.size(); ++i) {
+        hash_region_t<key_range_t> region = reports[i].first;
+        const hot_keys_report_t &report = reports[i].second;
+        scoped_cJSON_t entry(cJSON_CreateObject());
+        entry.AddItemToObject("reads", render_hot_keys(report.read_keys));
+        entry.AddItemToObject("writes", render_hot_keys(report.write_keys));
+        entry.AddItemToObject("read_prefixes", render_hot_keys(report.read_prefixes));
+        entry.AddItemToObject("write_prefixes", render_hot_keys(report.write_prefixes));
+        entry.AddItemToObject("slow_ops", render_slow_ops(report.slow_ops));
+        body.AddItemToObject(render_region_as_string(&region).c_str(), entry.release());
+    }
+    return http_json_res(body.get());
+}
+
+http_res_t hot_keys_app_t::handle(const http_req_t &req) {
+    if (req.method != GET) {
+        return http_res_t(HTTP_METHOD_NOT_ALLOWED);
+    }
+
+    boost::optional<std::string> maybe_n_id = req.find_query_param("namespace");
+
+    if (!maybe_n_id || !is_uuid(*maybe_n_id)) {
+        return http_error_res("Valid uuid required for query parameter \"namespace\"\n");
+    }
+    namespace_id_t n_id = str_to_uuid(*maybe_n_id);
+
+    uint64_t limit = DEFAULT_LIMIT;
+    boost::optional<std::string> maybe_limit = req.find_query_param("limit");
+
+    if (maybe_limit) {
+        if (!strtou64_strict(maybe_limit.get(), 10, &limit) || limit == 0 || limit > HOT_KEYS_TRACKED) {
+            return http_error_res(strprintf("Invalid limit value; must be between 1 and %d.", HOT_KEYS_TRACKED));
+        }
+    }
+
+    cow_ptr_t<namespaces_semilattice_metadata_t<memcached_protocol_t> > ns_snapshot = namespaces_sl_metadata->get();
+    cow_ptr_t<namespaces_semilattice_metadata_t<rdb_protocol_t> > rdb_ns_snapshot = rdb_namespaces_sl_metadata->get();
+
+    /* These are regular reads rather than outdated ones, so that the answers
+    come from the primaries, which serve the namespace's up-to-date reads. */
+    if (std_contains(ns_snapshot->namespaces, n_id)) {
+        try {
+            cond_t interrupt;
+            namespace_repo_t<memcached_protocol_t>::access_t ns_access(ns_repo, n_id, &interrupt);
+
+            memcached_protocol_t::read_t read(hot_keys_query_t(limit), time(NULL));
+            memcached_protocol_t::read_response_t db_res;
+            ns_access.get_namespace_if()->read(read, &db_res, order_token_t::ignore, &interrupt);
+
+            return render_reports(boost::get<hot_keys_result_t>(db_res.result).reports);
+        } catch (cannot_perform_query_exc_t &) {
+            return http_res_t(HTTP_INTERNAL_SERVER_ERROR);
+        }
+    } else if (std_contains(rdb_ns_snapshot->namespaces, n_id)) {
+        try {
+            cond_t interrupt;
+            namespace_repo_t<rdb_protocol_t>::access_t rdb_ns_access(rdb_ns_repo, n_id, &interrupt);
+
+            rdb_protocol_t::hot_keys_read_t inner_read(limit);
+            rdb_protocol_t::read_t read(inner_read);
+            rdb_protocol_t::read_response_t db_res;
+            rdb_ns_access.get_namespace_if()->read(read, &db_res, order_token_t::ignore, &interrupt);
+
+            return render_reports(boost::get<rdb_protocol_t::hot_keys_read_response_t>(db_res.response).reports);
+        } catch (cannot_perform_query_exc_t &) {
+            return http_res_t(HTTP_INTERNAL_SERVER_ERROR);
+        }
+    } else {
+        return http_res_t(HTTP_NOT_FOUND);
+    }
+}
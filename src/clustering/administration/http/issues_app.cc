@@ -26,5 +26,5 @@ http_res_t issues_http_app_t::handle(const http_req_t &req) {
     scoped_cJSON_t json(NULL);
     get_root(&json);
 
-    return http_json_res(json.get());
+    return http_json_res(&json);
 }
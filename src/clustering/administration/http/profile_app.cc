@@ -0,0 +1,111 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "clustering/administration/http/profile_app.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/profiler.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/pmap.hpp"
+#include "http/json.hpp"
+
+#define DEFAULT_DURATION_MS 1000
+#define MAX_DURATION_MS (60 * 1000)
+#define DEFAULT_FREQUENCY 100
+#define MAX_FREQUENCY 10000
+
+int get_num_threads();
+
+static void get_thread_coroutine_cycles(int thread, std::vector<std::map<std::string, uint64_t> > *cycles) {
+    on_thread_t thread_switcher(thread);
+    get_coroutine_cycles(&(*cycles)[thread]);
+}
+
+static std::map<std::string, uint64_t> get_all_coroutine_cycles() {
+    std::vector<std::map<std::string, uint64_t> > per_thread(get_num_threads());
+    pmap(get_num_threads(), boost::bind(&get_thread_coroutine_cycles, _1, &per_thread));
+
+    std::map<std::string, uint64_t> total;
+    for (size_t i = 0; i < per_thread.size(); ++i) {
+        for (std::map<std::string, uint64_t>::iterator it = per_thread[i].begin(); it != per_thread[i].end(); ++it) {
+            total[it->first] += it->second;
+        }
+    }
+    return total;
+}
+
+profile_app_t::profile_app_t() { }
+
+void profile_app_t::stop() {
+    stopping.pulse_if_not_already_pulsed();
+}
+
+http_res_t profile_app_t::handle(const http_req_t &req) {
+    if (req.method != GET) {
+        return http_res_t(HTTP_METHOD_NOT_ALLOWED);
+    }
+
+    uint64_t duration = DEFAULT_DURATION_MS;
+    boost::optional<std::string> maybe_duration = req.find_query_param("duration");
+    if (maybe_duration) {
+        if (!strtou64_strict(maybe_duration.get(), 10, &duration) || duration == 0 || duration > MAX_DURATION_MS) {
+            return http_error_res("Invalid duration value.");
+        }
+    }
+
+    uint64_t frequency = DEFAULT_FREQUENCY;
+    boost::optional<std::string> maybe_frequency = req.find_query_param("frequency");
+    if (maybe_frequency) {
+        if (!strtou64_strict(maybe_frequency.get(), 10, &frequency) || frequency == 0 || frequency > MAX_FREQUENCY) {
+            return http_error_res("Invalid frequency value.");
+        }
+    }
+
+    if (stopping.is_pulsed()) {
+        return http_error_res("The server is shutting down.", HTTP_INTERNAL_SERVER_ERROR);
+    }
+    if (!start_sampling_profiler(static_cast<int>(frequency))) {
+        return http_error_res("A profile is already being taken on this machine.");
+    }
+    std::map<std::string, uint64_t> cycles_before = get_all_coroutine_cycles();
+    try {
+        nap(duration, &stopping);
+    } catch (const interrupted_exc_t &) {
+        std::vector<sampled_stack_t> discarded;
+        stop_sampling_profiler(&discarded);
+        return http_error_res("The server is shutting down.", HTTP_INTERNAL_SERVER_ERROR);
+    }
+    std::map<std::string, uint64_t> cycles_after = get_all_coroutine_cycles();
+    std::vector<sampled_stack_t> stacks;
+    size_t dropped = stop_sampling_profiler(&stacks);
+
+    scoped_cJSON_t body(cJSON_CreateObject());
+
+    /* Only the time spent while we were profiling. */
+    scoped_cJSON_t coroutines(cJSON_CreateObject());
+    for (std::map<std::string, uint64_t>::iterator it = cycles_after.begin(); it != cycles_after.end(); ++it) {
+        uint64_t cycles = it->second - cycles_before[it->first];
+        if (cycles != 0) {
+            cJSON_AddItemToObject(coroutines.get(), it->first.c_str(), cJSON_CreateNumber(cycles));
+        }
+    }
+    body.AddItemToObject("coroutine_cycles", coroutines.release());
+
+    scoped_cJSON_t samples(cJSON_CreateArray());
+    for (std::vector<sampled_stack_t>::iterator it = stacks.begin(); it != stacks.end(); ++it) {
+        scoped_cJSON_t sample(cJSON_CreateObject());
+        sample.AddItemToObject("count", cJSON_CreateNumber(it->count));
+        sample.AddItemToObject("coroutine", cJSON_CreateString(it->coroutine_type.c_str()));
+        sample.AddItemToObject("stack", cJSON_CreateString(it->frames.c_str()));
+        cJSON_AddItemToArray(samples.get(), sample.release());
+    }
+    body.AddItemToObject("samples", samples.release());
+    body.AddItemToObject("dropped_samples", cJSON_CreateNumber(dropped));
+
+    return http_json_res(body.get());
+}
@@ -0,0 +1,28 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_PROFILE_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_PROFILE_APP_HPP_
+
+#include "concurrency/cond_var.hpp"
+#include "http/http.hpp"
+
+/* Profiles the machine that serves the request for a while, and returns how much
+time each type of coroutine spent running and the stacks the sampling profiler
+saw (see arch/runtime/profiler.hpp). Takes the query parameters `duration`, in
+milliseconds, and `frequency`, in samples per second of CPU time. */
+class profile_app_t : public http_app_t {
+public:
+    profile_app_t();
+    http_res_t handle(const http_req_t &req);
+
+    /* Cuts short the profile being taken, if any, and refuses later ones. Call
+    it before the HTTP server is destroyed, so that a long profile doesn't hold
+    it up. */
+    void stop();
+
+private:
+    cond_t stopping;
+
+    DISABLE_COPYING(profile_app_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_PROFILE_APP_HPP_ */
@@ -49,7 +49,7 @@ http_res_t semilattice_http_app_t::handle(const http_req_t &req) {
             case GET:
             {
                 scoped_cJSON_t json_repr(json_adapter_head->render());
-                return http_json_res(json_repr.get());
+                return http_cacheable_json_res(req, &json_repr);
             }
             break;
             case POST:
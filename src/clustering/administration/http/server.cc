@@ -4,12 +4,15 @@
 #include "clustering/administration/http/cyanide.hpp"
 #include "clustering/administration/http/directory_app.hpp"
 #include "clustering/administration/http/distribution_app.hpp"
+#include "clustering/administration/http/hot_keys_app.hpp"
 #include "clustering/administration/http/issues_app.hpp"
 #include "clustering/administration/http/last_seen_app.hpp"
 #include "clustering/administration/http/log_app.hpp"
+#include "clustering/administration/http/profile_app.hpp"
 #include "clustering/administration/http/progress_app.hpp"
 #include "clustering/administration/http/semilattice_app.hpp"
 #include "clustering/administration/http/stat_app.hpp"
+#include "clustering/administration/http/watch_app.hpp"
 #include "clustering/administration/http/combining_app.hpp"
 #include "http/file_app.hpp"
 #include "http/http.hpp"
@@ -216,8 +219,16 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
         _directory_metadata->subview(&get_log_mailbox),
         _directory_metadata->subview(&get_machine_id)));
     progress_app.init(new progress_app_t(_directory_metadata, mbox_manager));
+    profile_app.init(new profile_app_t);
     distribution_app.init(new distribution_app_t(metadata_field(&cluster_semilattice_metadata_t::memcached_namespaces, _semilattice_metadata), _namespace_repo,
                                                  metadata_field(&cluster_semilattice_metadata_t::rdb_namespaces, _semilattice_metadata), _rdb_namespace_repo));
+    hot_keys_app.init(new hot_keys_app_t(metadata_field(&cluster_semilattice_metadata_t::memcached_namespaces, _semilattice_metadata), _namespace_repo,
+                                         metadata_field(&cluster_semilattice_metadata_t::rdb_namespaces, _semilattice_metadata), _rdb_namespace_repo));
+
+    std::map<std::string, http_json_app_t *> watched_views;
+    watched_views["semilattice"] = semilattice_app.get();
+    watched_views["directory"] = directory_app.get();
+    watch_app.init(new metadata_watch_http_app_t(watched_views, _semilattice_metadata, _directory_metadata));
 
 #ifndef NDEBUG
     cyanide_app.init(new cyanide_http_app_t);
@@ -230,8 +241,11 @@ administrative_http_server_manager_t::administrative_http_server_manager_t(
     ajax_routes["last_seen"] = last_seen_app.get();
     ajax_routes["log"] = log_app.get();
     ajax_routes["progress"] = progress_app.get();
+    ajax_routes["profile"] = profile_app.get();
     ajax_routes["distribution"] = distribution_app.get();
+    ajax_routes["hot_keys"] = hot_keys_app.get();
     ajax_routes["semilattice"] = semilattice_app.get();
+    ajax_routes["watch"] = watch_app.get();
     ajax_routes["reql"] = reql_app;
     DEBUG_ONLY_CODE(ajax_routes["cyanide"] = cyanide_app.get());
 
@@ -256,6 +270,11 @@ administrative_http_server_manager_t::~administrative_http_server_manager_t() {
     /* This must be declared in the `.cc` file because the definitions of the
     destructors for the things in `scoped_ptr_t`s are not available from
     the `.hpp` file. */
+
+    /* Otherwise destroying `server` would wait for every watch request to time
+    out, and for the profile being taken to finish. */
+    watch_app->stop();
+    profile_app->stop();
 }
 
 int administrative_http_server_manager_t::get_port() const {
@@ -24,8 +24,11 @@ class stat_http_app_t;
 class last_seen_http_app_t;
 class log_http_app_t;
 class progress_app_t;
+class profile_app_t;
 class stat_manager_t;
 class distribution_app_t;
+class hot_keys_app_t;
+class metadata_watch_http_app_t;
 class cyanide_http_app_t;
 class combining_http_app_t;
 
@@ -58,7 +61,10 @@ private:
     scoped_ptr_t<last_seen_http_app_t> last_seen_app;
     scoped_ptr_t<log_http_app_t> log_app;
     scoped_ptr_t<progress_app_t> progress_app;
+    scoped_ptr_t<profile_app_t> profile_app;
     scoped_ptr_t<distribution_app_t> distribution_app;
+    scoped_ptr_t<hot_keys_app_t> hot_keys_app;
+    scoped_ptr_t<metadata_watch_http_app_t> watch_app;
     scoped_ptr_t<combining_http_app_t> combining_app;
 #ifndef NDEBUG
     scoped_ptr_t<cyanide_http_app_t> cyanide_app;
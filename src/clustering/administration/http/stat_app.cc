@@ -1,6 +1,7 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include <string>
 #include <set>
+#include <vector>
 
 #include "errors.hpp"
 #include <boost/ptr_container/ptr_map.hpp>
@@ -10,12 +11,14 @@
 #include "arch/timing.hpp"
 #include "clustering/administration/http/stat_app.hpp"
 #include "clustering/administration/stat_manager.hpp"
+#include "config/args.hpp"
 #include "http/json.hpp"
 #include "perfmon/perfmon.hpp"
 #include "perfmon/archive.hpp"
 #include "clustering/administration/main/watchable_fields.hpp"
 
 static const char * STAT_REQ_TIMEOUT_PARAM = "timeout";
+static const char * STAT_REQ_SINCE_PARAM = "since";
 static const uint64_t DEFAULT_STAT_REQ_TIMEOUT_MS = 1000;
 static const uint64_t MAX_STAT_REQ_TIMEOUT_MS = 60*1000;
 
@@ -32,9 +35,20 @@ stat_http_app_t::stat_http_app_t(mailbox_manager_t *_mbox_manager,
                                  clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > >& _directory,
                                  boost::shared_ptr<semilattice_readwrite_view_t<cluster_semilattice_metadata_t> >& _semilattice
                                  )
-    : mbox_manager(_mbox_manager), directory(_directory), semilattice(_semilattice)
+    : mbox_manager(_mbox_manager), directory(_directory), semilattice(_semilattice),
+      /* IDs from before a restart shouldn't look like ones we know. */
+      next_snapshot_id(current_microtime())
 { }
 
+uint64_t stat_http_app_t::remember_snapshot(const snapshot_t &snapshot) {
+    uint64_t id = next_snapshot_id++;
+    snapshots[id] = snapshot;
+    while (snapshots.size() > STATS_DELTA_SNAPSHOTS) {
+        snapshots.erase(snapshots.begin());
+    }
+    return id;
+}
+
 cJSON *render_as_json(perfmon_result_t *target) {
     if (target->is_map()) {
         cJSON *res = cJSON_CreateObject();
@@ -95,7 +109,8 @@ boost::optional<http_res_t> parse_query_params(
     const http_req_t &req,
     std::set<std::string> *filter_paths,
     std::set<std::string> *machine_whitelist,
-    uint64_t *timeout) {
+    uint64_t *timeout,
+    boost::optional<uint64_t> *since) {
 
     typedef boost::escaped_list_separator<char> separator_t;
     typedef boost::tokenizer<separator_t> tokenizer_t;
@@ -113,6 +128,13 @@ boost::optional<http_res_t> parse_query_params(
                 return boost::optional<http_res_t>(http_error_res(
                     "Invalid timeout value: "+it->val));
             }
+        } else if (it->key == STAT_REQ_SINCE_PARAM) {
+            uint64_t snapshot_id;
+            if (!strtou64_strict(it->val, 10, &snapshot_id)) {
+                return boost::optional<http_res_t>(http_error_res(
+                    "Invalid snapshot id: "+it->val));
+            }
+            *since = snapshot_id;
         } else if (it->key == "filter" || it->key == "machine_whitelist") {
             std::set<std::string> *out_set =
                 (it->key == "filter" ? filter_paths : machine_whitelist);
@@ -146,9 +168,10 @@ http_res_t stat_http_app_t::handle(const http_req_t &req) {
 #else
     uint64_t timeout = DEFAULT_STAT_REQ_TIMEOUT_MS*10;
 #endif
+    boost::optional<uint64_t> since;
     if (req.method != GET) return http_res_t(HTTP_METHOD_NOT_ALLOWED);
     boost::optional<http_res_t> maybe_error_res =
-        parse_query_params(req, &filter_paths, &machine_whitelist, &timeout);
+        parse_query_params(req, &filter_paths, &machine_whitelist, &timeout, &since);
     if (maybe_error_res) return *maybe_error_res;
 
     scoped_cJSON_t body(cJSON_CreateObject());
@@ -178,6 +201,7 @@ http_res_t stat_http_app_t::handle(const http_req_t &req) {
     }
 
     std::vector<machine_id_t> not_replied;
+    snapshot_t snapshot;
     for (stats_promises_t::iterator it = stats_promises.begin(); it != stats_promises.end(); ++it) {
         machine_id_t machine = it->first;
 
@@ -186,16 +210,47 @@ http_res_t stat_http_app_t::handle(const http_req_t &req) {
         waiter.wait();
 
         if (stats_ready->is_pulsed()) {
-            perfmon_result_t stats = it->second->stats.wait();
-            if (!stats.get_map()->empty()) {
-                body.AddItemToObject(uuid_to_str(machine).c_str(), render_as_json(&stats));
-            }
+            snapshot[machine].reset(new perfmon_result_t(it->second->stats.wait()));
         } else {
             not_replied.push_back(machine);
         }
     }
 
+    /* If we still have the snapshot the client is asking about, leave out
+    everything that hasn't changed since. Otherwise they get everything, which
+    is always a correct answer. */
+    std::map<uint64_t, snapshot_t>::iterator previous = since ? snapshots.find(*since) : snapshots.end();
+
+    scoped_cJSON_t removed(cJSON_CreateObject());
+    for (snapshot_t::const_iterator it = snapshot.begin(); it != snapshot.end(); ++it) {
+        perfmon_result_t stats(*it->second);
+        if (previous != snapshots.end()) {
+            snapshot_t::const_iterator prev = previous->second.find(it->first);
+            if (prev != previous->second.end()) {
+                std::vector<std::string> removed_paths;
+                stats.find_removed(*prev->second, "", &removed_paths);
+                if (!removed_paths.empty()) {
+                    scoped_cJSON_t paths(cJSON_CreateArray());
+                    for (size_t i = 0; i < removed_paths.size(); ++i) {
+                        paths.AddItemToArray(cJSON_CreateString(removed_paths[i].c_str()));
+                    }
+                    removed.AddItemToObject(uuid_to_str(it->first).c_str(), paths.release());
+                }
+                stats.remove_unchanged(*prev->second);
+            }
+        }
+        if (!stats.get_map()->empty()) {
+            body.AddItemToObject(uuid_to_str(it->first).c_str(), render_as_json(&stats));
+        }
+    }
+    if (previous != snapshots.end()) {
+        snapshots.erase(previous);
+    }
+
+    cJSON_AddItemToObject(body.get(), "removed", removed.release());
     cJSON_AddItemToObject(body.get(), "machines", prepare_machine_info(not_replied));
+    cJSON_AddItemToObject(body.get(), "snapshot_id",
+                          cJSON_CreateString(strprintf("%" PRIu64, remember_snapshot(snapshot)).c_str()));
 
-    return http_json_res(body.get());
+    return http_json_res(&body);
 }
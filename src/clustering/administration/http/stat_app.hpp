@@ -23,11 +23,23 @@ private:
 
     cJSON *prepare_machine_info(const std::vector<machine_id_t> &not_replied);
 
+    /* What each machine replied to an earlier request, so that a client can
+    pass `since=<snapshot_id>` and only get the stats that changed, along with
+    `removed`, the paths of the stats each machine no longer has. Each answer
+    is remembered under a new ID, and the snapshot it was a delta against is
+    forgotten: a client polling for deltas always passes the ID it got last,
+    so every such client holds on to exactly one snapshot. */
+    typedef std::map<machine_id_t, boost::shared_ptr<perfmon_result_t> > snapshot_t;
+    uint64_t remember_snapshot(const snapshot_t &snapshot);
+
 private:
     mailbox_manager_t *mbox_manager;
     clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > > directory;
     boost::shared_ptr<semilattice_readwrite_view_t<cluster_semilattice_metadata_t> > semilattice;
 
+    uint64_t next_snapshot_id;
+    std::map<uint64_t, snapshot_t> snapshots;
+
     DISABLE_COPYING(stat_http_app_t);
 };
 
@@ -0,0 +1,142 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#define __STDC_FORMAT_MACROS
+#include "clustering/administration/http/watch_app.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/timing.hpp"
+#include "concurrency/wait_any.hpp"
+#include "http/json.hpp"
+
+metadata_watch_http_app_t::metadata_watch_http_app_t(
+        const std::map<std::string, http_json_app_t *> &_components,
+        boost::shared_ptr<semilattice_read_view_t<cluster_semilattice_metadata_t> > semilattice_metadata,
+        const clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > > &directory_metadata)
+    : components(_components),
+      /* Versions from before a restart shouldn't look like ones we know. */
+      next_version(current_microtime()),
+      change_count(0),
+      changes(change_count),
+      semilattice_subs(boost::bind(&metadata_watch_http_app_t::on_change, this), semilattice_metadata),
+      directory_subs(boost::bind(&metadata_watch_http_app_t::on_change, this)) {
+    watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> >::freeze_t freeze(directory_metadata);
+    directory_subs.reset(directory_metadata, &freeze);
+}
+
+void metadata_watch_http_app_t::stop() {
+    stopping.pulse_if_not_already_pulsed();
+}
+
+void metadata_watch_http_app_t::on_change() {
+    changes.set_value(++change_count);
+}
+
+uint64_t metadata_watch_http_app_t::update_snapshot() {
+    uint64_t seen = change_count;
+    if (!snapshots.empty() && snapshots.rbegin()->second.changes == seen) {
+        return snapshots.rbegin()->first;
+    }
+
+    snapshot_t snapshot;
+    snapshot.changes = seen;
+    for (std::map<std::string, http_json_app_t *>::iterator it = components.begin(); it != components.end(); ++it) {
+        boost::shared_ptr<scoped_cJSON_t> json(new scoped_cJSON_t);
+        it->second->get_root(json.get());
+        snapshot.views[it->first] = json;
+    }
+
+    /* Most changes to the metadata, in particular to the directory, don't show
+    up in what we render. */
+    if (!snapshots.empty()) {
+        snapshot_t *latest = &snapshots.rbegin()->second;
+        bool same = true;
+        for (std::map<std::string, boost::shared_ptr<scoped_cJSON_t> >::iterator it = snapshot.views.begin(); it != snapshot.views.end(); ++it) {
+            if (!json_equal(latest->views[it->first]->get(), it->second->get())) {
+                same = false;
+                break;
+            }
+        }
+        if (same) {
+            latest->changes = std::max(latest->changes, seen);
+            return snapshots.rbegin()->first;
+        }
+    }
+
+    uint64_t version = next_version++;
+    snapshots[version] = snapshot;
+    while (snapshots.size() > METADATA_WATCH_SNAPSHOTS) {
+        snapshots.erase(snapshots.begin());
+    }
+    return version;
+}
+
+static bool changed_since(uint64_t seen, uint64_t changes) {
+    return changes != seen;
+}
+
+http_res_t metadata_watch_http_app_t::handle(const http_req_t &req) {
+    if (req.method != GET) {
+        return http_res_t(HTTP_METHOD_NOT_ALLOWED);
+    }
+
+    boost::optional<uint64_t> since;
+    boost::optional<std::string> maybe_since = req.find_query_param("since");
+    if (maybe_since) {
+        uint64_t version;
+        if (!strtou64_strict(maybe_since.get(), 10, &version)) {
+            return http_error_res("Invalid version: " + maybe_since.get());
+        }
+        since = version;
+    }
+
+    uint64_t timeout = METADATA_WATCH_DEFAULT_TIMEOUT_MS;
+    boost::optional<std::string> maybe_timeout = req.find_query_param("timeout");
+    if (maybe_timeout) {
+        if (!strtou64_strict(maybe_timeout.get(), 10, &timeout) || timeout > METADATA_WATCH_MAX_TIMEOUT_MS) {
+            return http_error_res(strprintf("Invalid timeout value; must be at most %d milliseconds.", METADATA_WATCH_MAX_TIMEOUT_MS));
+        }
+    }
+
+    uint64_t version = update_snapshot();
+    if (since && *since == version) {
+        signal_timer_t timer(timeout);
+        wait_any_t interruptor(&timer, &stopping);
+        try {
+            while (version == *since) {
+                uint64_t seen = snapshots.rbegin()->second.changes;
+                changes.get_watchable()->run_until_satisfied(boost::bind(&changed_since, seen, _1), &interruptor);
+                version = update_snapshot();
+            }
+        } catch (const interrupted_exc_t &) {
+            // Nothing changed in time; the answer is that nothing changed.
+        }
+    }
+
+    const snapshot_t &latest = snapshots.rbegin()->second;
+    version = snapshots.rbegin()->first;
+    std::map<uint64_t, snapshot_t>::iterator previous = since ? snapshots.find(*since) : snapshots.end();
+
+    scoped_cJSON_t body(cJSON_CreateObject());
+    body.AddItemToObject("version", cJSON_CreateString(strprintf("%" PRIu64, version).c_str()));
+    body.AddItemToObject("full", cJSON_CreateBool(previous == snapshots.end()));
+    for (std::map<std::string, boost::shared_ptr<scoped_cJSON_t> >::const_iterator it = latest.views.begin(); it != latest.views.end(); ++it) {
+        scoped_cJSON_t changed, deleted;
+        if (previous != snapshots.end()) {
+            json_diff(previous->second.views[it->first]->get(), it->second->get(), &changed, &deleted);
+        } else {
+            changed.reset(it->second->DeepCopy());
+            deleted.reset(cJSON_CreateArray());
+        }
+        scoped_cJSON_t view(cJSON_CreateObject());
+        view.AddItemToObject("changed", changed.release());
+        view.AddItemToObject("deleted", deleted.release());
+        body.AddItemToObject(it->first.c_str(), view.release());
+    }
+
+    return http_json_res(&body);
+}
@@ -0,0 +1,67 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#ifndef CLUSTERING_ADMINISTRATION_HTTP_WATCH_APP_HPP_
+#define CLUSTERING_ADMINISTRATION_HTTP_WATCH_APP_HPP_
+
+#include <map>
+#include <string>
+
+#include "errors.hpp"
+#include <boost/shared_ptr.hpp>
+
+#include "clustering/administration/metadata.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/watchable.hpp"
+#include "http/http.hpp"
+#include "rpc/semilattice/view.hpp"
+
+/* Serves `/ajax/watch[?since=<version>][&timeout=<ms>]`, so that clients can
+keep up with the cluster's semilattice and directory metadata without polling
+it. The answer has the current `version` and, for each of the `http_json_app_t`s
+it was given, what changed since `since` in the form `json_diff()` produces. If
+`since` is already the current version, the request waits until something
+changes or `timeout` runs out (in which case nothing has changed). If we no
+longer remember `since`, or it isn't given, `full` is true and the changes are
+the whole of each view. */
+class metadata_watch_http_app_t : public http_app_t {
+public:
+    metadata_watch_http_app_t(
+        const std::map<std::string, http_json_app_t *> &_components,
+        boost::shared_ptr<semilattice_read_view_t<cluster_semilattice_metadata_t> > semilattice_metadata,
+        const clone_ptr_t<watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> > > &directory_metadata);
+    http_res_t handle(const http_req_t &);
+
+    /* Makes the requests that are waiting for a change return now, and any later
+    ones return without waiting. Call it before the HTTP server is destroyed, so
+    that they don't hold it up. */
+    void stop();
+
+private:
+    struct snapshot_t {
+        /* How many changes to the metadata we had been told about when this
+        was rendered. */
+        uint64_t changes;
+        std::map<std::string, boost::shared_ptr<scoped_cJSON_t> > views;
+    };
+
+    void on_change();
+
+    /* Renders the metadata as a new version if it has changed since the latest
+    one, and returns the latest version. */
+    uint64_t update_snapshot();
+
+    std::map<std::string, http_json_app_t *> components;
+
+    uint64_t next_version;
+    std::map<uint64_t, snapshot_t> snapshots;
+
+    uint64_t change_count;
+    watchable_variable_t<uint64_t> changes;
+    cond_t stopping;
+
+    semilattice_read_view_t<cluster_semilattice_metadata_t>::subscription_t semilattice_subs;
+    watchable_t<std::map<peer_id_t, cluster_directory_metadata_t> >::subscription_t directory_subs;
+
+    DISABLE_COPYING(metadata_watch_http_app_t);
+};
+
+#endif /* CLUSTERING_ADMINISTRATION_HTTP_WATCH_APP_HPP_ */
@@ -15,6 +15,7 @@
 
 #include "arch/io/disk.hpp"
 #include "arch/os_signal.hpp"
+#include "arch/runtime/runtime.hpp"
 #include "arch/runtime/starter.hpp"
 #include "clustering/administration/cli/admin_command_parser.hpp"
 #include "clustering/administration/main/names.hpp"
@@ -25,7 +26,9 @@
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/logger.hpp"
 #include "clustering/administration/persist.hpp"
+#include "concurrency/pmap.hpp"
 #include "logger.hpp"
+#include "extproc/pool.hpp"
 #include "extproc/spawner.hpp"
 #include "mock/dummy_protocol.hpp"
 #include "utils.hpp"
@@ -98,18 +101,24 @@ public:
                  const std::vector<host_and_port_t> &_joins,
                  service_address_ports_t _ports,
                  std::string _web_assets,
-                 boost::optional<std::string> _config_file):
+                 boost::optional<std::string> _config_file,
+                 const extproc::pool_group_t::config_t &_extproc_config,
+                 int _stats_snapshot_interval_ms):
         spawner_info(_spawner_info),
         joins(&_joins),
         ports(_ports),
         web_assets(_web_assets),
-        config_file(_config_file) { }
+        config_file(_config_file),
+        extproc_config(_extproc_config),
+        stats_snapshot_interval_ms(_stats_snapshot_interval_ms) { }
 
     extproc::spawner_t::info_t *spawner_info;
     const std::vector<host_and_port_t> *joins;
     service_address_ports_t ports;
     std::string web_assets;
     boost::optional<std::string> config_file;
+    extproc::pool_group_t::config_t extproc_config;
+    int stats_snapshot_interval_ms;
 };
 
 std::string metadata_file(const std::string& file_path) {
@@ -210,6 +219,8 @@ service_address_ports_t get_service_address_ports(const po::variables_map& vm) {
 #endif
     // int reql_port = vm["reql-port"].as<int>();
     int reql_port = vm["driver-port"].as<int>();
+    int cluster_lanes = vm["cluster-lanes"].as<int>();
+    cluster_compression_t cluster_compression = vm["cluster-compression"].as<cluster_compression_t>();
     int port_offset = vm["port-offset"].as<int>();
 
     if (cluster_port != 0) {
@@ -225,8 +236,8 @@ service_address_ports_t get_service_address_ports(const po::variables_map& vm) {
     }
 
     return service_address_ports_t(
-        get_local_addresses(vm), cluster_port, cluster_client_port,
-        http_admin_is_disabled, http_port, reql_port, port_offset);
+        get_local_addresses(vm), cluster_port, cluster_client_port, cluster_lanes,
+        cluster_compression, http_admin_is_disabled, http_port, reql_port, port_offset);
 }
 
 void run_rethinkdb_create(const std::string &filepath, const name_string_t &machine_name, const io_backend_t io_backend, bool *result_out) {
@@ -337,6 +348,30 @@ std::string uname_msr() {
     return buf;
 }
 
+void set_busy_poll_on_thread(int thread, int usec) {
+    on_thread_t thread_switcher(thread);
+    set_busy_poll_usec(usec);
+}
+
+// Turns on busy-polling on the first `num_threads` threads, then runs `fun`.
+void run_with_busy_poll(int usec, int num_threads, const boost::function<void()> &fun) {
+    if (usec > 0) {
+        pmap(std::min(num_threads, get_num_threads()), boost::bind(&set_busy_poll_on_thread, _1, usec));
+    }
+    fun();
+}
+
+MUST_USE bool pull_stats_snapshot_interval_option(const po::variables_map& vm, int *interval_ms_out) {
+    *interval_ms_out = vm["stats-snapshot-interval"].as<int>();
+    return *interval_ms_out >= 0;
+}
+
+MUST_USE bool pull_busy_poll_options(const po::variables_map& vm, int *usec_out, int *threads_out) {
+    *usec_out = vm["busy-poll-usec"].as<int>();
+    *threads_out = vm["busy-poll-threads"].as<int>();
+    return *usec_out >= 0 && *threads_out >= 0;
+}
+
 void run_rethinkdb_serve(const std::string &filepath,
                          const io_backend_t io_backend,
                          bool *result_out,
@@ -375,6 +410,7 @@ void run_rethinkdb_serve(const std::string &filepath,
                                                                    &metadata_perfmon_collection));
                        }
         *result_out = serve(serve_info.spawner_info,
+                            serve_info.extproc_config,
                             io_backender.get(),
                             filepath, store.get(),
                             look_up_peers_addresses(*serve_info.joins),
@@ -382,6 +418,7 @@ void run_rethinkdb_serve(const std::string &filepath,
                             store->read_machine_id(),
                             store->read_metadata(),
                             serve_info.web_assets,
+                            serve_info.stats_snapshot_interval_ms,
                             &sigint_cond,
                             serve_info.config_file);
 
@@ -442,10 +479,12 @@ void run_rethinkdb_proxy(bool *result_out,
 
     try {
         *result_out = serve_proxy(serve_info.spawner_info,
+                                  serve_info.extproc_config,
                                   look_up_peers_addresses(*serve_info.joins),
                                   serve_info.ports,
                                   generate_uuid(), cluster_semilattice_metadata_t(),
                                   serve_info.web_assets,
+                                  serve_info.stats_snapshot_interval_ms,
                                   &sigint_cond,
                                   serve_info.config_file);
     } catch (const host_lookup_exc_t &ex) {
@@ -512,12 +551,38 @@ void validate(boost::any& value_out, const std::vector<std::string>& words,
 #endif
 }
 
+/* This allows `cluster_compression_t` to be used as a command-line argument
+with `boost::program_options`. */
+void validate(boost::any& value_out, const std::vector<std::string>& words,
+        cluster_compression_t *, int)
+{
+    po::validators::check_first_occurrence(value_out);
+    const std::string& word = po::validators::get_single_string(words);
+    if (word == "none") {
+        value_out = CLUSTER_COMPRESSION_NONE;
+        return;
+    } else if (word == "bulk") {
+        value_out = CLUSTER_COMPRESSION_BULK;
+        return;
+    } else if (word == "all") {
+        value_out = CLUSTER_COMPRESSION_ALL;
+        return;
+    }
+
+#if BOOST_VERSION >= 104200
+    throw po::validation_error(po::validation_error::invalid_option_value, word);
+#else
+    throw po::validation_error("Invalid option value: " + word);
+#endif
+}
+
 po::options_description get_web_options() {
     po::options_description desc("Web options");
     desc.add_options()
         ("web-static-directory", po::value<std::string>(), "specify directory from which to serve web resources")
         ("http-port", po::value<int>()->default_value(port_defaults::http_port), "port for http admin console")
-        ("no-http-admin", "disable http admin console");
+        ("no-http-admin", "disable http admin console")
+        ("stats-snapshot-interval", po::value<int>()->default_value(STATS_SNAPSHOT_INTERVAL_MS), "stats requests for the same stats less than this many milliseconds apart share one answer (0 to always collect them anew)");
     return desc;
 }
 
@@ -525,7 +590,8 @@ po::options_description get_web_options_visible() {
     po::options_description desc("Web options");
     desc.add_options()
         ("http-port", po::value<int>()->default_value(port_defaults::http_port), "port for http admin console")
-        ("no-http-admin", "disable http admin console");
+        ("no-http-admin", "disable http admin console")
+        ("stats-snapshot-interval", po::value<int>()->default_value(STATS_SNAPSHOT_INTERVAL_MS), "stats requests for the same stats less than this many milliseconds apart share one answer (0 to always collect them anew)");
     return desc;
 }
 
@@ -535,6 +601,8 @@ po::options_description get_network_options() {
         ("bind", po::value<std::vector<std::string> >()->composing(), "add the address of a local interface to listen on when accepting connections, may be 'all' or an IP address, loopback addresses are enabled by default")
         ("cluster-port", po::value<int>()->default_value(port_defaults::peer_port), "port for receiving connections from other nodes")
         DEBUG_ONLY(("client-port", po::value<int>()->default_value(port_defaults::client_port), "port to use when connecting to other nodes (for development)"))
+        ("cluster-lanes", po::value<int>()->default_value(1), "number of TCP connections to open to each other node; more than one spreads intracluster traffic across threads")
+        ("cluster-compression", po::value<cluster_compression_t>()->default_value(CLUSTER_COMPRESSION_NONE, "none"), "which intracluster traffic to compress: none, bulk (backfills only), or all; used on a connection if either end asks for it")
         ("driver-port", po::value<int>()->default_value(port_defaults::reql_port), "port for rethinkdb protocol for client drivers")
         ("join,j", po::value<std::vector<host_and_port_t> >()->composing(), "host:port of a node that we will connect to")
         ("port-offset,o", po::value<int>()->default_value(port_defaults::port_offset), "all ports used locally will have this value added");
@@ -551,7 +619,16 @@ po::options_description get_disk_options() {
 po::options_description get_cpu_options() {
     po::options_description desc("CPU options");
     desc.add_options()
-        ("cores,c", po::value<int>()->default_value(get_cpu_count()), "the number of cores to utilize");
+        ("cores,c", po::value<int>()->default_value(get_cpu_count()), "the number of cores to utilize")
+        ("busy-poll-usec", po::value<int>()->default_value(0), "how long a thread keeps polling for network events before it sleeps, in microseconds; trades CPU for latency (0 to disable)")
+        ("busy-poll-threads", po::value<int>()->default_value(DEFAULT_BUSY_POLL_THREADS), "how many of the threads busy-poll when busy-poll-usec is set; each one keeps a core busy");
+    return desc;
+}
+
+po::options_description get_js_options() {
+    po::options_description desc("JavaScript options");
+    desc.add_options()
+        ("js-shared-memory", "talk to the JavaScript worker processes through shared memory instead of sockets (experimental)");
     return desc;
 }
 
@@ -587,6 +664,7 @@ po::options_description get_rethinkdb_serve_options() {
     desc.add(get_web_options());
     desc.add(get_disk_options());
     desc.add(get_cpu_options());
+    desc.add(get_js_options());
     desc.add(get_service_options());
     return desc;
 }
@@ -600,6 +678,7 @@ po::options_description get_rethinkdb_serve_options_visible() {
     desc.add(get_disk_options());
 #endif // AIOSUPPORT
     desc.add(get_cpu_options());
+    desc.add(get_js_options());
     desc.add(get_service_options());
     return desc;
 }
@@ -608,6 +687,7 @@ po::options_description get_rethinkdb_proxy_options() {
     po::options_description desc("Allowed options");
     desc.add(get_network_options());
     desc.add(get_web_options());
+    desc.add(get_js_options());
     desc.add(get_service_options());
     desc.add_options()
         ("log-file", po::value<std::string>()->default_value("log_file"), "specify log file");
@@ -618,6 +698,7 @@ po::options_description get_rethinkdb_proxy_options_visible() {
     po::options_description desc("Allowed options");
     desc.add(get_network_options());
     desc.add(get_web_options_visible());
+    desc.add(get_js_options());
     desc.add(get_service_options());
     desc.add_options()
         ("log-file", po::value<std::string>()->default_value("log_file"), "specify log file");
@@ -659,10 +740,17 @@ po::options_description get_rethinkdb_porcelain_options() {
     desc.add(get_web_options());
     desc.add(get_disk_options());
     desc.add(get_cpu_options());
+    desc.add(get_js_options());
     desc.add(get_service_options());
     return desc;
 }
 
+extproc::pool_group_t::config_t get_extproc_config(const po::variables_map& vm) {
+    extproc::pool_group_t::config_t config;
+    config.use_shared_memory = vm.count("js-shared-memory") > 0;
+    return config;
+}
+
 // Returns true upon success.
 MUST_USE bool pull_io_backend_option(const po::variables_map& vm, io_backend_t *out) {
     std::string io_backend = vm["io-backend"].as<std::string>();
@@ -843,6 +931,18 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
 
+    int busy_poll_usec, busy_poll_threads;
+    if (!pull_busy_poll_options(vm, &busy_poll_usec, &busy_poll_threads)) {
+        fprintf(stderr, "ERROR: busy-poll-usec and busy-poll-threads must not be negative\n");
+        return EXIT_FAILURE;
+    }
+
+    int stats_snapshot_interval_ms;
+    if (!pull_stats_snapshot_interval_option(vm, &stats_snapshot_interval_ms)) {
+        fprintf(stderr, "ERROR: stats-snapshot-interval must not be negative\n");
+        return EXIT_FAILURE;
+    }
+
     if (write_pid_file(vm) != EXIT_SUCCESS) {
         return EXIT_FAILURE;
     }
@@ -855,14 +955,17 @@ int main_rethinkdb_serve(int argc, char *argv[]) {
     install_fallback_log_writer(logfilepath);
     
     serve_info_t serve_info(&spawner_info, joins, address_ports, web_path,
-                            optional_variable_value<std::string>(vm["config-file"]));
+                            optional_variable_value<std::string>(vm["config-file"]),
+                            get_extproc_config(vm),
+                            stats_snapshot_interval_ms);
 
     bool result;
-    run_in_thread_pool(boost::bind(&run_rethinkdb_serve, filepath,
-                                   io_backend, &result,
-                                   serve_info,
-                                   static_cast<machine_id_t*>(NULL),
-                                   static_cast<cluster_semilattice_metadata_t*>(NULL)),
+    run_in_thread_pool(boost::bind(&run_with_busy_poll, busy_poll_usec, busy_poll_threads,
+                                   boost::function<void()>(boost::bind(&run_rethinkdb_serve, filepath,
+                                                                       io_backend, &result,
+                                                                       serve_info,
+                                                                       static_cast<machine_id_t*>(NULL),
+                                                                       static_cast<cluster_semilattice_metadata_t*>(NULL)))),
                        num_workers);
 
     return result ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -946,12 +1049,20 @@ int main_rethinkdb_proxy(int argc, char *argv[]) {
 
     const int num_workers = get_cpu_count();
 
+    int stats_snapshot_interval_ms;
+    if (!pull_stats_snapshot_interval_option(vm, &stats_snapshot_interval_ms)) {
+        fprintf(stderr, "ERROR: stats-snapshot-interval must not be negative\n");
+        return EXIT_FAILURE;
+    }
+
     if (write_pid_file(vm) != EXIT_SUCCESS) {
         return EXIT_FAILURE;
     }
 
     serve_info_t serve_info(&spawner_info, joins, address_ports, web_path,
-                            optional_variable_value<std::string>(vm["config-file"]));
+                            optional_variable_value<std::string>(vm["config-file"]),
+                            get_extproc_config(vm),
+                            stats_snapshot_interval_ms);
 
     bool result;
     run_in_thread_pool(boost::bind(&run_rethinkdb_proxy,
@@ -1128,6 +1239,18 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
             return EXIT_FAILURE;
         }
 
+        int busy_poll_usec, busy_poll_threads;
+        if (!pull_busy_poll_options(vm, &busy_poll_usec, &busy_poll_threads)) {
+            fprintf(stderr, "ERROR: busy-poll-usec and busy-poll-threads must not be negative\n");
+            return EXIT_FAILURE;
+        }
+
+        int stats_snapshot_interval_ms;
+        if (!pull_stats_snapshot_interval_option(vm, &stats_snapshot_interval_ms)) {
+            fprintf(stderr, "ERROR: stats-snapshot-interval must not be negative\n");
+            return EXIT_FAILURE;
+        }
+
         if (write_pid_file(vm) != EXIT_SUCCESS) {
             return EXIT_FAILURE;
         }
@@ -1146,17 +1269,20 @@ int main_rethinkdb_porcelain(int argc, char *argv[]) {
         install_fallback_log_writer(logfilepath);
         
         serve_info_t serve_info(&spawner_info, joins, address_ports, web_path,
-                                optional_variable_value<std::string>(vm["config-file"]));
+                                optional_variable_value<std::string>(vm["config-file"]),
+                                get_extproc_config(vm),
+                                stats_snapshot_interval_ms);
 
 
         bool result;
-        run_in_thread_pool(boost::bind(&run_rethinkdb_porcelain,
-                                       filepath,
-                                       machine_name,
-                                       io_backend,
-                                       &result,
-                                       new_directory,
-                                       serve_info),
+        run_in_thread_pool(boost::bind(&run_with_busy_poll, busy_poll_usec, busy_poll_threads,
+                                       boost::function<void()>(boost::bind(&run_rethinkdb_porcelain,
+                                                                           filepath,
+                                                                           machine_name,
+                                                                           io_backend,
+                                                                           &result,
+                                                                           new_directory,
+                                                                           serve_info))),
                            num_workers);
 
         return result ? EXIT_SUCCESS : EXIT_FAILURE;
@@ -77,7 +77,7 @@ bool run_json_import(extproc::spawner_t::info_t *spawner_info,
     connectivity_cluster_t connectivity_cluster;
     message_multiplexer_t message_multiplexer(&connectivity_cluster);
 
-    message_multiplexer_t::client_t heartbeat_manager_client(&message_multiplexer, 'H');
+    message_multiplexer_t::client_t heartbeat_manager_client(&message_multiplexer, 'H', MESSAGE_PRIORITY_CONTROL);
     heartbeat_manager_t heartbeat_manager(&heartbeat_manager_client);
     message_multiplexer_t::client_t::run_t heartbeat_manager_client_run(&heartbeat_manager_client, &heartbeat_manager);
 
@@ -85,7 +85,7 @@ bool run_json_import(extproc::spawner_t::info_t *spawner_info,
     mailbox_manager_t mailbox_manager(&mailbox_manager_client);
     message_multiplexer_t::client_t::run_t mailbox_manager_client_run(&mailbox_manager_client, &mailbox_manager);
 
-    message_multiplexer_t::client_t semilattice_manager_client(&message_multiplexer, 'S');
+    message_multiplexer_t::client_t semilattice_manager_client(&message_multiplexer, 'S', MESSAGE_PRIORITY_METADATA);
     semilattice_manager_t<cluster_semilattice_metadata_t> semilattice_manager_cluster(&semilattice_manager_client, cluster_semilattice_metadata_t());
     message_multiplexer_t::client_t::run_t semilattice_manager_client_run(&semilattice_manager_client, &semilattice_manager_cluster);
 
@@ -105,7 +105,7 @@ bool run_json_import(extproc::spawner_t::info_t *spawner_info,
             log_server.get_business_card(),
             PROXY_PEER));
 
-    message_multiplexer_t::client_t directory_manager_client(&message_multiplexer, 'D');
+    message_multiplexer_t::client_t directory_manager_client(&message_multiplexer, 'D', MESSAGE_PRIORITY_METADATA);
     // TODO: Are we going to use the write manager at all?  Could we just remove it?  Just wondering.
     directory_write_manager_t<cluster_directory_metadata_t> directory_write_manager(&directory_manager_client, our_root_directory_variable.get_watchable());
     directory_read_manager_t<cluster_directory_metadata_t> directory_read_manager(connectivity_cluster.get_connectivity_service());
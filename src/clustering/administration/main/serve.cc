@@ -63,6 +63,7 @@ bool service_address_ports_t::is_bind_all() const {
 
 bool do_serve(
     extproc::spawner_t::info_t *spawner_info,
+    const extproc::pool_group_t::config_t &extproc_config,
     io_backender_t *io_backender,
     bool i_am_a_server,
     // NB. filepath & persistent_file are used iff i_am_a_server is true.
@@ -70,11 +71,11 @@ bool do_serve(
     const peer_address_set_t &joins,
     service_address_ports_t address_ports,
     machine_id_t machine_id, const cluster_semilattice_metadata_t &semilattice_metadata,
-    std::string web_assets, signal_t *stop_cond,
+    std::string web_assets, int stats_snapshot_interval_ms, signal_t *stop_cond,
     const boost::optional<std::string> &config_file) {
     try {
         guarantee(spawner_info);
-        extproc::pool_group_t extproc_pool_group(spawner_info, extproc::pool_group_t::DEFAULTS);
+        extproc::pool_group_t extproc_pool_group(spawner_info, extproc_config);
 
         local_issue_tracker_t local_issue_tracker;
 
@@ -87,7 +88,7 @@ bool do_serve(
         connectivity_cluster_t connectivity_cluster;
         message_multiplexer_t message_multiplexer(&connectivity_cluster);
 
-        message_multiplexer_t::client_t heartbeat_manager_client(&message_multiplexer, 'H');
+        message_multiplexer_t::client_t heartbeat_manager_client(&message_multiplexer, 'H', MESSAGE_PRIORITY_CONTROL);
         heartbeat_manager_t heartbeat_manager(&heartbeat_manager_client);
         message_multiplexer_t::client_t::run_t heartbeat_manager_client_run(&heartbeat_manager_client, &heartbeat_manager);
 
@@ -95,7 +96,7 @@ bool do_serve(
         mailbox_manager_t mailbox_manager(&mailbox_manager_client);
         message_multiplexer_t::client_t::run_t mailbox_manager_client_run(&mailbox_manager_client, &mailbox_manager);
 
-        message_multiplexer_t::client_t semilattice_manager_client(&message_multiplexer, 'S');
+        message_multiplexer_t::client_t semilattice_manager_client(&message_multiplexer, 'S', MESSAGE_PRIORITY_METADATA);
         semilattice_manager_t<cluster_semilattice_metadata_t> semilattice_manager_cluster(&semilattice_manager_client, semilattice_metadata);
         message_multiplexer_t::client_t::run_t semilattice_manager_client_run(&semilattice_manager_client, &semilattice_manager_cluster);
 
@@ -104,7 +105,7 @@ bool do_serve(
         // Initialize the stat manager before the directory manager so that we
         // could initialize the cluster directory metadata with the proper
         // stat_manager mailbox address
-        stat_manager_t stat_manager(&mailbox_manager);
+        stat_manager_t stat_manager(&mailbox_manager, stats_snapshot_interval_ms);
 
         metadata_change_handler_t<cluster_semilattice_metadata_t> metadata_change_handler(&mailbox_manager, semilattice_manager_cluster.get_root_view());
 
@@ -118,7 +119,7 @@ bool do_serve(
                 log_server.get_business_card(),
                 i_am_a_server ? SERVER_PEER : PROXY_PEER));
 
-        message_multiplexer_t::client_t directory_manager_client(&message_multiplexer, 'D');
+        message_multiplexer_t::client_t directory_manager_client(&message_multiplexer, 'D', MESSAGE_PRIORITY_METADATA);
         directory_write_manager_t<cluster_directory_metadata_t> directory_write_manager(&directory_manager_client, our_root_directory_variable.get_watchable());
         directory_read_manager_t<cluster_directory_metadata_t> directory_read_manager(connectivity_cluster.get_connectivity_service());
         message_multiplexer_t::client_t::run_t directory_manager_client_run(&directory_manager_client, &directory_read_manager);
@@ -134,7 +135,9 @@ bool do_serve(
                                                                address_ports.port,
                                                                &message_multiplexer_run,
                                                                address_ports.client_port,
-                                                               &heartbeat_manager);
+                                                               &heartbeat_manager,
+                                                               address_ports.cluster_lanes,
+                                                               address_ports.cluster_compression);
 
         // If (0 == port), then we asked the OS to give us a port number.
         if (address_ports.port != 0) {
@@ -371,6 +374,7 @@ bool do_serve(
 }
 
 bool serve(extproc::spawner_t::info_t *spawner_info,
+           const extproc::pool_group_t::config_t &extproc_config,
            io_backender_t *io_backender,
            const std::string &filepath,
            metadata_persistence::persistent_file_t *persistent_file,
@@ -379,9 +383,11 @@ bool serve(extproc::spawner_t::info_t *spawner_info,
            machine_id_t machine_id,
            const cluster_semilattice_metadata_t &semilattice_metadata,
            std::string web_assets,
+           int stats_snapshot_interval_ms,
            signal_t *stop_cond,
            const boost::optional<std::string>& config_file) {
     return do_serve(spawner_info,
+                    extproc_config,
                     io_backender,
                     true,
                     filepath,
@@ -391,21 +397,25 @@ bool serve(extproc::spawner_t::info_t *spawner_info,
                     machine_id,
                     semilattice_metadata,
                     web_assets,
+                    stats_snapshot_interval_ms,
                     stop_cond,
                     config_file);
 }
 
 bool serve_proxy(extproc::spawner_t::info_t *spawner_info,
+                 const extproc::pool_group_t::config_t &extproc_config,
                  const peer_address_set_t &joins,
                  service_address_ports_t address_ports,
                  machine_id_t machine_id,
                  const cluster_semilattice_metadata_t &semilattice_metadata,
                  std::string web_assets,
+                 int stats_snapshot_interval_ms,
                  signal_t *stop_cond,
                  const boost::optional<std::string>& config_file) {
     // TODO: filepath doesn't _seem_ ignored.
     // filepath and persistent_file are ignored for proxies, so we use the empty string & NULL respectively.
     return do_serve(spawner_info,
+                    extproc_config,
                     NULL,
                     false,
                     "",
@@ -415,6 +425,7 @@ bool serve_proxy(extproc::spawner_t::info_t *spawner_info,
                     machine_id,
                     semilattice_metadata,
                     web_assets,
+                    stats_snapshot_interval_ms,
                     stop_cond,
                     config_file);
 }
@@ -7,8 +7,10 @@
 
 #include "clustering/administration/metadata.hpp"
 #include "clustering/administration/persist.hpp"
+#include "extproc/pool.hpp"
 #include "extproc/spawner.hpp"
 #include "arch/address.hpp"
+#include "rpc/connectivity/compression.hpp"
 
 #define MAX_PORT 65536
 
@@ -26,6 +28,8 @@ struct service_address_ports_t {
     service_address_ports_t() :
         port(0),
         client_port(0),
+        cluster_lanes(1),
+        cluster_compression(CLUSTER_COMPRESSION_NONE),
         http_port(0),
         reql_port(0),
         port_offset(0) { }
@@ -33,6 +37,8 @@ struct service_address_ports_t {
     service_address_ports_t(const std::set<ip_address_t> &_local_addresses,
                             int _port,
                             int _client_port,
+                            int _cluster_lanes,
+                            cluster_compression_t _cluster_compression,
                             bool _http_admin_is_disabled,
                             int _http_port,
                             int _reql_port,
@@ -40,6 +46,8 @@ struct service_address_ports_t {
         local_addresses(_local_addresses),
         port(_port),
         client_port(_client_port),
+        cluster_lanes(_cluster_lanes),
+        cluster_compression(_cluster_compression),
         http_admin_is_disabled(_http_admin_is_disabled),
         http_port(_http_port),
         reql_port(_reql_port),
@@ -49,6 +57,9 @@ struct service_address_ports_t {
             sanitize_port(client_port, "client_port", port_offset);
             sanitize_port(http_port, "http_port", port_offset);
             sanitize_port(reql_port, "reql_port", port_offset);
+            if (cluster_lanes < 1) {
+                nice_crash("cluster_lanes must be at least 1 (got %d).", cluster_lanes);
+            }
     }
 
     std::string get_addresses_string() const;
@@ -58,6 +69,10 @@ struct service_address_ports_t {
     std::set<ip_address_t> local_addresses;
     int port;
     int client_port;
+    /* The number of TCP connections to open to each other node. */
+    int cluster_lanes;
+    /* Which intracluster messages to compress. */
+    cluster_compression_t cluster_compression;
     bool http_admin_is_disabled;
     int http_port;
     int reql_port;
@@ -68,6 +83,7 @@ struct service_address_ports_t {
 long time to compile. */
 
 bool serve(extproc::spawner_t::info_t *spawner_info,
+           const extproc::pool_group_t::config_t &extproc_config,
            io_backender_t *io_backender,
            const std::string &filepath,
            metadata_persistence::persistent_file_t *persistent_file,
@@ -76,15 +92,18 @@ bool serve(extproc::spawner_t::info_t *spawner_info,
            machine_id_t machine_id,
            const cluster_semilattice_metadata_t &semilattice_metadata,
            std::string web_assets,
+           int stats_snapshot_interval_ms,
            signal_t *stop_cond,
            const boost::optional<std::string>& config_file);
 
 bool serve_proxy(extproc::spawner_t::info_t *spawner_info,
+                 const extproc::pool_group_t::config_t &extproc_config,
                  const peer_address_set_t &joins,
                  service_address_ports_t ports,
                  machine_id_t machine_id,
                  const cluster_semilattice_metadata_t &semilattice_metadata,
                  std::string web_assets,
+                 int stats_snapshot_interval_ms,
                  signal_t *stop_cond,
                  const boost::optional<std::string>& config_file);
 
@@ -9,6 +9,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "arch/runtime/runtime.hpp"
 #include "arch/timing.hpp"
 #include "utils.hpp"
 
@@ -25,17 +26,39 @@ proc_stats_collector_t::instantaneous_stats_collector_t::instantaneous_stats_col
 }
 
 void *proc_stats_collector_t::instantaneous_stats_collector_t::begin_stats() {
-    return NULL;
+    return new thread_time_t[get_num_threads()];
 }
 
-void proc_stats_collector_t::instantaneous_stats_collector_t::visit_stats(void *) {
-    /* Do nothing; the things we need to get can be gotten on any thread */
+void proc_stats_collector_t::instantaneous_stats_collector_t::visit_stats(void *data) {
+    /* Everything but the thread utilization can be gotten on any thread */
+    thread_time_t *times = reinterpret_cast<thread_time_t *>(data);
+    thread_time_t *t = &times[get_thread_id()];
+    get_thread_wait_time(&t->waited, &t->elapsed);
 }
 
-perfmon_result_t *proc_stats_collector_t::instantaneous_stats_collector_t::end_stats(void *) {
+perfmon_result_t *proc_stats_collector_t::instantaneous_stats_collector_t::end_stats(void *data) {
+    thread_time_t *times = reinterpret_cast<thread_time_t *>(data);
+
     perfmon_result_t *result;
     perfmon_result_t::alloc_map_result(&result);
 
+    // How long each thread has spent doing something other than waiting for
+    // events, and how long it has been running. These only go up, so that
+    // every client can work out how busy the threads were between any two of
+    // its own collections.
+    perfmon_result_t *threads;
+    perfmon_result_t::alloc_map_result(&threads);
+    for (int i = 0; i < get_num_threads(); ++i) {
+        ticks_t busy = times[i].waited < times[i].elapsed ? times[i].elapsed - times[i].waited : 0;
+        perfmon_result_t *thread;
+        perfmon_result_t::alloc_map_result(&thread);
+        thread->insert("busy_secs", new perfmon_result_t(ticks_to_secs(busy)));
+        thread->insert("elapsed_secs", new perfmon_result_t(ticks_to_secs(times[i].elapsed)));
+        threads->insert(strprintf("%d", i), thread);
+    }
+    delete[] times;
+    result->insert("thread_time", threads);
+
     // Basic process stats (version, pid, uptime)
     struct timespec now = clock_monotonic();
 
@@ -17,6 +17,11 @@ private:
         void visit_stats(void *);
         perfmon_result_t *end_stats(void *);
     private:
+        struct thread_time_t {
+            thread_time_t() : waited(0), elapsed(0) { }
+            ticks_t waited, elapsed;
+        };
+
         ticks_t start_time;
     };
 
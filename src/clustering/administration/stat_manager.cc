@@ -8,7 +8,8 @@
 #include "perfmon/archive.hpp"
 #include "stl_utils.hpp"
 
-stat_manager_t::stat_manager_t(mailbox_manager_t* mm) :
+stat_manager_t::stat_manager_t(mailbox_manager_t* mm, int snapshot_interval_ms) :
+    snapshot_interval(secs_to_ticks(1) * snapshot_interval_ms / 1000),
     mailbox_manager(mm),
     get_stats_mailbox(mailbox_manager, boost::bind(&stat_manager_t::on_stats_request, this, _1, _2), mailbox_callback_mode_inline)
     { }
@@ -22,8 +23,30 @@ void stat_manager_t::on_stats_request(const return_address_t& reply_address, con
 }
 
 void stat_manager_t::perform_stats_request(const return_address_t& reply_address, const std::set<std::string>& requested_stats, auto_drainer_t::lock_t) {
-    perfmon_filter_t request(requested_stats);
-    scoped_ptr_t<perfmon_result_t> perfmon_result(perfmon_get_stats());
-    request.filter(perfmon_result.get());
-    send(mailbox_manager, reply_address, *perfmon_result.get());
+    ticks_t now = get_ticks();
+    /* Drop the snapshots that are too old to be handed out, so that filters
+    nobody asks for anymore don't stay around. */
+    for (std::map<std::set<stat_id_t>, cached_snapshot_t>::iterator it = snapshots.begin(); it != snapshots.end();) {
+        if (now - it->second.taken >= snapshot_interval) {
+            snapshots.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+
+    boost::shared_ptr<perfmon_result_t> perfmon_result;
+    std::map<std::set<stat_id_t>, cached_snapshot_t>::iterator cached = snapshots.find(requested_stats);
+    if (cached != snapshots.end()) {
+        perfmon_result = cached->second.result;
+    } else {
+        perfmon_filter_t request(requested_stats);
+        perfmon_result.reset(perfmon_get_stats(&request));
+        request.filter(perfmon_result.get());
+
+        cached_snapshot_t snapshot;
+        snapshot.taken = get_ticks();
+        snapshot.result = perfmon_result;
+        snapshots[requested_stats] = snapshot;
+    }
+    send(mailbox_manager, reply_address, *perfmon_result);
 }
@@ -6,6 +6,10 @@
 #include <map>
 #include <set>
 
+#include "errors.hpp"
+#include <boost/shared_ptr.hpp>
+
+#include "config/args.hpp"
 #include "perfmon/types.hpp"
 #include "rpc/mailbox/typed.hpp"
 
@@ -16,7 +20,10 @@ public:
     typedef mailbox_t<void(return_address_t, std::set<stat_id_t>)> get_stats_mailbox_t;
     typedef get_stats_mailbox_t::address_t get_stats_mailbox_address_t;
 
-    explicit stat_manager_t(mailbox_manager_t* mailbox_manager);
+    /* Requests for the same stats less than `snapshot_interval_ms` apart get
+    the same answer; 0 collects the stats anew for every request. */
+    explicit stat_manager_t(mailbox_manager_t* mailbox_manager,
+                            int snapshot_interval_ms = STATS_SNAPSHOT_INTERVAL_MS);
 
     get_stats_mailbox_address_t get_address();
 
@@ -24,6 +31,15 @@ private:
     void on_stats_request(const return_address_t& reply_address, const std::set<stat_id_t>& requested_stats);
     void perform_stats_request(const return_address_t& reply_address, const std::set<stat_id_t>& requested_stats, auto_drainer_t::lock_t);
 
+    /* Recent answers, by the set of stats they were for. Several admin clients
+    polling the same stats share one collection per `snapshot_interval`. */
+    struct cached_snapshot_t {
+        ticks_t taken;
+        boost::shared_ptr<perfmon_result_t> result;
+    };
+    std::map<std::set<stat_id_t>, cached_snapshot_t> snapshots;
+    ticks_t snapshot_interval;
+
     mailbox_manager_t *mailbox_manager;
     get_stats_mailbox_t get_stats_mailbox;
 
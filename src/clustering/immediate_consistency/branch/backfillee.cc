@@ -1,6 +1,9 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "clustering/immediate_consistency/branch/backfillee.hpp"
 
+#include <deque>
+#include <set>
+
 #include "clustering/immediate_consistency/branch/history.hpp"
 #include "concurrency/coro_pool.hpp"
 #include "concurrency/cross_thread_signal.hpp"
@@ -9,63 +12,107 @@
 #include "concurrency/queue/unlimited_fifo.hpp"
 #include "containers/death_runner.hpp"
 
-#define ALLOCATION_CHUNK 50
-
 template <class protocol_t>
 struct backfill_queue_entry_t {
+    enum kind_t {
+        CHUNK,
+        /* Every chunk for `region` has been sent */
+        CHECKPOINT,
+        /* The backfill is over */
+        DONE
+    };
+
     // TODO: The fact that fifo_enforcer_queue_t requires a default
     // constructor (and assignment operator, presumably) is completely asinine.
     backfill_queue_entry_t() { }
-    backfill_queue_entry_t(bool _is_not_last_backfill_chunk,
+    backfill_queue_entry_t(kind_t _kind,
                            const typename protocol_t::backfill_chunk_t &_chunk,
+                           int _charge,
+                           const typename protocol_t::region_t &_region,
                            fifo_enforcer_write_token_t _write_token)
-        : is_not_last_backfill_chunk(_is_not_last_backfill_chunk),
+        : kind(_kind),
           chunk(_chunk),
+          charge(_charge),
+          region(_region),
           write_token(_write_token) { }
 
-    bool is_not_last_backfill_chunk;
+    kind_t kind;
     typename protocol_t::backfill_chunk_t chunk;
+    /* How many bytes of the backfiller's window this chunk holds. */
+    int charge;
+    typename protocol_t::region_t region;
     fifo_enforcer_write_token_t write_token;
 };
 
 template <class protocol_t>
 void push_chunk_on_queue(fifo_enforcer_queue_t<backfill_queue_entry_t<protocol_t> > *queue,
-                         typename protocol_t::backfill_chunk_t chunk, fifo_enforcer_write_token_t token) {
-    queue->push(token, backfill_queue_entry_t<protocol_t>(true, chunk, token));
+                         typename protocol_t::backfill_chunk_t chunk, int charge, fifo_enforcer_write_token_t token) {
+    queue->push(token, backfill_queue_entry_t<protocol_t>(backfill_queue_entry_t<protocol_t>::CHUNK,
+                                                          chunk, charge, typename protocol_t::region_t(), token));
 }
 
 template <class protocol_t>
-void push_finish_on_queue(fifo_enforcer_queue_t<backfill_queue_entry_t<protocol_t> > *queue, fifo_enforcer_write_token_t token) {
-    queue->push(token, backfill_queue_entry_t<protocol_t>(false, typename protocol_t::backfill_chunk_t(), token));
+void push_progress_on_queue(fifo_enforcer_queue_t<backfill_queue_entry_t<protocol_t> > *queue,
+                            typename protocol_t::region_t region, bool is_done, fifo_enforcer_write_token_t token) {
+    queue->push(token, backfill_queue_entry_t<protocol_t>(is_done ? backfill_queue_entry_t<protocol_t>::DONE : backfill_queue_entry_t<protocol_t>::CHECKPOINT,
+                                                          typename protocol_t::backfill_chunk_t(), 0, region, token));
 }
 
 
 /* Now that the metadata indicates that the backfill is happening, it's
-   time to start actually performing backfill chunks */
+   time to start actually performing backfill chunks.
+
+   Up to `BACKFILL_APPLY_CONCURRENCY` chunks are applied at once. They take the
+   store's write token in the order they were sent, which is all it takes to
+   keep chunks that touch the same keys in order; chunks for disjoint key
+   ranges then proceed through the btree in parallel.
+
+   Along the way the backfiller tells us which regions it has sent everything
+   for. Once every chunk that came before such a checkpoint has been applied,
+   the region is at the backfill's end point, and every `checkpoint_bytes`
+   (`BACKFILL_CHECKPOINT_BYTES` by default) we say so in the metainfo. If the backfill is
+   interrupted, the next one then starts from the end point for those regions
+   and only has to send what changed since. */
 template <class protocol_t>
 class chunk_callback_t : public coro_pool_callback_t<backfill_queue_entry_t<protocol_t> >,
                          public home_thread_mixin_debug_only_t {
 public:
+    typedef region_map_t<protocol_t, version_range_t> version_map_t;
+
     chunk_callback_t(store_view_t<protocol_t> *_svs,
                      fifo_enforcer_queue_t<backfill_queue_entry_t<protocol_t> > *_chunk_queue, mailbox_manager_t *_mbox_manager,
-                     mailbox_addr_t<void(int)> _allocation_mailbox) :
+                     mailbox_addr_t<void(int)> _allocation_mailbox,
+                     const version_map_t &_span, const version_map_t &_end_point,
+                     order_source_t *_order_source, int64_t _checkpoint_bytes) :
         svs(_svs), chunk_queue(_chunk_queue), mbox_manager(_mbox_manager),
-        allocation_mailbox(_allocation_mailbox), unacked_chunks(0),
-        done_message_arrived(false), num_outstanding_chunks(0)
+        allocation_mailbox(_allocation_mailbox), unacked_bytes(0),
+        done_message_arrived(false), num_outstanding_chunks(0),
+        span(_span), end_point(_end_point), order_source(_order_source),
+        next_seq(0), checkpoint_bytes(_checkpoint_bytes), bytes_since_checkpoint(0),
+        have_new_checkpoints(false), checkpoint_in_progress(false)
     { }
 
     void apply_backfill_chunk(fifo_enforcer_write_token_t chunk_token, const typename protocol_t::backfill_chunk_t& chunk, signal_t *interruptor) {
         object_buffer_t<fifo_enforcer_sink_t::exit_write_t> write_token;
         svs->new_write_token(&write_token);
-        chunk_queue->finish_write(chunk_token);
+        int64_t seq;
+        {
+            ASSERT_NO_CORO_WAITING;
+            seq = next_seq++;
+            applying.insert(seq);
+            chunk_queue->finish_write(chunk_token);
+        }
 
         svs->receive_backfill(chunk, &write_token, interruptor);
+
+        applying.erase(seq);
+        fold_in_checkpoints();
     }
 
     void coro_pool_callback(backfill_queue_entry_t<protocol_t> chunk, signal_t *interruptor) {
         assert_thread();
         try {
-            if (chunk.is_not_last_backfill_chunk) {
+            if (chunk.kind == backfill_queue_entry_t<protocol_t>::CHUNK) {
                 /* This is an actual backfill chunk */
 
                 /* Before letting the next thing go, increment
@@ -80,25 +127,35 @@ public:
                 apply_backfill_chunk(chunk.write_token, chunk.chunk, interruptor);
 
                 /* Allow the backfiller to send us more data */
-                int chunks_to_send_out = 0;
+                int bytes_to_send_out = 0;
                 {
                     /* Notice it's important that we don't wait while we're
-                     * modifying unacked chunks, otherwise another callback may
+                     * modifying unacked bytes, otherwise another callback may
                      * decided to send out an allocation as well. */
                     ASSERT_NO_CORO_WAITING;
-                    ++unacked_chunks;
-                    guarantee(unacked_chunks <= ALLOCATION_CHUNK);
-                    if (unacked_chunks == ALLOCATION_CHUNK) {
-                        unacked_chunks = 0;
-                        chunks_to_send_out = ALLOCATION_CHUNK;
+                    unacked_bytes += chunk.charge;
+                    if (unacked_bytes >= BACKFILL_ACK_BYTES) {
+                        bytes_to_send_out = unacked_bytes;
+                        unacked_bytes = 0;
                     }
+                    bytes_since_checkpoint += chunk.charge;
                 }
-                if (chunks_to_send_out != 0) {
-                    send(mbox_manager, allocation_mailbox, chunks_to_send_out);
+                if (bytes_to_send_out != 0) {
+                    send(mbox_manager, MESSAGE_PRIORITY_CONTROL, allocation_mailbox, bytes_to_send_out);
                 }
 
+                maybe_write_checkpoint(interruptor);
+
                 num_outstanding_chunks--;
 
+            } else if (chunk.kind == backfill_queue_entry_t<protocol_t>::CHECKPOINT) {
+                {
+                    ASSERT_NO_CORO_WAITING;
+                    waiting_checkpoints.push_back(std::make_pair(next_seq, chunk.region));
+                    chunk_queue->finish_write(chunk.write_token);
+                }
+                fold_in_checkpoints();
+
             } else {
                 /* This is a fake backfill "chunk" that just indicates
                    that the backfill is over */
@@ -116,21 +173,103 @@ public:
                before the queue drains. That can only happen if we are
                being interrupted or if we lost contact with the backfiller.
                In either case, abort; the store will be left in a
-               half-backfilled state. */
+               half-backfilled state, apart from what we checkpointed. */
         }
     }
 
     cond_t done_cond;
 
 private:
+    /* Moves the checkpoints that no chunk still being applied comes before
+    into `finished`, merging adjacent regions as we go. */
+    void fold_in_checkpoints() {
+        ASSERT_NO_CORO_WAITING;
+        while (!waiting_checkpoints.empty() &&
+               (applying.empty() || *applying.begin() >= waiting_checkpoints.front().first)) {
+            typename protocol_t::region_t piece = waiting_checkpoints.front().second;
+            waiting_checkpoints.pop_front();
+            for (size_t i = 0; i < finished.size();) {
+                std::vector<typename protocol_t::region_t> pair;
+                pair.push_back(finished[i]);
+                pair.push_back(piece);
+                typename protocol_t::region_t joined;
+                if (region_join(pair, &joined) == REGION_JOIN_OK) {
+                    piece = joined;
+                    finished[i] = finished.back();
+                    finished.pop_back();
+                    i = 0;
+                } else {
+                    ++i;
+                }
+            }
+            finished.push_back(piece);
+            have_new_checkpoints = true;
+        }
+    }
+
+    void maybe_write_checkpoint(signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        version_map_t progress = span;
+        object_buffer_t<fifo_enforcer_sink_t::exit_write_t> write_token;
+        {
+            ASSERT_NO_CORO_WAITING;
+            if (checkpoint_in_progress || !have_new_checkpoints ||
+                    bytes_since_checkpoint < checkpoint_bytes) {
+                return;
+            }
+            checkpoint_in_progress = true;
+            have_new_checkpoints = false;
+            bytes_since_checkpoint = 0;
+            for (size_t i = 0; i < finished.size(); ++i) {
+                progress.update(end_point.mask(finished[i]));
+            }
+            /* Everything in `finished` has been applied, and chunks that take
+            a write token after this one can only touch other regions. */
+            svs->new_write_token(&write_token);
+        }
+
+        try {
+            svs->set_metainfo(
+                region_map_transform<protocol_t, version_range_t, binary_blob_t>(progress,
+                                                                                 &binary_blob_t::make<version_range_t>),
+                order_source->check_in("backfillee(checkpoint)"),
+                &write_token,
+                interruptor);
+        } catch (interrupted_exc_t) {
+            checkpoint_in_progress = false;
+            throw;
+        }
+        checkpoint_in_progress = false;
+    }
+
     store_view_t<protocol_t> *svs;
     fifo_enforcer_queue_t<backfill_queue_entry_t<protocol_t> > *chunk_queue;
     mailbox_manager_t *mbox_manager;
     mailbox_addr_t<void(int)> allocation_mailbox;
-    int unacked_chunks;
+    int unacked_bytes;
     bool done_message_arrived;
     int num_outstanding_chunks;
 
+    /* The metainfo we wrote when the backfill started, and where it ends. */
+    const version_map_t span, end_point;
+    order_source_t *order_source;
+
+    /* Chunks are numbered in the order they take the store's write token;
+    `applying` holds the numbers of those that are still being applied. */
+    int64_t next_seq;
+    std::set<int64_t> applying;
+
+    /* Checkpoints that are waiting for the chunks before them, with the number
+    the next chunk after them will get. */
+    std::deque<std::pair<int64_t, typename protocol_t::region_t> > waiting_checkpoints;
+
+    /* Disjoint regions that are already at `end_point`. */
+    std::vector<typename protocol_t::region_t> finished;
+
+    const int64_t checkpoint_bytes;
+    int64_t bytes_since_checkpoint;
+    bool have_new_checkpoints;
+    bool checkpoint_in_progress;
+
     DISABLE_COPYING(chunk_callback_t);
 };
 
@@ -149,7 +288,8 @@ void backfillee(
         typename protocol_t::region_t region,
         clone_ptr_t<watchable_t<boost::optional<boost::optional<backfiller_business_card_t<protocol_t> > > > > backfiller_metadata,
         backfill_session_id_t backfill_session_id,
-        signal_t *interruptor)
+        signal_t *interruptor,
+        int64_t checkpoint_bytes)
         THROWS_ONLY(interrupted_exc_t, resource_lost_exc_t)
 {
     rassert(region_is_superset(svs->get_region(), region));
@@ -192,17 +332,19 @@ void backfillee(
 
         fifo_enforcer_queue_t<backfill_queue_entry_t<protocol_t> > chunk_queue;
 
-        /* The backfiller will notify `done_mailbox` when the backfill is all over
-        and the version described in `end_point_mailbox` has been achieved. */
-        mailbox_t<void(fifo_enforcer_write_token_t)> done_mailbox(
+        /* The backfiller will notify `progress_mailbox` whenever it has sent
+        everything for part of the region, and once more when the backfill is
+        all over and the version described in `end_point_mailbox` has been
+        achieved. */
+        mailbox_t<void(typename protocol_t::region_t, bool, fifo_enforcer_write_token_t)> progress_mailbox(
             mailbox_manager,
-            boost::bind(&push_finish_on_queue<protocol_t>, &chunk_queue, _1),
+            boost::bind(&push_progress_on_queue<protocol_t>, &chunk_queue, _1, _2, _3),
             mailbox_callback_mode_inline);
 
         /* The backfiller will send individual chunks of the backfill to
         `chunk_mailbox`. */
-        mailbox_t<void(backfill_chunk_t, fifo_enforcer_write_token_t)> chunk_mailbox(
-            mailbox_manager, boost::bind(&push_chunk_on_queue<protocol_t>, &chunk_queue, _1, _2), mailbox_callback_mode_inline);
+        mailbox_t<void(backfill_chunk_t, int, fifo_enforcer_write_token_t)> chunk_mailbox(
+            mailbox_manager, boost::bind(&push_chunk_on_queue<protocol_t>, &chunk_queue, _1, _2, _3), mailbox_callback_mode_inline);
 
         /* The backfiller will register for allocations on the allocation
          * registration box. */
@@ -217,7 +359,7 @@ void backfillee(
             start_point, start_point_associated_history,
             end_point_mailbox.get_address(),
             chunk_mailbox.get_address(),
-            done_mailbox.get_address(),
+            progress_mailbox.get_address(),
             alloc_registration_mbox.get_address());
 
         /* If something goes wrong, we'd like to inform the backfiller that it
@@ -306,21 +448,24 @@ void backfillee(
             }
         }
 
+        version_map_t span(span_parts.begin(), span_parts.end());
+
         object_buffer_t<fifo_enforcer_sink_t::exit_write_t> write_token;
 
         svs->new_write_token(&write_token);
 
         svs->set_metainfo(
             region_map_transform<protocol_t, version_range_t, binary_blob_t>(
-                region_map_t<protocol_t, version_range_t>(span_parts.begin(), span_parts.end()),
+                span,
                 &binary_blob_t::make<version_range_t>),
             order_source.check_in("backfillee(B)"),
             &write_token,
             interruptor);
 
-        chunk_callback_t<protocol_t> chunk_callback(svs, &chunk_queue, mailbox_manager, allocation_mailbox);
+        chunk_callback_t<protocol_t> chunk_callback(svs, &chunk_queue, mailbox_manager, allocation_mailbox,
+                                                    span, end_point, &order_source, checkpoint_bytes);
 
-        coro_pool_t<backfill_queue_entry_t<protocol_t> > backfill_workers(10, &chunk_queue, &chunk_callback);
+        coro_pool_t<backfill_queue_entry_t<protocol_t> > backfill_workers(BACKFILL_APPLY_CONCURRENCY, &chunk_queue, &chunk_callback);
 
         /* Now wait for the backfill to be over */
         {
@@ -361,7 +506,8 @@ template void backfillee<mock::dummy_protocol_t>(
         mock::dummy_protocol_t::region_t region,
         clone_ptr_t<watchable_t<boost::optional<boost::optional<backfiller_business_card_t<mock::dummy_protocol_t> > > > > backfiller_metadata,
         backfill_session_id_t backfill_session_id,
-        signal_t *interruptor)
+        signal_t *interruptor,
+        int64_t checkpoint_bytes)
     THROWS_ONLY(interrupted_exc_t, resource_lost_exc_t);
 
 template void backfillee<memcached_protocol_t>(
@@ -371,7 +517,8 @@ template void backfillee<memcached_protocol_t>(
         memcached_protocol_t::region_t region,
         clone_ptr_t<watchable_t<boost::optional<boost::optional<backfiller_business_card_t<memcached_protocol_t> > > > > backfiller_metadata,
         backfill_session_id_t backfill_session_id,
-        signal_t *interruptor)
+        signal_t *interruptor,
+        int64_t checkpoint_bytes)
     THROWS_ONLY(interrupted_exc_t, resource_lost_exc_t);
 
 template void backfillee<rdb_protocol_t>(
@@ -381,5 +528,6 @@ template void backfillee<rdb_protocol_t>(
         rdb_protocol_t::region_t region,
         clone_ptr_t<watchable_t<boost::optional<boost::optional<backfiller_business_card_t<rdb_protocol_t> > > > > backfiller_metadata,
         backfill_session_id_t backfill_session_id,
-        signal_t *interruptor)
+        signal_t *interruptor,
+        int64_t checkpoint_bytes)
     THROWS_ONLY(interrupted_exc_t, resource_lost_exc_t);
@@ -5,6 +5,7 @@
 #include "clustering/immediate_consistency/branch/history.hpp"
 #include "clustering/immediate_consistency/branch/metadata.hpp"
 #include "clustering/generic/resource.hpp"
+#include "config/args.hpp"
 #include "rpc/semilattice/view.hpp"
 
 template <class> class clone_ptr_t;
@@ -33,7 +34,11 @@ void backfillee(
         backfill for progress-checking purposes. */
         backfill_session_id_t backfill_session_id,
 
-        signal_t *interruptor)
+        signal_t *interruptor,
+
+        /* How many bytes of chunks to apply between writes of the progress
+        made so far to the metainfo. Only tests should need to change it. */
+        int64_t checkpoint_bytes = BACKFILL_CHECKPOINT_BYTES)
     THROWS_ONLY(interrupted_exc_t, resource_lost_exc_t);
 
 #endif /* CLUSTERING_IMMEDIATE_CONSISTENCY_BRANCH_BACKFILLEE_HPP_ */
@@ -8,8 +8,6 @@
 #include "rpc/semilattice/view.hpp"
 #include "stl_utils.hpp"
 
-#define MAX_CHUNKS_OUT 5000
-
 inline state_timestamp_t get_earliest_timestamp_of_version_range(const version_range_t &vr) {
     return vr.earliest.timestamp;
 }
@@ -85,15 +83,30 @@ bool backfiller_t<protocol_t>::confirm_and_send_metainfo(typename store_view_t<p
     return true;
 }
 
+/* Chunks are charged against the backfill window by their size on the wire.
+The backfillee hands the charge back once it has applied the chunk. We only
+count the bytes here; `send()` does the real serialization. */
+template <class protocol_t>
+int backfill_chunk_charge(const typename protocol_t::backfill_chunk_t &chunk, int64_t *bytes_out) {
+    write_message_t msg(write_message_t::COUNT_ONLY);
+    msg << chunk;
+    *bytes_out = msg.size();
+    return std::min<int64_t>(*bytes_out + BACKFILL_CHUNK_OVERHEAD_BYTES, BACKFILL_WINDOW_BYTES / 2);
+}
+
 template <class protocol_t>
 void do_send_chunk(mailbox_manager_t *mbox_manager,
-                   mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, fifo_enforcer_write_token_t)> chunk_addr,
+                   mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, int, fifo_enforcer_write_token_t)> chunk_addr,
                    const typename protocol_t::backfill_chunk_t &chunk,
                    fifo_enforcer_source_t *fifo_src,
-                   semaphore_t *chunk_semaphore,
+                   semaphore_t *window_semaphore,
+                   traversal_progress_combiner_t *progress,
                    signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
-    chunk_semaphore->co_lock_interruptible(interruptor);
-    send(mbox_manager, chunk_addr, chunk, fifo_src->enter_write());
+    int64_t bytes;
+    int charge = backfill_chunk_charge<protocol_t>(chunk, &bytes);
+    window_semaphore->co_lock_interruptible(interruptor, charge);
+    progress->add_bytes_sent(bytes);
+    send(mbox_manager, MESSAGE_PRIORITY_BULK, chunk_addr, chunk, charge, fifo_src->enter_write());
 }
 
 template <class protocol_t>
@@ -102,16 +115,20 @@ public:
     backfiller_send_backfill_callback_t(const region_map_t<protocol_t, version_range_t> *start_point,
                                         mailbox_addr_t<void(region_map_t<protocol_t, version_range_t>, branch_history_t<protocol_t>)> end_point_cont,
                                         mailbox_manager_t *mailbox_manager,
-                                        mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, fifo_enforcer_write_token_t)> chunk_cont,
+                                        mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, int, fifo_enforcer_write_token_t)> chunk_cont,
+                                        mailbox_addr_t<void(typename protocol_t::region_t, bool, fifo_enforcer_write_token_t)> progress_cont,
                                         fifo_enforcer_source_t *fifo_src,
-                                        semaphore_t *chunk_semaphore,
+                                        semaphore_t *window_semaphore,
+                                        traversal_progress_combiner_t *progress,
                                         backfiller_t<protocol_t> *backfiller)
         : start_point_(start_point),
           end_point_cont_(end_point_cont),
           mailbox_manager_(mailbox_manager),
           chunk_cont_(chunk_cont),
+          progress_cont_(progress_cont),
           fifo_src_(fifo_src),
-          chunk_semaphore_(chunk_semaphore),
+          window_semaphore_(window_semaphore),
+          progress_(progress),
           backfiller_(backfiller) { }
 
     bool should_backfill_impl(const typename store_view_t<protocol_t>::metainfo_t &metainfo) {
@@ -119,15 +136,24 @@ public:
     }
 
     void send_chunk(const typename protocol_t::backfill_chunk_t &chunk, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
-        do_send_chunk<protocol_t>(mailbox_manager_, chunk_cont_, chunk, fifo_src_, chunk_semaphore_, interruptor);
+        do_send_chunk<protocol_t>(mailbox_manager_, chunk_cont_, chunk, fifo_src_, window_semaphore_, progress_, interruptor);
+    }
+
+    /* Checkpoints go through the same FIFO as the chunks, so the backfillee
+    sees one only after every chunk it covers. They don't count against the
+    window. */
+    void send_checkpoint(const typename protocol_t::region_t &region, UNUSED signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        send(mailbox_manager_, MESSAGE_PRIORITY_BULK, progress_cont_, region, false, fifo_src_->enter_write());
     }
 private:
     const region_map_t<protocol_t, version_range_t> *start_point_;
     mailbox_addr_t<void(region_map_t<protocol_t, version_range_t>, branch_history_t<protocol_t>)> end_point_cont_;
     mailbox_manager_t *mailbox_manager_;
-    mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, fifo_enforcer_write_token_t)> chunk_cont_;
+    mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, int, fifo_enforcer_write_token_t)> chunk_cont_;
+    mailbox_addr_t<void(typename protocol_t::region_t, bool, fifo_enforcer_write_token_t)> progress_cont_;
     fifo_enforcer_source_t *fifo_src_;
-    semaphore_t *chunk_semaphore_;
+    semaphore_t *window_semaphore_;
+    traversal_progress_combiner_t *progress_;
     backfiller_t<protocol_t> *backfiller_;
 
     DISABLE_COPYING(backfiller_send_backfill_callback_t);
@@ -138,8 +164,8 @@ void backfiller_t<protocol_t>::on_backfill(backfill_session_id_t session_id,
                                            const region_map_t<protocol_t, version_range_t> &start_point,
                                            const branch_history_t<protocol_t> &start_point_associated_branch_history,
                                            mailbox_addr_t<void(region_map_t<protocol_t, version_range_t>, branch_history_t<protocol_t>)> end_point_cont,
-                                           mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, fifo_enforcer_write_token_t)> chunk_cont,
-                                           mailbox_addr_t<void(fifo_enforcer_write_token_t)> done_cont,
+                                           mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, int, fifo_enforcer_write_token_t)> chunk_cont,
+                                           mailbox_addr_t<void(typename protocol_t::region_t, bool, fifo_enforcer_write_token_t)> progress_cont,
                                            mailbox_addr_t<void(mailbox_addr_t<void(int)>)> allocation_registration_box,
                                            auto_drainer_t::lock_t keepalive) {
 
@@ -160,8 +186,10 @@ void backfiller_t<protocol_t>::on_backfill(backfill_session_id_t session_id,
        wait on that cond yet. */
     wait_any_t interrupted(&local_interruptor, keepalive.get_drain_signal());
 
-    semaphore_t chunk_semaphore(MAX_CHUNKS_OUT);
-    mailbox_t<void(int)> receive_allocations_mbox(mailbox_manager, boost::bind(&semaphore_t::unlock, &chunk_semaphore, _1), mailbox_callback_mode_inline);
+    /* The backfillee gives us back the bytes of window that each chunk was
+    charged as it applies them, in batches. */
+    semaphore_t window_semaphore(BACKFILL_WINDOW_BYTES);
+    mailbox_t<void(int)> receive_allocations_mbox(mailbox_manager, boost::bind(&semaphore_t::unlock, &window_semaphore, _1), mailbox_callback_mode_inline);
     send(mailbox_manager, allocation_registration_box, receive_allocations_mbox.get_address());
 
     try {
@@ -177,7 +205,7 @@ void backfiller_t<protocol_t>::on_backfill(backfill_session_id_t session_id,
         svs->new_read_token(&send_backfill_token);
 
         backfiller_send_backfill_callback_t<protocol_t>
-            send_backfill_cb(&start_point, end_point_cont, mailbox_manager, chunk_cont, &fifo_src, &chunk_semaphore, this);
+            send_backfill_cb(&start_point, end_point_cont, mailbox_manager, chunk_cont, progress_cont, &fifo_src, &window_semaphore, &local_progress, this);
 
         /* Actually perform the backfill */
         svs->send_backfill(
@@ -190,8 +218,8 @@ void backfiller_t<protocol_t>::on_backfill(backfill_session_id_t session_id,
                      &send_backfill_token,
                      &interrupted);
 
-        /* Send a confirmation */
-        send(mailbox_manager, done_cont, fifo_src.enter_write());
+        /* Send a confirmation; that's a checkpoint for the whole domain. */
+        send(mailbox_manager, progress_cont, start_point.get_domain(), true, fifo_src.enter_write());
 
     } catch (interrupted_exc_t) {
         /* Ignore. If we were interrupted by the backfillee, then it already
@@ -223,15 +251,22 @@ void backfiller_t<protocol_t>::on_cancel_backfill(backfill_session_id_t session_
 
 template <class protocol_t>
 void backfiller_t<protocol_t>::request_backfill_progress(backfill_session_id_t session_id,
-                                                         mailbox_addr_t<void(std::pair<int, int>)> response_mbox,
+                                                         mailbox_addr_t<void(backfill_progress_report_t)> response_mbox,
                                                          auto_drainer_t::lock_t) {
+    backfill_progress_report_t report;
     if (std_contains(local_backfill_progress, session_id) && local_backfill_progress[session_id]) {
-        progress_completion_fraction_t fraction = local_backfill_progress[session_id]->guess_completion();
-        std::pair<int, int> pair_fraction = std::make_pair(fraction.estimate_of_released_nodes, fraction.estimate_of_total_nodes);
-        send(mailbox_manager, response_mbox, pair_fraction);
-    } else {
-        send(mailbox_manager, response_mbox, std::make_pair(-1, -1));
+        traversal_progress_combiner_t *progress = local_backfill_progress[session_id];
+        report.bytes_sent = progress->get_bytes_sent();
+        report.bytes_per_sec = progress->guess_bytes_per_sec();
+        progress_completion_fraction_t fraction = progress->guess_completion();
+        report.released_nodes = fraction.estimate_of_released_nodes;
+        report.total_nodes = fraction.estimate_of_total_nodes;
+        /* `guess_completion()` blocks, so the backfill might be over by now. */
+        if (std_contains(local_backfill_progress, session_id)) {
+            report.eta_secs = progress->guess_secs_remaining(fraction);
+        }
     }
+    send(mailbox_manager, response_mbox, report);
 
     //TODO indicate an error has occurred
 }
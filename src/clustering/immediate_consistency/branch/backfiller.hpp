@@ -38,15 +38,15 @@ private:
             const region_map_t<protocol_t, version_range_t> &start_point,
             const branch_history_t<protocol_t> &start_point_associated_branch_history,
             mailbox_addr_t<void(region_map_t<protocol_t, version_range_t>, branch_history_t<protocol_t>)> end_point_cont,
-            mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, fifo_enforcer_write_token_t)> chunk_cont,
-            mailbox_addr_t<void(fifo_enforcer_write_token_t)> done_cont,
+            mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, int, fifo_enforcer_write_token_t)> chunk_cont,
+            mailbox_addr_t<void(typename protocol_t::region_t, bool, fifo_enforcer_write_token_t)> progress_cont,
             mailbox_addr_t<void(mailbox_addr_t<void(int)>)> allocation_registration_box,
             auto_drainer_t::lock_t keepalive);
 
     void on_cancel_backfill(backfill_session_id_t session_id, UNUSED auto_drainer_t::lock_t);
 
     void request_backfill_progress(backfill_session_id_t session_id,
-                                   mailbox_addr_t<void(std::pair<int, int>)> response_mbox,
+                                   mailbox_addr_t<void(backfill_progress_report_t)> response_mbox,
                                    auto_drainer_t::lock_t);
 
     mailbox_manager_t *const mailbox_manager;
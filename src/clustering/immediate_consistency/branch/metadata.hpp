@@ -97,6 +97,22 @@ backfills over the network. It appears in the directory. */
 
 typedef uuid_u backfill_session_id_t;
 
+/* What a backfiller answers when asked how a backfill is going. The node counts
+come from the traversal of the backfiller's store and are -1 if it can't tell
+yet; so is `eta_secs`. */
+struct backfill_progress_report_t {
+    backfill_progress_report_t()
+        : released_nodes(-1), total_nodes(-1), bytes_sent(0), bytes_per_sec(0), eta_secs(-1) { }
+
+    int released_nodes;
+    int total_nodes;
+    int64_t bytes_sent;
+    double bytes_per_sec;
+    double eta_secs;
+
+    RDB_MAKE_ME_SERIALIZABLE_5(released_nodes, total_nodes, bytes_sent, bytes_per_sec, eta_secs);
+};
+
 template<class protocol_t>
 struct backfiller_business_card_t {
 
@@ -108,8 +124,10 @@ struct backfiller_business_card_t {
             region_map_t<protocol_t, version_range_t>,
             branch_history_t<protocol_t>
             ) >,
-        mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, fifo_enforcer_write_token_t)>,
-        mailbox_t<void(fifo_enforcer_write_token_t)>::address_t,
+        mailbox_addr_t<void(typename protocol_t::backfill_chunk_t, int, fifo_enforcer_write_token_t)>,
+        /* Checkpoints: every chunk for the region has been sent. The bool is
+        true for the last message, which covers the whole backfill. */
+        mailbox_addr_t<void(typename protocol_t::region_t, bool, fifo_enforcer_write_token_t)>,
         mailbox_t<void(mailbox_addr_t<void(int)>)>::address_t
         )> backfill_mailbox_t;
 
@@ -117,7 +135,7 @@ struct backfiller_business_card_t {
 
 
     /* Mailboxes used for requesting the progress of a backfill */
-    typedef mailbox_t<void(backfill_session_id_t, mailbox_addr_t<void(std::pair<int, int>)>)> request_progress_mailbox_t;
+    typedef mailbox_t<void(backfill_session_id_t, mailbox_addr_t<void(backfill_progress_report_t)>)> request_progress_mailbox_t;
 
     backfiller_business_card_t() { }
     backfiller_business_card_t(
@@ -3,6 +3,7 @@
 #include "clustering/immediate_consistency/query/master_access.hpp"
 #include "concurrency/fifo_enforcer.hpp"
 #include "concurrency/watchable.hpp"
+#include "perfmon/trace.hpp"
 
 template <class protocol_t>
 cluster_namespace_interface_t<protocol_t>::cluster_namespace_interface_t(
@@ -89,10 +90,16 @@ void cluster_namespace_interface_t<protocol_t>::dispatch_immediate_op(
     THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
     if (interruptor->is_pulsed()) throw interrupted_exc_t();
 
-    boost::ptr_vector<immediate_op_info_t<fifo_enforcer_token_type> > masters_to_contact;
+    boost::ptr_vector<immediate_op_info_t<op_type, fifo_enforcer_token_type> > masters_to_contact;
     {
         region_map_t<protocol_t, std::set<relationship_t *> > submap = relationships.mask(op.get_region());
         for (typename region_map_t<protocol_t, std::set<relationship_t *> >::iterator it = submap.begin(); it != submap.end(); it++) {
+            /* An operation that touches scattered keys (a multi-get, say) covers
+            shards that none of its keys are in. Don't bother those masters. */
+            op_type sharded_op = op.shard(it->first);
+            if (region_is_empty(sharded_op.get_region())) {
+                continue;
+            }
             relationship_t *chosen_relationship = NULL;
             for (typename std::set<relationship_t *>::const_iterator jt = it->second.begin(); jt != it->second.end(); jt++) {
                 if ((*jt)->master_access) {
@@ -105,12 +112,14 @@ void cluster_namespace_interface_t<protocol_t>::dispatch_immediate_op(
             if (!chosen_relationship) {
                 throw cannot_perform_query_exc_t("No master available");
             }
-            immediate_op_info_t<fifo_enforcer_token_type> *new_op_info =
-                new immediate_op_info_t<fifo_enforcer_token_type>();
+            immediate_op_info_t<op_type, fifo_enforcer_token_type> *new_op_info =
+                new immediate_op_info_t<op_type, fifo_enforcer_token_type>();
             new_op_info->region = it->first;
+            new_op_info->sharded_op = sharded_op;
             new_op_info->master_access = chosen_relationship->master_access;
             (new_op_info->master_access->*how_to_make_token)(&new_op_info->enforcement_token);
             new_op_info->keepalive = auto_drainer_t::lock_t(&chosen_relationship->drainer);
+            new_op_info->trace = current_trace();
             masters_to_contact.push_back(new_op_info);
         }
     }
@@ -141,6 +150,7 @@ void cluster_namespace_interface_t<protocol_t>::dispatch_immediate_op(
         }
     }
 
+    traced_span_t span("unshard");
     op.unshard(results.data(), results.size(), response, ctx);
 }
 
@@ -148,8 +158,8 @@ template <class protocol_t>
 template<class op_type, class fifo_enforcer_token_type, class op_response_type>
 void cluster_namespace_interface_t<protocol_t>::perform_immediate_op(
     void (master_access_t<protocol_t>::*how_to_run_query)(const op_type &, op_response_type *, order_token_t, fifo_enforcer_token_type *, signal_t *) THROWS_ONLY(interrupted_exc_t, resource_lost_exc_t, cannot_perform_query_exc_t),
-    boost::ptr_vector<immediate_op_info_t<fifo_enforcer_token_type> > *masters_to_contact,
-    const op_type *operation,
+    boost::ptr_vector<immediate_op_info_t<op_type, fifo_enforcer_token_type> > *masters_to_contact,
+    DEBUG_VAR const op_type *operation,
     std::vector<op_response_type> *results,
     std::vector<std::string> *failures,
     order_token_t order_token,
@@ -157,11 +167,14 @@ void cluster_namespace_interface_t<protocol_t>::perform_immediate_op(
     signal_t *interruptor)
     THROWS_NOTHING
 {
-    immediate_op_info_t<fifo_enforcer_token_type> *master_to_contact = &(*masters_to_contact)[i];
-    op_type sharded_op = operation->shard(master_to_contact->region);
+    immediate_op_info_t<op_type, fifo_enforcer_token_type> *master_to_contact = &(*masters_to_contact)[i];
+    const op_type &sharded_op = master_to_contact->sharded_op;
     rassert(region_is_superset(master_to_contact->region, sharded_op.get_region()));
     rassert(region_is_superset(operation->get_region(), sharded_op.get_region()));
 
+    trace_scope_t trace_scope(master_to_contact->trace);
+    traced_span_t span("master round trip");
+
     try {
         (master_to_contact->master_access->*how_to_run_query)(sharded_op,
                                                               &results->at(i),
@@ -193,6 +206,10 @@ cluster_namespace_interface_t<protocol_t>::dispatch_outdated_read(const typename
     {
         region_map_t<protocol_t, std::set<relationship_t *> > submap = relationships.mask(op.get_region());
         for (typename region_map_t<protocol_t, std::set<relationship_t *> >::iterator it = submap.begin(); it != submap.end(); it++) {
+            typename protocol_t::read_t sharded_op = op.shard(it->first);
+            if (region_is_empty(sharded_op.get_region())) {
+                continue;
+            }
             std::vector<relationship_t *> potential_relationships;
             relationship_t *chosen_relationship = NULL;
             for (typename std::set<relationship_t *>::const_iterator jt = it->second.begin(); jt != it->second.end(); jt++) {
@@ -215,8 +232,10 @@ cluster_namespace_interface_t<protocol_t>::dispatch_outdated_read(const typename
             }
             outdated_read_info_t *new_op_info = new outdated_read_info_t();
             new_op_info->region = it->first;
+            new_op_info->sharded_op = sharded_op;
             new_op_info->direct_reader_access = chosen_relationship->direct_reader_access;
             new_op_info->keepalive = auto_drainer_t::lock_t(&chosen_relationship->drainer);
+            new_op_info->trace = current_trace();
             direct_readers_to_contact.push_back(new_op_info);
         }
     }
@@ -234,6 +253,7 @@ cluster_namespace_interface_t<protocol_t>::dispatch_outdated_read(const typename
         }
     }
 
+    traced_span_t span("unshard");
     op.unshard(results.data(), results.size(), response, ctx);
 }
 
@@ -246,7 +266,7 @@ void outdated_read_store_result(typename protocol_t::read_response_t *result_out
 template <class protocol_t>
 void cluster_namespace_interface_t<protocol_t>::perform_outdated_read(
     boost::ptr_vector<outdated_read_info_t> *direct_readers_to_contact,
-    const typename protocol_t::read_t *operation,
+    DEBUG_VAR const typename protocol_t::read_t *operation,
     std::vector<typename protocol_t::read_response_t> *results,
     std::vector<std::string> *failures,
     int i,
@@ -254,10 +274,13 @@ void cluster_namespace_interface_t<protocol_t>::perform_outdated_read(
     THROWS_NOTHING
 {
     outdated_read_info_t *direct_reader_to_contact = &(*direct_readers_to_contact)[i];
-    typename protocol_t::read_t sharded_op = operation->shard(direct_reader_to_contact->region);
+    const typename protocol_t::read_t &sharded_op = direct_reader_to_contact->sharded_op;
     rassert(region_is_superset(direct_reader_to_contact->region, sharded_op.get_region()));
     rassert(region_is_superset(operation->get_region(), sharded_op.get_region()));
 
+    trace_scope_t trace_scope(direct_reader_to_contact->trace);
+    traced_span_t span("direct reader round trip");
+
     try {
         cond_t done;
         mailbox_t<void(typename protocol_t::read_response_t)> cont(mailbox_manager,
@@ -28,6 +28,7 @@ template <class> class cow_ptr_t;
 template <class protocol_t> class master_access_t;
 template <class protocol_t> class resource_access_t;
 class resource_lost_exc_t;
+class trace_t;
 template <class> class watchable_t;
 template <class> class watchable_subscription_t;
 
@@ -97,20 +98,26 @@ private:
     handling writes, so it's factored out into the `dispatch_immediate_op()`
     function. */
 
-    template<class fifo_enforcer_token_type>
+    template<class op_type, class fifo_enforcer_token_type>
     class immediate_op_info_t {
     public:
         typename protocol_t::region_t region;
+        op_type sharded_op;
         master_access_t<protocol_t> *master_access;
         fifo_enforcer_token_type enforcement_token;
         auto_drainer_t::lock_t keepalive;
+        /* The dispatching coroutine's trace (see perfmon/trace.hpp), for the
+        coroutine that contacts the master. */
+        trace_t *trace;
     };
 
     class outdated_read_info_t {
     public:
         typename protocol_t::region_t region;
+        typename protocol_t::read_t sharded_op;
         resource_access_t<direct_reader_business_card_t<protocol_t> > *direct_reader_access;
         auto_drainer_t::lock_t keepalive;
+        trace_t *trace;
     };
 
     template<class op_type, class fifo_enforcer_token_type, class op_response_type>
@@ -127,7 +134,7 @@ private:
     template<class op_type, class fifo_enforcer_token_type, class op_response_type>
     void perform_immediate_op(
             void (master_access_t<protocol_t>::*how_to_run_query)(const op_type &, op_response_type *, order_token_t, fifo_enforcer_token_type *, signal_t *) THROWS_ONLY(interrupted_exc_t, resource_lost_exc_t, cannot_perform_query_exc_t),
-            boost::ptr_vector<immediate_op_info_t<fifo_enforcer_token_type> > *masters_to_contact,
+            boost::ptr_vector<immediate_op_info_t<op_type, fifo_enforcer_token_type> > *masters_to_contact,
             const op_type *operation,
             std::vector<op_response_type> *results,
             std::vector<std::string> *failures,
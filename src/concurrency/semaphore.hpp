@@ -42,7 +42,7 @@ public:
 
     void co_lock(int count = 1);
 
-    void co_lock_interruptible(signal_t *interruptor);
+    void co_lock_interruptible(signal_t *interruptor, int count = 1);
 
     void unlock(int count = 1);
     void lock_now(int count = 1);
@@ -98,6 +98,10 @@
 // TODO: make this dynamic where possible
 #define MAX_THREADS                               128
 
+// How many threads busy-poll by default when `--busy-poll-usec` is set. Every
+// busy-polling thread keeps a core spinning, so this is kept small.
+#define DEFAULT_BUSY_POLL_THREADS                 2
+
 // Ticks (in milliseconds) the internal timed tasks are performed at
 #define TIMER_TICKS_IN_MS                         5
 
@@ -247,10 +251,102 @@
 // The size of zones the serializer will divide a block device into
 #define DEFAULT_FILE_ZONE_SIZE                    GIGABYTE
 
+// How many bytes of backfill chunks a backfiller may have sent that the
+// backfillee hasn't applied yet, per backfill.
+#define BACKFILL_WINDOW_BYTES                     (32 * MEGABYTE)
+
+// The backfillee hands credit back to the backfiller in batches of this many
+// bytes. No chunk is charged more than half the window, so the credit still
+// held back at the end of a batch can never stall the backfiller.
+#define BACKFILL_ACK_BYTES                        (BACKFILL_WINDOW_BYTES / 8)
+
+// What each backfill chunk is charged on top of its serialized size, so that
+// a flood of tiny chunks is limited as well.
+#define BACKFILL_CHUNK_OVERHEAD_BYTES             256
+
+// How many backfill chunks the backfillee applies to its store at once.
+#define BACKFILL_APPLY_CONCURRENCY                32
+
+// The backfillee records which parts of the backfill it has finished in the
+// store's metainfo after applying about this many bytes of chunks, so that an
+// interrupted backfill can pick up where it left off.
+#define BACKFILL_CHECKPOINT_BYTES                 (64 * MEGABYTE)
+
 #define COROUTINE_STACK_SIZE                      131072
 
+// Coroutine stacks are kept around for reuse when their coroutines finish. Past
+// this many idle coroutines per thread, the pages of the idle stacks are given
+// back to the OS (the address space and guard page are kept).
+#define COROUTINE_IDLE_STACKS_RESIDENT            256
+
 #define MAX_COROS_PER_THREAD                      10000
 
+// How many pieces of stealable work (see arch/runtime/work_stealing.hpp) an idle
+// thread takes from other threads before it looks at its own file descriptors
+// again.
+#define MAX_STEALS_PER_PUMP                       16
+
+// Client protobuf messages at least this big are parsed and serialized as
+// stealable work, so a few huge queries don't hold up a whole thread.
+#define PROTOB_STEALABLE_MESSAGE_BYTES            (64 * KILOBYTE)
+
+// A stats request for the same set of stats as one answered less than this many
+// milliseconds ago gets the same answer, instead of walking every perfmon on
+// every thread again. This is the default for `--stats-snapshot-interval`.
+#define STATS_SNAPSHOT_INTERVAL_MS                1000
+
+// How many stacks the sampling profiler (see arch/runtime/profiler.hpp) keeps
+// at most during one profile; samples past this are dropped.
+#define PROFILER_MAX_SAMPLES                      20000
+
+// How many earlier stats responses the stats HTTP app remembers, so that
+// clients can ask for only what changed since one of them. A snapshot is
+// forgotten once a delta against it has been sent, so this bounds how many
+// clients can poll for deltas at once.
+#define STATS_DELTA_SNAPSHOTS                     64
+
+// One in this many RDB queries on each thread is traced (see perfmon/trace.hpp)
+// even if the client didn't ask for it, and if it takes at least
+// RDB_SLOW_QUERY_LOG_MS milliseconds its trace is written to the log.
+#define RDB_TRACE_SAMPLE_INTERVAL                 100
+#define RDB_SLOW_QUERY_LOG_MS                     500
+
+// Past this many spans, a trace folds further spans with the same name into one
+// (see perfmon/trace.hpp), so that tracing a query over many rows or blocks
+// doesn't use unbounded memory, or bandwidth to send the spans back.
+#define TRACE_MAX_SPANS                           256
+
+// How many of the most read and written keys and key prefixes each btree slice
+// keeps track of (see btree/hot_keys.hpp), how many operations go by before
+// their counts are halved, and how many bytes of a key make up its prefix.
+#define HOT_KEYS_TRACKED                          16
+#define HOT_KEYS_DECAY_INTERVAL                   65536
+#define HOT_KEY_PREFIX_BYTES                      8
+
+// Btree operations that take at least this many milliseconds are remembered
+// in their slice's slow operation log, which holds the SLOW_OP_LOG_SIZE most
+// recent ones.
+#define BTREE_SLOW_OP_MS                          100
+#define SLOW_OP_LOG_SIZE                          32
+
+// An HTTP connection that has been waiting this many milliseconds for its next
+// request is closed.
+#define HTTP_KEEPALIVE_TIMEOUT_MS                 (60 * 1000)
+
+// Streamed HTTP response bodies are sent in chunks of about this many bytes,
+// and bodies smaller than HTTP_GZIP_MIN_BYTES aren't worth gzipping.
+#define HTTP_CHUNK_BYTES                          (16 * KILOBYTE)
+#define HTTP_GZIP_MIN_BYTES                       1024
+
+// A request to watch the cluster metadata for changes waits this many
+// milliseconds for one unless it asks for some other time, which can't be more
+// than METADATA_WATCH_MAX_TIMEOUT_MS. The METADATA_WATCH_SNAPSHOTS most recent
+// versions of the metadata are kept, so that clients that have one of them can
+// be sent just what changed.
+#define METADATA_WATCH_DEFAULT_TIMEOUT_MS         (30 * 1000)
+#define METADATA_WATCH_MAX_TIMEOUT_MS             (120 * 1000)
+#define METADATA_WATCH_SNAPSHOTS                  16
+
 
 // Size of a cache line (used in cache_line_padded_t).
 #define CACHE_LINE_SIZE                           64
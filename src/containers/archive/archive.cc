@@ -39,6 +39,11 @@ write_message_t::~write_message_t() {
 }
 
 void write_message_t::append(const void *p, int64_t n) {
+    if (count_only_) {
+        counted_ += n;
+        return;
+    }
+
     while (n > 0) {
         if (buffers_.empty() || buffers_.tail()->size == write_buffer_t::DATA_SIZE) {
             buffers_.push_back(new write_buffer_t);
@@ -54,7 +59,20 @@ void write_message_t::append(const void *p, int64_t n) {
     }
 }
 
+int64_t write_message_t::size() const {
+    if (count_only_) {
+        return counted_;
+    }
+
+    int64_t ret = 0;
+    for (write_buffer_t *b = buffers_.head(); b; b = buffers_.next(b)) {
+        ret += b->size;
+    }
+    return ret;
+}
+
 int send_write_message(write_stream_t *s, const write_message_t *msg) {
+    rassert(!msg->count_only_);
     intrusive_list_t<write_buffer_t> *list = const_cast<write_message_t *>(msg)->unsafe_expose_buffers();
     for (write_buffer_t *p = list->head(); p; p = list->next(p)) {
         int64_t res = s->write(p->data, p->size);
@@ -92,11 +92,19 @@ private:
 // to a write_message_t, and then flush that to a write_stream_t.
 class write_message_t {
 public:
-    write_message_t() { }
+    enum count_only_t { COUNT_ONLY };
+
+    write_message_t() : count_only_(false), counted_(0) { }
+    // A message that keeps none of what is appended to it, only how much.
+    // Serialize into one to find out how big something is on the wire.
+    explicit write_message_t(count_only_t) : count_only_(true), counted_(0) { }
     ~write_message_t();
 
     void append(const void *p, int64_t n);
 
+    // The number of bytes appended so far.
+    int64_t size() const;
+
     intrusive_list_t<write_buffer_t> *unsafe_expose_buffers() { return &buffers_; }
 
     // This _could_ destroy the object yo.
@@ -109,6 +117,8 @@ public:
 private:
     friend int send_write_message(write_stream_t *s, const write_message_t *msg);
 
+    bool count_only_;
+    int64_t counted_;
     intrusive_list_t<write_buffer_t> buffers_;
 
     DISABLE_COPYING(write_message_t);
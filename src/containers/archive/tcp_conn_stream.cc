@@ -39,6 +39,20 @@ int64_t tcp_conn_stream_t::write(const void *p, int64_t n) {
     }
 }
 
+int64_t tcp_conn_stream_t::writev(struct iovec *iov, int iovcnt) {
+    int64_t n = 0;
+    for (int i = 0; i < iovcnt; ++i) {
+        n += iov[i].iov_len;
+    }
+    try {
+        cond_t non_closer;
+        conn_->writev(iov, iovcnt, &non_closer);
+        return n;
+    } catch (const tcp_conn_write_closed_exc_t &) {
+        return -1;
+    }
+}
+
 void tcp_conn_stream_t::rethread(int new_thread) {
     conn_->rethread(new_thread);
 }
@@ -98,6 +112,14 @@ int64_t keepalive_tcp_conn_stream_t::write(const void *p, int64_t n) {
     return tcp_conn_stream_t::write(p, n);
 }
 
+int64_t keepalive_tcp_conn_stream_t::writev(struct iovec *iov, int iovcnt) {
+    if (keepalive_callback != NULL) {
+        keepalive_callback->keepalive_write();
+    }
+
+    return tcp_conn_stream_t::writev(iov, iovcnt);
+}
+
 rethread_tcp_conn_stream_t::rethread_tcp_conn_stream_t(tcp_conn_stream_t *conn, int thread) : conn_(conn), old_thread_(conn->home_thread()), new_thread_(thread) {
     conn->rethread(thread);
     rassert(conn->home_thread() == thread);
@@ -2,6 +2,8 @@
 #ifndef CONTAINERS_ARCHIVE_TCP_CONN_STREAM_HPP_
 #define CONTAINERS_ARCHIVE_TCP_CONN_STREAM_HPP_
 
+#include <sys/uio.h>
+
 #include "containers/archive/archive.hpp"
 #include "arch/address.hpp"
 #include "arch/types.hpp"
@@ -19,6 +21,11 @@ public:
     virtual MUST_USE int64_t read(void *p, int64_t n);
     virtual MUST_USE int64_t write(const void *p, int64_t n);
 
+    // Writes all of the buffers in `iov` in as few system calls as possible.
+    // Returns the total number of bytes written, or -1 upon error. The
+    // contents of `iov` are clobbered.
+    virtual MUST_USE int64_t writev(struct iovec *iov, int iovcnt);
+
     void rethread(int new_thread);
 
     int home_thread() const;
@@ -57,6 +64,7 @@ public:
 
     virtual MUST_USE int64_t read(void *p, int64_t n);
     virtual MUST_USE int64_t write(const void *p, int64_t n);
+    virtual MUST_USE int64_t writev(struct iovec *iov, int iovcnt);
 
 private:
     keepalive_callback_t *keepalive_callback;
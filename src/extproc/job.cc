@@ -54,6 +54,25 @@ pid_t job_t::control_t::get_spawner_pid() const {
     return spawner_pid;
 }
 
+void job_t::control_t::use_shared_memory(fd_t fds[shm_channel_t::NUM_FDS]) {
+    guarantee(!shm_.has());
+    shm_.init(new shm_channel_t(shm_channel_t::WORKER_SIDE, fds));
+}
+
+int64_t job_t::control_t::read_interruptible(void *p, int64_t n, signal_t *interruptor) {
+    if (shm_.has()) {
+        return shm_->read(p, n, interruptor);
+    }
+    return unix_socket_stream_t::read_interruptible(p, n, interruptor);
+}
+
+int64_t job_t::control_t::write_interruptible(const void *p, int64_t n, signal_t *interruptor) {
+    if (shm_.has()) {
+        return shm_->write(p, n, interruptor);
+    }
+    return unix_socket_stream_t::write_interruptible(p, n, interruptor);
+}
+
 // TODO(rntz): some way to send log messages to the engine.
 void job_t::control_t::vlog(const char *fmt, va_list ap) {
     flockfile(stderr);
@@ -7,6 +7,8 @@
 #include "arch/runtime/runtime_utils.hpp" // fd_t
 #include "containers/archive/archive.hpp"
 #include "containers/archive/socket_stream.hpp"
+#include "containers/scoped.hpp"
+#include "extproc/shm_channel.hpp"
 
 namespace extproc {
 
@@ -23,6 +25,16 @@ class job_t {
 
         pid_t get_spawner_pid() const;
 
+        // Moves all further traffic with the engine onto a shared memory
+        // channel. Takes ownership of `fds`, which come from
+        // shm_channel_t::create() on the engine side.
+        void use_shared_memory(fd_t fds[shm_channel_t::NUM_FDS]);
+
+        // Go through the shared memory channel if there is one, and through
+        // the socket otherwise.
+        virtual MUST_USE int64_t read_interruptible(void *p, int64_t n, signal_t *interruptor);
+        virtual int64_t write_interruptible(const void *p, int64_t n, signal_t *interruptor);
+
       private:
         friend void exec_worker(pid_t spawner_pid, fd_t sockfd);
 
@@ -30,6 +42,7 @@ class job_t {
 
         const pid_t pid;
         const pid_t spawner_pid;
+        scoped_ptr_t<shm_channel_t> shm_;
 
         DISABLE_COPYING(control_t);
     };
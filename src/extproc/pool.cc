@@ -50,7 +50,7 @@ void pool_t::repair_invariants() {
     rassert(num_workers() >= config()->min_workers);
 }
 
-pool_t::worker_t *pool_t::acquire_worker() {
+pool_t::worker_t *pool_t::acquire_worker(pid_t preferred_pid) {
     assert_thread();
 
     // We're going to be using up a worker process, so we lock the semaphore.
@@ -72,7 +72,17 @@ pool_t::worker_t *pool_t::acquire_worker() {
     guarantee(!idle_workers_.empty()); // sanity
 
     // Grab an idle worker, move it to the busy list, assign it to `handle`.
+    // There are only ever a handful of workers per thread, so a linear scan
+    // for the preferred one is fine.
     worker_t *worker = idle_workers_.head();
+    if (preferred_pid != -1) {
+        for (worker_t *w = idle_workers_.head(); w; w = idle_workers_.next(w)) {
+            if (w->pid_ == preferred_pid) {
+                worker = w;
+                break;
+            }
+        }
+    }
     idle_workers_.remove(worker);
     busy_workers_.push_back(worker);
     return worker;
@@ -134,7 +144,18 @@ class job_acceptor_t :
         public auto_job_t<job_acceptor_t>
 {
   public:
+    job_acceptor_t() : use_shared_memory_(false) {}
+    explicit job_acceptor_t(bool use_shared_memory) : use_shared_memory_(use_shared_memory) {}
+
     void run_job(control_t *control, UNUSED void *extra) {
+        if (use_shared_memory_) {
+            // The engine follows us with the fds of our shared memory channel.
+            fd_t fds[shm_channel_t::NUM_FDS];
+            guarantee(ARCHIVE_SUCCESS == control->recv_fds(shm_channel_t::NUM_FDS, fds),
+                      "worker: could not receive shared memory fds");
+            control->use_shared_memory(fds);
+        }
+
         while (-1 != accept_job(control, NULL)) {}
 
         // The "correct" way for us to die is to be killed by the engine
@@ -142,7 +163,8 @@ class job_acceptor_t :
         exit(EXIT_FAILURE);
     }
 
-    RDB_MAKE_ME_SERIALIZABLE_0();
+    bool use_shared_memory_;
+    RDB_MAKE_ME_SERIALIZABLE_1(use_shared_memory_);
 };
 
 void pool_t::spawn_workers(int num) {
@@ -167,10 +189,28 @@ void pool_t::spawn_workers(int num) {
     for (int i = 0; i < num; ++i) {
         worker_t *worker = new worker_t(this, pids[i], &fds[i]);
 
+        scoped_fd_t shm_fds[shm_channel_t::NUM_FDS];
+        bool use_shm = config()->use_shared_memory && shm_channel_t::create(shm_fds);
+
         // Send it a job that just loops accepting jobs.
-        guarantee(0 == job_acceptor_t().send_over(worker),
+        guarantee(0 == job_acceptor_t(use_shm).send_over(worker),
                   "Could not initialize worker process.");
 
+        if (use_shm) {
+            // The worker gets its own copies of the fds; ours go to our end
+            // of the channel.
+            fd_t raw_fds[shm_channel_t::NUM_FDS];
+            for (size_t j = 0; j < shm_channel_t::NUM_FDS; ++j) {
+                raw_fds[j] = shm_fds[j].get();
+            }
+            guarantee(0 == worker->send_fds(shm_channel_t::NUM_FDS, raw_fds),
+                      "Could not send shared memory to worker process.");
+            for (size_t j = 0; j < shm_channel_t::NUM_FDS; ++j) {
+                raw_fds[j] = shm_fds[j].release();
+            }
+            worker->shm_.init(new shm_channel_t(shm_channel_t::ENGINE_SIDE, raw_fds));
+        }
+
         // We've successfully spawned one worker.
         guarantee(num_spawning_workers_ > 0); // sanity
         --num_spawning_workers_;
@@ -207,6 +247,20 @@ void pool_t::worker_t::on_event(int events) {
     unix_socket_stream_t::on_event(events);
 }
 
+int64_t pool_t::worker_t::read_interruptible(void *p, int64_t n, signal_t *interruptor) {
+    if (shm_.has()) {
+        return shm_->read(p, n, interruptor);
+    }
+    return unix_socket_stream_t::read_interruptible(p, n, interruptor);
+}
+
+int64_t pool_t::worker_t::write_interruptible(const void *p, int64_t n, signal_t *interruptor) {
+    if (shm_.has()) {
+        return shm_->write(p, n, interruptor);
+    }
+    return unix_socket_stream_t::write_interruptible(p, n, interruptor);
+}
+
 void pool_t::worker_t::on_error() {
     // NB. We may or may not be in coroutine context when this method is called.
     assert_thread();
@@ -238,11 +292,14 @@ job_handle_t::~job_handle_t() {
     rassert(!connected(), "job handle still connected on destruction");
 }
 
-int job_handle_t::begin(pool_t *pool, const job_t &job) {
+int job_handle_t::begin(pool_t *pool, const job_t &job, worker_affinity_t *affinity) {
     rassert(!connected());
 
-    worker_ = pool->acquire_worker();
+    worker_ = pool->acquire_worker(affinity ? affinity->pid_ : -1);
     guarantee(worker_);         // for now, acquiring worker can't fail
+    if (affinity) {
+        affinity->pid_ = worker_->pid_;
+    }
 
     int res = job.send_over(this);
     // If sending failed, write() should have disconnected us.
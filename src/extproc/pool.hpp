@@ -13,6 +13,7 @@
 #include "containers/archive/socket_stream.hpp"
 #include "containers/intrusive_list.hpp"
 #include "extproc/job.hpp"
+#include "extproc/shm_channel.hpp"
 #include "extproc/spawner.hpp"
 
 namespace extproc {
@@ -20,6 +21,20 @@ namespace extproc {
 class job_handle_t;
 class pool_t;
 
+// Remembers which worker process a sequence of jobs last ran on, so that the
+// next job in the sequence can be sent back to the same process. Jobs that
+// keep per-process caches (eg. compiled javascript functions) find them warm
+// that way. This is only a hint: if that worker is busy or has died, any idle
+// worker is used instead.
+class worker_affinity_t {
+  public:
+    worker_affinity_t() : pid_(-1) {}
+
+  private:
+    friend class job_handle_t;
+    pid_t pid_;
+};
+
 // Use this to create one process pool per thread, and access the appropriate
 // one (via `get()`).
 class pool_group_t
@@ -32,9 +47,13 @@ class pool_group_t
 
     struct config_t {
         config_t()
-            : min_workers(DEFAULT_MIN_WORKERS), max_workers(DEFAULT_MAX_WORKERS) {}
+            : min_workers(DEFAULT_MIN_WORKERS), max_workers(DEFAULT_MAX_WORKERS),
+              use_shared_memory(false) {}
         int min_workers;        // >= 0
         int max_workers;        // >= min_workers, > 0
+        // Talk to workers through a shared memory channel rather than their
+        // sockets, where the platform supports it. See shm_channel.hpp.
+        bool use_shared_memory;
     };
 
     static const config_t DEFAULTS;
@@ -82,9 +101,16 @@ class pool_t :
         // condition on our socket. Calls on_error().
         virtual void on_event(int events);
 
+        // Go through `shm_` if the worker has one, and through the socket
+        // otherwise. The socket is still watched for errors either way, which
+        // is how we notice the worker dying.
+        virtual MUST_USE int64_t read_interruptible(void *p, int64_t n, signal_t *interruptor);
+        virtual int64_t write_interruptible(const void *p, int64_t n, signal_t *interruptor);
+
         pool_t *pool_;
         pid_t pid_;
         bool attached_;
+        scoped_ptr_t<shm_channel_t> shm_;
 
       private:
         DISABLE_COPYING(worker_t);
@@ -98,7 +124,8 @@ class pool_t :
     void repair_invariants();
 
     // Connects us to a worker. Private; used only by job_handle_t::spawn().
-    worker_t *acquire_worker();
+    // Prefers the idle worker with pid `preferred_pid`, if there is one.
+    worker_t *acquire_worker(pid_t preferred_pid);
 
     // Called by job_handle_t to indicate the job has finished or errored.
     void release_worker(worker_t *worker) THROWS_NOTHING;
@@ -170,8 +197,10 @@ class job_handle_t :
 
     // Begins running `job` on `pool`. Must be disconnected beforehand. On
     // success, returns 0 and connects us to the spawned job. Returns -1 on
-    // error.
-    int begin(pool_t *pool, const job_t &job);
+    // error. If `affinity` is non-NULL, the job is preferably run on the
+    // worker it names, and `affinity` is updated to name the worker actually
+    // used.
+    int begin(pool_t *pool, const job_t &job, worker_affinity_t *affinity = NULL);
 
     // Indicates the job has either finished normally or experienced an I/O
     // error; disconnects the job handle.
@@ -0,0 +1,219 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "extproc/shm_channel.hpp"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "arch/io/event_watcher.hpp"
+#include "arch/runtime/system_event/eventfd.hpp"
+#include "concurrency/wait_any.hpp"
+#include "errors.hpp"
+
+#if defined(__linux) && !defined(NO_EVENTFD) && defined(SYS_memfd_create)
+#define SHM_CHANNEL_SUPPORTED 1
+#endif
+
+namespace extproc {
+
+// Lives at the start of the shared region, once per direction. `head` and
+// `tail` count the bytes ever written and read; only the producer advances
+// `head` and only the consumer advances `tail`. Each sits on its own cache
+// line so the two processes don't fight over them.
+struct shm_channel_t::ring_t {
+    volatile uint64_t head;
+    char pad0[CACHE_LINE_SIZE - sizeof(uint64_t)];
+    volatile uint64_t tail;
+    char pad1[CACHE_LINE_SIZE - sizeof(uint64_t)];
+    // Set by the consumer while it sleeps waiting for data, and by the
+    // producer while it sleeps waiting for room.
+    volatile int32_t reader_sleeping;
+    volatile int32_t writer_sleeping;
+    char pad2[CACHE_LINE_SIZE - 2 * sizeof(int32_t)];
+
+    char *data() { return reinterpret_cast<char *>(this + 1); }
+};
+
+// Two rings, each followed by its data.
+const int64_t shm_channel_t::REGION_SIZE = 2 * (sizeof(shm_channel_t::ring_t) + shm_channel_t::RING_SIZE);
+
+bool shm_channel_t::create(scoped_fd_t fds_out[NUM_FDS]) {
+#ifdef SHM_CHANNEL_SUPPORTED
+    fd_t memfd = syscall(SYS_memfd_create, "rethinkdb-extproc", 0);
+    if (memfd == -1) {
+        return false;
+    }
+    fds_out[0].reset(memfd);
+    if (0 != ftruncate(memfd, REGION_SIZE)) {
+        fds_out[0].reset();
+        return false;
+    }
+
+    for (size_t i = 1; i < NUM_FDS; ++i) {
+        fd_t efd = eventfd(0, 0);
+        if (efd == -1) {
+            for (size_t j = 0; j < i; ++j) {
+                fds_out[j].reset();
+            }
+            return false;
+        }
+        fds_out[i].reset(efd);
+    }
+    return true;
+#else
+    (void) fds_out;
+    return false;
+#endif
+}
+
+shm_channel_t::shm_channel_t(side_t side, fd_t fds[NUM_FDS])
+    : side_(side),
+      memfd_(fds[0]),
+      our_eventfd_(side == ENGINE_SIDE ? fds[1] : fds[2]),
+      peer_eventfd_(side == ENGINE_SIDE ? fds[2] : fds[1])
+{
+    void *region = mmap(NULL, REGION_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, memfd_.get(), 0);
+    guarantee_err(region != MAP_FAILED, "could not map extproc shared memory");
+    region_ = static_cast<char *>(region);
+
+    // A freshly truncated memfd is zero-filled, which is exactly an empty
+    // pair of rings.
+    ring_t *engine_to_worker = reinterpret_cast<ring_t *>(region_);
+    ring_t *worker_to_engine = reinterpret_cast<ring_t *>(region_ + sizeof(ring_t) + RING_SIZE);
+    in_ = side == ENGINE_SIDE ? worker_to_engine : engine_to_worker;
+    out_ = side == ENGINE_SIDE ? engine_to_worker : worker_to_engine;
+
+    if (side == ENGINE_SIDE) {
+        // We drain our eventfd after every wakeup; that must not block.
+        guarantee_err(0 == fcntl(our_eventfd_.get(), F_SETFL, O_NONBLOCK),
+                      "could not make eventfd non-blocking");
+        watcher_.init(new linux_event_watcher_t(our_eventfd_.get(), this));
+    }
+}
+
+shm_channel_t::~shm_channel_t() {
+    watcher_.reset();
+    guarantee_err(0 == munmap(region_, REGION_SIZE), "could not unmap extproc shared memory");
+}
+
+int64_t shm_channel_t::read(void *p, int64_t n, signal_t *interruptor) {
+    guarantee(n > 0);
+
+    uint64_t available;
+    for (;;) {
+        available = in_->head - in_->tail;
+        if (available > 0) break;
+
+        // Announce that we're going to sleep, then look again, so that a write
+        // racing with us either sees the flag or is seen by us.
+        in_->reader_sleeping = 1;
+        __sync_synchronize();
+        available = in_->head - in_->tail;
+        if (available > 0) {
+            in_->reader_sleeping = 0;
+            break;
+        }
+        wait_for_wakeup(interruptor);
+        in_->reader_sleeping = 0;
+    }
+    // Don't read the data before we've seen `head` move past it.
+    __sync_synchronize();
+
+    const uint64_t tail = in_->tail;
+    const int64_t offset = tail % RING_SIZE;
+    const int64_t count = std::min<int64_t>(n, std::min<int64_t>(available, RING_SIZE - offset));
+    memcpy(p, in_->data() + offset, count);
+
+    // Finish reading before handing the space back.
+    __sync_synchronize();
+    in_->tail = tail + count;
+    __sync_synchronize();
+    if (in_->writer_sleeping) {
+        wake_peer();
+    }
+    return count;
+}
+
+int64_t shm_channel_t::write(const void *p, int64_t n, signal_t *interruptor) {
+    guarantee(n > 0);
+
+    const char *src = static_cast<const char *>(p);
+    int64_t written = 0;
+    while (written < n) {
+        uint64_t room;
+        for (;;) {
+            room = RING_SIZE - (out_->head - out_->tail);
+            if (room > 0) break;
+
+            out_->writer_sleeping = 1;
+            __sync_synchronize();
+            room = RING_SIZE - (out_->head - out_->tail);
+            if (room > 0) {
+                out_->writer_sleeping = 0;
+                break;
+            }
+            wait_for_wakeup(interruptor);
+            out_->writer_sleeping = 0;
+        }
+        // Don't overwrite data before we've seen `tail` move past it.
+        __sync_synchronize();
+
+        const uint64_t head = out_->head;
+        const int64_t offset = head % RING_SIZE;
+        const int64_t count = std::min<int64_t>(n - written, std::min<int64_t>(room, RING_SIZE - offset));
+        memcpy(out_->data() + offset, src + written, count);
+
+        // Publish the data before the new `head`.
+        __sync_synchronize();
+        out_->head = head + count;
+        __sync_synchronize();
+        if (out_->reader_sleeping) {
+            wake_peer();
+        }
+        written += count;
+    }
+    return n;
+}
+
+void shm_channel_t::wait_for_wakeup(signal_t *interruptor) {
+    eventfd_t value;
+    if (side_ == WORKER_SIDE) {
+        guarantee(!interruptor, "the worker side of an shm_channel_t can't be interrupted");
+        // Workers take a SIGALRM every so often (see exec_worker()).
+        while (0 != eventfd_read(our_eventfd_.get(), &value)) {
+            guarantee_err(errno == EINTR, "worker: could not read eventfd");
+        }
+        return;
+    }
+
+    {
+        linux_event_watcher_t::watch_t watch(watcher_.get(), poll_event_in);
+        wait_any_t waiter(&watch);
+        if (interruptor) waiter.add(interruptor);
+        waiter.wait_lazily_unordered();
+    }
+    if (interruptor && interruptor->is_pulsed()) {
+        throw interrupted_exc_t();
+    }
+
+    // Reset the counter. It can't be empty, unless we lost a race with a
+    // spurious wakeup; either way our caller looks at the ring again.
+    int res = eventfd_read(our_eventfd_.get(), &value);
+    guarantee_err(res == 0 || errno == EAGAIN, "could not read eventfd");
+}
+
+void shm_channel_t::wake_peer() {
+    while (0 != eventfd_write(peer_eventfd_.get(), 1)) {
+        guarantee_err(errno == EINTR, "could not write eventfd");
+    }
+}
+
+void shm_channel_t::on_event(int events) {
+    crash("error on extproc shared memory eventfd (events: %d)", events);
+}
+
+}  // namespace extproc
@@ -0,0 +1,88 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#ifndef EXTPROC_SHM_CHANNEL_HPP_
+#define EXTPROC_SHM_CHANNEL_HPP_
+
+#include <stdint.h>
+
+#include "arch/io/io_utils.hpp"         // scoped_fd_t
+#include "arch/runtime/event_queue_types.hpp" // linux_event_callback_t
+#include "arch/runtime/runtime_utils.hpp" // fd_t
+#include "concurrency/signal.hpp"
+#include "config/args.hpp"
+#include "containers/scoped.hpp"
+
+class linux_event_watcher_t;
+
+namespace extproc {
+
+// A bidirectional byte channel between the engine and a worker process, made
+// of two single-producer single-consumer rings in a shared memory region (one
+// per direction). Data is copied straight into and out of the region, without
+// a round-trip through a kernel socket buffer.
+//
+// Each side has an eventfd that the other side writes to when it makes
+// progress the first side is sleeping on (data to read, or room to write).
+// As long as neither side has to sleep, no system calls are made at all.
+//
+// The engine side waits through the event queue, so it can be interrupted;
+// the worker side blocks.
+class shm_channel_t :
+    private linux_event_callback_t
+{
+  public:
+    enum side_t { ENGINE_SIDE, WORKER_SIDE };
+
+    // Size of the ring in each direction.
+    static const int64_t RING_SIZE = 4 * MEGABYTE;
+
+    // The shared memory region and the two sides' eventfds, in that order.
+    static const size_t NUM_FDS = 3;
+
+    // Creates the shared memory region and the eventfds. Returns false if
+    // this platform doesn't support them, in which case the socket should be
+    // used instead.
+    static MUST_USE bool create(scoped_fd_t fds_out[NUM_FDS]);
+
+    // Maps a region made by `create()`. Takes ownership of `fds`. On the
+    // engine side, must be called from within the thread pool.
+    shm_channel_t(side_t side, fd_t fds[NUM_FDS]);
+    ~shm_channel_t();
+
+    // Reads between 1 and `n` bytes, blocking until some are available.
+    // Raises interrupted_exc_t if `interruptor` is pulsed first; `interruptor`
+    // must be NULL on the worker side.
+    MUST_USE int64_t read(void *p, int64_t n, signal_t *interruptor);
+
+    // Writes all `n` bytes, blocking while the ring is full. Interruption is
+    // as for `read()`.
+    int64_t write(const void *p, int64_t n, signal_t *interruptor);
+
+  private:
+    struct ring_t;
+
+    // The size of the whole shared region.
+    static const int64_t REGION_SIZE;
+
+    // Sleeps until the other side writes to our eventfd.
+    void wait_for_wakeup(signal_t *interruptor);
+
+    // Wakes the other side up.
+    void wake_peer();
+
+    // Called on errors on our eventfd, on the engine side.
+    virtual void on_event(int events);
+
+    side_t side_;
+    scoped_fd_t memfd_, our_eventfd_, peer_eventfd_;
+    char *region_;
+    ring_t *in_, *out_;
+
+    // Only on the engine side.
+    scoped_ptr_t<linux_event_watcher_t> watcher_;
+
+    DISABLE_COPYING(shm_channel_t);
+};
+
+}  // namespace extproc
+
+#endif  // EXTPROC_SHM_CHANNEL_HPP_
@@ -1,6 +1,11 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "http/http.hpp"
 
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
 #include <exception>
 
 #include "utils.hpp"
@@ -8,6 +13,10 @@
 #include <boost/algorithm/string.hpp>
 
 #include "arch/io/network.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/wait_any.hpp"
+#include "config/args.hpp"
+#include "http/json.hpp"
 #include "logger.hpp"
 
 static const char *resource_parts_sep_char = "/";
@@ -284,38 +293,242 @@ std::string human_readable_status(int code) {
     }
 }
 
-void write_http_msg(tcp_conn_t *conn, const http_res_t &res, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
-    conn->writef(closer, "HTTP/%s %d %s\r\n", res.version.c_str(), res.code, human_readable_status(res.code).c_str());
+/* Compresses a response body into the gzip format, a piece at a time. */
+class gzip_encoder_t {
+public:
+    gzip_encoder_t() {
+        memset(&stream, 0, sizeof(stream));
+        // 15 is zlib's default window size, and adding 16 asks for a gzip header.
+        int res = deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+        guarantee(res == Z_OK, "zlib could not start a gzip stream (error %d)", res);
+    }
+
+    ~gzip_encoder_t() {
+        deflateEnd(&stream);
+    }
+
+    /* Appends whatever compressed output `data` yields to `out`. If `finish` is
+    true, this is the end of the body, and everything is flushed out. */
+    void encode(const char *data, size_t size, bool finish, std::string *out) {
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+        stream.avail_in = size;
+        do {
+            Bytef buffer[4096];
+            stream.next_out = buffer;
+            stream.avail_out = sizeof(buffer);
+            int res = deflate(&stream, finish ? Z_FINISH : Z_NO_FLUSH);
+            guarantee(res != Z_STREAM_ERROR, "zlib could not compress a response");
+            out->append(reinterpret_cast<char *>(buffer), sizeof(buffer) - stream.avail_out);
+        } while (stream.avail_out == 0);
+    }
+
+private:
+    z_stream stream;
+
+    DISABLE_COPYING(gzip_encoder_t);
+};
+
+/* Writes a body with the chunked transfer coding, gzipping it first if
+`encoder` isn't `NULL`. */
+class chunked_body_writer_t {
+public:
+    chunked_body_writer_t(tcp_conn_t *_conn, gzip_encoder_t *_encoder, signal_t *_closer)
+        : conn(_conn), encoder(_encoder), closer(_closer) { }
+
+    void write(const std::string &data) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+        if (encoder != NULL) {
+            encoded.clear();
+            encoder->encode(data.data(), data.size(), false, &encoded);
+            write_chunk(encoded);
+        } else {
+            write_chunk(data);
+        }
+    }
+
+    void finish() THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+        if (encoder != NULL) {
+            encoded.clear();
+            encoder->encode(NULL, 0, true, &encoded);
+            write_chunk(encoded);
+        }
+        static const char last_chunk[] = "0\r\n\r\n";
+        conn->write_buffered(last_chunk, strlen(last_chunk), closer);
+    }
+
+private:
+    void write_chunk(const std::string &data) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+        // An empty chunk would end the body.
+        if (data.empty()) {
+            return;
+        }
+        std::string size_line = strprintf("%zx\r\n", data.size());
+        conn->write_buffered(size_line.data(), size_line.size(), closer);
+        conn->write_buffered(data.data(), data.size(), closer);
+        conn->write_buffered("\r\n", 2, closer);
+    }
+
+    tcp_conn_t *conn;
+    gzip_encoder_t *encoder;
+    signal_t *closer;
+    std::string encoded;
+
+    DISABLE_COPYING(chunked_body_writer_t);
+};
+
+/* Writes `res` to `conn`, but doesn't necessarily flush it; the caller has to
+call `flush_buffer()` when it's done writing responses. */
+void write_http_msg(tcp_conn_t *conn, const http_res_t &res, bool gzip, signal_t *closer) THROWS_ONLY(tcp_conn_write_closed_exc_t) {
+    bool has_body = res.code != HTTP_NO_CONTENT && res.code != HTTP_NOT_MODIFIED;
+    bool chunked = has_body && res.json_body && res.version == "1.1";
+
+    std::string body;
+    if (!has_body || chunked) {
+        // There's no body, or we'll print it as we go.
+    } else if (res.json_body) {
+        body = cJSON_print_unformatted_std_string(res.json_body->get());
+    } else {
+        body = res.body;
+    }
+
+    gzip = gzip && has_body && (chunked || body.size() >= HTTP_GZIP_MIN_BYTES);
+    if (gzip && !chunked) {
+        std::string compressed;
+        gzip_encoder_t encoder;
+        encoder.encode(body.data(), body.size(), true, &compressed);
+        body.swap(compressed);
+    }
+
+    std::string head = strprintf("HTTP/%s %d %s\r\n", res.version.c_str(), res.code, human_readable_status(res.code).c_str());
     for (std::vector<header_line_t>::const_iterator it = res.header_lines.begin(); it != res.header_lines.end(); ++it) {
-        conn->writef(closer, "%s: %s\r\n", it->key.c_str(), it->val.c_str());
+        // We work out the length ourselves, since we may have compressed the body.
+        if (!boost::iequals(it->key, "Content-Length")) {
+            head += strprintf("%s: %s\r\n", it->key.c_str(), it->val.c_str());
+        }
+    }
+    if (has_body) {
+        if (gzip) {
+            head += "Content-Encoding: gzip\r\n";
+        }
+        head += "Vary: Accept-Encoding\r\n";
+        if (chunked) {
+            head += "Transfer-Encoding: chunked\r\n";
+        } else {
+            // Even an empty body needs this, or a keep-alive client won't know where it ends.
+            head += strprintf("Content-Length: %zu\r\n", body.size());
+        }
+    }
+    head += "\r\n";
+    conn->write_buffered(head.data(), head.size(), closer);
+
+    if (chunked) {
+        scoped_ptr_t<gzip_encoder_t> encoder;
+        if (gzip) {
+            encoder.init(new gzip_encoder_t);
+        }
+        chunked_body_writer_t writer(conn, encoder.has() ? encoder.get() : NULL, closer);
+        cJSON_print_streamed(res.json_body->get(), HTTP_CHUNK_BYTES,
+                             boost::bind(&chunked_body_writer_t::write, &writer, _1));
+        writer.finish();
+    } else {
+        conn->write_buffered(body.data(), body.size(), closer);
+    }
+}
+
+/* HTTP/1.1 connections stay open unless the client says otherwise, and HTTP/1.0
+connections are closed unless it asks for them not to be. */
+static bool keep_alive_requested(const http_req_t &req) {
+    boost::optional<std::string> connection = req.find_header_line("Connection");
+    if (req.version == "1.1") {
+        return !(connection && boost::icontains(*connection, "close"));
+    } else {
+        return connection && boost::icontains(*connection, "keep-alive");
+    }
+}
+
+/* Returns true if the Accept-Encoding header lists gzip without giving it a
+quality of zero. */
+static bool gzip_accepted(const http_req_t &req) {
+    boost::optional<std::string> accept_encoding = req.find_header_line("Accept-Encoding");
+    if (!accept_encoding) {
+        return false;
+    }
+    std::vector<std::string> codings;
+    boost::split(codings, *accept_encoding, boost::is_any_of(","));
+    for (std::vector<std::string>::iterator it = codings.begin(); it != codings.end(); ++it) {
+        std::vector<std::string> params;
+        boost::split(params, *it, boost::is_any_of(";"));
+        if (!boost::iequals(boost::trim_copy(params[0]), "gzip")) {
+            continue;
+        }
+        for (size_t i = 1; i < params.size(); ++i) {
+            std::string param = boost::trim_copy(params[i]);
+            if (boost::istarts_with(param, "q=") && strtod(param.c_str() + 2, NULL) <= 0) {
+                return false;
+            }
+        }
+        return true;
     }
-    conn->writef(closer, "\r\n");
-    conn->write(res.body.c_str(), res.body.size(), closer);
+    return false;
+}
+
+/* Returns true if the client has already sent all of the headers of its next
+request, in which case the response to this one can wait to go out with that
+one's. */
+static bool next_request_buffered(tcp_conn_t *conn) {
+    static const char end_of_headers[] = "\r\n\r\n";
+    const_charslice buffered = conn->peek();
+    return std::search(buffered.beg, buffered.end, end_of_headers, end_of_headers + 4) != buffered.end;
 }
 
 void http_server_t::handle_conn(const scoped_ptr_t<tcp_conn_descriptor_t> &nconn, auto_drainer_t::lock_t keepalive) {
     scoped_ptr_t<tcp_conn_t> conn;
     nconn->make_overcomplicated(&conn);
 
-    http_req_t req;
-    tcp_http_msg_parser_t http_msg_parser;
-
-    /* parse the request */
     try {
-        if (http_msg_parser.parse(conn.get(), &req, keepalive.get_drain_signal())) {
+        for (;;) {
+            http_req_t req;
+            tcp_http_msg_parser_t http_msg_parser;
+
+            /* parse the request */
+            bool parsed;
+            {
+                signal_timer_t idle_timer(HTTP_KEEPALIVE_TIMEOUT_MS);
+                wait_any_t closer(&idle_timer, keepalive.get_drain_signal());
+                parsed = http_msg_parser.parse(conn.get(), &req, &closer);
+            }
+
+            if (!parsed) {
+                // Write error; we can't tell where the next request would start.
+                http_res_t res(HTTP_BAD_REQUEST);
+                res.version = "1.1";
+                res.add_header_line("Connection", "close");
+                write_http_msg(conn.get(), res, false, keepalive.get_drain_signal());
+                conn->flush_buffer(keepalive.get_drain_signal());
+                break;
+            }
+
+            /* Apps answer HEAD requests with a body like anything else, so the
+            client can't tell where the response ends unless we hang up. */
+            bool keep_alive = req.method != HEAD && keep_alive_requested(req);
+
             /* TODO pass interruptor */
             http_res_t res = application->handle(req);
             res.version = req.version;
-            write_http_msg(conn.get(), res, keepalive.get_drain_signal());
-        } else {
-            // Write error
-            http_res_t res;
-            res.code = 400;
-            write_http_msg(conn.get(), res, keepalive.get_drain_signal());
+            res.add_header_line("Connection", keep_alive ? "keep-alive" : "close");
+            write_http_msg(conn.get(), res, gzip_accepted(req), keepalive.get_drain_signal());
+
+            if (!keep_alive) {
+                conn->flush_buffer(keepalive.get_drain_signal());
+                break;
+            }
+            if (!next_request_buffered(conn.get())) {
+                conn->flush_buffer(keepalive.get_drain_signal());
+            }
         }
     } catch (const tcp_conn_read_closed_exc_t &) {
         //Someone disconnected before sending us all the information we
-        //needed... oh well.
+        //needed... oh well. This is also how an idle keep-alive connection
+        //ends.
     } catch (const tcp_conn_write_closed_exc_t &) {
         //We were trying to write to someone and they didn't stick around long
         //enough to write it.
@@ -383,6 +596,13 @@ bool tcp_http_msg_parser_t::parse(tcp_conn_t *conn, http_req_t *req, signal_t *c
         req->header_lines.push_back(final_line);
     }
 
+    // We only read bodies delimited by Content-Length. Reading a chunked body
+    // that way would leave it on the connection to be taken for the next
+    // request, so we refuse it, and the connection gets closed.
+    if (req->has_header_line("Transfer-Encoding")) {
+        return false;
+    }
+
     // Parse body
     size_t body_length = content_length(*req);
     const_charslice body = conn->peek(body_length, closer);
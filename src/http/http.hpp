@@ -10,6 +10,7 @@
 #include "errors.hpp"
 #include <boost/tokenizer.hpp>
 #include <boost/shared_array.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/optional.hpp>
 
 #include "arch/types.hpp"
@@ -90,6 +91,7 @@ int content_length(const http_req_t&);
 enum http_status_code_t {
     HTTP_OK = 200,
     HTTP_NO_CONTENT = 204,
+    HTTP_NOT_MODIFIED = 304,
     HTTP_BAD_REQUEST = 400,
     HTTP_FORBIDDEN = 403,
     HTTP_NOT_FOUND = 404,
@@ -99,12 +101,18 @@ enum http_status_code_t {
     HTTP_INTERNAL_SERVER_ERROR = 500
 };
 
+class scoped_cJSON_t;
+
 class http_res_t {
 public:
     std::string version;
     int code;
     std::vector<header_line_t> header_lines;
     std::string body;
+    /* If set, this is the body instead of `body`. It isn't printed until the
+    response is written, and then it's sent in chunks if the client speaks
+    HTTP/1.1; see `http_json_res(scoped_cJSON_t *)`. */
+    boost::shared_ptr<scoped_cJSON_t> json_body;
 
     void add_header_line(const std::string&, const std::string&);
     void set_body(const std::string&, const std::string&);
@@ -160,7 +168,10 @@ public:
 /* creating an http server will bind to the specified port and listen for http
  * connections, the data from incoming connections will be parsed into
  * http_req_ts and passed to the handle function which must then return an http
- * msg that's a meaningful response */
+ * msg that's a meaningful response. Connections are kept open for further
+ * requests (which clients may pipeline) unless the client asks otherwise or
+ * stays idle for HTTP_KEEPALIVE_TIMEOUT_MS, and responses are gzipped for
+ * clients that accept it. */
 class http_server_t {
 public:
     http_server_t(const std::set<ip_address_t> &local_addresses, int port, http_app_t *application);
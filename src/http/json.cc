@@ -2,8 +2,11 @@
 #define __STDC_FORMAT_MACROS
 #include "http/json.hpp"
 
+#include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 
+#include <map>
 #include <set>
 #include <vector>
 
@@ -21,6 +24,238 @@ http_res_t http_json_res(cJSON *json) {
     return http_res_t(HTTP_OK, "application/json", cJSON_default_print(json));
 }
 
+http_res_t http_json_res(scoped_cJSON_t *json) {
+    guarantee(json->get());
+    http_res_t res(HTTP_OK);
+    res.add_header_line("Content-Type", "application/json");
+    res.json_body.reset(new scoped_cJSON_t(json->release()));
+    return res;
+}
+
+static void hash_bytes(const char *data, size_t size, uint64_t *h) {
+    // FNV-1a
+    for (size_t i = 0; i < size; ++i) {
+        *h ^= static_cast<uint8_t>(data[i]);
+        *h *= 0x100000001b3ULL;
+    }
+}
+
+/* Unlike `json_hash()` in the RDB protocol, this depends on the order of object
+members, because two objects that print differently shouldn't share an ETag. */
+static void hash_json(cJSON *json, uint64_t *h) {
+    char type = json->type & 255;
+    hash_bytes(&type, sizeof(type), h);
+    switch (type) {
+    case cJSON_Number:
+        hash_bytes(reinterpret_cast<const char *>(&json->valuedouble), sizeof(json->valuedouble), h);
+        break;
+    case cJSON_String:
+        // Include the terminator, so that adjacent strings can't run together.
+        hash_bytes(json->valuestring, strlen(json->valuestring) + 1, h);
+        break;
+    case cJSON_Array:
+    case cJSON_Object:
+        {
+            json_iterator_t it(json);
+            while (cJSON *child = it.next()) {
+                if (type == cJSON_Object) {
+                    hash_bytes(child->string, strlen(child->string) + 1, h);
+                }
+                hash_json(child, h);
+            }
+        }
+        hash_bytes(&type, sizeof(type), h);
+        break;
+    default:
+        break;
+    }
+}
+
+http_res_t http_cacheable_json_res(const http_req_t &req, scoped_cJSON_t *json) {
+    guarantee(json->get());
+    uint64_t h = 0xcbf29ce484222325ULL;
+    hash_json(json->get(), &h);
+    std::string tag = strprintf("\"%016" PRIx64 "\"", h);
+
+    /* The tag is weak because the body may be formatted or compressed
+    differently from one response to the next. */
+    http_res_t res;
+    boost::optional<std::string> if_none_match = req.find_header_line("If-None-Match");
+    if (if_none_match && (*if_none_match == "*" || if_none_match->find(tag) != std::string::npos)) {
+        res = http_res_t(HTTP_NOT_MODIFIED);
+    } else {
+        res = http_json_res(json);
+    }
+    res.add_header_line("ETag", "W/" + tag);
+    // Browsers should ask every time, rather than guess how long it stays fresh.
+    res.add_header_line("Cache-Control", "no-cache");
+    return res;
+}
+
+/* `pending` is handed to `sink` and emptied whenever it gets to `chunk_size`. */
+static void print_streamed(cJSON *json, size_t chunk_size,
+                           const boost::function<void(const std::string &)> &sink,
+                           std::string *pending) {
+    switch (json->type & 255) {
+    case cJSON_Array:
+        pending->push_back('[');
+        for (json_iterator_t it(json); cJSON *child = it.next();) {
+            if (child != json->head) {
+                pending->push_back(',');
+            }
+            print_streamed(child, chunk_size, sink, pending);
+        }
+        pending->push_back(']');
+        break;
+    case cJSON_Object:
+        pending->push_back('{');
+        for (json_iterator_t it(json); cJSON *child = it.next();) {
+            if (child != json->head) {
+                pending->push_back(',');
+            }
+            char *key = cJSON_PrintString(child->string);
+            guarantee(key);
+            pending->append(key);
+            free(key);
+            pending->push_back(':');
+            print_streamed(child, chunk_size, sink, pending);
+        }
+        pending->push_back('}');
+        break;
+    default:
+        {
+            char *s = cJSON_PrintUnformatted(json);
+            guarantee(s);
+            pending->append(s);
+            free(s);
+        }
+        break;
+    }
+
+    if (pending->size() >= chunk_size) {
+        sink(*pending);
+        pending->clear();
+    }
+}
+
+void cJSON_print_streamed(cJSON *json, size_t chunk_size,
+                          const boost::function<void(const std::string &)> &sink) {
+    guarantee(json);
+    std::string pending;
+    pending.reserve(chunk_size);
+    print_streamed(json, chunk_size, sink, &pending);
+    if (!pending.empty()) {
+        sink(pending);
+    }
+}
+
+typedef std::map<std::string, cJSON *> json_members_t;
+
+static void get_members(cJSON *json, json_members_t *out) {
+    json_iterator_t it(json);
+    while (cJSON *child = it.next()) {
+        (*out)[child->string] = child;
+    }
+}
+
+bool json_equal(cJSON *a, cJSON *b) {
+    if ((a->type & 255) != (b->type & 255)) {
+        return false;
+    }
+    switch (a->type & 255) {
+    case cJSON_Number:
+        return a->valuedouble == b->valuedouble;
+    case cJSON_String:
+        return strcmp(a->valuestring, b->valuestring) == 0;
+    case cJSON_Array:
+        {
+            json_iterator_t ai(a), bi(b);
+            for (;;) {
+                cJSON *ac = ai.next(), *bc = bi.next();
+                if (ac == NULL || bc == NULL) {
+                    return ac == bc;
+                }
+                if (!json_equal(ac, bc)) {
+                    return false;
+                }
+            }
+        }
+    case cJSON_Object:
+        {
+            json_members_t a_members, b_members;
+            get_members(a, &a_members);
+            get_members(b, &b_members);
+            if (a_members.size() != b_members.size()) {
+                return false;
+            }
+            for (json_members_t::iterator it = a_members.begin(); it != a_members.end(); ++it) {
+                json_members_t::iterator jt = b_members.find(it->first);
+                if (jt == b_members.end() || !json_equal(it->second, jt->second)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    default:
+        return true;
+    }
+}
+
+/* `path` is the path to `from` and `to`, which are both objects. */
+static void diff_objects(cJSON *from, cJSON *to, std::vector<std::string> *path,
+                         cJSON *changed, cJSON *deleted) {
+    json_members_t from_members;
+    get_members(from, &from_members);
+
+    json_iterator_t it(to);
+    while (cJSON *to_child = it.next()) {
+        json_members_t::iterator jt = from_members.find(to_child->string);
+        if (jt == from_members.end()) {
+            cJSON_AddItemToObject(changed, to_child->string, cJSON_DeepCopy(to_child));
+            continue;
+        }
+        cJSON *from_child = jt->second;
+        from_members.erase(jt);
+
+        if (from_child->type == cJSON_Object && to_child->type == cJSON_Object) {
+            scoped_cJSON_t child_changes(cJSON_CreateObject());
+            path->push_back(to_child->string);
+            diff_objects(from_child, to_child, path, child_changes.get(), deleted);
+            path->pop_back();
+            if (child_changes.GetArraySize() != 0) {
+                cJSON_AddItemToObject(changed, to_child->string, child_changes.release());
+            }
+        } else if (!json_equal(from_child, to_child)) {
+            cJSON_AddItemToObject(changed, to_child->string, cJSON_DeepCopy(to_child));
+        }
+    }
+
+    for (json_members_t::iterator jt = from_members.begin(); jt != from_members.end(); ++jt) {
+        cJSON *deleted_path = cJSON_CreateArray();
+        for (size_t i = 0; i < path->size(); ++i) {
+            cJSON_AddItemToArray(deleted_path, cJSON_CreateString((*path)[i].c_str()));
+        }
+        cJSON_AddItemToArray(deleted_path, cJSON_CreateString(jt->first.c_str()));
+        cJSON_AddItemToArray(deleted, deleted_path);
+    }
+}
+
+bool json_diff(cJSON *from, cJSON *to, scoped_cJSON_t *changed_out, scoped_cJSON_t *deleted_out) {
+    deleted_out->reset(cJSON_CreateArray());
+    if (from->type == cJSON_Object && to->type == cJSON_Object) {
+        changed_out->reset(cJSON_CreateObject());
+        std::vector<std::string> path;
+        diff_objects(from, to, &path, changed_out->get(), deleted_out->get());
+        return changed_out->GetArraySize() != 0 || deleted_out->GetArraySize() != 0;
+    } else if (json_equal(from, to)) {
+        changed_out->reset(cJSON_CreateObject());
+        return false;
+    } else {
+        changed_out->reset(cJSON_DeepCopy(to));
+        return true;
+    }
+}
+
 cJSON *cJSON_merge(cJSON *lhs, cJSON *rhs) {
     guarantee(lhs->type == cJSON_Object);
     guarantee(rhs->type == cJSON_Object);
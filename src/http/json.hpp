@@ -5,10 +5,14 @@
 #include <string>
 #include <set>
 
+#include "errors.hpp"
+#include <boost/function.hpp>
+
 #include "http/json/cJSON.hpp"
 #include "containers/archive/archive.hpp"
 
 class http_res_t;
+struct http_req_t;
 
 http_res_t http_json_res(cJSON *json);
 
@@ -112,6 +116,38 @@ public:
     }
 };
 
+/* Like `http_json_res(cJSON *)`, but takes the JSON out of `json` and leaves it
+to be printed while the response is being written (see `http_res_t::json_body`)
+instead of printing it into a string up front. Use this for responses that can
+get big. */
+http_res_t http_json_res(scoped_cJSON_t *json);
+
+/* Like `http_json_res(scoped_cJSON_t *)`, but the response carries a weak ETag
+computed from the JSON's contents, and if the request's If-None-Match header
+already names that ETag, the response is just 304 Not Modified. For views that
+clients poll and that seldom change. */
+http_res_t http_cacheable_json_res(const http_req_t &req, scoped_cJSON_t *json);
+
+/* Prints `json` without formatting, the same as `cJSON_PrintUnformatted()`, but
+hands the text to `sink` a piece at a time, whenever at least `chunk_size` bytes
+have built up and once more at the end, so that the whole text never has to be
+in memory at once. */
+void cJSON_print_streamed(cJSON *json, size_t chunk_size,
+                          const boost::function<void(const std::string &)> &sink);
+
+/* Returns true if `a` and `b` are the same JSON value. The order of object
+members doesn't matter. */
+bool json_equal(cJSON *a, cJSON *b);
+
+/* Works out how to turn `from` into `to`. `changed_out` gets `to`'s value for
+everything that is new or different, except that where both sides have an
+object, it gets an object of just the changes instead, so merging it into `from`
+member by member (as in a JSON merge patch) gives `to`'s values. `deleted_out`
+gets an array of the paths, each an array of keys, of the object members that
+`to` no longer has. Returns false, leaving `changed_out` and `deleted_out` empty,
+if there is no difference. */
+bool json_diff(cJSON *from, cJSON *to, scoped_cJSON_t *changed_out, scoped_cJSON_t *deleted_out);
+
 class json_iterator_t {
 public:
     explicit json_iterator_t(cJSON *target);
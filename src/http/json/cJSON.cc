@@ -265,6 +265,7 @@ cJSON *cJSON_Parse(const char *value)
 /* Render a cJSON item/entity/structure to text. */
 char *cJSON_Print(cJSON *item)                                {return print_value(item,0,1);}
 char *cJSON_PrintUnformatted(cJSON *item)        {return print_value(item,0,0);}
+char *cJSON_PrintString(const char *str)        {return print_string_ptr(str);}
 
 /* Parser core - when encountering text, process appropriately. */
 static const char *parse_value(cJSON *item,const char *value)
@@ -23,6 +23,11 @@ public:
         cb_->on_deletion(key, recency, interruptor);
     }
 
+    void on_range_done(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        rassert(kr_.is_superset(range));
+        cb_->on_range_done(range, interruptor);
+    }
+
     void on_pair(transaction_t *txn, repli_timestamp_t recency, const btree_key_t *key, const void *val, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
         rassert(kr_.contains_key(key->contents, key->size));
         const memcached_value_t *value = static_cast<const memcached_value_t *>(val);
@@ -37,12 +37,14 @@ void debug_print(append_only_printf_buffer_t *buf, const backfill_atom_t& atom);
 
 
 // How to use this class: Send on_delete_range calls before
-// on_keyvalue calls for keys within that range.
+// on_keyvalue calls for keys within that range. on_range_done is
+// called once nothing more will be sent for the keys in that range.
 class backfill_callback_t {
 public:
     virtual void on_delete_range(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_deletion(const btree_key_t *key, repli_timestamp_t recency, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
     virtual void on_keyvalue(const backfill_atom_t& atom, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
+    virtual void on_range_done(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
 protected:
     virtual ~backfill_callback_t() { }
 };
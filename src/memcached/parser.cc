@@ -9,6 +9,7 @@
 #include <stdarg.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <set>
 #include <stdexcept>
 #include <vector>
@@ -37,6 +38,13 @@ static const char *crlf = "\r\n";
 /* txt_memcached_handler_t only exists as a convenient thing to pass around to do_get(),
 do_storage(), and the like. */
 
+struct get_t {
+    store_key_t key;
+    get_result_t res;
+    std::string error_message;
+    bool ok;
+};
+
 struct txt_memcached_handler_t : public home_thread_mixin_debug_only_t {
     txt_memcached_handler_t(memcached_interface_t *_interface,
                             namespace_interface_t<memcached_protocol_t> *_nsi,
@@ -48,6 +56,12 @@ struct txt_memcached_handler_t : public home_thread_mixin_debug_only_t {
           stats(_stats), interruptor(_interruptor)
     { }
 
+    ~txt_memcached_handler_t() {
+        for (size_t i = 0; i < spare_gets.size(); ++i) {
+            delete spare_gets[i];
+        }
+    }
+
     memcached_interface_t *interface;
 
     namespace_interface_t<memcached_protocol_t> *nsi;
@@ -58,6 +72,27 @@ struct txt_memcached_handler_t : public home_thread_mixin_debug_only_t {
 
     signal_t *interruptor;
 
+    /* Arrays of `get_t`s that earlier gets have finished with, so that a connection
+    doing a steady stream of gets doesn't allocate one for every request. There can
+    be more than one because pipelined gets overlap. */
+    std::vector<std::vector<get_t> *> spare_gets;
+
+    std::vector<get_t> *take_gets() {
+        if (spare_gets.empty()) {
+            return new std::vector<get_t>;
+        }
+        std::vector<get_t> *gets = spare_gets.back();
+        spare_gets.pop_back();
+        return gets;
+    }
+
+    void return_gets(std::vector<get_t> *gets) {
+        /* Drop the references to the values now rather than whenever the array
+        gets reused; `clear()` keeps the capacity. */
+        gets->clear();
+        spare_gets.push_back(gets);
+    }
+
     cas_t generate_cas() {
         // TODO we have to do better than this. CASes need to be generated in a
         // way that is very fast but also gives a reasonably good guarantee of
@@ -271,13 +306,6 @@ private:
 };
 /* do_get() is used for "get" and "gets" commands. */
 
-struct get_t {
-    store_key_t key;
-    get_result_t res;
-    std::string error_message;
-    bool ok;
-};
-
 void do_one_get(txt_memcached_handler_t *rh, bool with_cas, get_t *gets, int i, order_token_t token) {
     try {
         if (with_cas) {
@@ -302,6 +330,71 @@ void do_one_get(txt_memcached_handler_t *rh, bool with_cas, get_t *gets, int i,
     }
 }
 
+/* Looks up the keys of `gets` listed in `(*shards)[s]` with a single read. They
+are all on the same shard, so if it can't be reached, only they fail. */
+void do_shard_get(txt_memcached_handler_t *rh, std::vector<get_t> *gets, const std::vector<std::vector<size_t> > *shards, int s, order_token_t token) {
+    const std::vector<size_t> &indices = (*shards)[s];
+    std::vector<store_key_t> keys(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i) {
+        keys[i] = (*gets)[indices[i]].key;
+    }
+    try {
+        memcached_protocol_t::read_t read(multi_get_query_t(keys), time(NULL));
+        memcached_protocol_t::read_response_t response;
+        rh->nsi->read(read, &response, token, rh->interruptor);
+        const multi_get_result_t &result = boost::get<multi_get_result_t>(response.result);
+        guarantee(result.results.size() == indices.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            (*gets)[indices[i]].res = result.results[i];
+            (*gets)[indices[i]].ok = true;
+        }
+    } catch (const cannot_perform_query_exc_t &e) {
+        for (size_t i = 0; i < indices.size(); ++i) {
+            (*gets)[indices[i]].error_message = e.what();
+            (*gets)[indices[i]].ok = false;
+        }
+    } catch (interrupted_exc_t) {
+        /* do nothing */
+    }
+}
+
+/* Looks up all of `gets` with one read per shard, so that a shard that is down
+only fails the keys that are on it. */
+void do_multi_get(txt_memcached_handler_t *rh, std::vector<get_t> *gets, order_token_t token) {
+    std::vector<std::vector<size_t> > shards;
+    std::vector<bool> assigned(gets->size(), false);
+    try {
+        std::set<memcached_protocol_t::region_t> scheme = rh->nsi->get_sharding_scheme();
+        for (std::set<memcached_protocol_t::region_t>::iterator it = scheme.begin(); it != scheme.end(); ++it) {
+            std::vector<size_t> indices;
+            for (size_t i = 0; i < gets->size(); ++i) {
+                if (!assigned[i] && region_contains_key(*it, (*gets)[i].key)) {
+                    indices.push_back(i);
+                    assigned[i] = true;
+                }
+            }
+            if (!indices.empty()) {
+                shards.push_back(indices);
+            }
+        }
+    } catch (const cannot_perform_query_exc_t &) {
+        /* We don't know the shards; the keys left over below go out in one
+        read, which fails as a whole if any shard is down. */
+    }
+
+    std::vector<size_t> rest;
+    for (size_t i = 0; i < gets->size(); ++i) {
+        if (!assigned[i]) {
+            rest.push_back(i);
+        }
+    }
+    if (!rest.empty()) {
+        shards.push_back(rest);
+    }
+
+    pmap(shards.size(), boost::bind(&do_shard_get, rh, gets, &shards, _1, token));
+}
+
 void do_get(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, bool with_cas, int argc, char **argv, order_token_t token) {
     // We should already be spawned within a coroutine.
     pipeliner_acq_t pipeliner_acq(pipeliner);
@@ -310,7 +403,13 @@ void do_get(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, bool with_cas,
     rassert(strcmp(argv[0], "get") == 0 || strcmp(argv[0], "gets") == 0);
 
     /* Vector to store the keys and the task-objects */
-    std::vector<get_t> gets;
+    std::vector<get_t> *gets_buffer = rh->take_gets();
+    std::vector<get_t> &gets = *gets_buffer;
+    struct return_gets_t {
+        txt_memcached_handler_t *rh;
+        std::vector<get_t> *gets;
+        ~return_gets_t() { rh->return_gets(gets); }
+    } return_gets = { rh, gets_buffer };
 
     /* First parse all of the keys to get */
     gets.reserve(argc - 1);
@@ -337,8 +436,13 @@ void do_get(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, bool with_cas,
 
     block_pm_duration get_timer(&rh->stats->pm_cmd_get);
 
-    /* Now that we're sure they're all valid, send off the requests */
-    pmap(gets.size(), boost::bind(&do_one_get, rh, with_cas, gets.data(), _1, token));
+    /* Now that we're sure they're all valid, send off the requests. "gets" has to
+    be a write per key, because each key gets its own CAS. */
+    if (with_cas || gets.size() == 1) {
+        pmap(gets.size(), boost::bind(&do_one_get, rh, with_cas, gets.data(), _1, token));
+    } else {
+        do_multi_get(rh, &gets, token);
+    }
 
     if (rh->interruptor->is_pulsed()) {
         pipeliner_acq.begin_write();
@@ -348,14 +452,20 @@ void do_get(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, bool with_cas,
 
     pipeliner_acq.begin_write();
 
-    /* Check if any failed */
+    /* Only fail the whole request if every key failed. Otherwise the keys on
+    shards we couldn't reach are left out, as if they were misses; that's what a
+    client sees from memcached when one of its servers is down. */
+    size_t num_failed = 0;
     for (size_t i = 0; i < gets.size(); ++i) {
         if (!gets[i].ok) {
-            rh->server_error("%s", gets[i].error_message.c_str());
-            pipeliner_acq.end_write();
-            return;
+            ++num_failed;
         }
     }
+    if (num_failed == gets.size()) {
+        rh->server_error("%s", gets[0].error_message.c_str());
+        pipeliner_acq.end_write();
+        return;
+    }
 
     /* Handle the results in sequence */
     for (size_t i = 0; i < gets.size(); ++i) {
@@ -363,7 +473,7 @@ void do_get(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, bool with_cas,
 
         /* If res.value is NULL that means the value was not found so we don't write
            anything */
-        if (res.value) {
+        if (gets[i].ok && res.value) {
             /* If the write half of the connection has been closed, there's no point in trying
                to send anything */
             if (rh->is_write_open()) {
@@ -570,6 +680,27 @@ enum storage_command_t {
     prepend_command
 };
 
+// This is protocol.txt, verbatim:
+// Some commands involve a client sending some kind of expiration time
+// (relative to an item or to an operation requested by the client) to
+// the server. In all such cases, the actual value sent may either be
+// Unix time (number of seconds since January 1, 1970, as a 32-bit
+// value), or a number of seconds starting from current time. In the
+// latter case, this number of seconds may not exceed 60*60*24*30 (number
+// of seconds in 30 days); if the number sent by a client is larger than
+// that, the server will consider it to be real Unix time value rather
+// than an offset from current time.
+exptime_t convert_exptime(exptime_t exptime) {
+    if (exptime <= 60*60*24*30 && exptime > 0) {
+        // If 60*60*24*30 < exptime <= time(NULL), that's fine, the
+        // btree code needs to handle that case gracefully anyway
+        // (since the clock can tick in the middle of an insert
+        // anyway...).  We have tests in expiration.py.
+        exptime += time(NULL);
+    }
+    return exptime;
+}
+
 struct storage_metadata_t {
     const mcflags_t mcflags;
     const exptime_t exptime;
@@ -772,23 +903,7 @@ void do_storage(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, storage_com
         return;
     }
 
-    // This is protocol.txt, verbatim:
-    // Some commands involve a client sending some kind of expiration time
-    // (relative to an item or to an operation requested by the client) to
-    // the server. In all such cases, the actual value sent may either be
-    // Unix time (number of seconds since January 1, 1970, as a 32-bit
-    // value), or a number of seconds starting from current time. In the
-    // latter case, this number of seconds may not exceed 60*60*24*30 (number
-    // of seconds in 30 days); if the number sent by a client is larger than
-    // that, the server will consider it to be real Unix time value rather
-    // than an offset from current time.
-    if (exptime <= 60*60*24*30 && exptime > 0) {
-        // If 60*60*24*30 < exptime <= time(NULL), that's fine, the
-        // btree code needs to handle that case gracefully anyway
-        // (since the clock can tick in the middle of an insert
-        // anyway...).  We have tests in expiration.py.
-        exptime += time(NULL);
-    }
+    exptime = convert_exptime(exptime);
 
     /* Now parse the value length */
     size_t value_size = strtou64_strict(argv[4], &invalid_char, 10);
@@ -1065,7 +1180,9 @@ void do_delete(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, int argc, ch
 
 /* "stats" command */
 
-void format_stats(const perfmon_result_t *stats, const std::string& name, const std::set<std::string>& names_to_match, std::vector<std::string> *result) {
+/* Flattens `stats` into (name, value) pairs, keeping only the names in
+`names_to_match` unless it's empty. */
+void collect_stats(const perfmon_result_t *stats, const std::string& name, const std::set<std::string>& names_to_match, std::vector<std::pair<std::string, std::string> > *result) {
     // `switch` is used instead of `if` with `is_map` and `is_string` checks
     // because that way the compiler guarantees us an error message if someone
     // adds another type of `perfmon_results_t` and forgets to change this code
@@ -1074,13 +1191,13 @@ void format_stats(const perfmon_result_t *stats, const std::string& name, const
              // This is not super-efficient (better to only scan for the stats
              // that match the name), but we don't care right now
             if (names_to_match.empty() || names_to_match.count(name) != 0) {
-                result->push_back(strprintf("STAT %s %s\r\n", name.c_str(), stats->get_string()->c_str()));
+                result->push_back(std::make_pair(name, *stats->get_string()));
             }
             break;
         case perfmon_result_t::type_map:
             for (perfmon_result_t::const_iterator i = stats->begin(); i != stats->end(); ++i) {
                 std::string sub_name(name.empty() ? i->first : name + "." + i->first);
-                format_stats(i->second, sub_name, names_to_match, result);
+                collect_stats(i->second, sub_name, names_to_match, result);
             }
             break;
         default:
@@ -1098,7 +1215,11 @@ void memcached_stats(int argc, char **argv, std::vector<std::string> *stat_respo
     }
 
     scoped_ptr_t<perfmon_result_t> stats(perfmon_get_stats());
-    format_stats(stats.get(), std::string(), names_to_match, stat_response_lines);
+    std::vector<std::pair<std::string, std::string> > pairs;
+    collect_stats(stats.get(), std::string(), names_to_match, &pairs);
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        stat_response_lines->push_back(strprintf("STAT %s %s\r\n", pairs[i].first.c_str(), pairs[i].second.c_str()));
+    }
     stat_response_lines->push_back(end_marker);
 }
 
@@ -1155,7 +1276,14 @@ void handle_memcache(memcached_interface_t *interface,
         }
 
         /* Dispatch to the appropriate subclass */
+#ifndef NDEBUG
         order_token_t token = order_source.check_in(std::string("handle_memcache+") + args[0]);
+#else
+        /* The tag is ignored in release mode, so don't build a new string for it on
+        every command. */
+        static const std::string handle_memcache_tag("handle_memcache");
+        order_token_t token = order_source.check_in(handle_memcache_tag);
+#endif
         if (!strcmp(args[0], "get")) {    // check for retrieval commands
             coro_t::spawn_now_dangerously(boost::bind(do_get, &rh, &pipeliner, false, args.size(), args.data(), token.with_read_mode()));
         } else if (!strcmp(args[0], "gets")) {
@@ -1237,3 +1365,644 @@ void handle_memcache(memcached_interface_t *interface,
     logDBG("Closed memcached stream: %p", coro_t::self());
 }
 
+
+/* The binary protocol. Every request and response is a packet with a fixed 24-byte
+header (integers are big-endian), followed by the "extras", the key and the value, in
+that order. The "quiet" variants of commands only send a response if something went
+wrong (or, for gets, if the key was found); clients send a batch of them followed by a
+`noop`, whose response tells them the batch is done. */
+
+enum binary_magic_t {
+    binary_request_magic = MEMCACHED_BINARY_REQUEST_MAGIC,
+    binary_response_magic = 0x81
+};
+
+enum binary_opcode_t {
+    binary_get = 0x00,
+    binary_set = 0x01,
+    binary_add = 0x02,
+    binary_replace = 0x03,
+    binary_delete = 0x04,
+    binary_increment = 0x05,
+    binary_decrement = 0x06,
+    binary_quit = 0x07,
+    binary_getq = 0x09,
+    binary_noop = 0x0a,
+    binary_version = 0x0b,
+    binary_getk = 0x0c,
+    binary_getkq = 0x0d,
+    binary_append = 0x0e,
+    binary_prepend = 0x0f,
+    binary_stat = 0x10,
+    binary_setq = 0x11,
+    binary_addq = 0x12,
+    binary_replaceq = 0x13,
+    binary_deleteq = 0x14,
+    binary_incrementq = 0x15,
+    binary_decrementq = 0x16,
+    binary_quitq = 0x17,
+    binary_appendq = 0x19,
+    binary_prependq = 0x1a
+};
+
+enum binary_status_t {
+    binary_no_error = 0x0000,
+    binary_key_not_found = 0x0001,
+    binary_key_exists = 0x0002,
+    binary_value_too_large = 0x0003,
+    binary_invalid_arguments = 0x0004,
+    binary_item_not_stored = 0x0005,
+    binary_non_numeric_value = 0x0006,
+    binary_unknown_command = 0x0081,
+    binary_internal_error = 0x0084
+};
+
+static const size_t binary_header_size = 24;
+
+// No command we support has more extras than this (`incr` and `decr` have 20 bytes).
+static const size_t binary_max_extras_size = 32;
+
+static uint16_t decode_be16(const char *p) {
+    const uint8_t *u = reinterpret_cast<const uint8_t *>(p);
+    return (uint16_t(u[0]) << 8) | u[1];
+}
+
+static uint32_t decode_be32(const char *p) {
+    return (uint32_t(decode_be16(p)) << 16) | decode_be16(p + 2);
+}
+
+static uint64_t decode_be64(const char *p) {
+    return (uint64_t(decode_be32(p)) << 32) | decode_be32(p + 4);
+}
+
+static void encode_be16(uint16_t x, char *p) {
+    p[0] = x >> 8;
+    p[1] = x;
+}
+
+static void encode_be32(uint32_t x, char *p) {
+    encode_be16(x >> 16, p);
+    encode_be16(x, p + 2);
+}
+
+static void encode_be64(uint64_t x, char *p) {
+    encode_be32(x >> 32, p);
+    encode_be32(x, p + 4);
+}
+
+struct binary_request_t {
+    uint8_t opcode;
+    uint32_t opaque;
+    cas_t cas;
+
+    /* `binary_no_error`, or why the request can't be carried out even though the
+    packet was well-formed (the key was too long, say). */
+    binary_status_t parse_status;
+
+    size_t extras_size;
+    char extras[binary_max_extras_size];
+
+    bool has_key;
+    store_key_t key;
+
+    // NULL if the request had no value.
+    intrusive_ptr_t<data_buffer_t> value;
+};
+
+static bool binary_is_quiet(uint8_t opcode) {
+    switch (opcode) {
+    case binary_getq:
+    case binary_getkq:
+    case binary_setq:
+    case binary_addq:
+    case binary_replaceq:
+    case binary_deleteq:
+    case binary_incrementq:
+    case binary_decrementq:
+    case binary_quitq:
+    case binary_appendq:
+    case binary_prependq:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void write_binary_response(txt_memcached_handler_t *rh, const binary_request_t &req, binary_status_t status,
+                           const char *extras, size_t extras_size,
+                           const char *key, size_t key_size,
+                           const char *value, size_t value_size,
+                           cas_t cas) THROWS_NOTHING {
+    char header[binary_header_size];
+    header[0] = binary_response_magic;
+    header[1] = req.opcode;
+    encode_be16(key_size, header + 2);
+    header[4] = extras_size;
+    header[5] = 0;   // data type
+    encode_be16(status, header + 6);
+    encode_be32(extras_size + key_size + value_size, header + 8);
+    encode_be32(req.opaque, header + 12);
+    encode_be64(cas, header + 16);
+    rh->write(header, binary_header_size);
+    if (extras_size > 0) rh->write(extras, extras_size);
+    if (key_size > 0) rh->write(key, key_size);
+    if (value_size > 0) {
+        if (value_size < MAX_BUFFERED_GET_SIZE) {
+            rh->write(value, value_size);
+        } else {
+            rh->write_unbuffered(value, value_size);
+        }
+    }
+}
+
+void write_binary_status(txt_memcached_handler_t *rh, const binary_request_t &req, binary_status_t status) THROWS_NOTHING {
+    write_binary_response(rh, req, status, NULL, 0, NULL, 0, NULL, 0, 0);
+}
+
+/* Errors carry a human-readable message as their value. */
+void write_binary_error(txt_memcached_handler_t *rh, const binary_request_t &req, binary_status_t status, const std::string &message) THROWS_NOTHING {
+    write_binary_response(rh, req, status, NULL, 0, NULL, 0, message.data(), message.size(), 0);
+}
+
+/* Checks that `req` has the parts its command calls for. A command that wants
+a value takes an empty one too, which comes without any value at all. */
+binary_status_t check_binary_request(const binary_request_t &req, size_t extras_size, bool wants_key, bool wants_value) {
+    if (req.parse_status != binary_no_error) {
+        return req.parse_status;
+    }
+    if (req.extras_size != extras_size || req.has_key != wants_key || (req.value.has() && !wants_value)) {
+        return binary_invalid_arguments;
+    }
+    return binary_no_error;
+}
+
+void reject_binary_request(txt_memcached_handler_t *rh, pipeliner_acq_t *pipeliner_acq, const binary_request_t &req, binary_status_t status) {
+    pipeliner_acq->begin_write();
+    write_binary_status(rh, req, status);
+    pipeliner_acq->end_write();
+}
+
+void do_binary_get(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, binary_request_t req, order_token_t token) {
+    // We should already be spawned within a coroutine.
+    pipeliner_acq_t pipeliner_acq(pipeliner);
+    pipeliner_acq.done_argparsing();
+
+    binary_status_t status = check_binary_request(req, 0, true, false);
+    if (status != binary_no_error) {
+        reject_binary_request(rh, &pipeliner_acq, req, status);
+        return;
+    }
+    rh->stats->pm_get_key_size.record(req.key.size());
+
+    block_pm_duration get_timer(&rh->stats->pm_cmd_get);
+
+    get_t get;
+    get.key = req.key;
+    do_one_get(rh, false, &get, 0, token);
+
+    pipeliner_acq.begin_write();
+    if (rh->interruptor->is_pulsed()) {
+        /* Nothing to say */
+    } else if (!get.ok) {
+        write_binary_error(rh, req, binary_internal_error, get.error_message);
+    } else if (!get.res.value) {
+        if (!binary_is_quiet(req.opcode)) {
+            write_binary_error(rh, req, binary_key_not_found, "Not found");
+        }
+    } else if (rh->is_write_open()) {
+        char flags[4];
+        encode_be32(get.res.flags, flags);
+        bool with_key = req.opcode == binary_getk || req.opcode == binary_getkq;
+        write_binary_response(rh, req, binary_no_error, flags, sizeof(flags),
+                              with_key ? reinterpret_cast<const char *>(req.key.contents()) : NULL,
+                              with_key ? req.key.size() : 0,
+                              get.res.value->buf(), get.res.value->size(),
+                              get.res.cas);
+    }
+    pipeliner_acq.end_write();
+}
+
+/* Carries out `write`. Returns false if we were interrupted, in which case nothing
+should be sent to the client. */
+bool run_binary_write(txt_memcached_handler_t *rh, const memcached_protocol_t::write_t &write, order_token_t token,
+                      memcached_protocol_t::write_response_t *response_out, std::string *error_out) {
+    try {
+        rh->nsi->write(write, response_out, token, rh->interruptor);
+    } catch (const cannot_perform_query_exc_t &e) {
+        *error_out = e.what();
+        if (error_out->empty()) *error_out = "cannot perform query";
+    } catch (const interrupted_exc_t &) {
+        return false;
+    }
+    return true;
+}
+
+void do_binary_storage(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, binary_request_t req, order_token_t token) {
+    pipeliner_acq_t pipeliner_acq(pipeliner);
+    pipeliner_acq.done_argparsing();
+
+    bool append_prepend = false;
+    add_policy_t add_policy = add_policy_yes;
+    replace_policy_t replace_policy = replace_policy_yes;
+    switch (req.opcode) {
+    case binary_set:
+    case binary_setq:
+        break;
+    case binary_add:
+    case binary_addq:
+        replace_policy = replace_policy_no;
+        break;
+    case binary_replace:
+    case binary_replaceq:
+        add_policy = add_policy_no;
+        break;
+    case binary_append:
+    case binary_appendq:
+    case binary_prepend:
+    case binary_prependq:
+        append_prepend = true;
+        break;
+    default:
+        unreachable();
+    }
+
+    binary_status_t status = check_binary_request(req, append_prepend ? 0 : 8, true, true);
+    if (status == binary_no_error && req.cas != 0) {
+        /* A CAS on a set or a replace means "only if it hasn't changed". An add
+        can't have one, since there's nothing to have changed, and we can't check
+        one on an append or a prepend. */
+        if (append_prepend || replace_policy == replace_policy_no) {
+            status = binary_invalid_arguments;
+        } else {
+            add_policy = add_policy_no;
+            replace_policy = replace_policy_if_cas_matches;
+        }
+    }
+    if (status != binary_no_error) {
+        reject_binary_request(rh, &pipeliner_acq, req, status);
+        return;
+    }
+    if (!req.value.has()) {
+        req.value = data_buffer_t::create(0);
+    }
+    rh->stats->pm_storage_key_size.record(req.key.size());
+    rh->stats->pm_storage_value_size.record(req.value->size());
+
+    block_pm_duration set_timer(&rh->stats->pm_cmd_set);
+
+    memcached_protocol_t::write_response_t result;
+    std::string error_message;
+    bool ok;
+    if (append_prepend) {
+        append_prepend_mutation_t mutation(
+            req.opcode == binary_append || req.opcode == binary_appendq ? append_prepend_APPEND : append_prepend_PREPEND,
+            req.key, req.value);
+        ok = run_binary_write(rh, memcached_protocol_t::write_t(mutation, rh->generate_cas(), time(NULL)),
+                              token, &result, &error_message);
+    } else {
+        sarc_mutation_t mutation(req.key, req.value, decode_be32(req.extras),
+                                 convert_exptime(decode_be32(req.extras + 4)),
+                                 add_policy, replace_policy, req.cas);
+        ok = run_binary_write(rh, memcached_protocol_t::write_t(mutation, rh->generate_cas(), time(NULL)),
+                              token, &result, &error_message);
+    }
+
+    pipeliner_acq.begin_write();
+    if (!ok) {
+        /* We were interrupted */
+    } else if (!error_message.empty()) {
+        write_binary_error(rh, req, binary_internal_error, error_message);
+    } else {
+        if (append_prepend) {
+            switch (boost::get<append_prepend_result_t>(result.result)) {
+            case apr_success: status = binary_no_error; break;
+            case apr_not_found: status = binary_item_not_stored; break;
+            case apr_too_large: status = binary_value_too_large; break;
+            default: unreachable();
+            }
+        } else {
+            switch (boost::get<set_result_t>(result.result)) {
+            case sr_stored: status = binary_no_error; break;
+            case sr_didnt_add: status = binary_key_not_found; break;
+            case sr_didnt_replace: status = binary_key_exists; break;
+            case sr_too_large: status = binary_value_too_large; break;
+            default: unreachable();
+            }
+        }
+        /* We don't know the CAS the value ended up with (it only gets one if it
+        had one before), so we send none. */
+        if (status != binary_no_error || !binary_is_quiet(req.opcode)) {
+            write_binary_status(rh, req, status);
+        }
+    }
+    pipeliner_acq.end_write();
+}
+
+void do_binary_delete(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, binary_request_t req, order_token_t token) {
+    pipeliner_acq_t pipeliner_acq(pipeliner);
+    pipeliner_acq.done_argparsing();
+
+    binary_status_t status = check_binary_request(req, 0, true, false);
+    if (status != binary_no_error) {
+        reject_binary_request(rh, &pipeliner_acq, req, status);
+        return;
+    }
+    rh->stats->pm_delete_key_size.record(req.key.size());
+
+    block_pm_duration set_timer(&rh->stats->pm_cmd_set);
+
+    memcached_protocol_t::write_response_t result;
+    std::string error_message;
+    bool ok = run_binary_write(rh, memcached_protocol_t::write_t(delete_mutation_t(req.key, false), INVALID_CAS, time(NULL)),
+                               token, &result, &error_message);
+
+    pipeliner_acq.begin_write();
+    if (!ok) {
+        /* We were interrupted */
+    } else if (!error_message.empty()) {
+        write_binary_error(rh, req, binary_internal_error, error_message);
+    } else if (boost::get<delete_result_t>(result.result) == dr_not_found) {
+        write_binary_error(rh, req, binary_key_not_found, "Not found");
+    } else if (!binary_is_quiet(req.opcode)) {
+        write_binary_status(rh, req, binary_no_error);
+    }
+    pipeliner_acq.end_write();
+}
+
+void do_binary_incr_decr(txt_memcached_handler_t *rh, pipeliner_t *pipeliner, binary_request_t req, order_token_t token) {
+    pipeliner_acq_t pipeliner_acq(pipeliner);
+    pipeliner_acq.done_argparsing();
+
+    /* The extras are the delta, the value to start from if the key doesn't exist, and
+    the expiration time to give it then (or all ones if it shouldn't be created). */
+    binary_status_t status = check_binary_request(req, 20, true, false);
+    if (status != binary_no_error) {
+        reject_binary_request(rh, &pipeliner_acq, req, status);
+        return;
+    }
+    const uint64_t delta = decode_be64(req.extras);
+    const uint64_t initial = decode_be64(req.extras + 8);
+    const exptime_t exptime = decode_be32(req.extras + 16);
+    const bool incr = req.opcode == binary_increment || req.opcode == binary_incrementq;
+
+    block_pm_duration set_timer(&rh->stats->pm_cmd_set);
+
+    memcached_protocol_t::write_response_t result;
+    std::string error_message;
+    uint64_t new_value = 0;
+
+    incr_decr_mutation_t mutation(incr ? incr_decr_INCR : incr_decr_DECR, req.key, delta);
+    if (!run_binary_write(rh, memcached_protocol_t::write_t(mutation, rh->generate_cas(), time(NULL)),
+                          token, &result, &error_message)) {
+        pipeliner_acq.begin_write();
+        pipeliner_acq.end_write();
+        return;
+    }
+    if (error_message.empty()) {
+        incr_decr_result_t res = boost::get<incr_decr_result_t>(result.result);
+        switch (res.res) {
+        case incr_decr_result_t::idr_success:
+            new_value = res.new_value;
+            break;
+        case incr_decr_result_t::idr_not_found:
+            status = binary_key_not_found;
+            break;
+        case incr_decr_result_t::idr_not_numeric:
+            status = binary_non_numeric_value;
+            break;
+        default: unreachable();
+        }
+    }
+
+    if (error_message.empty() && status == binary_key_not_found && exptime != 0xffffffff) {
+        /* Create the key with the initial value. If someone beat us to it, their
+        value stands and we report that the key exists. */
+        std::string initial_str = strprintf("%" PRIu64, initial);
+        intrusive_ptr_t<data_buffer_t> data = data_buffer_t::create(initial_str.size());
+        memcpy(data->buf(), initial_str.data(), initial_str.size());
+        sarc_mutation_t add(req.key, data, 0, convert_exptime(exptime), add_policy_yes, replace_policy_no, NO_CAS_SUPPLIED);
+        if (!run_binary_write(rh, memcached_protocol_t::write_t(add, rh->generate_cas(), time(NULL)),
+                              order_token_t::ignore, &result, &error_message)) {
+            pipeliner_acq.begin_write();
+            pipeliner_acq.end_write();
+            return;
+        }
+        if (error_message.empty()) {
+            if (boost::get<set_result_t>(result.result) == sr_stored) {
+                status = binary_no_error;
+                new_value = initial;
+            } else {
+                status = binary_key_exists;
+            }
+        }
+    }
+
+    pipeliner_acq.begin_write();
+    if (!error_message.empty()) {
+        write_binary_error(rh, req, binary_internal_error, error_message);
+    } else if (status == binary_key_not_found) {
+        write_binary_error(rh, req, status, "Not found");
+    } else if (status == binary_non_numeric_value) {
+        write_binary_error(rh, req, status, "Non-numeric value");
+    } else if (status != binary_no_error) {
+        write_binary_status(rh, req, status);
+    } else if (!binary_is_quiet(req.opcode)) {
+        char value[8];
+        encode_be64(new_value, value);
+        write_binary_response(rh, req, binary_no_error, NULL, 0, NULL, 0, value, sizeof(value), 0);
+    }
+    pipeliner_acq.end_write();
+}
+
+/* Reads and throws away `size` bytes. */
+void skip_binary_bytes(txt_memcached_handler_t *rh, size_t size) THROWS_ONLY(memcached_interface_t::no_more_data_exc_t) {
+    char buffer[4096];
+    while (size > 0) {
+        size_t chunk = std::min(size, sizeof(buffer));
+        rh->read(buffer, chunk);
+        size -= chunk;
+    }
+}
+
+/* Reads a request off the connection. Returns false if the client isn't speaking
+the binary protocol, in which case the connection should be closed. */
+bool read_binary_request(txt_memcached_handler_t *rh, binary_request_t *req) THROWS_ONLY(memcached_interface_t::no_more_data_exc_t) {
+    char header[binary_header_size];
+    rh->read(header, binary_header_size);
+
+    if (static_cast<uint8_t>(header[0]) != binary_request_magic) {
+        return false;
+    }
+    req->opcode = header[1];
+    const size_t key_size = decode_be16(header + 2);
+    const size_t extras_size = static_cast<uint8_t>(header[4]);
+    const size_t body_size = decode_be32(header + 8);
+    req->opaque = decode_be32(header + 12);
+    req->cas = decode_be64(header + 16);
+    if (body_size < extras_size + key_size) {
+        return false;
+    }
+    const size_t value_size = body_size - extras_size - key_size;
+
+    req->parse_status = binary_no_error;
+
+    req->extras_size = extras_size;
+    if (extras_size <= binary_max_extras_size) {
+        rh->read(req->extras, extras_size);
+    } else {
+        skip_binary_bytes(rh, extras_size);
+        req->parse_status = binary_invalid_arguments;
+    }
+
+    req->has_key = key_size > 0;
+    if (key_size <= MAX_KEY_SIZE) {
+        uint8_t key[MAX_KEY_SIZE];
+        rh->read(key, key_size);
+        req->key = store_key_t(key_size, key);
+    } else {
+        skip_binary_bytes(rh, key_size);
+        req->parse_status = binary_invalid_arguments;
+    }
+
+    req->value.reset();
+    // Same limit as the text protocol.
+    if (value_size >= (1u << 31) - 1) {
+        skip_binary_bytes(rh, value_size);
+        req->parse_status = binary_value_too_large;
+    } else if (value_size > 0) {
+        req->value = data_buffer_t::create(value_size);
+        rh->read(req->value->buf(), value_size);
+    }
+
+    return true;
+}
+
+void handle_memcache_binary(memcached_interface_t *interface,
+        namespace_interface_t<memcached_protocol_t> *nsi,
+        int max_concurrent_queries_per_connection,
+        memcached_stats_t *stats,
+        signal_t *interruptor) {
+    logDBG("Opened binary memcached stream: %p", coro_t::self());
+
+    txt_memcached_handler_t rh(interface, nsi, max_concurrent_queries_per_connection, stats, interruptor);
+
+    /* As for the text protocol, requests are carried out in the order they arrive. */
+    order_source_t order_source;
+
+    pipeliner_t pipeliner(&rh);
+
+    binary_request_t req;
+    bool quit = false;
+
+    while (pipeliner.lock_argparsing(), !interruptor->is_pulsed()) {
+        block_pm_duration read_timer(&rh.stats->pm_conns_reading);
+        try {
+            if (!read_binary_request(&rh, &req)) {
+                logDBG("Closing binary memcached stream %p because of a malformed packet", coro_t::self());
+                break;
+            }
+        } catch (memcached_interface_t::no_more_data_exc_t) {
+            break;
+        }
+        read_timer.end();
+
+        block_pm_duration action_timer(&rh.stats->pm_conns_acting);
+
+        if (req.opcode == binary_quit || req.opcode == binary_quitq) {
+            // We reply once everything before it is done; see below.
+            quit = true;
+            break;
+        }
+
+        order_token_t token = order_source.check_in("handle_memcache_binary");
+        switch (req.opcode) {
+        case binary_get:
+        case binary_getq:
+        case binary_getk:
+        case binary_getkq:
+            coro_t::spawn_now_dangerously(boost::bind(do_binary_get, &rh, &pipeliner, req, token.with_read_mode()));
+            break;
+        case binary_set:
+        case binary_setq:
+        case binary_add:
+        case binary_addq:
+        case binary_replace:
+        case binary_replaceq:
+        case binary_append:
+        case binary_appendq:
+        case binary_prepend:
+        case binary_prependq:
+            coro_t::spawn_now_dangerously(boost::bind(do_binary_storage, &rh, &pipeliner, req, token));
+            break;
+        case binary_delete:
+        case binary_deleteq:
+            coro_t::spawn_now_dangerously(boost::bind(do_binary_delete, &rh, &pipeliner, req, token));
+            break;
+        case binary_increment:
+        case binary_incrementq:
+        case binary_decrement:
+        case binary_decrementq:
+            coro_t::spawn_now_dangerously(boost::bind(do_binary_incr_decr, &rh, &pipeliner, req, token));
+            break;
+        case binary_noop: {
+            pipeliner_acq_t pipeliner_acq(&pipeliner);
+            pipeliner_acq.done_argparsing();
+            pipeliner_acq.begin_write();
+            write_binary_status(&rh, req, binary_no_error);
+            pipeliner_acq.end_write();
+        } break;
+        case binary_version: {
+            pipeliner_acq_t pipeliner_acq(&pipeliner);
+            pipeliner_acq.done_argparsing();
+            pipeliner_acq.begin_write();
+            std::string version = strprintf("rethinkdb-%s", RETHINKDB_VERSION);
+            write_binary_response(&rh, req, binary_no_error, NULL, 0, NULL, 0, version.data(), version.size(), 0);
+            pipeliner_acq.end_write();
+        } break;
+        case binary_stat: {
+            pipeliner_acq_t pipeliner_acq(&pipeliner);
+
+            std::set<std::string> names_to_match;
+            if (req.has_key) {
+                names_to_match.insert(std::string(reinterpret_cast<const char *>(req.key.contents()), req.key.size()));
+            }
+            std::vector<std::pair<std::string, std::string> > pairs;
+            {
+                scoped_ptr_t<perfmon_result_t> stats_result(perfmon_get_stats());
+                collect_stats(stats_result.get(), std::string(), names_to_match, &pairs);
+            }
+
+            pipeliner_acq.done_argparsing();
+            pipeliner_acq.begin_write();
+            for (size_t i = 0; i < pairs.size(); ++i) {
+                write_binary_response(&rh, req, binary_no_error, NULL, 0,
+                                      pairs[i].first.data(), pairs[i].first.size(),
+                                      pairs[i].second.data(), pairs[i].second.size(), 0);
+            }
+            // An empty packet ends the list.
+            write_binary_status(&rh, req, binary_no_error);
+            pipeliner_acq.end_write();
+        } break;
+        default: {
+            pipeliner_acq_t pipeliner_acq(&pipeliner);
+            pipeliner_acq.done_argparsing();
+            pipeliner_acq.begin_write();
+            write_binary_error(&rh, req, binary_unknown_command, "Unknown command");
+            pipeliner_acq.end_write();
+        } break;
+        }
+
+        action_timer.end();
+    }
+
+    // Make sure anything that would be running has finished.
+    pipeliner_acq_t pipeliner_acq(&pipeliner);
+    pipeliner_acq.done_argparsing();
+    pipeliner_acq.begin_write();
+    if (quit && req.opcode == binary_quit) {
+        write_binary_status(&rh, req, binary_no_error);
+    }
+    pipeliner_acq.end_write();
+
+    logDBG("Closed binary memcached stream: %p", coro_t::self());
+}
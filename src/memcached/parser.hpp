@@ -41,4 +41,15 @@ void handle_memcache(memcached_interface_t *interface,
                      memcached_stats_t *,
                      signal_t *interruptor);
 
+/* `handle_memcache_binary()` is the same, but for clients that speak the binary
+protocol. Binary requests start with `MEMCACHED_BINARY_REQUEST_MAGIC`, which can't
+start a text command. */
+#define MEMCACHED_BINARY_REQUEST_MAGIC 0x80
+
+void handle_memcache_binary(memcached_interface_t *interface,
+                            namespace_interface_t<memcached_protocol_t> *nsi,
+                            int max_concurrent_queries_per_connection,
+                            memcached_stats_t *,
+                            signal_t *interruptor);
+
 #endif /* MEMCACHED_PARSER_HPP_ */
@@ -77,12 +77,16 @@ archive_result_t deserialize(read_stream_t *s, intrusive_ptr_t<data_buffer_t> *b
 }
 
 RDB_IMPL_SERIALIZABLE_1(get_query_t, key);
+RDB_IMPL_SERIALIZABLE_2(multi_get_query_t, keys, region);
 RDB_IMPL_SERIALIZABLE_2(rget_query_t, region, maximum);
 RDB_IMPL_SERIALIZABLE_3(distribution_get_query_t, max_depth, result_limit, region);
+RDB_IMPL_SERIALIZABLE_2(hot_keys_query_t, limit, region);
 RDB_IMPL_SERIALIZABLE_3(get_result_t, value, flags, cas);
+RDB_IMPL_SERIALIZABLE_2(multi_get_result_t, region, results);
 RDB_IMPL_SERIALIZABLE_3(key_with_data_buffer_t, key, mcflags, value_provider);
 RDB_IMPL_SERIALIZABLE_2(rget_result_t, pairs, truncated);
 RDB_IMPL_SERIALIZABLE_2(distribution_result_t, region, key_counts);
+RDB_IMPL_SERIALIZABLE_1(hot_keys_result_t, reports);
 RDB_IMPL_SERIALIZABLE_1(get_cas_mutation_t, key);
 RDB_IMPL_SERIALIZABLE_7(sarc_mutation_t, key, data, flags, exptime, add_policy, replace_policy, old_cas);
 RDB_IMPL_SERIALIZABLE_2(delete_mutation_t, key, dont_put_in_delete_queue);
@@ -107,6 +111,36 @@ region_t monokey_region(const store_key_t &k) {
     return region_t(h, h + 1, key_range_t(key_range_t::closed, k, key_range_t::closed, k));
 }
 
+bool region_contains_key(const region_t &region, const store_key_t &k) {
+    uint64_t h = hash_region_hasher(k.contents(), k.size());
+    return region.beg <= h && h < region.end && region.inner.contains_key(k);
+}
+
+/* Returns the smallest region containing all of `keys`, or the empty region if
+there aren't any. */
+region_t bounding_region(const std::vector<store_key_t> &keys) {
+    if (keys.empty()) {
+        return region_t::empty();
+    }
+    uint64_t beg = HASH_REGION_HASH_SIZE, end = 0;
+    const store_key_t *left = &keys[0], *right = &keys[0];
+    for (size_t i = 0; i < keys.size(); ++i) {
+        uint64_t h = hash_region_hasher(keys[i].contents(), keys[i].size());
+        beg = std::min(beg, h);
+        end = std::max(end, h + 1);
+        if (keys[i] < *left) {
+            left = &keys[i];
+        }
+        if (*right < keys[i]) {
+            right = &keys[i];
+        }
+    }
+    return region_t(beg, end, key_range_t(key_range_t::closed, *left, key_range_t::closed, *right));
+}
+
+multi_get_query_t::multi_get_query_t(const std::vector<store_key_t> &_keys)
+    : keys(_keys), region(bounding_region(_keys)) { }
+
 /* `read_t::get_region()` */
 
 /* Wrap all our local types in anonymous namespaces so the linker doesn't
@@ -117,12 +151,18 @@ struct read_get_region_visitor_t : public boost::static_visitor<region_t> {
     region_t operator()(get_query_t get) {
         return monokey_region(get.key);
     }
+    region_t operator()(const multi_get_query_t &multi_get) {
+        return multi_get.region;
+    }
     region_t operator()(rget_query_t rget) {
         return rget.region;
     }
     region_t operator()(distribution_get_query_t dst_get) {
         return dst_get.region;
     }
+    region_t operator()(const hot_keys_query_t &hot_keys) {
+        return hot_keys.region;
+    }
 };
 
 }   /* anonymous namespace */
@@ -147,6 +187,16 @@ struct read_shard_visitor_t : public boost::static_visitor<read_t> {
         rassert(region == monokey_region(get.key));
         return read_t(get, effective_time);
     }
+    read_t operator()(const multi_get_query_t &multi_get) {
+        rassert(region_is_superset(multi_get.region, region));
+        std::vector<store_key_t> keys;
+        for (size_t i = 0; i < multi_get.keys.size(); ++i) {
+            if (region_contains_key(region, multi_get.keys[i])) {
+                keys.push_back(multi_get.keys[i]);
+            }
+        }
+        return read_t(multi_get_query_t(keys), effective_time);
+    }
     read_t operator()(rget_query_t rget) {
         rassert(region_is_superset(rget.region, region));
         rget.region = region;
@@ -157,6 +207,11 @@ struct read_shard_visitor_t : public boost::static_visitor<read_t> {
         distribution_get.region = region;
         return read_t(distribution_get, effective_time);
     }
+    read_t operator()(hot_keys_query_t hot_keys) {
+        rassert(region_is_superset(hot_keys.region, region));
+        hot_keys.region = region;
+        return read_t(hot_keys, effective_time);
+    }
 };
 
 }   /* anonymous namespace */
@@ -216,6 +271,26 @@ struct read_unshard_visitor_t : public boost::static_visitor<read_response_t> {
         guarantee(count == 1);
         return read_response_t(boost::get<get_result_t>(bits[0].result));
     }
+    read_response_t operator()(const multi_get_query_t &multi_get) {
+        /* Each key was sent to exactly one shard, and each shard answered its
+        keys in the order they appear in `multi_get.keys`. */
+        multi_get_result_t result;
+        result.region = multi_get.region;
+        result.results.resize(multi_get.keys.size());
+        for (size_t i = 0; i < count; ++i) {
+            const multi_get_result_t *bit = boost::get<multi_get_result_t>(&bits[i].result);
+            guarantee(bit, "Bad boost::get\n");
+            size_t j = 0;
+            for (size_t k = 0; k < multi_get.keys.size(); ++k) {
+                if (region_contains_key(bit->region, multi_get.keys[k])) {
+                    guarantee(j < bit->results.size());
+                    result.results[k] = bit->results[j++];
+                }
+            }
+            guarantee(j == bit->results.size());
+        }
+        return read_response_t(result);
+    }
     read_response_t operator()(rget_query_t rget) {
         // TODO: do this without dynamic memory?
         std::vector<key_with_data_buffer_t> pairs;
@@ -242,6 +317,16 @@ struct read_unshard_visitor_t : public boost::static_visitor<read_response_t> {
         return read_response_t(result);
     }
 
+    read_response_t operator()(UNUSED const hot_keys_query_t &hot_keys) {
+        hot_keys_result_t result;
+        for (size_t i = 0; i < count; ++i) {
+            const hot_keys_result_t *bit = boost::get<hot_keys_result_t>(&bits[i].result);
+            guarantee(bit, "Bad boost::get\n");
+            result.reports.insert(result.reports.end(), bit->reports.begin(), bit->reports.end());
+        }
+        return read_response_t(result);
+    }
+
     read_response_t operator()(distribution_get_query_t dget) {
         // TODO: do this without copying so much and/or without dynamic memory
         // Sort results by region
@@ -457,6 +542,22 @@ struct read_visitor_t : public boost::static_visitor<read_response_t> {
             memcached_get(get.key, btree, effective_time, txn, superblock));
     }
 
+    read_response_t operator()(const multi_get_query_t& multi_get) {
+        multi_get_result_t result;
+        result.region = multi_get.region;
+        result.results.resize(multi_get.keys.size());
+        if (multi_get.keys.empty()) {
+            superblock->release();
+        } else {
+            /* Each lookup releases the superblock once it has the root, so it
+            can't be let go of until they all have. */
+            refcount_superblock_t refcount_wrapper(superblock, multi_get.keys.size());
+            pmap(multi_get.keys.size(), boost::bind(&read_visitor_t::do_one_get, this,
+                                                   &multi_get.keys, &result.results, _1, &refcount_wrapper));
+        }
+        return read_response_t(result);
+    }
+
     read_response_t operator()(const rget_query_t& rget) {
         return read_response_t(
             memcached_rget_slice(btree, rget.region.inner, rget.maximum, effective_time, txn, superblock));
@@ -482,6 +583,15 @@ struct read_visitor_t : public boost::static_visitor<read_response_t> {
         return read_response_t(dstr);
     }
 
+    read_response_t operator()(const hot_keys_query_t& hot_keys) {
+        superblock->release();
+        hot_keys_result_t result;
+        result.reports.resize(1);
+        result.reports[0].first = hot_keys.region;
+        btree->stats.hot_keys.get_report(hot_keys.limit, &result.reports[0].second);
+        return read_response_t(result);
+    }
+
     read_visitor_t(btree_slice_t *_btree,
                    transaction_t *_txn,
                    superblock_t *_superblock,
@@ -492,6 +602,11 @@ struct read_visitor_t : public boost::static_visitor<read_response_t> {
         effective_time(_effective_time) { }
 
 private:
+    void do_one_get(const std::vector<store_key_t> *keys, std::vector<get_result_t> *results,
+                    int i, superblock_t *sb) {
+        (*results)[i] = memcached_get((*keys)[i], btree, effective_time, txn, sb);
+    }
+
     btree_slice_t *btree;
     transaction_t *txn;
     superblock_t *superblock;
@@ -575,8 +690,8 @@ void store_t::protocol_write(const write_t &write,
 class memcached_backfill_callback_t : public backfill_callback_t {
     typedef backfill_chunk_t chunk_t;
 public:
-    explicit memcached_backfill_callback_t(chunk_fun_callback_t<memcached_protocol_t> *chunk_fun_cb)
-        : chunk_fun_cb_(chunk_fun_cb) { }
+    memcached_backfill_callback_t(chunk_fun_callback_t<memcached_protocol_t> *chunk_fun_cb, const region_t &region)
+        : chunk_fun_cb_(chunk_fun_cb), region_(region) { }
 
     void on_delete_range(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
         chunk_fun_cb_->send_chunk(chunk_t::delete_range(region_t(range)), interruptor);
@@ -589,6 +704,13 @@ public:
     void on_keyvalue(const backfill_atom_t& atom, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
         chunk_fun_cb_->send_chunk(chunk_t::set_key(atom), interruptor);
     }
+
+    void on_range_done(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        region_t done = region_intersection(region_, region_t(range));
+        if (!region_is_empty(done)) {
+            chunk_fun_cb_->send_checkpoint(done, interruptor);
+        }
+    }
     ~memcached_backfill_callback_t() { }
 
 protected:
@@ -598,19 +720,21 @@ protected:
 
 private:
     chunk_fun_callback_t<memcached_protocol_t> *chunk_fun_cb_;
+    region_t region_;
 
     DISABLE_COPYING(memcached_backfill_callback_t);
 };
 
 static void call_memcached_backfill(int i, btree_slice_t *btree, const std::vector<std::pair<region_t, state_timestamp_t> > &regions,
-        memcached_backfill_callback_t *callback, transaction_t *txn, superblock_t *superblock, memcached_protocol_t::backfill_progress_t *progress,
+        chunk_fun_callback_t<memcached_protocol_t> *chunk_fun_cb, transaction_t *txn, superblock_t *superblock, memcached_protocol_t::backfill_progress_t *progress,
         signal_t *interruptor) {
     parallel_traversal_progress_t *p = new parallel_traversal_progress_t;
     scoped_ptr_t<traversal_progress_t> p_owner(p);
     progress->add_constituent(&p_owner);
     repli_timestamp_t timestamp = regions[i].second.to_repli_timestamp();
+    memcached_backfill_callback_t callback(chunk_fun_cb, regions[i].first);
     try {
-        memcached_backfill(btree, regions[i].first.inner, timestamp, callback, txn, superblock, p, interruptor);
+        memcached_backfill(btree, regions[i].first.inner, timestamp, &callback, txn, superblock, p, interruptor);
     } catch (interrupted_exc_t) {
         /* do nothing; `protocol_send_backfill()` will notice and deal with it.
         */
@@ -629,14 +753,12 @@ void store_t::protocol_send_backfill(const region_map_t<memcached_protocol_t, st
     std::vector<std::pair<region_t, state_timestamp_t> > regions(start_point.begin(), start_point.end());
 
     if (regions.size() > 0) {
-        memcached_backfill_callback_t callback(chunk_fun_cb);
-
         // pmapping by regions.size() is now the arguably wrong thing to do,
         // because adjacent regions often have the same value. On the other hand
         // it's harmless, because caching is basically perfect.
         refcount_superblock_t refcount_wrapper(superblock, regions.size());
         pmap(regions.size(), boost::bind(&call_memcached_backfill, _1,
-                                         btree, regions, &callback, txn, &refcount_wrapper, progress, interruptor));
+                                         btree, regions, chunk_fun_cb, txn, &refcount_wrapper, progress, interruptor));
 
         /* if interruptor was pulsed in `call_memcached_backfill()`, it returned
         normally anyway. So now we have to check manually. */
@@ -32,12 +32,16 @@ write_message_t &operator<<(write_message_t &msg, const rget_result_t &iter);
 archive_result_t deserialize(read_stream_t *s, rget_result_t *iter);
 
 RDB_DECLARE_SERIALIZABLE(get_query_t);
+RDB_DECLARE_SERIALIZABLE(multi_get_query_t);
 RDB_DECLARE_SERIALIZABLE(rget_query_t);
 RDB_DECLARE_SERIALIZABLE(distribution_get_query_t);
+RDB_DECLARE_SERIALIZABLE(hot_keys_query_t);
 RDB_DECLARE_SERIALIZABLE(get_result_t);
+RDB_DECLARE_SERIALIZABLE(multi_get_result_t);
 RDB_DECLARE_SERIALIZABLE(key_with_data_buffer_t);
 RDB_DECLARE_SERIALIZABLE(rget_result_t);
 RDB_DECLARE_SERIALIZABLE(distribution_result_t);
+RDB_DECLARE_SERIALIZABLE(hot_keys_result_t);
 RDB_DECLARE_SERIALIZABLE(get_cas_mutation_t);
 RDB_DECLARE_SERIALIZABLE(sarc_mutation_t);
 RDB_DECLARE_SERIALIZABLE(delete_mutation_t);
@@ -58,7 +62,7 @@ public:
     struct context_t { };
 
     struct read_response_t {
-        typedef boost::variant<get_result_t, rget_result_t, distribution_result_t> result_t;
+        typedef boost::variant<get_result_t, rget_result_t, distribution_result_t, multi_get_result_t, hot_keys_result_t> result_t;
 
         read_response_t() { }
         read_response_t(const read_response_t& r) : result(r.result) { }
@@ -68,7 +72,7 @@ public:
     };
 
     struct read_t {
-        typedef boost::variant<get_query_t, rget_query_t, distribution_get_query_t> query_t;
+        typedef boost::variant<get_query_t, rget_query_t, distribution_get_query_t, multi_get_query_t, hot_keys_query_t> query_t;
 
         region_t get_region() const THROWS_NOTHING;
         read_t shard(const region_t &region) const THROWS_NOTHING;
@@ -216,6 +220,8 @@ RDB_DECLARE_SERIALIZABLE(memcached_protocol_t::backfill_chunk_t::key_value_pair_
 RDB_DECLARE_SERIALIZABLE(memcached_protocol_t::backfill_chunk_t);
 
 
+bool region_contains_key(const memcached_protocol_t::region_t &region, const store_key_t &k);
+
 void debug_print(append_only_printf_buffer_t *buf, const memcached_protocol_t::write_t& write);
 void debug_print(append_only_printf_buffer_t *buf, const memcached_protocol_t::backfill_chunk_t& chunk);
 
@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "protocol_api.hpp"
+#include "btree/hot_keys.hpp"
 #include "btree/keys.hpp"
 #include "config/args.hpp"
 #include "containers/data_buffer.hpp"
@@ -52,6 +53,30 @@ struct get_result_t {
     cas_t cas;
 };
 
+/* `get` with several keys. A multi-get becomes one of these rather than a
+`get_query_t` per key, so that it costs one round trip per shard instead of one
+per key. */
+
+struct multi_get_query_t {
+    std::vector<store_key_t> keys;
+
+    /* The smallest region containing all of `keys`. Sharding narrows it down to
+    the keys in the shard. */
+    hash_region_t<key_range_t> region;
+
+    multi_get_query_t() { }
+    explicit multi_get_query_t(const std::vector<store_key_t> &_keys);
+};
+
+struct multi_get_result_t {
+    /* The region of the query this answers, so that `unshard()` can tell which
+    keys the results belong to. */
+    hash_region_t<key_range_t> region;
+
+    /* One for each key in the query, in the same order. */
+    std::vector<get_result_t> results;
+};
+
 /* `rget` */
 
 struct rget_query_t {
@@ -103,6 +128,26 @@ struct distribution_result_t  {
     std::map<store_key_t, int64_t> key_counts;
 };
 
+/* `hot_keys` asks every btree in the region which keys it sees most and which
+of its operations were slow (see btree/hot_keys.hpp). */
+struct hot_keys_query_t {
+    hot_keys_query_t()
+        : limit(0), region(hash_region_t<key_range_t>::universe())
+    { }
+    explicit hot_keys_query_t(size_t _limit)
+        : limit(_limit), region(hash_region_t<key_range_t>::universe())
+    { }
+
+    /* How many keys to return in each list. */
+    size_t limit;
+    hash_region_t<key_range_t> region;
+};
+
+struct hot_keys_result_t {
+    /* One report for each btree, with the region it holds. */
+    std::vector<std::pair<hash_region_t<key_range_t>, hot_keys_report_t> > reports;
+};
+
 /* `gets` */
 
 struct get_cas_mutation_t {
@@ -55,9 +55,16 @@ struct tcp_conn_memcached_interface_t : public memcached_interface_t, public hom
 
     void read_line(std::vector<char> *dest, signal_t *interruptor) {
         try {
+            /* How much of the buffer we've already searched. A long line arrives
+            over several reads, and there's no point looking at its start again each
+            time. We back up by one byte in case the CR came at the end of the last
+            read. */
+            size_t scanned = 0;
             for (;;) {
                 const_charslice sl = conn->peek();
-                void *crlf_loc = memmem(sl.beg, sl.end - sl.beg, "\r\n", 2);
+                size_t skip = scanned > 0 ? scanned - 1 : 0;
+                void *crlf_loc = memmem(sl.beg + skip, sl.end - sl.beg - skip, "\r\n", 2);
+                scanned = sl.end - sl.beg;
                 ssize_t threshold = MEGABYTE;
 
                 if (crlf_loc) {
@@ -91,8 +98,25 @@ struct tcp_conn_memcached_interface_t : public memcached_interface_t, public hom
 };
 
 void serve_memcache(tcp_conn_t *conn, namespace_interface_t<memcached_protocol_t> *nsi, memcached_stats_t *stats, signal_t *interruptor) {
+    /* The first byte the client sends tells us which protocol it speaks. */
+    bool binary;
+    try {
+        const_charslice sl = conn->peek();
+        while (sl.beg == sl.end) {
+            conn->read_more_buffered(interruptor);
+            sl = conn->peek();
+        }
+        binary = static_cast<uint8_t>(*sl.beg) == MEMCACHED_BINARY_REQUEST_MAGIC;
+    } catch (const tcp_conn_read_closed_exc_t &) {
+        return;
+    }
+
     tcp_conn_memcached_interface_t interface(conn);
-    handle_memcache(&interface, nsi, MAX_CONCURRENT_QUERIES_PER_CONNECTION, stats, interruptor);
+    if (binary) {
+        handle_memcache_binary(&interface, nsi, MAX_CONCURRENT_QUERIES_PER_CONNECTION, stats, interruptor);
+    } else {
+        handle_memcache(&interface, nsi, MAX_CONCURRENT_QUERIES_PER_CONNECTION, stats, interruptor);
+    }
 }
 
 
@@ -431,6 +431,9 @@ bool dummy_protocol_t::store_t::send_backfill(const region_map_t<dummy_protocol_
                     chunk.timestamp = timestamps_snapshot[*it];
                     send_backfill_cb->send_chunk(chunk, interruptor);
                 }
+                dummy_protocol_t::region_t key_region;
+                key_region.keys.insert(*it);
+                send_backfill_cb->send_checkpoint(key_region, interruptor);
                 if (rng.randint(2) == 0) nap(rng.randint(10), interruptor);
             }
         }
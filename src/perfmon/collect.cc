@@ -15,7 +15,13 @@ static void co_perfmon_visit(int thread, void *data) {
 int get_num_threads();
 
 perfmon_result_t *perfmon_get_stats() {
-    void *data = get_global_perfmon_collection().begin_stats();
+    return perfmon_get_stats(NULL);
+}
+
+perfmon_result_t *perfmon_get_stats(const perfmon_filter_t *filter) {
+    void *data = filter == NULL
+        ? get_global_perfmon_collection().begin_stats()
+        : get_global_perfmon_collection().begin_filtered_stats(filter, filter->all_active(), 0);
     pmap(get_num_threads(), boost::bind(&co_perfmon_visit, _1, data));
     return get_global_perfmon_collection().end_stats(data);
 }
@@ -11,4 +11,10 @@
  */
 perfmon_result_t *perfmon_get_stats();
 
+/* Like `perfmon_get_stats()`, but doesn't collect stats that `filter` would
+ * throw away. The result still has to be passed through `filter->filter()`,
+ * because perfmons that aren't collections are collected in full.
+ */
+perfmon_result_t *perfmon_get_stats(const perfmon_filter_t *filter);
+
 #endif  // PERFMON_COLLECT_HPP_
@@ -25,16 +25,20 @@ private:
 public:
     DEBUG_ONLY(size_t size;)
     void **contexts;
+    /* Constituents that were filtered out, and so have no context. */
+    bool *skipped;
 
     stats_collection_context_t(rwi_lock_t *constituents_lock,
                                const intrusive_list_t<perfmon_membership_t> &constituents) :
         lock_sentry(constituents_lock),
         DEBUG_ONLY(size(constituents.size()), )
-        contexts(new void *[constituents.size()])
+        contexts(new void *[constituents.size()]),
+        skipped(new bool[constituents.size()])
     { }
 
     ~stats_collection_context_t() {
         delete[] contexts;
+        delete[] skipped;
     }
 };
 
@@ -42,6 +46,14 @@ perfmon_collection_t::perfmon_collection_t() {
 }
 
 void *perfmon_collection_t::begin_stats() {
+    return begin_filtered_stats(NULL, std::vector<bool>(), 0);
+}
+
+void *perfmon_collection_t::begin_filtered_stats(const perfmon_filter_t *filter, const std::vector<bool> &active, size_t depth) {
+    if (filter != NULL && filter->matches_everything(active, depth)) {
+        filter = NULL;
+    }
+
     stats_collection_context_t *ctx;
     {
         on_thread_t thread_switcher(home_thread());
@@ -51,7 +63,32 @@ void *perfmon_collection_t::begin_stats() {
     size_t i = 0;
     for (perfmon_membership_t *p = constituents.head(); p != NULL; p = constituents.next(p), ++i) {
         rassert(i < ctx->size);
-        ctx->contexts[i] = p->get()->begin_stats();
+        ctx->skipped[i] = false;
+        if (filter == NULL) {
+            ctx->contexts[i] = p->get()->begin_stats();
+            continue;
+        }
+
+        /* Spliced constituents are at the same depth as we are. */
+        std::vector<bool> subactive = active;
+        size_t subdepth = depth;
+        if (!p->splice()) {
+            if (!filter->match_child(active, depth, p->name, &subactive)) {
+                ctx->skipped[i] = true;
+                ctx->contexts[i] = NULL;
+                continue;
+            }
+            ++subdepth;
+        }
+
+        perfmon_collection_t *subcollection = dynamic_cast<perfmon_collection_t *>(p->get());
+        if (subcollection != NULL) {
+            ctx->contexts[i] = subcollection->begin_filtered_stats(filter, subactive, subdepth);
+        } else {
+            /* Other perfmons are cheap to leave in; the filter proper will
+            trim what they return. */
+            ctx->contexts[i] = p->get()->begin_stats();
+        }
     }
     return ctx;
 }
@@ -61,7 +98,9 @@ void perfmon_collection_t::visit_stats(void *_context) {
     size_t i = 0;
     for (perfmon_membership_t *p = constituents.head(); p != NULL; p = constituents.next(p), ++i) {
         rassert(i < ctx->size);
-        p->get()->visit_stats(ctx->contexts[i]);
+        if (!ctx->skipped[i]) {
+            p->get()->visit_stats(ctx->contexts[i]);
+        }
     }
 }
 
@@ -74,6 +113,9 @@ perfmon_result_t * perfmon_collection_t::end_stats(void *_context) {
     size_t i = 0;
     for (perfmon_membership_t *p = constituents.head(); p != NULL; p = constituents.next(p), ++i) {
         rassert(i < ctx->size);
+        if (ctx->skipped[i]) {
+            continue;
+        }
         perfmon_result_t * stat = p->get()->end_stats(ctx->contexts[i]);
         if (p->splice()) {
             stat->splice_into(map);
@@ -161,10 +203,12 @@ perfmon_multi_membership_t::~perfmon_multi_membership_t() {
 
 perfmon_result_t::perfmon_result_t() {
     type = type_value;
+    number_type = number_none;
 }
 
 perfmon_result_t::perfmon_result_t(const perfmon_result_t &copyee)
-    : type(copyee.type), value_(copyee.value_), map_() {
+    : type(copyee.type), number_type(copyee.number_type), integer_(copyee.integer_), real_(copyee.real_),
+      value_(copyee.value_), map_() {
     for (perfmon_result_t::internal_map_t::const_iterator it = copyee.map_.begin(); it != copyee.map_.end(); ++it) {
         perfmon_result_t *subcopy = new perfmon_result_t(*it->second);
         map_.insert(std::pair<std::string, perfmon_result_t *>(it->first, subcopy));
@@ -173,11 +217,25 @@ perfmon_result_t::perfmon_result_t(const perfmon_result_t &copyee)
 
 perfmon_result_t::perfmon_result_t(const std::string &s) {
     type = type_value;
+    number_type = number_none;
     value_ = s;
 }
 
+perfmon_result_t::perfmon_result_t(int64_t i) {
+    type = type_value;
+    number_type = number_integer;
+    integer_ = i;
+}
+
+perfmon_result_t::perfmon_result_t(double d) {
+    type = type_value;
+    number_type = number_real;
+    real_ = d;
+}
+
 perfmon_result_t::perfmon_result_t(const std::map<std::string, perfmon_result_t *> &m) {
     type = type_map;
+    number_type = number_none;
     map_ = m;
 }
 
@@ -216,13 +274,25 @@ void perfmon_result_t::alloc_map_result(perfmon_result_t **out) {
     *out = new perfmon_result_t(perfmon_result_t::internal_map_t());
 }
 
+void perfmon_result_t::format_number() const {
+    if (number_type == number_integer && value_.empty()) {
+        value_ = strprintf("%" PRIi64, integer_);
+    } else if (number_type == number_real && value_.empty()) {
+        value_ = strprintf("%.8f", real_);
+    }
+}
+
 std::string *perfmon_result_t::get_string() {
     rassert(type == type_value);
+    format_number();
+    // The caller might change the string, after which the number is stale.
+    number_type = number_none;
     return &value_;
 }
 
 const std::string *perfmon_result_t::get_string() const {
     rassert(type == type_value);
+    format_number();
     return &value_;
 }
 
@@ -249,6 +319,57 @@ bool perfmon_result_t::is_map() const {
     return type == type_map;
 }
 
+bool perfmon_result_t::is_number() const {
+    return type == type_value && number_type != number_none;
+}
+
+double perfmon_result_t::get_number() const {
+    rassert(is_number());
+    return number_type == number_integer ? static_cast<double>(integer_) : real_;
+}
+
+static bool same_value(const perfmon_result_t *a, const perfmon_result_t *b) {
+    if (a->is_number() && b->is_number()) {
+        return a->get_number() == b->get_number();
+    }
+    return *a->get_string() == *b->get_string();
+}
+
+void perfmon_result_t::remove_unchanged(const perfmon_result_t &previous) {
+    rassert(type == type_map && previous.type == type_map);
+    std::list<iterator> to_delete;
+    for (iterator it = map_.begin(); it != map_.end(); ++it) {
+        const_iterator prev = previous.map_.find(it->first);
+        if (prev == previous.map_.end() || it->second->type != prev->second->type) {
+            continue;
+        }
+        if (it->second->is_map()) {
+            it->second->remove_unchanged(*prev->second);
+            if (it->second->map_.empty()) {
+                to_delete.push_back(it);
+            }
+        } else if (same_value(it->second, prev->second)) {
+            to_delete.push_back(it);
+        }
+    }
+    for (std::list<iterator>::const_iterator it = to_delete.begin(); it != to_delete.end(); ++it) {
+        erase(*it);
+    }
+}
+
+void perfmon_result_t::find_removed(const perfmon_result_t &previous, const std::string &prefix,
+                                    std::vector<std::string> *paths_out) const {
+    rassert(type == type_map && previous.type == type_map);
+    for (const_iterator prev = previous.map_.begin(); prev != previous.map_.end(); ++prev) {
+        const_iterator it = map_.find(prev->first);
+        if (it == map_.end()) {
+            paths_out->push_back(prefix + prev->first);
+        } else if (it->second->is_map() && prev->second->is_map()) {
+            it->second->find_removed(*prev->second, prefix + prev->first + "/", paths_out);
+        }
+    }
+}
+
 perfmon_result_t::perfmon_result_type_t perfmon_result_t::get_type() const {
     return type;
 }
@@ -257,6 +378,7 @@ void perfmon_result_t::reset_type(perfmon_result_type_t new_type) {
     value_.clear();
     clear_map();
     type = new_type;
+    number_type = number_none;
 }
 
 std::pair<perfmon_result_t::iterator, bool> perfmon_result_t::insert(const std::string &name, perfmon_result_t *val) {
@@ -340,7 +462,32 @@ perfmon_filter_t::~perfmon_filter_t() {
 }
 
 void perfmon_filter_t::filter(perfmon_result_t *p) const {
-    subfilter(p, 0, std::vector<bool>(regexps.size(), true));
+    subfilter(p, 0, all_active());
+}
+
+std::vector<bool> perfmon_filter_t::all_active() const {
+    return std::vector<bool>(regexps.size(), true);
+}
+
+bool perfmon_filter_t::matches_everything(const std::vector<bool> &active, size_t depth) const {
+    for (size_t i = 0; i < regexps.size(); ++i) {
+        if (active[i] && depth >= regexps[i].size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool perfmon_filter_t::match_child(const std::vector<bool> &active, size_t depth, const std::string &name, std::vector<bool> *subactive_out) const {
+    rassert(!matches_everything(active, depth));
+    *subactive_out = active;
+    bool some_subpath = false;
+    for (size_t i = 0; i < regexps.size(); ++i) {
+        if (!active[i]) continue;
+        (*subactive_out)[i] = regexps[i][depth]->matches(name);
+        some_subpath |= (*subactive_out)[i];
+    }
+    return some_subpath;
 }
 
 /* Filter a [perfmon_result_t].  [depth] is how deep we are in the paths that
@@ -15,6 +15,7 @@
 #include "concurrency/rwi_lock.hpp"
 
 class perfmon_collection_t;
+class perfmon_filter_t;
 class perfmon_result_t;
 
 /* The perfmon (short for "PERFormance MONitor") is responsible for gathering
@@ -58,6 +59,11 @@ public:
     void visit_stats(void *_contexts);
     perfmon_result_t *end_stats(void *_contexts);
 
+    /* Like `begin_stats()`, but leaves out the constituents that `filter` would
+    throw away anyway, so they're never visited. `active` and `depth` say where
+    in the filter's paths this collection is; see `perfmon_filter_t`. */
+    void *begin_filtered_stats(const perfmon_filter_t *filter, const std::vector<bool> &active, size_t depth);
+
 private:
     friend class perfmon_membership_t;
 
@@ -105,6 +111,17 @@ public:
     explicit perfmon_filter_t(const std::set<std::string> &paths);
     ~perfmon_filter_t();
     void filter(perfmon_result_t *target) const;
+
+    /* These let a collection apply the filter before collecting instead of
+    after. `active` says which paths still match at `depth`; at the top it's
+    `all_active()` and `depth` is 0. */
+    std::vector<bool> all_active() const;
+    /* True if one of the active paths has been matched all the way, so that
+    everything below `depth` is kept. */
+    bool matches_everything(const std::vector<bool> &active, size_t depth) const;
+    /* Works out which paths are still active under a child called `name`.
+    Returns false if none are, in which case the child would be thrown away. */
+    bool match_child(const std::vector<bool> &active, size_t depth, const std::string &name, std::vector<bool> *subactive_out) const;
 private:
     perfmon_result_t *subfilter(perfmon_result_t *target,
                                 size_t depth, std::vector<bool> active) const;
@@ -126,6 +143,10 @@ public:
     perfmon_result_t();
     perfmon_result_t(const perfmon_result_t &);
     explicit perfmon_result_t(const std::string &);
+    /* Numeric values aren't formatted until someone asks for the string, which
+    for filtered-out or unchanged stats is never. */
+    explicit perfmon_result_t(int64_t);
+    explicit perfmon_result_t(double);
     virtual ~perfmon_result_t();
 
     static perfmon_result_t make_string();
@@ -142,6 +163,19 @@ public:
 
     bool is_string() const;
     bool is_map() const;
+    /* True for values that were made from a number. They're still strings as
+    far as `get_string()` is concerned. */
+    bool is_number() const;
+    double get_number() const;
+
+    /* Removes the values that are the same in `previous`, and the maps that
+    end up empty because of it. */
+    void remove_unchanged(const perfmon_result_t &previous);
+
+    /* Appends to `paths_out` the slash-separated paths, each starting with
+    `prefix`, of the values and maps that `previous` has and this doesn't. */
+    void find_removed(const perfmon_result_t &previous, const std::string &prefix,
+                      std::vector<std::string> *paths_out) const;
 
     perfmon_result_type_t get_type() const;
     void reset_type(perfmon_result_type_t new_type);
@@ -160,9 +194,19 @@ private:
     void clear_map();
     explicit perfmon_result_t(const internal_map_t &);
 
+    void format_number() const;
+
     perfmon_result_type_t type;
 
-    std::string value_;
+    enum number_type_t {
+        number_none,
+        number_integer,
+        number_real
+    } number_type;
+    int64_t integer_;
+    double real_;
+
+    mutable std::string value_;
     internal_map_t map_;
 
     void operator=(const perfmon_result_t &);
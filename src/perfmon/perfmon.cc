@@ -18,6 +18,10 @@ static const char * stat_per_sec = "per_sec";
 static const char * stat_count = "count";
 static const char * stat_mean = "mean";
 static const char * stat_std_dev = "std_dev";
+static const char * stat_p50 = "p50";
+static const char * stat_p90 = "p90";
+static const char * stat_p99 = "p99";
+static const char * stat_p999 = "p999";
 static const char * no_value = "-";
 
 
@@ -52,7 +56,7 @@ int64_t perfmon_counter_t::combine_stats(padded_int64_t *data) {
 }
 
 perfmon_result_t *perfmon_counter_t::output_stat(const int64_t &stat) {
-    return new perfmon_result_t(strprintf("%" PRIi64, stat));
+    return new perfmon_result_t(stat);
 }
 
 /* perfmon_sampler_t */
@@ -118,16 +122,157 @@ perfmon_result_t *perfmon_sampler_t::output_stat(const stats_t &aggregated) {
     perfmon_result_t::alloc_map_result(&stat);
 
     if (aggregated.count > 0) {
-        stat->insert(stat_avg, new perfmon_result_t(strprintf("%.8f", aggregated.sum / aggregated.count)));
-        stat->insert(stat_min, new perfmon_result_t(strprintf("%.8f", aggregated.min)));
-        stat->insert(stat_max, new perfmon_result_t(strprintf("%.8f", aggregated.max)));
+        stat->insert(stat_avg, new perfmon_result_t(aggregated.sum / aggregated.count));
+        stat->insert(stat_min, new perfmon_result_t(aggregated.min));
+        stat->insert(stat_max, new perfmon_result_t(aggregated.max));
     } else {
         stat->insert(stat_avg, new perfmon_result_t(no_value));
         stat->insert(stat_min, new perfmon_result_t(no_value));
         stat->insert(stat_max, new perfmon_result_t(no_value));
     }
     if (include_rate) {
-        stat->insert(stat_per_sec, new perfmon_result_t(strprintf("%.8f", aggregated.count / ticks_to_secs(length))));
+        stat->insert(stat_per_sec, new perfmon_result_t(aggregated.count / ticks_to_secs(length)));
+    }
+    return stat;
+}
+
+/* perfmon_histogram_t */
+
+namespace perfmon_histogram {
+
+histogram_t::histogram_t() : count(0), max(0) {
+    memset(buckets, 0, sizeof(buckets));
+}
+
+int histogram_t::bucket_index(ticks_t value) {
+    if (value < static_cast<ticks_t>(SUB_BUCKETS)) {
+        return value;
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - SUB_BUCKET_BITS;
+    int index = (shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+    return std::min(index, NUM_BUCKETS - 1);
+}
+
+ticks_t histogram_t::bucket_max(int index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    int shift = index / SUB_BUCKETS - 1;
+    ticks_t low = static_cast<ticks_t>(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+    return low + (static_cast<ticks_t>(1) << shift) - 1;
+}
+
+void histogram_t::record(ticks_t value) {
+    ++buckets[bucket_index(value)];
+    ++count;
+    max = std::max(max, value);
+}
+
+void histogram_t::aggregate(const histogram_t &h) {
+    if (h.count == 0) {
+        return;
+    }
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        buckets[i] += h.buckets[i];
+    }
+    count += h.count;
+    max = std::max(max, h.max);
+}
+
+ticks_t histogram_t::percentile(double fraction) const {
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(ceil(fraction * count)));
+    uint64_t seen = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            /* The last bucket has no upper bound. */
+            return i == NUM_BUCKETS - 1 ? max : std::min(bucket_max(i), max);
+        }
+    }
+    return max;
+}
+
+}   /* namespace perfmon_histogram */
+
+perfmon_histogram_t::perfmon_histogram_t(ticks_t _length)
+    : perfmon_perthread_t<histogram_t>(), thread_data(new thread_info_t[MAX_THREADS]), length(_length)
+{
+    for (int i = 0; i < MAX_THREADS; i++) {
+        thread_data[i].current = thread_data[i].last = NULL;
+        thread_data[i].current_interval = get_ticks() / length;
+    }
+}
+
+perfmon_histogram_t::~perfmon_histogram_t() {
+    for (int i = 0; i < MAX_THREADS; i++) {
+        delete thread_data[i].current;
+        delete thread_data[i].last;
+    }
+    delete[] thread_data;
+}
+
+void perfmon_histogram_t::update(ticks_t now) {
+    int interval = now / length;
+    rassert(get_thread_id() >= 0);
+    thread_info_t *thread = &thread_data[get_thread_id()];
+
+    if (thread->current == NULL || thread->current_interval == interval) {
+        /* We're up to date, or have never recorded anything; nothing to do */
+        thread->current_interval = interval;
+    } else if (thread->current_interval + 1 == interval) {
+        /* We're one step behind */
+        std::swap(thread->current, thread->last);
+        *thread->current = histogram_t();
+        thread->current_interval++;
+    } else {
+        /* We're more than one step behind */
+        *thread->current = *thread->last = histogram_t();
+        thread->current_interval = interval;
+    }
+}
+
+void perfmon_histogram_t::record(ticks_t duration) {
+    update(get_ticks());
+    rassert(get_thread_id() >= 0);
+    thread_info_t *thread = &thread_data[get_thread_id()];
+    if (thread->current == NULL) {
+        thread->current = new histogram_t;
+        thread->last = new histogram_t;
+    }
+    thread->current->record(duration);
+}
+
+void perfmon_histogram_t::get_thread_stat(histogram_t *stat) {
+    update(get_ticks());
+    /* Like perfmon_sampler_t, report the last complete interval. */
+    rassert(get_thread_id() >= 0);
+    if (thread_data[get_thread_id()].last != NULL) {
+        *stat = *thread_data[get_thread_id()].last;
+    }
+}
+
+perfmon_histogram::histogram_t perfmon_histogram_t::combine_stats(histogram_t *stats) {
+    histogram_t aggregated;
+    for (int i = 0; i < get_num_threads(); i++) {
+        aggregated.aggregate(stats[i]);
+    }
+    return aggregated;
+}
+
+perfmon_result_t *perfmon_histogram_t::output_stat(const histogram_t &aggregated) {
+    perfmon_result_t *stat;
+    perfmon_result_t::alloc_map_result(&stat);
+
+    stat->insert(stat_count, new perfmon_result_t(static_cast<int64_t>(aggregated.count)));
+    const char *names[] = { stat_p50, stat_p90, stat_p99, stat_p999, stat_max };
+    const double fractions[] = { 0.5, 0.9, 0.99, 0.999, 1.0 };
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); ++i) {
+        if (aggregated.count > 0) {
+            stat->insert(names[i], new perfmon_result_t(ticks_to_secs(aggregated.percentile(fractions[i]))));
+        } else {
+            stat->insert(names[i], new perfmon_result_t(no_value));
+        }
     }
     return stat;
 }
@@ -209,10 +354,10 @@ perfmon_result_t *perfmon_stddev_t::output_stat(const stddev_t &stat_data) {
     perfmon_result_t *stat;
     perfmon_result_t::alloc_map_result(&stat);
 
-    stat->insert(stat_count, new perfmon_result_t(strprintf("%zu", stat_data.datapoints())));
+    stat->insert(stat_count, new perfmon_result_t(static_cast<int64_t>(stat_data.datapoints())));
     if (stat_data.datapoints()) {
-        stat->insert(stat_mean, new perfmon_result_t(strprintf("%.8f", stat_data.mean())));
-        stat->insert(stat_std_dev, new perfmon_result_t(strprintf("%.8f", stat_data.standard_deviation())));
+        stat->insert(stat_mean, new perfmon_result_t(stat_data.mean()));
+        stat->insert(stat_std_dev, new perfmon_result_t(stat_data.standard_deviation()));
     } else {
         // No stats
         stat->insert(stat_mean, new perfmon_result_t(no_value));
@@ -279,14 +424,15 @@ double perfmon_rate_monitor_t::combine_stats(double *stats) {
 }
 
 perfmon_result_t *perfmon_rate_monitor_t::output_stat(const double &stat) {
-    return new perfmon_result_t(strprintf("%.8f", stat / ticks_to_secs(length)));
+    return new perfmon_result_t(stat / ticks_to_secs(length));
 }
 
 perfmon_duration_sampler_t::perfmon_duration_sampler_t(ticks_t length, bool _ignore_global_full_perfmon)
-    : stat(), active(), total(), recent(length, true),
+    : stat(), active(), total(), recent(length, true), recent_percentiles(length),
       active_membership(&stat, &active, "active_count"),
       total_membership(&stat, &total, "total"),
       recent_membership(&stat, &recent, "recent_duration"),
+      recent_percentiles_membership(&stat, &recent_percentiles, "recent_duration_percentiles"),
       ignore_global_full_perfmon(_ignore_global_full_perfmon)
 { }
 
@@ -303,7 +449,9 @@ void perfmon_duration_sampler_t::begin(ticks_t *v) {
 void perfmon_duration_sampler_t::end(ticks_t *v) {
     --active;
     if (*v != 0) {
-        recent.record(ticks_to_secs(get_ticks() - *v));
+        ticks_t duration = get_ticks() - *v;
+        recent.record(ticks_to_secs(duration));
+        recent_percentiles.record(duration);
     }
 }
 
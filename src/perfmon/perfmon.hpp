@@ -211,11 +211,74 @@ public:
     void record(double value = 1.0);
 };
 
+/* perfmon_histogram_t is a perfmon_t that keeps a histogram of durations, so
+ * that it can report percentiles (the tail latency, which the averages of
+ * perfmon_sampler_t hide). Like perfmon_sampler_t, it reports on the last
+ * complete interval of 'length' ticks. Each thread records into its own
+ * histogram, so recording is just an increment; the histograms are only added
+ * together when stats are collected.
+ */
+
+namespace perfmon_histogram {
+
+/* The histogram is HDR-style: every power of two is split into `SUB_BUCKETS`
+ * equal buckets, so a reported value is within 1/`SUB_BUCKETS` of the real one
+ * at any magnitude, in a fixed amount of space. Durations are in ticks
+ * (nanoseconds); anything from 2^`MAX_VALUE_BITS` ticks (about 18 minutes) up
+ * goes in the last bucket. */
+const int SUB_BUCKET_BITS = 4;
+const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+const int MAX_VALUE_BITS = 40;
+const int NUM_BUCKETS = (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+struct histogram_t {
+    histogram_t();
+    void record(ticks_t value);
+    void aggregate(const histogram_t &h);
+    /* Returns the smallest value that at least `fraction` of the recorded values
+    are no bigger than, to within the precision of the buckets. */
+    ticks_t percentile(double fraction) const;
+
+    static int bucket_index(ticks_t value);
+    /* The largest value that goes in bucket `index`. */
+    static ticks_t bucket_max(int index);
+
+    uint64_t count;
+    ticks_t max;
+    uint32_t buckets[NUM_BUCKETS];
+};
+
+}   /* namespace perfmon_histogram */
+
+class perfmon_histogram_t : public perfmon_perthread_t<perfmon_histogram::histogram_t> {
+    typedef perfmon_histogram::histogram_t histogram_t;
+    struct thread_info_t {
+        /* Allocated the first time the thread records something, because most
+        threads never touch most histograms. */
+        histogram_t *current, *last;
+        int current_interval;
+    };
+
+    thread_info_t *thread_data;
+
+    void get_thread_stat(histogram_t *);
+    histogram_t combine_stats(histogram_t *);
+    perfmon_result_t *output_stat(const histogram_t&);
+
+    void update(ticks_t now);
+
+    ticks_t length;
+public:
+    explicit perfmon_histogram_t(ticks_t _length);
+    virtual ~perfmon_histogram_t();
+    void record(ticks_t duration);
+};
+
 /* perfmon_duration_sampler_t is a perfmon_t that monitors events that have a
  * starting and ending time. When something starts, call begin(); when
  * something ends, call end() with the same value as begin. It will produce
- * stats for the number of active events, the average length of an event, and
- * so on. If `global_full_perfmon` is false, it won't report any timing-related
+ * stats for the number of active events, the average length of an event, its
+ * percentiles, and so on. If `global_full_perfmon` is false, it won't report any timing-related
  * stats because `get_ticks()` is rather slow.
  *
  * Frequently we're in the case where we'd like to have a single slow perfmon
@@ -230,9 +293,11 @@ private:
     perfmon_counter_t active;
     perfmon_counter_t total;
     perfmon_sampler_t recent;
+    perfmon_histogram_t recent_percentiles;
     perfmon_membership_t active_membership;
     perfmon_membership_t total_membership;
     perfmon_membership_t recent_membership;
+    perfmon_membership_t recent_percentiles_membership;
 
     bool ignore_global_full_perfmon;
 public:
@@ -0,0 +1,115 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#define __STDC_FORMAT_MACROS
+#include "perfmon/trace.hpp"
+
+#include <inttypes.h>
+
+#include <algorithm>
+
+#include "arch/runtime/coroutines.hpp"
+#include "config/args.hpp"
+
+trace_t::trace_t(bool wants_remote_spans)
+    : start_time(get_ticks()), remote(wants_remote_spans) { }
+
+bool trace_t::wants_remote_spans() const {
+    return remote;
+}
+
+void trace_t::add_span(const std::string &name, ticks_t start, ticks_t end) {
+    trace_span_t span;
+    span.name = name;
+    span.start = ticks_to_secs(start - start_time);
+    span.duration = ticks_to_secs(end - start);
+
+    spinlock_acq_t acq(&lock);
+    add_span_locked(span);
+}
+
+void trace_t::add_span_locked(const trace_span_t &span) {
+    if (spans.size() < TRACE_MAX_SPANS) {
+        spans.push_back(span);
+        return;
+    }
+
+    std::map<std::string, size_t>::iterator it = merged.find(span.name);
+    if (it == merged.end()) {
+        merged[span.name] = spans.size();
+        spans.push_back(span);
+    } else {
+        trace_span_t *into = &spans[it->second];
+        into->start = std::min(into->start, span.start);
+        into->duration += span.duration;
+        into->count += span.count;
+    }
+}
+
+void trace_t::add_remote_spans(const std::vector<trace_span_t> &remote_spans) {
+    double remote_end = 0;
+    for (std::vector<trace_span_t>::const_iterator it = remote_spans.begin(); it != remote_spans.end(); ++it) {
+        remote_end = std::max(remote_end, it->start + it->duration);
+    }
+    double offset = std::max(0.0, elapsed() - remote_end);
+
+    spinlock_acq_t acq(&lock);
+    for (std::vector<trace_span_t>::const_iterator it = remote_spans.begin(); it != remote_spans.end(); ++it) {
+        trace_span_t span = *it;
+        span.start += offset;
+        add_span_locked(span);
+    }
+}
+
+static bool starts_earlier(const trace_span_t &a, const trace_span_t &b) {
+    return a.start < b.start;
+}
+
+std::vector<trace_span_t> trace_t::get_spans() const {
+    std::vector<trace_span_t> sorted;
+    {
+        spinlock_acq_t acq(&lock);
+        sorted = spans;
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), &starts_earlier);
+    return sorted;
+}
+
+double trace_t::elapsed() const {
+    return ticks_to_secs(get_ticks() - start_time);
+}
+
+trace_scope_t::trace_scope_t(trace_t *trace) : previous(current_trace()) {
+    coro_t::set_current_trace(trace);
+}
+
+trace_scope_t::~trace_scope_t() {
+    coro_t::set_current_trace(previous);
+}
+
+traced_span_t::traced_span_t(const char *_name, bool enabled)
+    : trace(enabled ? current_trace() : NULL), name(_name), start(0) {
+    if (trace != NULL) {
+        start = get_ticks();
+    }
+}
+
+traced_span_t::~traced_span_t() {
+    if (trace != NULL) {
+        trace->add_span(name, start, get_ticks());
+    }
+}
+
+trace_t *current_trace() {
+    return coro_t::current_trace();
+}
+
+std::string format_trace_spans(const std::vector<trace_span_t> &spans) {
+    std::string out;
+    for (std::vector<trace_span_t>::const_iterator it = spans.begin(); it != spans.end(); ++it) {
+        out += strprintf("  %.6fs +%.6fs %s", it->start, it->duration, it->name.c_str());
+        if (it->count > 1) {
+            out += strprintf(" (%" PRIi64 " spans)", it->count);
+        }
+        out += "\n";
+    }
+    return out;
+}
@@ -0,0 +1,113 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#ifndef PERFMON_TRACE_HPP_
+#define PERFMON_TRACE_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "arch/spinlock.hpp"
+#include "rpc/serialize_macros.hpp"
+#include "utils.hpp"
+
+/* A trace records how long the stages of one operation (a query, say) took, so
+that when the operation is slow we can tell where the time went. While a trace is
+current in a coroutine (see `trace_scope_t`), every `traced_span_t` that the
+coroutine goes through adds a span to it. Coroutines don't inherit the trace of
+the coroutine that spawned them; code that hands work to other coroutines and
+wants it traced has to pass the trace along explicitly. When there's no current
+trace, a `traced_span_t` costs a branch.
+
+Operations that go through a span once per row or per block would make a trace
+grow without bound, so once a trace has `TRACE_MAX_SPANS` spans, later spans are
+folded into one span per name. */
+
+struct trace_span_t {
+    trace_span_t() : start(0), duration(0), count(1) { }
+
+    std::string name;
+    /* Both in seconds; `start` is relative to the start of the trace. If
+    `count` is more than one, this stands for that many spans with this name,
+    `start` is when the first of them started and `duration` is their total. */
+    double start;
+    double duration;
+    int64_t count;
+
+    RDB_MAKE_ME_SERIALIZABLE_4(name, start, duration, count);
+};
+
+class trace_t {
+public:
+    /* If `wants_remote_spans` is false, the parts of the operation that run on
+    other machines aren't traced, which saves sending their spans back. */
+    explicit trace_t(bool wants_remote_spans = true);
+
+    bool wants_remote_spans() const;
+
+    /* `start` and `end` are `get_ticks()` values. */
+    void add_span(const std::string &name, ticks_t start, ticks_t end);
+
+    /* Adds spans that were recorded by a different trace, usually one for the
+    part of the operation that ran on another machine. We don't share a clock
+    with that machine, so the spans are lined up to end now. */
+    void add_remote_spans(const std::vector<trace_span_t> &spans);
+
+    /* Sorted by start time. */
+    std::vector<trace_span_t> get_spans() const;
+
+    /* Seconds since the trace was started. */
+    double elapsed() const;
+
+private:
+    /* `lock` must be held. */
+    void add_span_locked(const trace_span_t &span);
+
+    ticks_t start_time;
+    bool remote;
+
+    /* Coroutines on other threads may add spans at the same time. */
+    mutable spinlock_t lock;
+    std::vector<trace_span_t> spans;
+
+    /* Where in `spans` the span that later spans with each name are folded
+    into is, once there are too many spans. */
+    std::map<std::string, size_t> merged;
+
+    DISABLE_COPYING(trace_t);
+};
+
+/* Makes `trace` the current coroutine's trace while it exists. `trace` may be
+NULL, which stops tracing. */
+class trace_scope_t {
+public:
+    explicit trace_scope_t(trace_t *trace);
+    ~trace_scope_t();
+
+private:
+    trace_t *previous;
+
+    DISABLE_COPYING(trace_scope_t);
+};
+
+/* Adds a span to the current trace, if there is one, covering the lifetime of
+the `traced_span_t`. `name` must outlive it. */
+class traced_span_t {
+public:
+    explicit traced_span_t(const char *name, bool enabled = true);
+    ~traced_span_t();
+
+private:
+    trace_t *trace;
+    const char *name;
+    ticks_t start;
+
+    DISABLE_COPYING(traced_span_t);
+};
+
+/* The current coroutine's trace, or NULL. */
+trace_t *current_trace();
+
+/* One line per span, for the log. */
+std::string format_trace_spans(const std::vector<trace_span_t> &spans);
+
+#endif  // PERFMON_TRACE_HPP_
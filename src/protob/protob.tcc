@@ -12,9 +12,20 @@
 
 #include "arch/arch.hpp"
 #include "arch/io/network.hpp"
+#include "arch/runtime/work_stealing.hpp"
 #include "concurrency/cross_thread_signal.hpp"
 #include "utils.hpp"
 
+template <class message_t>
+void protob_parse_message(message_t *message, const char *data, int size, bool *res_out) {
+    *res_out = message->ParseFromArray(data, size);
+}
+
+template <class message_t>
+void protob_serialize_message(const message_t *message, char *data, int size) {
+    message->SerializeToArray(data, size);
+}
+
 template <class request_t, class response_t, class context_t>
 protob_server_t<request_t, response_t, context_t>::protob_server_t(const std::set<ip_address_t> &local_addresses,
                                                                    int port,
@@ -89,7 +100,15 @@ void protob_server_t<request_t, response_t, context_t>::handle_conn(const scoped
                 scoped_array_t<char> data(size);
                 conn->read(data.data(), size, &ct_keepalive);
 
-                bool res = request.ParseFromArray(data.data(), size);
+                // Decoding a huge query can take a while, and it doesn't
+                // matter which thread does it.
+                bool res;
+                if (size >= PROTOB_STEALABLE_MESSAGE_BYTES) {
+                    run_stealable(boost::bind(&protob_parse_message<request_t>,
+                                              &request, data.data(), size, &res));
+                } else {
+                    res = request.ParseFromArray(data.data(), size);
+                }
                 if (!res) {
                     err = "Client is buggy (failed to deserialize protobuf).";
                     forced_response = on_unparsable_query(&request, err);
@@ -143,7 +162,12 @@ void protob_server_t<request_t, response_t, context_t>::send(const response_t &r
     conn->write(&size, sizeof(res.ByteSize()), closer);
     scoped_array_t<char> data(size);
 
-    res.SerializeToArray(data.data(), size);
+    if (size >= PROTOB_STEALABLE_MESSAGE_BYTES) {
+        run_stealable(boost::bind(&protob_serialize_message<response_t>,
+                                  &res, data.data(), size));
+    } else {
+        res.SerializeToArray(data.data(), size);
+    }
     conn->write(data.data(), size, closer);
 }
 
@@ -276,6 +276,9 @@ template <class protocol_t>
 class chunk_fun_callback_t {
 public:
     virtual void send_chunk(const typename protocol_t::backfill_chunk_t &, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
+    /* Promises that every chunk for `region` has been sent. The regions passed
+    to `send_checkpoint()` during one backfill never overlap. */
+    virtual void send_checkpoint(const typename protocol_t::region_t &region, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) = 0;
 
 protected:
     chunk_fun_callback_t() { }
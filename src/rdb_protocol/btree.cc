@@ -225,6 +225,11 @@ public:
         cb_->on_deletion(key, recency, interruptor);
     }
 
+    void on_range_done(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        rassert(kr_.is_superset(range));
+        cb_->on_range_done(range, interruptor);
+    }
+
     void on_pair(transaction_t *txn, repli_timestamp_t recency, const btree_key_t *key, const void *val, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
         rassert(kr_.contains_key(key->contents, key->size));
         const rdb_value_t *value = static_cast<const rdb_value_t *>(val);
@@ -309,7 +314,8 @@ public:
                                               const key_range_t &range,
                                               rget_read_response_t *_response)
         : bad_init(false), transaction(txn), response(_response), cumulative_size(0),
-          env(_env), transform(_transform), terminal(_terminal)
+          env(_env), transform(_transform), terminal(_terminal), distinct_seen(transform.size()),
+          batch_size(query_language::transform_batch_size(transform))
     {
         try {
             response->last_considered_key = range.left;
@@ -334,51 +340,72 @@ public:
 
             const rdb_value_t *rdb_value = reinterpret_cast<const rdb_value_t *>(value);
 
-            json_list_t data;
-            data.push_back(get_data(rdb_value, transaction));
+            pending_keys.push_back(store_key);
+            pending_rows.push_back(json_list_t(1, get_data(rdb_value, transaction)));
+            if (pending_rows.size() < batch_size) {
+                return true;
+            }
+            return flush();
+        } catch (const query_language::runtime_exc_t &e) {
+            /* Evaluation threw so we're not going to be accepting any more requests. */
+            response->result = e;
+            return false;
+        }
+    }
 
-            //Apply transforms to the data
-            typedef rdb_protocol_details::transform_t::iterator tit_t;
-            for (tit_t it  = transform.begin();
-                       it != transform.end();
-                       ++it) {
-                json_list_t tmp;
+    /* Processes the rows that are still pending once the traversal is over. */
+    void finish() {
+        if (bad_init || pending_rows.empty()) return;
+        try {
+            flush();
+        } catch (const query_language::runtime_exc_t &e) {
+            response->result = e;
+        }
+    }
 
-                for (json_list_t::iterator jt  = data.begin();
-                                           jt != data.end();
-                                           ++jt) {
-                    boost::apply_visitor(query_language::transform_visitor_t(*jt, &tmp, env, it->scopes, it->backtrace), it->variant);
-                }
-                data.clear();
-                data.splice(data.begin(), tmp);
-            }
+    /* Pushes the pending rows through the transformation and on to the
+    terminal or the result stream. Returns false once the response is full. */
+    bool flush() {
+        std::vector<store_key_t> keys;
+        std::vector<json_list_t> data;
+        keys.swap(pending_keys);
+        data.swap(pending_rows);
+
+        //Apply transforms to the data
+        typedef rdb_protocol_details::transform_t::iterator tit_t;
+        size_t transform_index = 0;
+        for (tit_t it  = transform.begin();
+                   it != transform.end();
+                   ++it, ++transform_index) {
+            query_language::transform_batch(*it, &data, env, &distinct_seen[transform_index]);
+        }
 
-            if (!terminal) {
-                typedef rget_read_response_t::stream_t stream_t;
-                stream_t *stream = boost::get<stream_t>(&response->result);
-                guarantee(stream);
-                for (json_list_t::iterator it =  data.begin();
-                                           it != data.end();
+        if (!terminal) {
+            typedef rget_read_response_t::stream_t stream_t;
+            stream_t *stream = boost::get<stream_t>(&response->result);
+            guarantee(stream);
+            for (size_t i = 0; i < data.size(); ++i) {
+                for (json_list_t::iterator it =  data[i].begin();
+                                           it != data[i].end();
                                            ++it) {
-                    stream->push_back(std::make_pair(key, *it));
+                    stream->push_back(std::make_pair(keys[i], *it));
                     cumulative_size += estimate_rget_response_size(*it);
                 }
+            }
 
-                return cumulative_size < rget_max_chunk_size;
-            } else {
-                for (json_list_t::iterator jt  = data.begin();
-                                           jt != data.end();
+            return cumulative_size < rget_max_chunk_size;
+        } else {
+            for (size_t i = 0; i < data.size(); ++i) {
+                for (json_list_t::iterator jt  = data[i].begin();
+                                           jt != data[i].end();
                                            ++jt) {
                     boost::apply_visitor(query_language::terminal_visitor_t(*jt, env, terminal->scopes, terminal->backtrace, &response->result), terminal->variant);
                 }
-                return true;
             }
-        } catch (const query_language::runtime_exc_t &e) {
-            /* Evaluation threw so we're not going to be accepting any more requests. */
-            response->result = e;
-            return false;
+            return true;
         }
     }
+
     bool bad_init;
     transaction_t *transaction;
     rget_read_response_t *response;
@@ -386,6 +413,13 @@ public:
     query_language::runtime_environment_t *env;
     rdb_protocol_details::transform_t transform;
     boost::optional<rdb_protocol_details::terminal_t> terminal;
+    // One set per transformation, used by `Distinct` to pre-filter this shard.
+    std::vector<query_language::json_set_t> distinct_seen;
+    // Rows are pushed through the transformation this many at a time (see
+    // `transform_batch_size()`).
+    size_t batch_size;
+    std::vector<store_key_t> pending_keys;
+    std::vector<json_list_t> pending_rows;
 };
 
 void rdb_rget_slice(btree_slice_t *slice, const key_range_t &range,
@@ -394,6 +428,7 @@ void rdb_rget_slice(btree_slice_t *slice, const key_range_t &range,
                     boost::optional<rdb_protocol_details::terminal_t> terminal, rget_read_response_t *response) {
     rdb_rget_depth_first_traversal_callback_t callback(txn, env, transform, terminal, range, response);
     btree_depth_first_traversal(slice, txn, superblock, range, &callback);
+    callback.finish();
 
     if (callback.cumulative_size >= rget_max_chunk_size) {
         response->truncated = true;
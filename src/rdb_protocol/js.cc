@@ -2,10 +2,14 @@
 #define __STDC_LIMIT_MACROS
 #include <stdint.h>             // for UINT32_MAX
 
+#include <deque>
+
 #include "utils.hpp"
 #include <boost/optional.hpp>
+#include <boost/unordered_map.hpp>
 
 #include "containers/scoped.hpp"
+#include "perfmon/trace.hpp"
 #include "rdb_protocol/jsimpl.hpp"
 #include "rdb_protocol/rdb_protocol_json.hpp"
 
@@ -15,6 +19,10 @@ const id_t MIN_ID = 1;
 // TODO: This is not the max id.  MAX_ID - 1 is the max id.
 const id_t MAX_ID = UINT32_MAX;
 
+// The most compiled function definitions a worker process keeps around between
+// jobs.
+const size_t MAX_CACHED_SCRIPTS = 1000;
+
 // ---------- utility functions ----------
 static void append_caught_error(std::string *errmsg, const v8::TryCatch &try_catch) {
     if (!try_catch.HasCaught()) return;
@@ -100,8 +108,60 @@ void env_t::forget(id_t id) {
 }
 
 
+// ---------- script_cache_t ----------
+// Worker-side cache of compiled function definitions, keyed by their full
+// source. Worker processes outlive the jobs they run, so a definition compiled
+// for one query is reused by later queries that are sent to the same worker
+// (see `extproc::worker_affinity_t`). The scripts are context-independent: each
+// task still runs the definition in its own fresh context (see `context_t`) to
+// get a function, so queries can't see each other's globals. Evicts in
+// insertion order once full.
+class script_cache_t {
+  public:
+    script_cache_t() { }
+
+    // Returns an empty handle if `key` isn't cached.
+    v8::Handle<v8::Script> find(const std::string &key) {
+        scripts_t::iterator it = scripts_.find(key);
+        if (it == scripts_.end()) {
+            return v8::Handle<v8::Script>();
+        }
+        return it->second;
+    }
+
+    void insert(const std::string &key, v8::Handle<v8::Script> script) {
+        if (scripts_.size() >= MAX_CACHED_SCRIPTS) {
+            scripts_t::iterator it = scripts_.find(insertion_order_.front());
+            guarantee(it != scripts_.end());
+            it->second.Dispose();
+            scripts_.erase(it);
+            insertion_order_.pop_front();
+        }
+        std::pair<scripts_t::iterator, bool> res
+            = scripts_.insert(std::make_pair(key, v8::Persistent<v8::Script>::New(script)));
+        guarantee(res.second);
+        insertion_order_.push_back(key);
+    }
+
+  private:
+    typedef boost::unordered_map<std::string, v8::Persistent<v8::Script> > scripts_t;
+    scripts_t scripts_;
+    std::deque<std::string> insertion_order_;
+
+    DISABLE_COPYING(script_cache_t);
+};
+
+// Only ever used on the worker side, which is single-threaded. Deliberately
+// leaked: workers are killed rather than shut down cleanly.
+static script_cache_t *worker_script_cache() {
+    static script_cache_t *cache = new script_cache_t();
+    return cache;
+}
+
+
 // ---------- runner_t ----------
-runner_t::runner_t() : running_task_(false) { }
+runner_t::runner_t(extproc::worker_affinity_t *affinity)
+    : affinity_(affinity), running_task_(false) { }
 
 const runner_t::req_config_t *runner_t::default_req_config() {
     static req_config_t config;
@@ -119,11 +179,20 @@ runner_t::~runner_t() {
 }
 
 void runner_t::begin(extproc::pool_t *pool) {
+    // We may have been connected to a job before, which has since finished or
+    // been interrupted. Its ids mean nothing to the new one.
+    reset_job_state();
+
     // TODO(rntz): might eventually want to handle external process failure
-    int res = extproc::job_handle_t::begin(pool, job_t());
+    int res = extproc::job_handle_t::begin(pool, job_t(), affinity_);
     guarantee(0 == res);
 }
 
+void runner_t::reset_job_state() {
+    used_ids_.clear();
+    compiled_ids_.clear();
+}
+
 void runner_t::interrupt() {
     extproc::job_handle_t::interrupt();
 }
@@ -195,6 +264,14 @@ void runner_t::release_id(id_t id) {
     run_task_t(this, default_req_config(), release_task_t(id));
 
     used_ids_.erase(it);
+    for (std::map<std::string, id_t>::iterator jt = compiled_ids_.begin();
+         jt != compiled_ids_.end();
+         ++jt) {
+        if (jt->second == id) {
+            compiled_ids_.erase(jt);
+            break;
+        }
+    }
 }
 
 // ----- compile() -----
@@ -317,23 +394,26 @@ struct compile_task_t : auto_task_t<compile_task_t> {
                 endsz);
     }
 
-    v8::Handle<v8::Function> mkFunc(std::string *errmsg) {
-        v8::Handle<v8::Function> result; // initially empty
-
-        // Compile & run script to get a function.
-        scoped_array_t<char> srcbuf;
-        mkFuncSrc(&srcbuf);
+    // Compiles the function definition without tying it to a context.
+    static v8::Handle<v8::Script> mkScript(const scoped_array_t<char> &srcbuf, std::string *errmsg) {
         // TODO(rntz): use an "external resource" to avoid copy?
         v8::Handle<v8::String> src = v8::String::New(srcbuf.data(), srcbuf.size());
 
         v8::TryCatch try_catch;
 
-        v8::Handle<v8::Script> script = v8::Script::Compile(src);
+        v8::Handle<v8::Script> script = v8::Script::New(src);
         if (script.IsEmpty()) {
             *errmsg = "compiling function definition failed";
             append_caught_error(errmsg, try_catch);
-            return result;
         }
+        return script;
+    }
+
+    // Runs the function definition in the current context to get a function.
+    static v8::Handle<v8::Function> mkFunc(v8::Handle<v8::Script> script, std::string *errmsg) {
+        v8::Handle<v8::Function> result; // initially empty
+
+        v8::TryCatch try_catch;
 
         v8::Handle<v8::Value> funcv = script->Run();
         if (funcv.IsEmpty()) {
@@ -355,10 +435,25 @@ struct compile_task_t : auto_task_t<compile_task_t> {
         std::string *errmsg = boost::get<std::string>(&result);
 
         v8::HandleScope handle_scope;
-        // Evaluate the function definition.
-        v8::Handle<v8::Function> func = mkFunc(errmsg);
-        if (!func.IsEmpty()) {
-            result = env->rememberValue(func);
+        scoped_array_t<char> srcbuf;
+        mkFuncSrc(&srcbuf);
+
+        // Reuse the compiled definition if this worker has compiled it
+        // before; either way, evaluate it afresh in this task's context.
+        script_cache_t *cache = worker_script_cache();
+        std::string key(srcbuf.data(), srcbuf.size());
+        v8::Handle<v8::Script> script = cache->find(key);
+        if (script.IsEmpty()) {
+            script = mkScript(srcbuf, errmsg);
+            if (!script.IsEmpty()) {
+                cache->insert(key, script);
+            }
+        }
+        if (!script.IsEmpty()) {
+            v8::Handle<v8::Function> func = mkFunc(script, errmsg);
+            if (!func.IsEmpty()) {
+                result = env->rememberValue(func);
+            }
         }
 
         write_message_t msg;
@@ -374,6 +469,21 @@ id_t runner_t::compile(
     std::string *errmsg,
     const req_config_t *config)
 {
+    std::string key;
+    for (size_t i = 0; i < args.size(); ++i) {
+        key += args[i];
+        key += ',';
+    }
+    key += '\0';
+    key += source;
+
+    std::map<std::string, id_t>::iterator it = compiled_ids_.find(key);
+    if (it != compiled_ids_.end()) {
+        return it->second;
+    }
+
+    traced_span_t span("js compile");
+
     id_result_t result;
 
     {
@@ -386,10 +496,49 @@ id_t runner_t::compile(
     //TODO: shouldn't we do something if the visitor returns INVALID_ID?
     id_t id = boost::apply_visitor(v, result);
     note_id(id);
+    if (id != INVALID_ID) {
+        compiled_ids_.insert(std::make_pair(key, id));
+    }
     return id;
 }
 
 // ----- call() -----
+// Calls `func` with receiver `object` (a fresh empty object if `object` is
+// empty) and JSONifies the result. Returns an empty pointer on error.
+static boost::shared_ptr<scoped_cJSON_t> call_function(
+        v8::Handle<v8::Function> func,
+        const boost::shared_ptr<scoped_cJSON_t> &object,
+        const std::vector<boost::shared_ptr<scoped_cJSON_t> > &args,
+        std::string *errmsg) {
+    v8::TryCatch try_catch;
+    v8::HandleScope scope;
+
+    // Construct receiver object.
+    v8::Handle<v8::Object> obj = object ? fromJSON(*object->get())->ToObject()
+                                        : v8::Object::New();
+    guarantee(!obj.IsEmpty());
+
+    // Construct arguments.
+    size_t nargs = args.size();
+
+    scoped_array_t<v8::Handle<v8::Value> > handles(nargs);
+    for (size_t i = 0; i < nargs; ++i) {
+        handles[i] = fromJSON(*args[i]->get());
+        guarantee(!handles[i].IsEmpty());
+    }
+
+    // Call function with environment as its receiver.
+    v8::Handle<v8::Value> value = func->Call(obj, nargs, handles.data());
+    if (value.IsEmpty()) {
+        *errmsg = "calling function failed";
+        append_caught_error(errmsg, try_catch);
+        return boost::shared_ptr<scoped_cJSON_t>();
+    }
+
+    // JSONify result.
+    return toJSON(value, errmsg);
+}
+
 struct call_task_t : auto_task_t<call_task_t> {
     call_task_t() {}
     call_task_t(id_t id,
@@ -408,33 +557,6 @@ struct call_task_t : auto_task_t<call_task_t> {
     std::vector<boost::shared_ptr<scoped_cJSON_t> > args_;
     RDB_MAKE_ME_SERIALIZABLE_3(func_id_, obj_, args_);
 
-    v8::Handle<v8::Value> eval(v8::Handle<v8::Function> func, std::string *errmsg) {
-        v8::TryCatch try_catch;
-        v8::HandleScope scope;
-
-        // Construct receiver object.
-        v8::Handle<v8::Object> obj = obj_ ? fromJSON(*obj_.get()->get())->ToObject()
-                                          : v8::Object::New();
-        guarantee(!obj.IsEmpty());
-
-        // Construct arguments.
-        size_t nargs = args_.size();
-
-        scoped_array_t<v8::Handle<v8::Value> > handles(nargs);
-        for (size_t i = 0; i < nargs; ++i) {
-            handles[i] = fromJSON(*args_[i]->get());
-            guarantee(!handles[i].IsEmpty());
-        }
-
-        // Call function with environment as its receiver.
-        v8::Handle<v8::Value> result = func->Call(obj, nargs, handles.data());
-        if (result.IsEmpty()) {
-            *errmsg = "calling function failed";
-            append_caught_error(errmsg, try_catch);
-        }
-        return scope.Close(result);
-    }
-
     void run(env_t *env) {
         // TODO(rntz): This is very similar to compile_task_t::run(). Refactor?
         json_result_t result("");
@@ -444,13 +566,10 @@ struct call_task_t : auto_task_t<call_task_t> {
         v8::Handle<v8::Function> func = v8::Handle<v8::Function>::Cast(env->findValue(func_id_));
         guarantee(!func.IsEmpty());
 
-        v8::Handle<v8::Value> value = eval(func, errmsg);
-        if (!value.IsEmpty()) {
-            // JSONify result.
-            boost::shared_ptr<scoped_cJSON_t> json = toJSON(value, errmsg);
-            if (json) {
-                result = json;
-            }
+        boost::shared_ptr<scoped_cJSON_t> json
+            = call_function(func, obj_ ? *obj_ : boost::shared_ptr<scoped_cJSON_t>(), args_, errmsg);
+        if (json) {
+            result = json;
         }
 
         write_message_t msg;
@@ -467,6 +586,7 @@ boost::shared_ptr<scoped_cJSON_t> runner_t::call(
     std::string *errmsg,
     const req_config_t *config)
 {
+    traced_span_t span("js call");
     json_result_t result;
     guarantee(!object || object->type() == cJSON_Object);
 
@@ -480,4 +600,84 @@ boost::shared_ptr<scoped_cJSON_t> runner_t::call(
     return boost::apply_visitor(v, result);
 }
 
+// ----- call_batch() -----
+struct call_batch_task_t : auto_task_t<call_batch_task_t> {
+    call_batch_task_t() {}
+    call_batch_task_t(id_t id,
+                      const std::vector<boost::shared_ptr<scoped_cJSON_t> > &objs,
+                      const std::vector<std::vector<boost::shared_ptr<scoped_cJSON_t> > > &args)
+        : func_id_(id), objs_(objs.size()), args_(args)
+    {
+        guarantee(objs.size() == args_.size());
+        for (size_t i = 0; i < objs.size(); ++i) {
+            if (NULL != objs[i].get()) {
+                objs_[i] = objs[i];
+            }
+        }
+    }
+
+    id_t func_id_;
+    std::vector<boost::optional<boost::shared_ptr<scoped_cJSON_t> > > objs_;
+    std::vector<std::vector<boost::shared_ptr<scoped_cJSON_t> > > args_;
+    RDB_MAKE_ME_SERIALIZABLE_3(func_id_, objs_, args_);
+
+    void run(env_t *env) {
+        json_batch_result_t result("");
+        std::string *errmsg = boost::get<std::string>(&result);
+
+        v8::HandleScope handle_scope;
+        v8::Handle<v8::Function> func = v8::Handle<v8::Function>::Cast(env->findValue(func_id_));
+        guarantee(!func.IsEmpty());
+
+        std::vector<boost::shared_ptr<scoped_cJSON_t> > values;
+        values.reserve(args_.size());
+        for (size_t i = 0; i < args_.size(); ++i) {
+            boost::shared_ptr<scoped_cJSON_t> json = call_function(
+                func, objs_[i] ? *objs_[i] : boost::shared_ptr<scoped_cJSON_t>(), args_[i], errmsg);
+            if (!json) {
+                break;
+            }
+            values.push_back(json);
+        }
+        if (values.size() == args_.size()) {
+            result = values;
+        }
+
+        write_message_t msg;
+        msg << result;
+        int sendres = send_write_message(env->control(), &msg);
+        guarantee(0 == sendres);
+    }
+};
+
+bool runner_t::call_batch(
+    id_t func_id,
+    const std::vector<boost::shared_ptr<scoped_cJSON_t> > &objects,
+    const std::vector<std::vector<boost::shared_ptr<scoped_cJSON_t> > > &args,
+    std::vector<boost::shared_ptr<scoped_cJSON_t> > *results,
+    std::string *errmsg,
+    const req_config_t *config)
+{
+    traced_span_t span("js call batch");
+    guarantee(objects.size() == args.size());
+    for (size_t i = 0; i < objects.size(); ++i) {
+        guarantee(!objects[i] || objects[i]->type() == cJSON_Object);
+    }
+
+    json_batch_result_t result;
+
+    {
+        run_task_t run(this, config, call_batch_task_t(func_id, objects, args));
+        int res = deserialize(&run, &result);
+        guarantee(ARCHIVE_SUCCESS == res);
+    }
+
+    if (std::string *msg = boost::get<std::string>(&result)) {
+        *errmsg = *msg;
+        return false;
+    }
+    results->swap(boost::get<std::vector<boost::shared_ptr<scoped_cJSON_t> > >(result));
+    return true;
+}
+
 } // namespace js
@@ -61,7 +61,10 @@ class runner_t : private extproc::job_handle_t {
     friend class run_task_t;
 
   public:
-    runner_t();
+    // If `affinity` is non-NULL, every job this runner begins is preferably
+    // sent to the worker process its previous job ran on, whose cache of
+    // compiled functions is then still warm. `affinity` must outlive us.
+    explicit runner_t(extproc::worker_affinity_t *affinity = NULL);
     ~runner_t();
 
     // For now we crash on errors, but eventually we may need to deal with job
@@ -95,7 +98,9 @@ class runner_t : private extproc::job_handle_t {
     static const req_config_t *default_req_config();
 
     // Returns INVALID_ID on error.
-    // Returned id may only be used in `call`.
+    // Returned id may only be used in `call` and `call_batch`. Compiling the
+    // same arguments and source twice in one job returns the same id without
+    // a round-trip to the worker.
     MUST_USE id_t compile(
         // Argument names
         const std::vector<std::string> &args,
@@ -118,6 +123,19 @@ class runner_t : private extproc::job_handle_t {
         std::string *errmsg,
         const req_config_t *config = NULL);
 
+    // Calls a previously compiled function once per element of `args`, all in
+    // a single round-trip to the worker. `objects[i]` is the receiver for the
+    // i'th call, with the same meaning as `object` in `call`. On success,
+    // fills in `results` (one per call) and returns true. If any call fails,
+    // returns false and sets `errmsg`.
+    MUST_USE bool call_batch(
+        id_t func_id,
+        const std::vector<boost::shared_ptr<scoped_cJSON_t> > &objects,
+        const std::vector<std::vector<boost::shared_ptr<scoped_cJSON_t> > > &args,
+        std::vector<boost::shared_ptr<scoped_cJSON_t> > *results,
+        std::string *errmsg,
+        const req_config_t *config = NULL);
+
     // TODO (rntz): a way to send streams over to javascript.
     // TODO (rntz): a way to get streams back from javascript.
 
@@ -156,10 +174,19 @@ class runner_t : private extproc::job_handle_t {
         }
     }
 
+    // Forgets everything tied to the job we were connected to.
+    void reset_job_state();
+
   private:
+    extproc::worker_affinity_t *affinity_;
+
     // Used only for assertions and guarantees.
     bool running_task_;
     std::set<id_t> used_ids_;
+
+    // Functions compiled in the current job, keyed by argument names and
+    // source.
+    std::map<std::string, id_t> compiled_ids_;
 };
 
 } // namespace js
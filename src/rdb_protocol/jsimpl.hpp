@@ -6,6 +6,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "errors.hpp"
 #include <boost/variant.hpp>
@@ -93,6 +94,7 @@ struct auto_task_t : extproc::auto_job_t<instance_t, task_t> {};
 // Results we get back from tasks, generally "success or error" variants
 typedef boost::variant<id_t, std::string> id_result_t;
 typedef boost::variant<boost::shared_ptr<scoped_cJSON_t>, std::string> json_result_t;
+typedef boost::variant<std::vector<boost::shared_ptr<scoped_cJSON_t> >, std::string> json_batch_result_t;
 
 // Visitors to extract values from results.
 struct id_visitor_t {
@@ -6,15 +6,21 @@
 
 #include "concurrency/cross_thread_watchable.hpp"
 #include "concurrency/watchable.hpp"
+#include "logger.hpp"
+#include "perfmon/trace.hpp"
 #include "rdb_protocol/stream_cache.hpp"
 #include "rpc/semilattice/view/field.hpp"
 
 query_server_t::query_server_t(const std::set<ip_address_t> &local_addresses,
                                int port,
                                rdb_protocol_t::context_t *_ctx) :
+    stats_membership(&get_global_perfmon_collection(), &stats, "query_server"),
+    pm_queries(secs_to_ticks(1), true),
+    pm_queries_membership(&stats, &pm_queries, "queries"),
     server(local_addresses, port, boost::bind(&query_server_t::handle, this, _1, _2),
            &on_unparsable_query, INLINE),
-    ctx(_ctx), parser_id(generate_uuid()), thread_counters(0)
+    ctx(_ctx), parser_id(generate_uuid()), thread_counters(0),
+    queries_until_sampled(RDB_TRACE_SAMPLE_INTERVAL)
 { }
 
 http_app_t *query_server_t::get_http_app() {
@@ -40,22 +46,51 @@ Response on_unparsable_query(Query *q, std::string msg) {
     return res;
 }
 
+static void put_trace(const std::vector<trace_span_t> &spans, Response *res_out) {
+    for (size_t i = 0; i < spans.size(); ++i) {
+        Response::Span *span = res_out->add_trace();
+        span->set_name(spans[i].name);
+        span->set_start(spans[i].start);
+        span->set_duration(spans[i].duration);
+        if (spans[i].count > 1) {
+            span->set_count(spans[i].count);
+        }
+    }
+}
+
 Response query_server_t::handle(Query *q, context_t *query_context) {
     stream_cache_t *stream_cache = &query_context->stream_cache;
     signal_t *interruptor = query_context->interruptor;
     guarantee(interruptor);
+    block_pm_duration query_timer(&pm_queries);
     Response res;
     res.set_token(q->token());
 
+    int *until_sampled = queries_until_sampled.get();
+    bool sampled = --*until_sampled <= 0;
+    if (sampled) {
+        *until_sampled = RDB_TRACE_SAMPLE_INTERVAL;
+    }
+    scoped_ptr_t<trace_t> trace;
+    if (q->trace() || sampled) {
+        /* Sampled queries only go to the log, which doesn't need the spans
+        from the other machines badly enough to have them sent back. */
+        trace.init(new trace_t(q->trace()));
+    }
+    trace_scope_t trace_scope(trace.has() ? trace.get() : NULL);
+
     query_language::type_checking_environment_t type_environment;
 
     query_language::backtrace_t root_backtrace;
     bool is_deterministic;
 
     try {
-        query_language::check_query_type(
-            q, &type_environment, &is_deterministic, root_backtrace);
-        boost::shared_ptr<js::runner_t> js_runner = boost::make_shared<js::runner_t>();
+        {
+            traced_span_t span("check_query_type");
+            query_language::check_query_type(
+                q, &type_environment, &is_deterministic, root_backtrace);
+        }
+        boost::shared_ptr<js::runner_t> js_runner = boost::make_shared<js::runner_t>(&query_context->js_affinity);
         int thread = get_thread_id();
         query_language::runtime_environment_t runtime_environment(
             ctx->pool_group, ctx->ns_repo,
@@ -65,17 +100,16 @@ Response query_server_t::handle(Query *q, context_t *query_context) {
             ctx->directory_read_manager,
             js_runner, interruptor, ctx->machine_id);
         //[execute_query] will set the status code unless it throws
+        traced_span_t span("execute_query");
         execute_query(q, &runtime_environment, &res, scopes_t(),
                       root_backtrace, stream_cache);
     } catch (const query_language::broken_client_exc_t &e) {
         res.set_status_code(Response::BROKEN_CLIENT);
         res.set_error_message(e.message);
-        return res;
     } catch (const query_language::bad_query_exc_t &e) {
         res.set_status_code(Response::BAD_QUERY);
         res.set_error_message(e.message);
         put_backtrace(e.backtrace, &res);
-        return res;
     } catch (const query_language::runtime_exc_t &e) {
         res.set_status_code(Response::RUNTIME_ERROR);
         res.set_error_message(e.message);
@@ -85,5 +119,17 @@ Response query_server_t::handle(Query *q, context_t *query_context) {
         res.set_error_message("Query interrupted.  Did you shut down the server?");
     }
 
+    if (trace.has()) {
+        std::vector<trace_span_t> spans = trace->get_spans();
+        if (q->trace()) {
+            put_trace(spans, &res);
+        }
+        double elapsed = trace->elapsed();
+        if (elapsed * 1000 >= RDB_SLOW_QUERY_LOG_MS) {
+            logINF("Slow query (token %" PRIi64 ") took %.3f seconds:\n%s",
+                   q->token(), elapsed, format_trace_spans(spans).c_str());
+        }
+    }
+
     return res;
 }
@@ -10,6 +10,7 @@
 #include "clustering/administration/namespace_interface_repository.hpp"
 #include "clustering/administration/namespace_metadata.hpp"
 #include "extproc/pool.hpp"
+#include "perfmon/perfmon.hpp"
 #include "protob/protob.hpp"
 #include "protocol_api.hpp"
 #include "rdb_protocol/protocol.hpp"
@@ -27,13 +28,29 @@ public:
         context_t() : interruptor(0) { }
         stream_cache_t stream_cache;
         signal_t *interruptor;
+        // Sends the javascript of every query on this connection to the same
+        // worker process, where its compiled functions are cached.
+        extproc::worker_affinity_t js_affinity;
     };
 private:
     Response handle(Query *q, context_t *query_context);
+
+    /* A query may touch any number of tables, and this server doesn't know
+    which until it runs it, so query latency is tracked for the server as a
+    whole rather than per table. These come before `server`, which may start
+    handling queries as soon as it is constructed. */
+    perfmon_collection_t stats;
+    perfmon_membership_t stats_membership;
+    perfmon_duration_sampler_t pm_queries;
+    perfmon_membership_t pm_queries_membership;
+
     protob_server_t<Query, Response, context_t> server;
     rdb_protocol_t::context_t *ctx;
     uuid_u parser_id;
     one_per_thread_t<int> thread_counters;
+    // Counts queries down to the next one that gets traced even though the
+    // client didn't ask for it.
+    one_per_thread_t<int> queries_until_sampled;
 
     DISABLE_COPYING(query_server_t);
 };
@@ -17,6 +17,7 @@
 #include "rdb_protocol/btree.hpp"
 #include "rdb_protocol/protocol.hpp"
 #include "rdb_protocol/query_language.hpp"
+#include "rdb_protocol/transform_visitors.hpp"
 #include "rpc/semilattice/view/field.hpp"
 #include "rpc/semilattice/watchable.hpp"
 #include "serializer/config.hpp"
@@ -42,6 +43,9 @@ typedef rdb_protocol_t::rget_read_response_t rget_read_response_t;
 typedef rdb_protocol_t::distribution_read_t distribution_read_t;
 typedef rdb_protocol_t::distribution_read_response_t distribution_read_response_t;
 
+typedef rdb_protocol_t::hot_keys_read_t hot_keys_read_t;
+typedef rdb_protocol_t::hot_keys_read_response_t hot_keys_read_response_t;
+
 typedef rdb_protocol_t::write_t write_t;
 typedef rdb_protocol_t::write_response_t write_response_t;
 
@@ -81,6 +85,7 @@ RDB_IMPL_SERIALIZABLE_3(backfill_atom_t, key, value, recency);
 RDB_IMPL_SERIALIZABLE_3(transform_atom_t, variant, scopes, backtrace);
 RDB_IMPL_SERIALIZABLE_3(terminal_t, variant, scopes, backtrace);
 RDB_IMPL_SERIALIZABLE_0(Length);
+RDB_IMPL_SERIALIZABLE_0(Distinct);
 
 }  // namespace rdb_protocol_details
 
@@ -143,6 +148,10 @@ struct r_get_region_visitor : public boost::static_visitor<region_t> {
     region_t operator()(const distribution_read_t &dg) const {
         return dg.region;
     }
+
+    region_t operator()(const hot_keys_read_t &hk) const {
+        return hk.region;
+    }
 };
 
 }   /* anonymous namespace */
@@ -179,13 +188,22 @@ struct r_shard_visitor : public boost::static_visitor<read_t> {
         return read_t(_dg);
     }
 
+    read_t operator()(const hot_keys_read_t &hk) const {
+        rassert(region_is_superset(hk.region, region));
+        hot_keys_read_t _hk(hk);
+        _hk.region = region;
+        return read_t(_hk);
+    }
+
     const region_t &region;
 };
 
 }   /* anonymous namespace */
 
 read_t read_t::shard(const region_t &region) const THROWS_NOTHING {
-    return boost::apply_visitor(r_shard_visitor(region), read);
+    read_t sharded = boost::apply_visitor(r_shard_visitor(region), read);
+    sharded.trace = trace || (current_trace() != NULL && current_trace()->wants_remote_spans());
+    return sharded;
 }
 
 /* read_t::unshard implementation */
@@ -227,12 +245,52 @@ void scale_down_distribution(size_t result_limit, std::map<store_key_t, int64_t>
     }
 }
 
+/* Below this many groups (summed over all shards) merging grouped map reduce
+results isn't worth a trip to other threads. */
+const size_t GROUPED_MERGE_PARALLEL_THRESHOLD = 10000;
+
+typedef std::vector<std::pair<boost::shared_ptr<scoped_cJSON_t>, boost::shared_ptr<scoped_cJSON_t> > > grouped_partition_t;
+
+/* Merges one hash partition of the shards' grouped map reduce results. Runs on
+thread `partition % get_num_threads()` with an evaluation environment of its
+own, since a `js::runner_t` can only run one task at a time. */
+void merge_grouped_partition(context_t *ctx,
+                             const Builtin_GroupedMapReduce *gmr,
+                             const rdb_protocol_details::terminal_t *terminal,
+                             const std::vector<grouped_partition_t> *partitions,
+                             std::vector<groups_t> *merged,
+                             std::vector<boost::optional<query_language::runtime_exc_t> > *errors,
+                             int partition) {
+    on_thread_t th(partition % get_num_threads());
+
+    query_language::runtime_environment_t env(
+        ctx->pool_group,
+        ctx->ns_repo,
+        ctx->cross_thread_namespace_watchables[get_thread_id()].get()->get_watchable(),
+        ctx->cross_thread_database_watchables[get_thread_id()].get()->get_watchable(),
+        ctx->semilattice_metadata,
+        boost::make_shared<js::runner_t>(),
+        ctx->signals[get_thread_id()].get(),
+        ctx->machine_id);
+
+    const grouped_partition_t &in = (*partitions)[partition];
+    groups_t *out = &(*merged)[partition];
+    try {
+        for (grouped_partition_t::const_iterator it = in.begin(); it != in.end(); ++it) {
+            query_language::reduce_into_group(gmr->reduction(), it->first, it->second, &env,
+                                              terminal->scopes, terminal->backtrace.with("reduction"), out);
+        }
+    } catch (const query_language::runtime_exc_t &e) {
+        (*errors)[partition] = e;
+    }
+}
+
 class unshard_visitor_t : public boost::static_visitor<void> {
 public:
     unshard_visitor_t(const read_response_t *_responses,
                       size_t _count,
-                      read_response_t *_response_out, context_t *ctx)
-        : responses(_responses), count(_count), response_out(_response_out),
+                      read_response_t *_response_out, context_t *_ctx)
+        : responses(_responses), count(_count), response_out(_response_out), ctx(_ctx),
           env(ctx->pool_group,
               ctx->ns_repo,
               ctx->cross_thread_namespace_watchables[get_thread_id()].get()->get_watchable(),
@@ -302,22 +360,48 @@ public:
                 //GroupedMapreduce
                 rg_response.result = groups_t();
                 groups_t *res_groups = boost::get<groups_t>(&rg_response.result);
+
+                size_t total_groups = 0;
                 for (size_t i = 0; i < count; ++i) {
                     const rget_read_response_t *_rr = boost::get<rget_read_response_t>(&responses[i].response);
                     guarantee(_rr);
+                    total_groups += boost::get<groups_t>(&(_rr->result))->size();
+                }
+
+                if (total_groups < GROUPED_MERGE_PARALLEL_THRESHOLD || get_num_threads() == 1) {
+                    for (size_t i = 0; i < count; ++i) {
+                        const groups_t *groups = boost::get<groups_t>(&(boost::get<rget_read_response_t>(&responses[i].response)->result));
+                        for (groups_t::const_iterator j = groups->begin(); j != groups->end(); ++j) {
+                            query_language::reduce_into_group(gmr->reduction(), j->first, j->second, &env,
+                                                              rg.terminal->scopes, rg.terminal->backtrace.with("reduction"), res_groups);
+                        }
+                    }
+                } else {
+                    /* Split the key space by group hash so that each
+                    partition can be merged independently on its own thread. */
+                    const int num_partitions = get_num_threads();
+                    std::vector<grouped_partition_t> partitions(num_partitions);
+                    for (size_t i = 0; i < count; ++i) {
+                        const groups_t *groups = boost::get<groups_t>(&(boost::get<rget_read_response_t>(&responses[i].response)->result));
+                        for (groups_t::const_iterator j = groups->begin(); j != groups->end(); ++j) {
+                            partitions[query_language::json_hash(j->first->get()) % num_partitions].push_back(*j);
+                        }
+                    }
 
-                    const groups_t *groups = boost::get<groups_t>(&(_rr->result));
+                    std::vector<groups_t> merged(num_partitions);
+                    std::vector<boost::optional<runtime_exc_t> > errors(num_partitions);
+                    pmap(num_partitions, boost::bind(&merge_grouped_partition, ctx, gmr, rg.terminal.get_ptr(),
+                                                     &partitions, &merged, &errors, _1));
 
-                    for (groups_t::const_iterator j = groups->begin(); j != groups->end(); ++j) {
-                        Term base = gmr->reduction().base(),
-                             body = gmr->reduction().body();
+                    for (int p = 0; p < num_partitions; ++p) {
+                        if (errors[p]) {
+                            throw *errors[p];
+                        }
+                    }
 
-                        scopes_t scopes_copy = rg.terminal->scopes;
-                        query_language::new_val_scope_t inner_scope(&scopes_copy.scope);
-                        scopes_copy.scope.put_in_scope(gmr->reduction().var1(),
-                            res_groups->insert(std::make_pair(j->first, eval_term_as_json(&base, &env, rg.terminal->scopes, rg.terminal->backtrace.with("reduction").with("base")))).first->second);
-                        scopes_copy.scope.put_in_scope(gmr->reduction().var2(), j->second);
-                        (*res_groups)[j->first] = eval_term_as_json(&body, &env, scopes_copy, rg.terminal->backtrace.with("reduction").with("body"));
+                    // Partitions hold disjoint groups, so this is a plain union.
+                    for (int p = 0; p < num_partitions; ++p) {
+                        res_groups->insert(merged[p].begin(), merged[p].end());
                     }
                 }
             } else if (const Reduction *r = boost::get<Reduction>(&rg.terminal->variant)) {
@@ -373,6 +457,16 @@ public:
         }
     }
 
+    void operator()(const hot_keys_read_t &) {
+        hot_keys_read_response_t res;
+        for (size_t i = 0; i < count; ++i) {
+            const hot_keys_read_response_t *bit = boost::get<hot_keys_read_response_t>(&responses[i].response);
+            guarantee(bit, "Bad boost::get\n");
+            res.reports.insert(res.reports.end(), bit->reports.begin(), bit->reports.end());
+        }
+        response_out->response = res;
+    }
+
     void operator()(const distribution_read_t &dg) {
         // TODO: do this without copying so much and/or without dynamic memory
         // Sort results by region
@@ -439,12 +533,19 @@ private:
     const read_response_t *responses;
     size_t count;
     read_response_t *response_out;
+    context_t *ctx;
     query_language::runtime_environment_t env;
 };
 
 void read_t::unshard(read_response_t *responses, size_t count, read_response_t *response, context_t *ctx) const THROWS_NOTHING {
+    if (trace_t *t = current_trace()) {
+        for (size_t i = 0; i < count; ++i) {
+            t->add_remote_spans(responses[i].trace_spans);
+        }
+    }
     unshard_visitor_t v(responses, count, response, ctx);
     boost::apply_visitor(v, read);
+    response->trace_spans.clear();
 }
 
 bool rget_data_cmp(const std::pair<store_key_t, boost::shared_ptr<scoped_cJSON_t> >& a,
@@ -503,12 +604,18 @@ struct w_shard_visitor : public boost::static_visitor<write_t> {
 }   /* anonymous namespace */
 
 write_t write_t::shard(const region_t &region) const THROWS_NOTHING {
-    return boost::apply_visitor(w_shard_visitor(region), write);
+    write_t sharded = boost::apply_visitor(w_shard_visitor(region), write);
+    sharded.trace = trace || (current_trace() != NULL && current_trace()->wants_remote_spans());
+    return sharded;
 }
 
 void write_t::unshard(const write_response_t *responses, size_t count, write_response_t *response, UNUSED context_t *ctx) const THROWS_NOTHING {
     guarantee(count == 1);
     *response = responses[0];
+    if (trace_t *t = current_trace()) {
+        t->add_remote_spans(response->trace_spans);
+    }
+    response->trace_spans.clear();
 }
 
 store_t::store_t(serializer_t *serializer,
@@ -563,6 +670,15 @@ struct read_visitor_t : public boost::static_visitor<void> {
         res.region = dg.region;
     }
 
+    void operator()(const hot_keys_read_t &hk) {
+        superblock->release();
+        response->response = hot_keys_read_response_t();
+        hot_keys_read_response_t &res = boost::get<hot_keys_read_response_t>(response->response);
+        res.reports.resize(1);
+        res.reports[0].first = hk.region;
+        btree->stats.hot_keys.get_report(hk.limit, &res.reports[0].second);
+    }
+
     read_visitor_t(btree_slice_t *_btree,
                    transaction_t *_txn,
                    superblock_t *_superblock,
@@ -601,8 +717,20 @@ void store_t::protocol_read(const read_t &read,
                             transaction_t *txn,
                             superblock_t *superblock,
                             signal_t *interruptor) {
-    read_visitor_t v(btree, txn, superblock, ctx, response, interruptor);
-    boost::apply_visitor(v, read.read);
+    if (!read.trace) {
+        read_visitor_t v(btree, txn, superblock, ctx, response, interruptor);
+        boost::apply_visitor(v, read.read);
+        return;
+    }
+
+    trace_t trace;
+    {
+        trace_scope_t trace_scope(&trace);
+        traced_span_t span("store read");
+        read_visitor_t v(btree, txn, superblock, ctx, response, interruptor);
+        boost::apply_visitor(v, read.read);
+    }
+    response->trace_spans = trace.get_spans();
 }
 
 namespace {
@@ -669,8 +797,20 @@ void store_t::protocol_write(const write_t &write,
                              transaction_t *txn,
                              superblock_t *superblock,
                              signal_t *interruptor) {
-    write_visitor_t v(btree, txn, superblock, timestamp.to_repli_timestamp(), ctx, response, interruptor);
-    boost::apply_visitor(v, write.write);
+    if (!write.trace) {
+        write_visitor_t v(btree, txn, superblock, timestamp.to_repli_timestamp(), ctx, response, interruptor);
+        boost::apply_visitor(v, write.write);
+        return;
+    }
+
+    trace_t trace;
+    {
+        trace_scope_t trace_scope(&trace);
+        traced_span_t span("store write");
+        write_visitor_t v(btree, txn, superblock, timestamp.to_repli_timestamp(), ctx, response, interruptor);
+        boost::apply_visitor(v, write.write);
+    }
+    response->trace_spans = trace.get_spans();
 }
 
 namespace {
@@ -723,8 +863,8 @@ struct rdb_backfill_callback_impl_t : public rdb_backfill_callback_t {
 public:
     typedef backfill_chunk_t chunk_t;
 
-    explicit rdb_backfill_callback_impl_t(chunk_fun_callback_t<rdb_protocol_t> *_chunk_fun_cb)
-        : chunk_fun_cb(_chunk_fun_cb) { }
+    rdb_backfill_callback_impl_t(chunk_fun_callback_t<rdb_protocol_t> *_chunk_fun_cb, const region_t &_region)
+        : chunk_fun_cb(_chunk_fun_cb), region(_region) { }
     ~rdb_backfill_callback_impl_t() { }
 
     void on_delete_range(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
@@ -739,6 +879,13 @@ public:
         chunk_fun_cb->send_chunk(chunk_t::set_key(atom), interruptor);
     }
 
+    void on_range_done(const key_range_t &range, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
+        region_t done = region_intersection(region, region_t(range));
+        if (!region_is_empty(done)) {
+            chunk_fun_cb->send_checkpoint(done, interruptor);
+        }
+    }
+
 protected:
     store_key_t to_store_key(const btree_key_t *key) {
         return store_key_t(key->size, key->contents);
@@ -746,19 +893,21 @@ protected:
 
 private:
     chunk_fun_callback_t<rdb_protocol_t> *chunk_fun_cb;
+    region_t region;
 
     DISABLE_COPYING(rdb_backfill_callback_impl_t);
 };
 
 static void call_rdb_backfill(int i, btree_slice_t *btree, const std::vector<std::pair<region_t, state_timestamp_t> > &regions,
-        rdb_backfill_callback_t *callback, transaction_t *txn, superblock_t *superblock, backfill_progress_t *progress,
+        chunk_fun_callback_t<rdb_protocol_t> *chunk_fun_cb, transaction_t *txn, superblock_t *superblock, backfill_progress_t *progress,
         signal_t *interruptor) THROWS_ONLY(interrupted_exc_t) {
     parallel_traversal_progress_t *p = new parallel_traversal_progress_t;
     scoped_ptr_t<traversal_progress_t> p_owned(p);
     progress->add_constituent(&p_owned);
     repli_timestamp_t timestamp = regions[i].second.to_repli_timestamp();
+    rdb_backfill_callback_impl_t callback(chunk_fun_cb, regions[i].first);
     try {
-        rdb_backfill(btree, regions[i].first.inner, timestamp, callback, txn, superblock, p, interruptor);
+        rdb_backfill(btree, regions[i].first.inner, timestamp, &callback, txn, superblock, p, interruptor);
     } catch (interrupted_exc_t) {
         /* do nothing; `protocol_send_backfill()` will notice that interruptor
         has been pulsed */
@@ -773,11 +922,10 @@ void store_t::protocol_send_backfill(const region_map_t<rdb_protocol_t, state_ti
                                      backfill_progress_t *progress,
                                      signal_t *interruptor)
                                      THROWS_ONLY(interrupted_exc_t) {
-    rdb_backfill_callback_impl_t callback(chunk_fun_cb);
     std::vector<std::pair<region_t, state_timestamp_t> > regions(start_point.begin(), start_point.end());
     refcount_superblock_t refcount_wrapper(superblock, regions.size());
     pmap(regions.size(), boost::bind(&call_rdb_backfill, _1,
-        btree, regions, &callback, txn, &refcount_wrapper, progress, interruptor));
+        btree, regions, chunk_fun_cb, txn, &refcount_wrapper, progress, interruptor));
 
     /* If interruptor was pulsed, `call_rdb_backfill()` exited silently, so we
     have to check directly. */
@@ -905,19 +1053,21 @@ RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::rget_read_response_t::inserted_t, ins
 RDB_IMPL_ME_SERIALIZABLE_5(rdb_protocol_t::rget_read_response_t,
                            result, errors, key_range, truncated, last_considered_key);
 RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::distribution_read_response_t, region, key_counts);
-RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::read_response_t, response);
+RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::hot_keys_read_response_t, reports);
+RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::read_response_t, response, trace_spans);
 
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::point_read_t, key);
 RDB_IMPL_ME_SERIALIZABLE_3(rdb_protocol_t::rget_read_t, region, transform, terminal);
 
 RDB_IMPL_ME_SERIALIZABLE_3(rdb_protocol_t::distribution_read_t, max_depth, result_limit, region);
-RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::read_t, read);
+RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::hot_keys_read_t, limit, region);
+RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::read_t, read, trace);
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::point_write_response_t, result);
 
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::point_delete_response_t, result);
 RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::point_modify_response_t, result, exc);
 
-RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::write_response_t, response);
+RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::write_response_t, response, trace_spans);
 
 RDB_IMPL_ME_SERIALIZABLE_6(rdb_protocol_t::point_modify_t, primary_key, key, op, scopes, backtrace, mapping);
 
@@ -925,7 +1075,7 @@ RDB_IMPL_ME_SERIALIZABLE_3(rdb_protocol_t::point_write_t, key, data, overwrite);
 
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::point_delete_t, key);
 
-RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::write_t, write);
+RDB_IMPL_ME_SERIALIZABLE_2(rdb_protocol_t::write_t, write, trace);
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::backfill_chunk_t::delete_key_t, key);
 
 RDB_IMPL_ME_SERIALIZABLE_1(rdb_protocol_t::backfill_chunk_t::delete_range_t, range);
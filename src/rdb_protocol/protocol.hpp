@@ -15,6 +15,7 @@
 #include <boost/optional.hpp>
 
 #include "btree/btree_store.hpp"
+#include "btree/hot_keys.hpp"
 #include "btree/keys.hpp"
 #include "buffer_cache/types.hpp"
 #include "containers/archive/stl_types.hpp"
@@ -22,6 +23,7 @@
 #include "http/json.hpp"
 #include "http/json/cJSON.hpp"
 #include "memcached/region.hpp"
+#include "perfmon/trace.hpp"
 #include "hash_region.hpp"
 #include "protocol_api.hpp"
 #include "rdb_protocol/exceptions.hpp"
@@ -96,7 +98,16 @@ struct backfill_atom_t {
 
 RDB_DECLARE_SERIALIZABLE(backfill_atom_t);
 
-typedef boost::variant<Builtin_Filter, Mapping, Builtin_ConcatMap, Builtin_Range>  transform_variant_t;
+/* Drops values that were already seen earlier in the same pass (e.g. on the
+same shard of a table scan). Only a bounded number of values is remembered, so
+this is a pre-filter for `Builtin::DISTINCT` rather than a full implementation
+of it. */
+
+struct Distinct { };
+
+RDB_DECLARE_SERIALIZABLE(Distinct);
+
+typedef boost::variant<Builtin_Filter, Mapping, Builtin_ConcatMap, Builtin_Range, Distinct>  transform_variant_t;
 
 struct transform_atom_t {
     transform_atom_t() { }
@@ -224,14 +235,23 @@ struct rdb_protocol_t {
         RDB_DECLARE_ME_SERIALIZABLE;
     };
 
+    struct hot_keys_read_response_t {
+        /* One report for each btree, with the region it holds. */
+        std::vector<std::pair<region_t, hot_keys_report_t> > reports;
+
+        RDB_DECLARE_ME_SERIALIZABLE;
+    };
+
     struct read_response_t {
     private:
-        typedef boost::variant<point_read_response_t, rget_read_response_t, distribution_read_response_t> _response_t;
+        typedef boost::variant<point_read_response_t, rget_read_response_t, distribution_read_response_t, hot_keys_read_response_t> _response_t;
     public:
         _response_t response;
+        /* The spans the store recorded, if the read asked to be traced. */
+        std::vector<trace_span_t> trace_spans;
 
         read_response_t() { }
-        read_response_t(const read_response_t& r) : response(r.response) { }
+        read_response_t(const read_response_t& r) : response(r.response), trace_spans(r.trace_spans) { }
         explicit read_response_t(const _response_t &r) : response(r) { }
 
         RDB_DECLARE_ME_SERIALIZABLE;
@@ -294,20 +314,41 @@ struct rdb_protocol_t {
         RDB_DECLARE_ME_SERIALIZABLE;
     };
 
+    /* Asks every btree in the region which keys it sees most and which of its
+    operations were slow (see btree/hot_keys.hpp). */
+    class hot_keys_read_t {
+    public:
+        hot_keys_read_t()
+            : limit(0), region(region_t::universe())
+        { }
+        explicit hot_keys_read_t(size_t _limit)
+            : limit(_limit), region(region_t::universe())
+        { }
+
+        /* How many keys to return in each list. */
+        size_t limit;
+        region_t region;
+
+        RDB_DECLARE_ME_SERIALIZABLE;
+    };
+
 
     struct read_t {
     private:
-        typedef boost::variant<point_read_t, rget_read_t, distribution_read_t> _read_t;
+        typedef boost::variant<point_read_t, rget_read_t, distribution_read_t, hot_keys_read_t> _read_t;
     public:
         _read_t read;
+        /* Whether the store should send back how long its part took. Set by
+        `shard()` when the query is being traced. */
+        bool trace;
 
         region_t get_region() const THROWS_NOTHING;
         read_t shard(const region_t &region) const THROWS_NOTHING;
         void unshard(read_response_t *responses, size_t count, read_response_t *response, context_t *ctx) const THROWS_NOTHING;
 
-        read_t() { }
-        read_t(const read_t& r) : read(r.read) { }
-        explicit read_t(const _read_t &r) : read(r) { }
+        read_t() : trace(false) { }
+        read_t(const read_t& r) : read(r.read), trace(r.trace) { }
+        explicit read_t(const _read_t &r) : read(r), trace(false) { }
 
         // Only use snapshotting if we're doing a range get.
         bool use_snapshot() const { return boost::get<rget_read_t>(&read); }
@@ -352,9 +393,10 @@ struct rdb_protocol_t {
 
     struct write_response_t {
         boost::variant<point_write_response_t, point_modify_response_t, point_delete_response_t> response;
+        std::vector<trace_span_t> trace_spans;
 
         write_response_t() { }
-        write_response_t(const write_response_t& w) : response(w.response) { }
+        write_response_t(const write_response_t& w) : response(w.response), trace_spans(w.trace_spans) { }
         explicit write_response_t(const point_write_response_t& w) : response(w) { }
         explicit write_response_t(const point_modify_response_t& m) : response(m) { }
         explicit write_response_t(const point_delete_response_t& d) : response(d) { }
@@ -405,16 +447,17 @@ struct rdb_protocol_t {
 
     struct write_t {
         boost::variant<point_write_t, point_delete_t, point_modify_t> write;
+        bool trace;
 
         region_t get_region() const THROWS_NOTHING;
         write_t shard(const region_t &region) const THROWS_NOTHING;
         void unshard(const write_response_t *responses, size_t count, write_response_t *response, context_t *cache) const THROWS_NOTHING;
 
-        write_t() { }
-        write_t(const write_t& w) : write(w.write) { }
-        explicit write_t(const point_write_t &w) : write(w) { }
-        explicit write_t(const point_delete_t &d) : write(d) { }
-        explicit write_t(const point_modify_t &m) : write(m) { }
+        write_t() : trace(false) { }
+        write_t(const write_t& w) : write(w.write), trace(w.trace) { }
+        explicit write_t(const point_write_t &w) : write(w), trace(false) { }
+        explicit write_t(const point_delete_t &d) : write(d), trace(false) { }
+        explicit write_t(const point_modify_t &m) : write(m), trace(false) { }
 
         RDB_DECLARE_ME_SERIALIZABLE;
     };
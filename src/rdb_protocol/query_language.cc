@@ -4,9 +4,12 @@
 #include <math.h>
 
 #include "errors.hpp"
+#include <boost/bind.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/optional.hpp>
 #include <boost/variant.hpp>
 
+#include "arch/runtime/work_stealing.hpp"
 #include "clustering/administration/main/ports.hpp"
 #include "clustering/administration/suggester.hpp"
 #include "concurrency/cross_thread_signal.hpp"
@@ -1155,13 +1158,64 @@ void execute_query(Query *q, runtime_environment_t *env, Response *res, const sc
     }
 }
 
+bool term_is_pure(const Term &t) {
+    return t.HasExtension(extension::deterministic) && t.GetExtension(extension::deterministic);
+}
+
+namespace {
+
+/* What a piece of stealable evaluation threw, to be thrown again on the thread
+that's waiting for it. */
+struct evaluation_error_t {
+    evaluation_error_t() : interrupted(false) { }
+    boost::optional<runtime_exc_t> runtime;
+    boost::optional<broken_client_exc_t> broken_client;
+    bool interrupted;
+};
+
+void run_catching_evaluation_errors(const boost::function<void()> &fun, evaluation_error_t *error) {
+    try {
+        fun();
+    } catch (const runtime_exc_t &e) {
+        error->runtime = e;
+    } catch (const broken_client_exc_t &e) {
+        error->broken_client = e;
+    } catch (const interrupted_exc_t &) {
+        error->interrupted = true;
+    }
+}
+
+void eval_and_print_json(Term *t, runtime_environment_t *env, const scopes_t *scopes, const backtrace_t *backtrace, std::string *out) {
+    *out = eval_term_as_json(t, env, *scopes, *backtrace)->PrintUnformatted();
+}
+
+}  // namespace
+
+void run_stealable_evaluation(const boost::function<void()> &fun) THROWS_ONLY(interrupted_exc_t, runtime_exc_t, broken_client_exc_t) {
+    evaluation_error_t error;
+    run_stealable(boost::bind(&run_catching_evaluation_errors, fun, &error));
+    if (error.runtime) {
+        throw *error.runtime;
+    } else if (error.broken_client) {
+        throw *error.broken_client;
+    } else if (error.interrupted) {
+        throw interrupted_exc_t();
+    }
+}
+
 void execute_read_query(ReadQuery *r, runtime_environment_t *env, Response *res, const scopes_t &scopes, const backtrace_t &backtrace, stream_cache_t *stream_cache) THROWS_ONLY(interrupted_exc_t, runtime_exc_t, broken_client_exc_t) {
     int type = r->GetExtension(extension::inferred_read_type);
 
     switch (type) {
     case TERM_TYPE_JSON: {
-        boost::shared_ptr<scoped_cJSON_t> json = eval_term_as_json(r->mutable_term(), env, scopes, backtrace);
-        res->add_response(json->PrintUnformatted());
+        std::string printed;
+        if (term_is_pure(r->term())) {
+            run_stealable_evaluation(boost::bind(&eval_and_print_json, r->mutable_term(), env,
+                                                 &scopes, &backtrace, &printed));
+        } else {
+            eval_and_print_json(r->mutable_term(), env, &scopes, &backtrace, &printed);
+        }
+        res->add_response(printed);
         res->set_status_code(Response::SUCCESS_JSON);
         break;
     }
@@ -1686,6 +1740,38 @@ boost::shared_ptr<scoped_cJSON_t> eval_term_as_json_and_check_either(Term *t, ru
 }
 
 
+/* Returns the id of `t`'s compiled javascript function, compiling it with
+argument names `argnames` if that hasn't happened yet. */
+static js::id_t compile_javascript(Term *t, js::runner_t *js, const std::vector<std::string> &argnames, const backtrace_t &backtrace) {
+    if (t->HasExtension(extension::js_id)) {
+        return t->GetExtension(extension::js_id);
+    }
+
+    // Not compiled yet. Compile it and add the extension.
+    std::string errmsg;
+    js::id_t id = js->compile(argnames, t->javascript(), &errmsg);
+    if (js::INVALID_ID == id) {
+        throw runtime_exc_t("failed to compile javascript: " + errmsg, backtrace);
+    }
+    t->SetExtension(extension::js_id, (int32_t) id);
+    return id;
+}
+
+/* The object to bind "this" to when evaluating javascript in `scopes`. */
+static boost::shared_ptr<scoped_cJSON_t> javascript_receiver(const scopes_t &scopes) {
+    // Figure out whether to bind "this" to the implicit object.
+    boost::shared_ptr<scoped_cJSON_t> object;
+    if (scopes.implicit_attribute_value.has_value()) {
+        object = scopes.implicit_attribute_value.get_value();
+        if (object->type() != cJSON_Object) {
+            // If it's not a JSON object, we have to ignore it ("this"
+            // can't be bound to a non-object).
+            object.reset();
+        }
+    }
+    return object;
+}
+
 boost::shared_ptr<scoped_cJSON_t> eval_term_as_json(Term *t, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace) THROWS_ONLY(interrupted_exc_t, runtime_exc_t, broken_client_exc_t) {
     switch (t->type()) {
     case Term::IMPLICIT_VAR:
@@ -1827,31 +1913,10 @@ boost::shared_ptr<scoped_cJSON_t> eval_term_as_json(Term *t, runtime_environment
         std::vector<boost::shared_ptr<scoped_cJSON_t> > argvals;
         scopes.scope.dump(compiled ? NULL : &argnames, &argvals);
 
-        js::id_t id;
-        if (compiled) {
-            id = t->GetExtension(extension::js_id);
-        } else {
-            // Not compiled yet. Compile it and add the extension.
-            id = js->compile(argnames, t->javascript(), &errmsg);
-            if (js::INVALID_ID == id) {
-                throw runtime_exc_t("failed to compile javascript: " + errmsg, backtrace);
-            }
-            t->SetExtension(extension::js_id, (int32_t) id);
-        }
-
-        // Figure out whether to bind "this" to the implicit object.
-        boost::shared_ptr<scoped_cJSON_t> object;
-        if (scopes.implicit_attribute_value.has_value()) {
-            object = scopes.implicit_attribute_value.get_value();
-            if (object->type() != cJSON_Object) {
-                // If it's not a JSON object, we have to ignore it ("this"
-                // can't be bound to a non-object).
-                object.reset();
-            }
-        }
+        js::id_t id = compile_javascript(t, js.get(), argnames, backtrace);
 
         // Evaluate the source.
-        result = js->call(id, object, argvals, &errmsg);
+        result = js->call(id, javascript_receiver(scopes), argvals, &errmsg);
         if (!result) {
             throw runtime_exc_t("failed to evaluate javascript: " + errmsg, backtrace);
         }
@@ -2512,6 +2577,41 @@ boost::shared_ptr<scoped_cJSON_t> map_rdb(std::string arg, Term *term, runtime_e
     return eval_term_as_json(term, env, scopes_copy, backtrace);
 }
 
+void map_rdb_batch(const std::string &arg, Term *term, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace,
+                   const std::vector<boost::shared_ptr<scoped_cJSON_t> > &vals,
+                   std::vector<boost::shared_ptr<scoped_cJSON_t> > *results_out) {
+    guarantee(term->type() == Term::JAVASCRIPT);
+    results_out->clear();
+    if (vals.empty()) {
+        return;
+    }
+
+    boost::shared_ptr<js::runner_t> js = env->get_js_runner();
+
+    // Bind `arg` to each value in turn, exactly as `map_rdb` does, and
+    // collect the arguments and receiver each call would have gotten.
+    std::vector<std::string> argnames;
+    std::vector<boost::shared_ptr<scoped_cJSON_t> > objects;
+    std::vector<std::vector<boost::shared_ptr<scoped_cJSON_t> > > argvals(vals.size());
+    objects.reserve(vals.size());
+    for (size_t i = 0; i < vals.size(); ++i) {
+        scopes_t scopes_copy = scopes;
+        variable_val_scope_t::new_scope_t scope_maker(&scopes_copy.scope, arg, vals[i]);
+        implicit_value_setter_t impliciter(&scopes_copy.implicit_attribute_value, vals[i]);
+
+        scopes_copy.scope.dump(i == 0 ? &argnames : NULL, &argvals[i]);
+        objects.push_back(javascript_receiver(scopes_copy));
+    }
+
+    js::id_t id = compile_javascript(term, js.get(), argnames, backtrace);
+
+    std::string errmsg;
+    if (!js->call_batch(id, objects, argvals, results_out, &errmsg)) {
+        throw runtime_exc_t("failed to evaluate javascript: " + errmsg, backtrace);
+    }
+    guarantee(results_out->size() == vals.size());
+}
+
 boost::shared_ptr<scoped_cJSON_t> eval_mapping(Mapping m, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace,
                                                boost::shared_ptr<scoped_cJSON_t> val) {
     return map_rdb(m.arg(), m.mutable_body(), env, scopes, backtrace, val);
@@ -2590,9 +2690,11 @@ boost::shared_ptr<json_stream_t> eval_call_as_stream(Term::Call *c, runtime_envi
             {
                 boost::shared_ptr<json_stream_t> stream = eval_term_as_stream(c->mutable_args(0), env, scopes, backtrace.with("arg:0"));
 
-                shared_scoped_less_t comparator(backtrace);
+                /* Table scans drop duplicates on each shard before sending
+                values back; the distinct stream does the exact work. */
+                stream = stream->add_predistinct(env, scopes, backtrace);
 
-                return boost::shared_ptr<json_stream_t>(new distinct_stream_t<shared_scoped_less_t>(stream, comparator));
+                return boost::shared_ptr<json_stream_t>(new distinct_stream_t(stream));
             }
             break;
         case Builtin::SLICE:
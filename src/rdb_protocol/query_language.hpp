@@ -12,6 +12,7 @@
 #include <vector>
 
 #include "utils.hpp"
+#include <boost/function.hpp>
 #include <boost/variant.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -70,6 +71,17 @@ boost::shared_ptr<json_stream_t> eval_call_as_stream(Term::Call *c, runtime_envi
 
 namespace_repo_t<rdb_protocol_t>::access_t eval_table_ref(TableRef *t, runtime_environment_t *, const backtrace_t &backtrace) THROWS_ONLY(interrupted_exc_t, runtime_exc_t, broken_client_exc_t);
 
+/* True if `t` has been type-checked and evaluating it only computes on JSON: it
+doesn't touch any tables or call into javascript. Nothing such a term does
+depends on which thread it's evaluated on. */
+bool term_is_pure(const Term &t);
+
+/* Runs `fun` as stealable work (see arch/runtime/work_stealing.hpp), so that an
+idle thread can take it off this one, and rethrows here whatever it threw.
+`fun` may only evaluate pure terms, and mustn't touch anything else that
+belongs to this thread. */
+void run_stealable_evaluation(const boost::function<void()> &fun) THROWS_ONLY(interrupted_exc_t, runtime_exc_t, broken_client_exc_t);
+
 class view_t {
 public:
     view_t(const namespace_repo_t<rdb_protocol_t>::access_t &_access,
@@ -105,6 +117,12 @@ boost::shared_ptr<scoped_cJSON_t> eval_mapping(Mapping m, runtime_environment_t
 
 boost::shared_ptr<scoped_cJSON_t> map_rdb(std::string arg, Term *term, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace, boost::shared_ptr<scoped_cJSON_t> val);
 
+/* Like `map_rdb` applied to each of `vals`, for a `term` that is a bare
+javascript term. All the calls go to the javascript worker in one round-trip. */
+void map_rdb_batch(const std::string &arg, Term *term, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace,
+                   const std::vector<boost::shared_ptr<scoped_cJSON_t> > &vals,
+                   std::vector<boost::shared_ptr<scoped_cJSON_t> > *results_out);
+
 boost::shared_ptr<json_stream_t> concatmap(std::string arg, Term *term, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace, boost::shared_ptr<scoped_cJSON_t> val);
 
 } //namespace query_language
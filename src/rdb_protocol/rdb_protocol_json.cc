@@ -151,6 +151,69 @@ int json_cmp(cJSON *l, cJSON *r) {
     unreachable();
 }
 
+namespace {
+
+uint64_t hash_mix(uint64_t h, uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+uint64_t hash_bytes(const char *s, size_t len) {
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<uint8_t>(s[i]);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+}  // anonymous namespace
+
+uint64_t json_hash(cJSON *json) {
+    uint64_t h = hash_mix(0, json->type);
+    switch (json->type) {
+        case cJSON_False:
+        case cJSON_True:
+        case cJSON_NULL:
+            return h;
+        case cJSON_Number:
+            {
+                double d = json->valuedouble;
+                if (d == 0) {
+                    d = 0;  // Make -0.0 and 0.0 hash the same, as they compare equal.
+                }
+                uint64_t bits;
+                memcpy(&bits, &d, sizeof(bits));
+                return hash_mix(h, bits);
+            }
+        case cJSON_String:
+            return hash_mix(h, hash_bytes(json->valuestring, strlen(json->valuestring)));
+        case cJSON_Array:
+            {
+                json_iterator_t it(json);
+                while (cJSON *cur = it.next()) {
+                    h = hash_mix(h, json_hash(cur));
+                }
+                return h;
+            }
+        case cJSON_Object:
+            {
+                // Members are combined with a commutative operation so that
+                // their order in the object doesn't matter.
+                uint64_t members = 0;
+                json_iterator_t it(json);
+                while (cJSON *cur = it.next()) {
+                    guarantee(cur->string != NULL, "cJSON object is in a map but has no key set... something has gone wrong with cJSON.");
+                    members += hash_mix(hash_bytes(cur->string, strlen(cur->string)), json_hash(cur));
+                }
+                return hash_mix(h, members);
+            }
+        default:
+            unreachable();
+    }
+}
+
 void require_type(const cJSON *json, int type, const backtrace_t &b) {
     if (json->type != type) {
         throw runtime_exc_t(strprintf("Required type: %s but found %s.",
@@ -4,6 +4,7 @@
 
 #include "errors.hpp"
 #include <boost/shared_ptr.hpp>
+#include <boost/unordered_set.hpp>
 
 #include "rdb_protocol/backtrace.hpp"
 #include "http/json.hpp"
@@ -18,6 +19,11 @@ namespace query_language {
 
 int json_cmp(cJSON *l, cJSON *r);
 
+/* A hash of the JSON value that agrees with `json_cmp`: values that compare
+equal hash equal (object member order doesn't matter, and numbers hash by
+value). */
+uint64_t json_hash(cJSON *json);
+
 class shared_scoped_less_t {
 public:
     shared_scoped_less_t() { }
@@ -30,6 +36,23 @@ private:
     backtrace_t backtrace;
 };
 
+class shared_scoped_hash_t {
+public:
+    size_t operator()(const boost::shared_ptr<scoped_cJSON_t> &json) const {
+        return json_hash(json->get());
+    }
+};
+
+class shared_scoped_equal_t {
+public:
+    bool operator()(const boost::shared_ptr<scoped_cJSON_t> &a,
+                    const boost::shared_ptr<scoped_cJSON_t> &b) const {
+        return json_cmp(a->get(), b->get()) == 0;
+    }
+};
+
+typedef boost::unordered_set<boost::shared_ptr<scoped_cJSON_t>, shared_scoped_hash_t, shared_scoped_equal_t> json_set_t;
+
 void require_type(const cJSON *, int type, const backtrace_t &);
 
 } //namespace query_language
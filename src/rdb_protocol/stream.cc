@@ -5,6 +5,10 @@
 
 namespace query_language {
 
+boost::shared_ptr<json_stream_t> json_stream_t::add_predistinct(UNUSED runtime_environment_t *env, UNUSED const scopes_t &scopes, UNUSED const backtrace_t &backtrace) {
+    return shared_from_this();
+}
+
 boost::shared_ptr<json_stream_t> json_stream_t::add_transformation(const rdb_protocol_details::transform_variant_t &t, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace) {
     rdb_protocol_details::transform_t transform;
     transform.push_back(rdb_protocol_details::transform_atom_t(t, scopes, backtrace));
@@ -46,36 +50,47 @@ transform_stream_t::transform_stream_t(boost::shared_ptr<json_stream_t> _stream,
                                        const rdb_protocol_details::transform_t &tr) :
     stream(_stream),
     env(_env),
-    transform(tr) { }
+    transform(tr),
+    distinct_seen(transform.size()),
+    next_batch_size(TRANSFORM_FIRST_BATCH_SIZE) { }
 
 boost::shared_ptr<scoped_cJSON_t> transform_stream_t::next() {
+    /* Pipelines that call into javascript take a batch of inputs at a time,
+    so that each javascript mapping or filter costs one round-trip to the
+    worker per batch rather than one per row. So do ones that only compute on
+    JSON, so that a batch can be taken by another thread. The batches start
+    small and grow, so that a client that only wants the first few rows doesn't
+    pay for a whole batch. */
+    const size_t max_batch_size = transform_batch_size(transform);
+
     while (data.empty()) {
-        boost::shared_ptr<scoped_cJSON_t> input = stream->next();
-        if (!input) {
+        const size_t batch_size = std::min(next_batch_size, max_batch_size);
+        next_batch_size = std::min(2 * next_batch_size, max_batch_size);
+
+        std::vector<json_list_t> rows;
+        while (rows.size() < batch_size) {
+            boost::shared_ptr<scoped_cJSON_t> input = stream->next();
+            if (!input) {
+                break;
+            }
+            rows.push_back(json_list_t(1, input));
+        }
+        if (rows.empty()) {
             return boost::shared_ptr<scoped_cJSON_t>();
         }
 
-        json_list_t accumulator;
-        accumulator.push_back(input);
-
         //Apply transforms to the data
         typedef rdb_protocol_details::transform_t::iterator tit_t;
+        size_t transform_index = 0;
         for (tit_t it  = transform.begin();
                    it != transform.end();
-                   ++it) {
-            json_list_t tmp;
-            for (json_list_t::iterator jt  = accumulator.begin();
-                                       jt != accumulator.end();
-                                       ++jt) {
-                boost::apply_visitor(transform_visitor_t(*jt, &tmp, env, it->scopes, it->backtrace), it->variant);
-            }
-
-            /* Equivalent to `accumulator = tmp`, but without the extra copying */
-            std::swap(accumulator, tmp);
+                   ++it, ++transform_index) {
+            transform_batch(*it, &rows, env, &distinct_seen[transform_index]);
         }
 
-        /* Equivalent to `data = accumulator`, but without the extra copying */
-        std::swap(data, accumulator);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            data.splice(data.end(), rows[i]);
+        }
     }
 
     boost::shared_ptr<scoped_cJSON_t> res = data.front();
@@ -85,6 +100,7 @@ boost::shared_ptr<scoped_cJSON_t> transform_stream_t::next() {
 
 boost::shared_ptr<json_stream_t> transform_stream_t::add_transformation(const rdb_protocol_details::transform_variant_t &t, UNUSED runtime_environment_t *env2, const scopes_t &scopes, const backtrace_t &backtrace) {
     transform.push_back(rdb_protocol_details::transform_atom_t(t, scopes, backtrace));
+    distinct_seen.resize(transform.size());
     return shared_from_this();
 }
 
@@ -122,6 +138,10 @@ boost::shared_ptr<json_stream_t> batched_rget_stream_t::add_transformation(const
     return shared_from_this();
 }
 
+boost::shared_ptr<json_stream_t> batched_rget_stream_t::add_predistinct(runtime_environment_t *env2, const scopes_t &scopes, const backtrace_t &per_op_backtrace) {
+    return add_transformation(rdb_protocol_details::Distinct(), env2, scopes, per_op_backtrace);
+}
+
 result_t batched_rget_stream_t::apply_terminal(const rdb_protocol_details::terminal_variant_t &t, UNUSED runtime_environment_t *env2, const scopes_t &scopes, const backtrace_t &per_op_backtrace) {
     rdb_protocol_t::region_t region(range);
     rdb_protocol_t::rget_read_t rget_read(region);
@@ -212,4 +232,26 @@ boost::shared_ptr<json_stream_t> union_stream_t::add_transformation(const rdb_pr
     return shared_from_this();
 }
 
+boost::shared_ptr<json_stream_t> union_stream_t::add_predistinct(runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace) {
+    for (stream_list_t::iterator it  = streams.begin();
+                                 it != streams.end();
+                                 ++it) {
+        *it = (*it)->add_predistinct(env, scopes, backtrace);
+    }
+    return shared_from_this();
+}
+
+distinct_stream_t::distinct_stream_t(boost::shared_ptr<json_stream_t> _stream)
+    : stream(_stream)
+{ }
+
+boost::shared_ptr<scoped_cJSON_t> distinct_stream_t::next() {
+    while (boost::shared_ptr<scoped_cJSON_t> json = stream->next()) {
+        if (seen.insert(json).second) { // was this not already present?
+            return json;
+        }
+    }
+    return boost::shared_ptr<scoped_cJSON_t>();
+}
+
 } //namespace query_language 
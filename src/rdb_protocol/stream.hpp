@@ -4,7 +4,6 @@
 
 #include <algorithm>
 #include <list>
-#include <set>
 #include <string>
 #include <vector>
 
@@ -34,6 +33,9 @@ public:
     json_stream_t() { }
     virtual boost::shared_ptr<scoped_cJSON_t> next() = 0; //MAY THROW
     virtual MUST_USE boost::shared_ptr<json_stream_t> add_transformation(const rdb_protocol_details::transform_variant_t &, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace);
+    /* Lets the stream drop duplicate values early where that's cheap, e.g. on
+    the shards of a table scan. The result may still contain duplicates. */
+    virtual MUST_USE boost::shared_ptr<json_stream_t> add_predistinct(runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace);
     virtual result_t apply_terminal(const rdb_protocol_details::terminal_variant_t &, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace);
 
     virtual ~json_stream_t() { }
@@ -78,7 +80,11 @@ private:
     boost::shared_ptr<json_stream_t> stream;
     runtime_environment_t *env;
     rdb_protocol_details::transform_t transform;
+    std::vector<json_set_t> distinct_seen;
     json_list_t data;
+    // How many rows the next batch takes, before capping it at
+    // `transform_batch_size()`.
+    size_t next_batch_size;
 };
 
 class batched_rget_stream_t : public json_stream_t {
@@ -91,6 +97,7 @@ public:
     boost::shared_ptr<scoped_cJSON_t> next();
 
     boost::shared_ptr<json_stream_t> add_transformation(const rdb_protocol_details::transform_variant_t &t, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace);
+    boost::shared_ptr<json_stream_t> add_predistinct(runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace);
     result_t apply_terminal(const rdb_protocol_details::terminal_variant_t &t, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace);
 
     virtual void reset_interruptor(signal_t *new_interruptor) {
@@ -123,6 +130,7 @@ public:
     boost::shared_ptr<scoped_cJSON_t> next();
 
     boost::shared_ptr<json_stream_t> add_transformation(const rdb_protocol_details::transform_variant_t &, runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace);
+    boost::shared_ptr<json_stream_t> add_predistinct(runtime_environment_t *env, const scopes_t &scopes, const backtrace_t &backtrace);
 
     /* TODO: Maybe we can optimize `apply_terminal()`. */
 
@@ -131,26 +139,17 @@ private:
     stream_list_t::iterator hd;
 };
 
-template <class C>
+/* Lets through the first occurrence of each value, tracking the values seen so
+far in a hash set keyed on `json_hash`. */
 class distinct_stream_t : public json_stream_t {
 public:
-    typedef boost::function<bool(boost::shared_ptr<scoped_cJSON_t>)> predicate;  // NOLINT
-    distinct_stream_t(boost::shared_ptr<json_stream_t> _stream, const C &_c)
-        : stream(_stream), seen(_c)
-    { }
+    explicit distinct_stream_t(boost::shared_ptr<json_stream_t> _stream);
 
-    boost::shared_ptr<scoped_cJSON_t> next() {
-        while (boost::shared_ptr<scoped_cJSON_t> json = stream->next()) {
-            if (seen.insert(json).second) { // was this not already present?
-                return json;
-            }
-        }
-        return boost::shared_ptr<scoped_cJSON_t>();
-    }
+    boost::shared_ptr<scoped_cJSON_t> next();
 
 private:
     boost::shared_ptr<json_stream_t> stream;
-    std::set<boost::shared_ptr<scoped_cJSON_t>, C> seen;
+    json_set_t seen;
 };
 
 class slice_stream_t : public json_stream_t {
@@ -1,7 +1,38 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "rdb_protocol/stream_cache.hpp"
+
+#include <stdexcept>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "concurrency/wait_any.hpp"
 #include "rdb_protocol/exceptions.hpp"
 #include "rdb_protocol/stream.hpp"
-#include "rdb_protocol/stream_cache.hpp"
+
+int64_t stream_cache_t::total_prefetched_bytes = 0;
+
+/* Holds a copy of whatever a prefetch caught, so that it can be thrown again,
+with its type, from `serve`. */
+class stream_cache_t::prefetch_error_t {
+public:
+    virtual ~prefetch_error_t() { }
+    virtual void rethrow() const = 0;
+};
+
+template <class exc_t>
+class stream_cache_t::typed_prefetch_error_t : public stream_cache_t::prefetch_error_t {
+public:
+    explicit typed_prefetch_error_t(const exc_t &_exc) : exc(_exc) { }
+    void rethrow() const {
+        throw exc;
+    }
+private:
+    exc_t exc;
+};
+
+stream_cache_t::stream_cache_t() { }
 
 bool stream_cache_t::contains(int64_t key) {
     return streams.find(key) != streams.end();
@@ -10,29 +41,73 @@ bool stream_cache_t::contains(int64_t key) {
 void stream_cache_t::insert(ReadQuery *r, int64_t key,
                             boost::shared_ptr<query_language::json_stream_t> val) {
     maybe_evict();
-    std::pair<std::map<int64_t, entry_t>::iterator, bool> res = streams.insert(std::pair<int64_t, entry_t>(key, entry_t(time(0), val, r)));
+    boost::shared_ptr<entry_t> entry(new entry_t(time(0), val, r));
+    std::pair<std::map<int64_t, boost::shared_ptr<entry_t> >::iterator, bool> res = streams.insert(std::make_pair(key, entry));
     guarantee(res.second);
 }
 
 void stream_cache_t::erase(int64_t key) {
-    size_t num_erased = streams.erase(key);
-    guarantee(num_erased == 1);
+    std::map<int64_t, boost::shared_ptr<entry_t> >::iterator it = streams.find(key);
+    guarantee(it != streams.end());
+    __sync_sub_and_fetch(&total_prefetched_bytes, it->second->prefetched_bytes);
+    streams.erase(it);
 }
 
 bool stream_cache_t::serve(int64_t key, Response *res, signal_t *interruptor) {
-    std::map<int64_t, entry_t>::iterator it = streams.find(key);
+    std::map<int64_t, boost::shared_ptr<entry_t> >::iterator it = streams.find(key);
     if (it == streams.end()) return false;
-    entry_t *entry = &it->second;
+    // Keeps the entry alive while we wait for a prefetch to hand over the stream.
+    boost::shared_ptr<entry_t> entry = it->second;
     entry->last_activity = time(0);
+    entry->adapt_chunk_bytes(get_ticks());
     try {
+        entry->serve_waiting = true;
+        if (boost::shared_ptr<cond_t> prefetch_done = entry->prefetch_done) {
+            /* A read in progress can't be cut short without losing it, but
+            the client shouldn't have to wait for it if it goes away. */
+            try {
+                wait_interruptible(prefetch_done.get(), interruptor);
+            } catch (const interrupted_exc_t &) {
+                entry->serve_waiting = false;
+                throw;
+            }
+        }
+        mutex_t::acq_t stream_acq(&entry->stream_mutex);
+        entry->serve_waiting = false;
+
         int chunk_size = 0;
+        size_t chunk_bytes = 0;
         // This is a hack.  Some streams have an interruptor that is invalid by
         // the time we reach here, so we just reset it to a good one.
         entry->stream->reset_interruptor(interruptor);
-        while (boost::shared_ptr<scoped_cJSON_t> json = entry->stream->next()) {
-            res->add_response(json->PrintUnformatted());
-            if (entry->max_chunk_size && ++chunk_size >= entry->max_chunk_size) {
+        for (;;) {
+            if (!entry->prefetched.empty()) {
+                const std::string &json = entry->prefetched.front();
+                chunk_bytes += json.size();
+                entry->prefetched_bytes -= json.size();
+                __sync_sub_and_fetch(&total_prefetched_bytes, json.size());
+                res->add_response(json);
+                entry->prefetched.pop_front();
+            } else if (entry->prefetch_error) {
+                entry->prefetch_error->rethrow();
+            } else if (entry->exhausted) {
+                break;
+            } else if (boost::shared_ptr<scoped_cJSON_t> json = entry->stream->next()) {
+                std::string printed = json->PrintUnformatted();
+                chunk_bytes += printed.size();
+                res->add_response(printed);
+            } else {
+                entry->exhausted = true;
+                break;
+            }
+
+            if ((entry->max_chunk_size && ++chunk_size >= entry->max_chunk_size) ||
+                chunk_bytes >= entry->chunk_bytes) {
                 res->set_status_code(Response::SUCCESS_PARTIAL);
+                entry->last_served = get_ticks();
+                entry->prefetch_done.reset(new cond_t);
+                coro_t::spawn_sometime(boost::bind(&stream_cache_t::prefetch, this, entry.get(),
+                                                   auto_drainer_t::lock_t(&entry->drainer)));
                 return true;
             }
         }
@@ -45,14 +120,55 @@ bool stream_cache_t::serve(int64_t key, Response *res, signal_t *interruptor) {
     return true;
 }
 
+void stream_cache_t::prefetch(entry_t *entry, auto_drainer_t::lock_t keepalive) {
+    boost::shared_ptr<cond_t> done = entry->prefetch_done;
+    mutex_t::acq_t stream_acq(&entry->stream_mutex);
+    signal_t *drain_signal = keepalive.get_drain_signal();
+    entry->stream->reset_interruptor(drain_signal);
+    try {
+        while (!entry->exhausted &&
+               !entry->serve_waiting &&
+               !drain_signal->is_pulsed() &&
+               entry->prefetched_bytes < entry->chunk_bytes &&
+               total_prefetched_bytes < MAX_PREFETCHED_BYTES) {
+            boost::shared_ptr<scoped_cJSON_t> json = entry->stream->next();
+            if (drain_signal->is_pulsed()) {
+                // The entry has been erased; don't account for anything more.
+                break;
+            } else if (!json) {
+                entry->exhausted = true;
+                break;
+            }
+            entry->prefetched.push_back(json->PrintUnformatted());
+            entry->prefetched_bytes += entry->prefetched.back().size();
+            __sync_add_and_fetch(&total_prefetched_bytes, entry->prefetched.back().size());
+        }
+    } catch (const interrupted_exc_t &) {
+        /* Either the entry is going away or the stream gave up; `serve` will
+        retry the stream with the client's interruptor. */
+    } catch (const query_language::runtime_exc_t &e) {
+        entry->prefetch_error.reset(new typed_prefetch_error_t<query_language::runtime_exc_t>(e));
+    } catch (const query_language::bad_query_exc_t &e) {
+        entry->prefetch_error.reset(new typed_prefetch_error_t<query_language::bad_query_exc_t>(e));
+    } catch (const query_language::broken_client_exc_t &e) {
+        entry->prefetch_error.reset(new typed_prefetch_error_t<query_language::broken_client_exc_t>(e));
+    } catch (const std::exception &e) {
+        /* Nothing else may escape a coroutine nobody is waiting on. The client
+        gets this when it asks for the results that weren't prefetched, the same
+        as if `serve` had run into it. */
+        entry->prefetch_error.reset(new typed_prefetch_error_t<std::runtime_error>(std::runtime_error(e.what())));
+    }
+    done->pulse();
+}
+
 void stream_cache_t::maybe_evict() {
     time_t cur_time = time(0);
-    std::map<int64_t, entry_t>::iterator it_old, it = streams.begin();
+    std::map<int64_t, boost::shared_ptr<entry_t> >::iterator it_old, it = streams.begin();
     while (it != streams.end()) {
         it_old = it++;
-        entry_t *entry = &it_old->second;
+        entry_t *entry = it_old->second.get();
         if (entry->max_age && cur_time - entry->last_activity > entry->max_age) {
-            streams.erase(it_old);
+            erase(it_old->first);
         }
     }
 }
@@ -67,8 +183,10 @@ bool valid_age(int64_t age) { return 0 <= age; }
 stream_cache_t::entry_t::entry_t(time_t _last_activity,
                                  boost::shared_ptr<query_language::json_stream_t> _stream,
                                  ReadQuery *r)
-    : last_activity(_last_activity), stream(_stream),
-      max_chunk_size(DEFAULT_MAX_CHUNK_SIZE), max_age(DEFAULT_MAX_AGE) {
+    : last_activity(_last_activity), last_served(get_ticks()), stream(_stream),
+      max_chunk_size(DEFAULT_MAX_CHUNK_SIZE), max_age(DEFAULT_MAX_AGE),
+      chunk_bytes(DEFAULT_CHUNK_BYTES), prefetched_bytes(0), exhausted(false),
+      serve_waiting(false) {
     if (r) {
         if (r->has_max_chunk_size() && valid_chunk_size(r->max_chunk_size())) {
             max_chunk_size = r->max_chunk_size();
@@ -78,3 +196,17 @@ stream_cache_t::entry_t::entry_t(time_t _last_activity,
         }
     }
 }
+
+void stream_cache_t::entry_t::adapt_chunk_bytes(ticks_t now) {
+    /* A client that comes straight back drained its last chunk faster than we
+    could prefetch the next one, so we fetch more at a time. A client that
+    takes its time doesn't need as much sitting around in memory. */
+    const ticks_t fast = secs_to_ticks(1) / 100;
+    const ticks_t slow = secs_to_ticks(1);
+    ticks_t elapsed = now - last_served;
+    if (elapsed < fast) {
+        chunk_bytes = chunk_bytes * 2 < MAX_CHUNK_BYTES ? chunk_bytes * 2 : MAX_CHUNK_BYTES;
+    } else if (elapsed > slow) {
+        chunk_bytes = chunk_bytes / 2 > MIN_CHUNK_BYTES ? chunk_bytes / 2 : MIN_CHUNK_BYTES;
+    }
+}
@@ -4,11 +4,18 @@
 
 #include <time.h>
 
+#include <deque>
 #include <map>
+#include <string>
 
 #include "utils.hpp"
 #include <boost/shared_ptr.hpp>
 
+#include "config/args.hpp"
+#include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
+#include "concurrency/mutex.hpp"
+#include "rdb_protocol/exceptions.hpp"
 #include "rdb_protocol/rdb_protocol_json.hpp"
 #include "rdb_protocol/query_language.pb.h"
 
@@ -16,28 +23,84 @@ namespace query_language {
 class json_stream_t;
 }
 
+/* Holds the streams that clients are reading with CONTINUE. After serving a
+chunk, the cache prefetches the next one in the background so the following
+CONTINUE doesn't have to wait for a round of shard reads. Chunks are sized in
+bytes, and the size adapts to how quickly the client comes back for more.
+Prefetched results held by all the caches in the process together are bounded
+by `MAX_PREFETCHED_BYTES`; past that, streams aren't prefetched until the
+clients have taken some of them. */
 class stream_cache_t {
 public:
+    stream_cache_t();
+
     // TODO: Uses of contains can all just try insert or erase and look at return codes.
     bool contains(int64_t key);
     void insert(ReadQuery *r, int64_t key, boost::shared_ptr<query_language::json_stream_t> val);
     void erase(int64_t key);
     bool serve(int64_t key, Response *res, signal_t *interruptor);
 private:
+    class entry_t;
+    class prefetch_error_t;
+    template <class exc_t> class typed_prefetch_error_t;
+
     void maybe_evict();
+    void prefetch(entry_t *entry, auto_drainer_t::lock_t keepalive);
 
-    struct entry_t {
+    // The most bytes of prefetched results held by all the caches together.
+    static const int64_t MAX_PREFETCHED_BYTES = 32 * MEGABYTE;
+    // How many bytes of prefetched results all the caches hold. Caches on
+    // different threads update it, so it is only changed with `__sync` builtins.
+    static int64_t total_prefetched_bytes;
+
+    class entry_t {
+    public:
         static const int DEFAULT_MAX_CHUNK_SIZE = 1000; // 0 = unbounded
         static const time_t DEFAULT_MAX_AGE = 0; // 0 = never evict
+        static const size_t MIN_CHUNK_BYTES = 16 * KILOBYTE;
+        static const size_t DEFAULT_CHUNK_BYTES = 256 * KILOBYTE;
+        static const size_t MAX_CHUNK_BYTES = 4 * MEGABYTE;
         entry_t(time_t _last_activity,
                 boost::shared_ptr<query_language::json_stream_t> _stream,
                 ReadQuery *r);
+
+        // Grows or shrinks `chunk_bytes` depending on how long the client took
+        // to come back for the chunk it's asking for now.
+        void adapt_chunk_bytes(ticks_t now);
+
         time_t last_activity;
+        ticks_t last_served;
         boost::shared_ptr<query_language::json_stream_t> stream;
         int max_chunk_size; //Size of 0 = unlimited
         time_t max_age;
+        size_t chunk_bytes;
+
+        // Results pulled from `stream` ahead of the client asking for them.
+        std::deque<std::string> prefetched;
+        size_t prefetched_bytes;
+        bool exhausted;
+        // An error hit while prefetching. It's rethrown to the client after
+        // the results that came before it.
+        boost::shared_ptr<prefetch_error_t> prefetch_error;
+
+        // Held by whoever is pulling from `stream`.
+        mutex_t stream_mutex;
+        // Set while `serve` waits for `stream_mutex` so that a prefetch in
+        // progress hands it over early.
+        bool serve_waiting;
+        // Pulsed when the most recently spawned prefetch is done with the
+        // stream. `serve` waits for it, rather than for `stream_mutex`, so
+        // that the wait can be interrupted. Shared so that a waiter can
+        // outlive the prefetch.
+        boost::shared_ptr<cond_t> prefetch_done;
+
+        // Destroyed first, so that a prefetch in progress is stopped before
+        // the rest of the entry goes away.
+        auto_drainer_t drainer;
+    private:
+        DISABLE_COPYING(entry_t);
     };
-    std::map<int64_t, entry_t> streams;
+    std::map<int64_t, boost::shared_ptr<entry_t> > streams;
 };
 
 #endif  // RDB_PROTOCOL_STREAM_CACHE_HPP_
@@ -1,12 +1,16 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "rdb_protocol/transform_visitors.hpp"
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
 #include "rdb_protocol/query_language.hpp"
 
 
 namespace query_language {
 
-transform_visitor_t::transform_visitor_t(boost::shared_ptr<scoped_cJSON_t> _json, json_list_t *_out, query_language::runtime_environment_t *_env, const scopes_t &_scopes, const backtrace_t &_backtrace)
-    : json(_json), out(_out), env(_env), scopes(_scopes), backtrace(_backtrace)
+transform_visitor_t::transform_visitor_t(boost::shared_ptr<scoped_cJSON_t> _json, json_list_t *_out, query_language::runtime_environment_t *_env, const scopes_t &_scopes, const backtrace_t &_backtrace, json_set_t *_seen)
+    : json(_json), out(_out), env(_env), scopes(_scopes), backtrace(_backtrace), seen(_seen)
 { }
 
 void transform_visitor_t::operator()(const Builtin_Filter &filter) const {
@@ -62,6 +66,162 @@ void transform_visitor_t::operator()(Builtin_Range range) const {
     }
 }
 
+void transform_visitor_t::operator()(const rdb_protocol_details::Distinct &) const {
+    guarantee(seen);
+    if (seen->find(json) != seen->end()) {
+        return;
+    }
+    if (seen->size() < DISTINCT_PREFILTER_MAX_VALUES) {
+        seen->insert(json);
+    }
+    out->push_back(json);
+}
+
+/* If `variant` is a mapping or filter whose body is a bare javascript term,
+returns that body and sets `arg_out` and `is_filter_out`. Returns NULL
+otherwise. */
+static const Term *javascript_body(const rdb_protocol_details::transform_variant_t &variant,
+                                   std::string *arg_out, bool *is_filter_out) {
+    if (const Mapping *mapping = boost::get<Mapping>(&variant)) {
+        if (mapping->body().type() == Term::JAVASCRIPT) {
+            *arg_out = mapping->arg();
+            *is_filter_out = false;
+            return &mapping->body();
+        }
+    } else if (const Builtin_Filter *filter = boost::get<Builtin_Filter>(&variant)) {
+        if (filter->predicate().body().type() == Term::JAVASCRIPT) {
+            *arg_out = filter->predicate().arg();
+            *is_filter_out = true;
+            return &filter->predicate().body();
+        }
+    }
+    return NULL;
+}
+
+bool transform_has_javascript(const rdb_protocol_details::transform_t &transform) {
+    for (rdb_protocol_details::transform_t::const_iterator it = transform.begin();
+         it != transform.end();
+         ++it) {
+        std::string arg;
+        bool is_filter;
+        if (javascript_body(it->variant, &arg, &is_filter)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* True if applying `variant` only computes on JSON. */
+static bool transform_is_pure(const rdb_protocol_details::transform_variant_t &variant) {
+    if (const Mapping *mapping = boost::get<Mapping>(&variant)) {
+        return term_is_pure(mapping->body());
+    } else if (const Builtin_Filter *filter = boost::get<Builtin_Filter>(&variant)) {
+        return term_is_pure(filter->predicate().body());
+    } else if (const Builtin_ConcatMap *concatmap = boost::get<Builtin_ConcatMap>(&variant)) {
+        return term_is_pure(concatmap->mapping().body());
+    } else if (const Builtin_Range *range = boost::get<Builtin_Range>(&variant)) {
+        return (!range->has_lowerbound() || term_is_pure(range->lowerbound())) &&
+               (!range->has_upperbound() || term_is_pure(range->upperbound()));
+    } else {
+        return boost::get<rdb_protocol_details::Distinct>(&variant) != NULL;
+    }
+}
+
+size_t transform_batch_size(const rdb_protocol_details::transform_t &transform) {
+    if (transform_has_javascript(transform)) {
+        return JS_TRANSFORM_BATCH_SIZE;
+    }
+    for (rdb_protocol_details::transform_t::const_iterator it = transform.begin();
+         it != transform.end();
+         ++it) {
+        if (transform_is_pure(it->variant)) {
+            return PURE_TRANSFORM_BATCH_SIZE;
+        }
+    }
+    return 1;
+}
+
+static void visit_batch(const rdb_protocol_details::transform_atom_t *atom,
+                        std::vector<json_list_t> *rows,
+                        query_language::runtime_environment_t *env,
+                        json_set_t *seen) {
+    for (size_t i = 0; i < rows->size(); ++i) {
+        json_list_t tmp;
+        for (json_list_t::iterator jt  = (*rows)[i].begin();
+                                   jt != (*rows)[i].end();
+                                   ++jt) {
+            boost::apply_visitor(transform_visitor_t(*jt, &tmp, env, atom->scopes, atom->backtrace, seen), atom->variant);
+        }
+        std::swap((*rows)[i], tmp);
+    }
+}
+
+void transform_batch(const rdb_protocol_details::transform_atom_t &atom,
+                     std::vector<json_list_t> *rows,
+                     query_language::runtime_environment_t *env,
+                     json_set_t *seen) {
+    std::string arg;
+    bool is_filter;
+    const Term *js_body = javascript_body(atom.variant, &arg, &is_filter);
+
+    if (!js_body) {
+        if (rows->size() >= PURE_TRANSFORM_STEALABLE_ROWS && transform_is_pure(atom.variant)) {
+            run_stealable_evaluation(boost::bind(&visit_batch, &atom, rows, env, seen));
+        } else {
+            visit_batch(&atom, rows, env, seen);
+        }
+        return;
+    }
+
+    std::vector<boost::shared_ptr<scoped_cJSON_t> > vals;
+    for (size_t i = 0; i < rows->size(); ++i) {
+        vals.insert(vals.end(), (*rows)[i].begin(), (*rows)[i].end());
+    }
+
+    Term body = *js_body;
+    std::vector<boost::shared_ptr<scoped_cJSON_t> > results;
+    map_rdb_batch(arg, &body, env, atom.scopes, atom.backtrace, vals, &results);
+
+    size_t k = 0;
+    for (size_t i = 0; i < rows->size(); ++i) {
+        json_list_t tmp;
+        for (json_list_t::iterator jt  = (*rows)[i].begin();
+                                   jt != (*rows)[i].end();
+                                   ++jt, ++k) {
+            if (!is_filter) {
+                tmp.push_back(results[k]);
+            } else if (results[k]->type() == cJSON_True) {
+                tmp.push_back(*jt);
+            } else if (results[k]->type() != cJSON_False) {
+                throw runtime_exc_t("Predicate failed to evaluate to a bool", atom.backtrace);
+            }
+        }
+        std::swap((*rows)[i], tmp);
+    }
+    guarantee(k == results.size());
+}
+
+void reduce_into_group(const Reduction &reduction,
+                       const boost::shared_ptr<scoped_cJSON_t> &group,
+                       const boost::shared_ptr<scoped_cJSON_t> &value,
+                       query_language::runtime_environment_t *env,
+                       const scopes_t &scopes,
+                       const backtrace_t &backtrace,
+                       rget_read_response_t::groups_t *groups) {
+    rget_read_response_t::groups_t::iterator it = groups->lower_bound(group);
+    if (it == groups->end() || groups->key_comp()(group, it->first)) {
+        Term base = reduction.base();
+        it = groups->insert(it, std::make_pair(group, eval_term_as_json(&base, env, scopes, backtrace.with("base"))));
+    }
+
+    Term body = reduction.body();
+    scopes_t scopes_copy = scopes;
+    new_val_scope_t inner_scope(&scopes_copy.scope);
+    scopes_copy.scope.put_in_scope(reduction.var1(), it->second);
+    scopes_copy.scope.put_in_scope(reduction.var2(), value);
+    it->second = eval_term_as_json(&body, env, scopes_copy, backtrace.with("body"));
+}
+
 terminal_initializer_visitor_t::terminal_initializer_visitor_t(rget_read_response_t::result_t *_out,
                                                                query_language::runtime_environment_t *_env,
                                                                const scopes_t &_scopes,
@@ -116,16 +276,7 @@ void terminal_visitor_t::operator()(const Builtin_GroupedMapReduce &gmr) const {
     }
 
     //Finally reduce it in
-    {
-        Term base = gmr.reduction().base(),
-             body = gmr.reduction().body();
-
-        scopes_t scopes_copy = scopes;
-        new_val_scope_t inner_scope(&scopes_copy.scope);
-        scopes_copy.scope.put_in_scope(gmr.reduction().var1(), res_groups->insert(std::make_pair(grouping, eval_term_as_json(&base, env, scopes, backtrace.with("reduction").with("base")))).first->second);
-        scopes_copy.scope.put_in_scope(gmr.reduction().var2(), mapped_value);
-        (*res_groups)[grouping] = eval_term_as_json(&body, env, scopes_copy, backtrace.with("reduction").with("body"));
-    }
+    reduce_into_group(gmr.reduction(), grouping, mapped_value, env, scopes, backtrace.with("reduction"), res_groups);
 }
 
 void terminal_visitor_t::operator()(const Reduction &r) const {
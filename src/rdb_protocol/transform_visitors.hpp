@@ -3,6 +3,7 @@
 #define RDB_PROTOCOL_TRANSFORM_VISITORS_HPP_
 
 #include <list>
+#include <vector>
 
 #include "errors.hpp"
 #include <boost/shared_ptr.hpp>
@@ -20,10 +21,17 @@ class runtime_environment_t;
 
 typedef std::list<boost::shared_ptr<scoped_cJSON_t> > json_list_t;
 
-/* A visitor for applying a transformation to a bit of json. */
+/* The most values a `Distinct` transformation remembers in one pass. Values
+past this are passed through unfiltered; `Builtin::DISTINCT` does the exact
+deduplication after the pass. */
+const size_t DISTINCT_PREFILTER_MAX_VALUES = 100000;
+
+/* A visitor for applying a transformation to a bit of json. `_seen` holds the
+values a `Distinct` transformation has already let through in this pass, and
+may be NULL for all other transformations. */
 class transform_visitor_t : public boost::static_visitor<void> {
 public:
-    transform_visitor_t(boost::shared_ptr<scoped_cJSON_t> _json, json_list_t *_out, query_language::runtime_environment_t *_env, const scopes_t &_scopes, const backtrace_t &_backtrace);
+    transform_visitor_t(boost::shared_ptr<scoped_cJSON_t> _json, json_list_t *_out, query_language::runtime_environment_t *_env, const scopes_t &_scopes, const backtrace_t &_backtrace, json_set_t *_seen = NULL);
 
     void operator()(const Builtin_Filter &filter) const;
 
@@ -33,14 +41,63 @@ public:
 
     void operator()(Builtin_Range range) const;
 
+    void operator()(const rdb_protocol_details::Distinct &) const;
+
 private:
     boost::shared_ptr<scoped_cJSON_t> json;
     json_list_t *out;
     query_language::runtime_environment_t *env;
     scopes_t scopes;
     backtrace_t backtrace;
+    json_set_t *seen;
 };
 
+/* How many rows a transformation pipeline that calls into javascript pushes
+through each transformation at once. */
+const size_t JS_TRANSFORM_BATCH_SIZE = 100;
+
+/* The same, for pipelines that have transformations which only compute on
+JSON, and batches of at least how many rows such a transformation is applied to
+as stealable work (see `run_stealable_evaluation()`). */
+const size_t PURE_TRANSFORM_BATCH_SIZE = 100;
+const size_t PURE_TRANSFORM_STEALABLE_ROWS = 16;
+
+/* A stream that batches its rows starts with batches this big, and doubles them
+up to `transform_batch_size()`, so that the first rows don't wait for a whole
+batch to be read and transformed. */
+const size_t TRANSFORM_FIRST_BATCH_SIZE = 4;
+
+/* True if some mapping or filter in `transform` has a bare javascript term as
+its body. Such pipelines are worth running with `transform_batch`. */
+bool transform_has_javascript(const rdb_protocol_details::transform_t &transform);
+
+/* How many rows at a time are worth pushing through `transform` with
+`transform_batch`: a batch if it calls into javascript or has transformations
+that can be run as stealable work, and otherwise one. */
+size_t transform_batch_size(const rdb_protocol_details::transform_t &transform);
+
+/* Applies one transformation to a batch of rows. `(*rows)[i]` holds what the
+i'th row has been transformed into so far, and is replaced with what `atom`
+makes of it. A mapping or filter whose body is a bare javascript term is
+evaluated for the whole batch in one round-trip to the javascript worker;
+anything else is applied value by value with `transform_visitor_t`, as
+stealable work if it only computes on JSON and the batch is big enough. */
+void transform_batch(const rdb_protocol_details::transform_atom_t &atom,
+                     std::vector<json_list_t> *rows,
+                     query_language::runtime_environment_t *env,
+                     json_set_t *seen);
+
+/* Folds `value` into the running reduction for `group`. The reduction's base
+is only evaluated the first time a group is seen. This is the combine step
+shared by the shard-side terminal and by the merge of shard results. */
+void reduce_into_group(const Reduction &reduction,
+                       const boost::shared_ptr<scoped_cJSON_t> &group,
+                       const boost::shared_ptr<scoped_cJSON_t> &value,
+                       query_language::runtime_environment_t *env,
+                       const scopes_t &scopes,
+                       const backtrace_t &backtrace,
+                       rget_read_response_t::groups_t *groups);
+
 /* A visitor for setting the result type based on a terminal. */
 class terminal_initializer_visitor_t : public boost::static_visitor<void> {
 public:
@@ -19,6 +19,50 @@
 const std::string connectivity_cluster_t::cluster_proto_header("RethinkDB cluster\n");
 const std::string connectivity_cluster_t::cluster_version(RETHINKDB_CODE_VERSION);
 
+/* How long we wait for a peer's extra lanes to be opened before giving up on
+the connection. */
+static const int64_t LANE_SETUP_TIMEOUT_MS = 10000;
+
+/* A lane's flusher writes at most about this much at a time, so that a message
+that gets queued mid-flush only waits for one batch to go out ahead of it. */
+static const int64_t MAX_SEND_BATCH_BYTES = 256 * KILOBYTE;
+
+/* Each round of the deficit round robin, a class with messages waiting gets to
+send `weight * SEND_QUANTUM_BYTES` more bytes. Control messages don't take part;
+they always go first. */
+static const int64_t SEND_QUANTUM_BYTES = 4 * KILOBYTE;
+static const int64_t send_priority_weights[NUM_MESSAGE_PRIORITIES] = {
+    0,  // MESSAGE_PRIORITY_CONTROL
+    8,  // MESSAGE_PRIORITY_QUERY
+    4,  // MESSAGE_PRIORITY_METADATA
+    1   // MESSAGE_PRIORITY_BULK
+};
+
+static bool should_compress(cluster_compression_t compression, message_priority_t priority, size_t size) {
+    if (size < MIN_COMPRESSED_MESSAGE_SIZE) {
+        return false;
+    }
+    switch (compression) {
+    case CLUSTER_COMPRESSION_NONE: return false;
+    case CLUSTER_COMPRESSION_BULK: return priority == MESSAGE_PRIORITY_BULK;
+    case CLUSTER_COMPRESSION_ALL: return priority != MESSAGE_PRIORITY_CONTROL;
+    default: unreachable();
+    }
+}
+
+static const char *message_priority_name(message_priority_t priority) {
+    switch (priority) {
+    case MESSAGE_PRIORITY_CONTROL: return "control";
+    case MESSAGE_PRIORITY_QUERY: return "query";
+    case MESSAGE_PRIORITY_METADATA: return "metadata";
+    case MESSAGE_PRIORITY_BULK: return "bulk";
+    case MESSAGE_PRIORITY_DEFAULT:
+    case NUM_MESSAGE_PRIORITIES:
+    default:
+        unreachable();
+    }
+}
+
 #if defined (__x86_64__)
 const std::string connectivity_cluster_t::cluster_arch_bitsize("64bit");
 #elif defined (__i386__)
@@ -50,9 +94,13 @@ connectivity_cluster_t::run_t::run_t(connectivity_cluster_t *p,
                                      int port,
                                      message_handler_t *mh,
                                      int client_port,
-                                     heartbeat_manager_t *_heartbeat_manager) THROWS_ONLY(address_in_use_exc_t) :
+                                     heartbeat_manager_t *_heartbeat_manager,
+                                     int _lanes_per_peer,
+                                     cluster_compression_t _compression) THROWS_ONLY(address_in_use_exc_t) :
     parent(p),
     message_handler(mh),
+    lanes_per_peer(_lanes_per_peer),
+    compression(_compression),
     heartbeat_manager(_heartbeat_manager),
 
     /* Create the socket to use when listening for connections from peers */
@@ -83,13 +131,14 @@ connectivity_cluster_t::run_t::run_t(connectivity_cluster_t *p,
     `connection_map` on each thread and notifying any listeners that we're now
     connected to ourself. The destructor will remove us from the
     `connection_map` and again notify any listeners. */
-    connection_to_ourself(this, parent->me, NULL, routing_table[parent->me]),
+    connection_to_ourself(this, parent->me, NULL, std::vector<lane_t *>(), routing_table[parent->me], CLUSTER_COMPRESSION_NONE),
 
     listener(new tcp_listener_t(cluster_listener_socket.get(),
                                 boost::bind(&connectivity_cluster_t::run_t::on_new_connection,
                                             this, _1, auto_drainer_t::lock_t(&drainer))))
 {
     parent->assert_thread();
+    guarantee(lanes_per_peer >= 1);
 }
 
 connectivity_cluster_t::run_t::~run_t() { }
@@ -109,12 +158,132 @@ void connectivity_cluster_t::run_t::join(peer_address_t address) THROWS_NOTHING
         auto_drainer_t::lock_t(&drainer)));
 }
 
-connectivity_cluster_t::run_t::connection_entry_t::connection_entry_t(run_t *p, peer_id_t id, tcp_conn_stream_t *c, peer_address_t a) THROWS_NOTHING :
-    conn(c), address(a), session_id(generate_uuid()),
+connectivity_cluster_t::run_t::lane_t::lane_t(tcp_conn_stream_t *c) :
+    conn(c), flusher_running(false) {
+    rassert(conn->home_thread() == get_thread_id());
+    for (int p = 0; p < NUM_MESSAGE_PRIORITIES; ++p) {
+        send_deficits[p] = 0;
+    }
+}
+
+connectivity_cluster_t::run_t::lane_t::~lane_t() {
+    /* Whoever sent the messages in `send_queues` was holding a lock on the
+    `connection_entry_t`, which is gone by now. The flusher itself may not
+    have exited yet; `send_drainer` waits for it. */
+    guarantee(send_queues_empty());
+}
+
+void connectivity_cluster_t::run_t::lane_t::send(outgoing_message_t *msg) {
+    assert_thread();
+    rassert(msg->priority >= 0 && msg->priority < NUM_MESSAGE_PRIORITIES);
+
+    send_queues[msg->priority].push_back(msg);
+    if (!flusher_running) {
+        /* Spawn rather than flushing directly, so that other senders that
+        show up before the flusher gets to run join the same write. */
+        flusher_running = true;
+        coro_t::spawn_sometime(boost::bind(
+            &lane_t::flush_send_queue, this,
+            auto_drainer_t::lock_t(&send_drainer)));
+    }
+
+    msg->sent.wait_lazily_unordered();
+}
+
+void connectivity_cluster_t::run_t::lane_t::flush_send_queue(UNUSED auto_drainer_t::lock_t keepalive) {
+    assert_thread();
+
+    std::vector<outgoing_message_t *> batch;
+    std::vector<struct iovec> iov;
+    while (!send_queues_empty()) {
+        batch.clear();
+        iov.clear();
+        take_send_batch(&batch);
+        for (std::vector<outgoing_message_t *>::iterator it = batch.begin(); it != batch.end(); ++it) {
+            outgoing_message_t *msg = *it;
+
+            struct iovec header;
+            header.iov_base = &msg->header;
+            header.iov_len = sizeof(msg->header);
+            iov.push_back(header);
+            if (msg->size > 0) {
+                struct iovec body;
+                body.iov_base = const_cast<char *>(msg->data->data());
+                body.iov_len = msg->size;
+                iov.push_back(body);
+            }
+        }
+
+        int64_t res = conn->writev(iov.data(), iov.size());
+        if (res == -1) {
+            /* Close the other half of the connection to make sure that
+            `connectivity_cluster_t::run_t::handle()` notices that something is
+            up */
+            if (conn->is_read_open()) {
+                conn->shutdown_read();
+            }
+        }
+
+        for (std::vector<outgoing_message_t *>::iterator it = batch.begin(); it != batch.end(); ++it) {
+            (*it)->sent.pulse();
+        }
+    }
+    flusher_running = false;
+}
+
+void connectivity_cluster_t::run_t::lane_t::take_send_batch(std::vector<outgoing_message_t *> *batch_out) {
+    int64_t batch_bytes = 0;
+
+    intrusive_list_t<outgoing_message_t> *control = &send_queues[MESSAGE_PRIORITY_CONTROL];
+    while (outgoing_message_t *msg = control->head()) {
+        control->pop_front();
+        batch_out->push_back(msg);
+        batch_bytes += msg->wire_size();
+    }
+
+    bool any_waiting;
+    do {
+        any_waiting = false;
+        for (int p = MESSAGE_PRIORITY_CONTROL + 1; p < NUM_MESSAGE_PRIORITIES; ++p) {
+            intrusive_list_t<outgoing_message_t> *queue = &send_queues[p];
+            if (queue->empty()) {
+                continue;
+            }
+            send_deficits[p] += send_priority_weights[p] * SEND_QUANTUM_BYTES;
+            while (!queue->empty() && queue->head()->wire_size() <= send_deficits[p]) {
+                outgoing_message_t *msg = queue->head();
+                queue->pop_front();
+                batch_out->push_back(msg);
+                send_deficits[p] -= msg->wire_size();
+                batch_bytes += msg->wire_size();
+            }
+            if (queue->empty()) {
+                /* A class doesn't get to save up credit while it's idle */
+                send_deficits[p] = 0;
+            } else {
+                any_waiting = true;
+            }
+        }
+    } while (any_waiting && batch_bytes < MAX_SEND_BATCH_BYTES);
+}
+
+bool connectivity_cluster_t::run_t::lane_t::send_queues_empty() {
+    for (int p = 0; p < NUM_MESSAGE_PRIORITIES; ++p) {
+        if (!send_queues[p].empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+connectivity_cluster_t::run_t::connection_entry_t::connection_entry_t(run_t *p, peer_id_t id, tcp_conn_stream_t *c, const std::vector<lane_t *> &l, peer_address_t a, cluster_compression_t comp) THROWS_NOTHING :
+    conn(c), lanes(l), address(a), compression(comp), session_id(generate_uuid()),
     pm_collection(),
     pm_bytes_sent(secs_to_ticks(1), true),
+    pm_bytes_saved_by_compression(secs_to_ticks(1), true),
     pm_collection_membership(&p->parent->connectivity_collection, &pm_collection, uuid_to_str(id.get_uuid())),
     pm_bytes_sent_membership(&pm_collection, &pm_bytes_sent, "bytes_sent"),
+    pm_bytes_saved_by_compression_membership(&pm_collection, &pm_bytes_saved_by_compression, "bytes_saved_by_compression"),
     parent(p), peer(id),
     entries(new one_per_thread_t<entry_installation_t>(this)) {
     if (peer != parent->parent->me && parent->heartbeat_manager != NULL) {
@@ -127,12 +296,19 @@ connectivity_cluster_t::run_t::connection_entry_t::~connection_entry_t() THROWS_
         parent->heartbeat_manager->end_peer_heartbeat(peer);
     }
 
-    // Delete entries early just so we can make the assertion below.
+    /* `~entry_installation_t` destroys the `auto_drainer_t`'s in entries,
+    so once this returns nobody is using `lanes` any more. */
     entries.reset();
+}
 
-    /* `~entry_installation_t` destroys the `auto_drainer_t`'s in entries,
-    so nothing can be holding the `send_mutex`. */
-    guarantee(!send_mutex.is_locked());
+connectivity_cluster_t::run_t::lane_t *connectivity_cluster_t::run_t::connection_entry_t::lane_for_hint(int hint) {
+    rassert(!lanes.empty());
+    if (hint == 0 || lanes.size() == 1) {
+        return lanes[0];
+    }
+    /* Hints are non-negative, but be careful anyway. */
+    unsigned int h = hint;
+    return lanes[1 + (h - 1) % (lanes.size() - 1)];
 }
 
 static void ping_connection_watcher(peer_id_t peer, peers_list_callback_t *connect_disconnect_cb) THROWS_NOTHING {
@@ -375,33 +551,68 @@ bool is_similar_peer_address(const peer_address_t &left, const peer_address_t &r
     return left_loopback_only || right_loopback_only;
 }
 
-// We log error conditions as follows:
-// - silent: network error; conflict between parallel connections
-// - warning: invalid header
-// - error: id or address don't match expected id or address; deserialization range error; unknown error
-// In all cases we close the connection and quit.
-void connectivity_cluster_t::run_t::handle(
-        /* `conn` should remain valid until `handle()` returns.
-         * `handle()` does not take ownership of `conn`. */
-        keepalive_tcp_conn_stream_t *conn,
-        boost::optional<peer_id_t> expected_id,
-        boost::optional<peer_address_t> expected_address,
-        auto_drainer_t::lock_t drainer_lock,
-        bool *successful_join) THROWS_NOTHING
-{
-    parent->assert_thread();
+/* A peer's extra lanes, while its first connection is being set up and for
+as long as that connection lasts. Lives on the listener thread, in the frame of
+the `handle()` call for the first connection. */
+class connectivity_cluster_t::run_t::lane_set_t {
+public:
+    explicit lane_set_t(int num_lanes) : conns(num_lanes, NULL), missing(num_lanes - 1) {
+        if (missing == 0) {
+            all_ready.pulse();
+        }
+    }
 
-    // Get the name of our peer, for error reporting.
+    /* Returns false if we aren't expecting lane number `lane`. */
+    bool add(int lane, keepalive_tcp_conn_stream_t *conn) {
+        if (lane <= 0 || lane >= static_cast<int>(conns.size()) || conns[lane] != NULL) {
+            return false;
+        }
+        conns[lane] = conn;
+        if (--missing == 0) {
+            all_ready.pulse();
+        }
+        return true;
+    }
+
+    /* Called when one of the lanes couldn't be opened. */
+    void fail() {
+        if (!failed.is_pulsed()) {
+            failed.pulse();
+        }
+    }
+
+    /* `conns[0]` is unused; it's the connection that `handle()` has. */
+    std::vector<keepalive_tcp_conn_stream_t *> conns;
+    int missing;
+    cond_t all_ready, failed;
+
+    /* The coroutines that own the connections in `conns` hold a lock on this,
+    and keep their connections open until it's drained. */
+    auto_drainer_t drainer;
+
+private:
+    DISABLE_COPYING(lane_set_t);
+};
+
+static std::string get_peername(keepalive_tcp_conn_stream_t *conn) {
     ip_address_t peer_addr;
-    std::string peerstr = "(unknown)";
-    if (!conn->get_underlying_conn()->getpeername(&peer_addr))
-        peerstr = peer_addr.as_dotted_decimal();
-    const char *peername = peerstr.c_str();
+    if (!conn->get_underlying_conn()->getpeername(&peer_addr)) {
+        return peer_addr.as_dotted_decimal();
+    }
+    return "(unknown)";
+}
 
-    // Make sure that if we're ordered to shut down, any pending read
-    // or write gets interrupted.
-    cluster_conn_closing_subscription_t conn_closer_1(conn);
-    conn_closer_1.reset(drainer_lock.get_drain_signal());
+bool connectivity_cluster_t::run_t::exchange_headers(
+        keepalive_tcp_conn_stream_t *conn,
+        const char *peername,
+        int32_t our_lane,
+        peer_id_t *other_id_out,
+        peer_address_t *other_address_out,
+        int32_t *other_lane_out,
+        int32_t *other_lanes_per_peer_out,
+        cluster_compression_t *other_compression_out) THROWS_NOTHING
+{
+    parent->assert_thread();
 
     // Each side sends a header followed by its own ID and address, then receives and checks the
     // other side's.
@@ -413,8 +624,11 @@ void connectivity_cluster_t::run_t::handle(
         msg << cluster_build_mode;
         msg << parent->me;
         msg << routing_table[parent->me];
+        msg << our_lane;
+        msg << static_cast<int32_t>(lanes_per_peer);
+        msg << static_cast<int8_t>(compression);
         if (send_write_message(conn, &msg))
-            return; // network error.
+            return false; // network error.
     }
 
     // Receive & check header.
@@ -425,12 +639,12 @@ void connectivity_cluster_t::run_t::handle(
         for (uint64_t i = 0; i < cluster_proto_header.length(); i += r) {
             r = conn->read(buffer, std::min(buffer_size, int64_t(cluster_proto_header.length() - i)));
             if (-1 == r)
-                return; // network error.
+                return false; // network error.
             rassert(r >= 0);
             // If EOF or remote_header does not match header, terminate connection.
             if (0 == r || memcmp(cluster_proto_header.c_str() + i, buffer, r) != 0) {
                 logWRN("Received invalid clustering header from %s, closing connection -- something might be connecting to the wrong port.", peername);
-                return;
+                return false;
             }
         }
     }
@@ -443,46 +657,117 @@ void connectivity_cluster_t::run_t::handle(
         if (deserialize_and_check(conn, &remote_version, peername) ||
             deserialize_and_check(conn, &remote_arch_bitsize, peername),
             deserialize_and_check(conn, &remote_build_mode, peername))
-            return;
+            return false;
 
         if (remote_version != cluster_version) {
             logWRN("Connection attempt with a RethinkDB node of the wrong version,"
                    " local version: %s, remote version: %s, connection dropped\n",
                    cluster_version.c_str(), remote_version.c_str());
-            return;
+            return false;
         }
 
         if (remote_arch_bitsize != cluster_arch_bitsize) {
             logWRN("Connection attempt with a RethinkDB node of the wrong architecture,"
                    " local: %s, remote: %s, connection dropped\n",
                    cluster_arch_bitsize.c_str(), remote_arch_bitsize.c_str());
-            return;
+            return false;
         }
 
         if (remote_build_mode != cluster_build_mode) {
             logWRN("Connection attempt with a RethinkDB node of the wrong build mode,"
                    " local: %s, remote: %s, connection dropped\n",
                    cluster_build_mode.c_str(), remote_build_mode.c_str());
-            return;
+            return false;
         }
     }
 
-    // Receive id, address.
-    peer_id_t other_id;
-    peer_address_t other_address;
-    if (deserialize_and_check(conn, &other_id, peername) ||
-        deserialize_and_check(conn, &other_address, peername))
-        return;
+    // Receive id, address, lane, and compression information.
+    int8_t other_compression;
+    if (deserialize_and_check(conn, other_id_out, peername) ||
+        deserialize_and_check(conn, other_address_out, peername) ||
+        deserialize_and_check(conn, other_lane_out, peername) ||
+        deserialize_and_check(conn, other_lanes_per_peer_out, peername) ||
+        deserialize_and_check(conn, &other_compression, peername))
+        return false;
+
+    if (*other_lane_out < 0 || *other_lanes_per_peer_out < 1) {
+        logERR("received invalid lane information from %s, closing connection", peername);
+        return false;
+    }
+    if (other_compression < CLUSTER_COMPRESSION_NONE || other_compression > CLUSTER_COMPRESSION_ALL) {
+        logERR("received invalid compression setting from %s, closing connection", peername);
+        return false;
+    }
+    *other_compression_out = static_cast<cluster_compression_t>(other_compression);
 
     /* Sanity checks */
-    if (other_id == parent->me) {
+    if (*other_id_out == parent->me) {
         // TODO: report this on command-line in some cases. see issue 546 on github.
-        return;
+        return false;
     }
-    if (other_id.is_nil()) {
+    if (other_id_out->is_nil()) {
         logERR("received nil peer id from %s, closing connection", peername);
+        return false;
+    }
+
+    return true;
+}
+
+// We log error conditions as follows:
+// - silent: network error; conflict between parallel connections
+// - warning: invalid header
+// - error: id or address don't match expected id or address; deserialization range error; unknown error
+// In all cases we close the connection and quit.
+void connectivity_cluster_t::run_t::handle(
+        /* `conn` should remain valid until `handle()` returns.
+         * `handle()` does not take ownership of `conn`. */
+        keepalive_tcp_conn_stream_t *conn,
+        boost::optional<peer_id_t> expected_id,
+        boost::optional<peer_address_t> expected_address,
+        auto_drainer_t::lock_t drainer_lock,
+        bool *successful_join) THROWS_NOTHING
+{
+    parent->assert_thread();
+
+    // Get the name of our peer, for error reporting.
+    ip_address_t peer_addr;
+    std::string peerstr = "(unknown)";
+    if (!conn->get_underlying_conn()->getpeername(&peer_addr))
+        peerstr = peer_addr.as_dotted_decimal();
+    const char *peername = peerstr.c_str();
+
+    // Make sure that if we're ordered to shut down, any pending read
+    // or write gets interrupted.
+    cluster_conn_closing_subscription_t conn_closer_1(conn);
+    conn_closer_1.reset(drainer_lock.get_drain_signal());
+
+    peer_id_t other_id;
+    peer_address_t other_address;
+    int32_t other_lane, other_lanes_per_peer;
+    cluster_compression_t other_compression;
+    if (!exchange_headers(conn, peername, 0, &other_id, &other_address, &other_lane, &other_lanes_per_peer, &other_compression))
+        return;
+
+    if (other_lane != 0) {
+        /* This is one of the extra lanes of a connection that another call to
+        `handle()` is setting up. Hand it over, and keep it open for as long as
+        that call is using it. That call takes care of closing it from now on;
+        it's about to be moved to another thread. */
+        std::map<peer_id_t, lane_set_t *>::iterator it = pending_lane_sets.find(other_id);
+        if (it == pending_lane_sets.end()) {
+            logERR("received a lane for a connection that isn't being set up from %s, closing connection", peername);
+            return;
+        }
+        auto_drainer_t::lock_t lanes_lock(&it->second->drainer);
+        if (!it->second->add(other_lane, conn)) {
+            logERR("received an unexpected lane from %s, closing connection", peername);
+            return;
+        }
+        conn_closer_1.reset();
+        lanes_lock.get_drain_signal()->wait_lazily_unordered();
         return;
     }
+
     if (expected_id && other_id != *expected_id) {
         // This is only a problem if we're not using a loopback address
         if (!peer_addr.is_loopback()) {
@@ -504,6 +789,14 @@ void connectivity_cluster_t::run_t::handle(
     // Just saying that we're still on the rpc listener thread.
     parent->assert_thread();
 
+    /* Both sides use the same number of lanes. The extra lanes are opened
+    once the routing tables have been exchanged; see below. */
+    const int num_lanes = std::min<int>(lanes_per_peer, other_lanes_per_peer);
+    lane_set_t lane_set(num_lanes);
+
+    /* Either side can ask for compression; it applies in both directions. */
+    const cluster_compression_t conn_compression = std::max(compression, other_compression);
+
     /* The trickiest case is when there are two or more parallel connections
     that are trying to be established between the same two machines. We can get
     this when e.g. machine A and machine B try to connect to each other at the
@@ -513,6 +806,8 @@ void connectivity_cluster_t::run_t::handle(
 
     object_buffer_t<map_insertion_sentry_t<peer_id_t, peer_address_t> >
         routing_table_entry_sentry;
+    object_buffer_t<map_insertion_sentry_t<peer_id_t, lane_set_t *> >
+        pending_lane_set_sentry;
 
     /* We pick one side of the connection to be the "leader" and the other side
     to be the "follower". These roles are only relevant in the initial startup
@@ -520,7 +815,8 @@ void connectivity_cluster_t::run_t::handle(
     it drops the connection. If not, it sends its routing table to the follower.
     Then the follower registers itself locally. There shouldn't be a conflict
     because any duplicate connection would have been detected by the leader.
-    Then the follower sends its routing table to the leader. */
+    Then the follower sends its routing table to the leader. The leader also
+    opens any extra lanes, so the follower waits for them. */
     bool we_are_leader = parent->me < other_id;
 
     // Just saying: Still on rpc listener thread, for
@@ -604,6 +900,10 @@ void connectivity_cluster_t::run_t::handle(
             /* Register ourselves while in the critical section, so that whoever
             comes next will see us */
             routing_table_entry_sentry.create(&routing_table, other_id, other_address);
+
+            /* The leader opens our extra lanes as soon as it has our routing
+            table, so we must be ready for them before we send it. */
+            pending_lane_set_sentry.create(&pending_lane_sets, other_id, &lane_set);
         }
 
         /* Send our routing table to the leader */
@@ -618,6 +918,28 @@ void connectivity_cluster_t::run_t::handle(
     // Just saying: We haven't left the RPC listener thread.
     parent->assert_thread();
 
+    /* Wait for the extra lanes, if there are any. */
+    if (num_lanes > 1) {
+        if (we_are_leader) {
+            for (int i = 1; i < num_lanes; ++i) {
+                coro_t::spawn_sometime(boost::bind(
+                    &connectivity_cluster_t::run_t::connect_lane, this,
+                    peer_addr, other_address.port, other_id, i,
+                    &lane_set, auto_drainer_t::lock_t(&lane_set.drainer)));
+            }
+        }
+
+        signal_timer_t timeout(LANE_SETUP_TIMEOUT_MS);
+        wait_any_t waiter(&lane_set.all_ready, &lane_set.failed, &timeout, drainer_lock.get_drain_signal());
+        waiter.wait_lazily_unordered();
+        if (!lane_set.all_ready.is_pulsed()) {
+            if (!drainer_lock.get_drain_signal()->is_pulsed()) {
+                logWRN("Could not open all %d connections to %s, closing connection", num_lanes, peername);
+            }
+            return;
+        }
+    }
+
     // This check is so that when trying multiple connections to a peer in parallel, we can
     //  make sure only one of them succeeds
     if (successful_join != NULL) {
@@ -657,6 +979,14 @@ void connectivity_cluster_t::run_t::handle(
 
     cross_thread_signal_t connection_thread_drain_signal(drainer_lock.get_drain_signal(), chosen_thread);
 
+    /* The extra lanes get threads of their own. Lane `i` carries the messages
+    for mailboxes on thread `i - 1` (modulo the number of lanes), so we put it
+    on that thread if we have it. */
+    scoped_array_t<scoped_ptr_t<rethread_tcp_conn_stream_t> > unregister_lanes(num_lanes);
+    for (int i = 1; i < num_lanes; ++i) {
+        unregister_lanes[i].init(new rethread_tcp_conn_stream_t(lane_set.conns[i], INVALID_THREAD));
+    }
+
     rethread_tcp_conn_stream_t unregister_conn(conn, INVALID_THREAD);
     on_thread_t conn_threader(chosen_thread);
     rethread_tcp_conn_stream_t reregister_conn(conn, get_thread_id());
@@ -666,30 +996,133 @@ void connectivity_cluster_t::run_t::handle(
     cluster_conn_closing_subscription_t conn_closer_2(conn);
     conn_closer_2.reset(&connection_thread_drain_signal);
 
+    lane_t primary_lane(conn);
+    std::vector<lane_t *> lanes(num_lanes, &primary_lane);
+    for (int i = 1; i < num_lanes; ++i) {
+        on_thread_t th((i - 1) % get_num_threads());
+        lane_set.conns[i]->rethread(get_thread_id());
+        lanes[i] = new lane_t(lane_set.conns[i]);
+    }
+
     {
         /* `connection_entry_t` is the public interface of this coroutine. Its
         constructor registers it in the `connectivity_cluster_t`'s connection
         map and notifies any connect listeners. */
-        connection_entry_t conn_structure(this, other_id, conn, other_address);
+        connection_entry_t conn_structure(this, other_id, conn, lanes, other_address, conn_compression);
         object_buffer_t<heartbeat_keepalive_t> keepalive;
 
         if (heartbeat_manager != NULL) {
             keepalive.create(conn, heartbeat_manager, other_id);
         }
 
-        /* Main message-handling loop: read messages off the connection until
-        it's closed, which may be due to network events, or the other end
-        shutting down, or us shutting down. */
+        /* Main message-handling loop: read messages off every lane until one
+        of them is closed, which may be due to network events, or the other end
+        shutting down, or us shutting down. Then close the rest. */
+        cond_t stop_lanes;
+        pmap(num_lanes, boost::bind(&connectivity_cluster_t::run_t::receive_on_lane, this,
+                                    &lanes, other_id, peername, &stop_lanes, _1));
+
+        /* The `conn_structure` destructor removes us from the connection map
+        and notifies any disconnect listeners. */
+    }
+
+    for (int i = 1; i < num_lanes; ++i) {
+        on_thread_t th(lanes[i]->conn->home_thread());
+        delete lanes[i];
+        lane_set.conns[i]->rethread(INVALID_THREAD);
+    }
+}
+
+void connectivity_cluster_t::run_t::connect_lane(
+        ip_address_t ip,
+        int port,
+        peer_id_t expected_id,
+        int lane,
+        lane_set_t *lanes,
+        auto_drainer_t::lock_t lanes_lock) THROWS_NOTHING {
+    parent->assert_thread();
+    try {
+        /* Extra lanes don't use `cluster_client_port`; TCP couldn't tell them
+        apart from the first connection if they did. */
+        keepalive_tcp_conn_stream_t conn(ip, port, lanes_lock.get_drain_signal());
+        std::string peerstr = get_peername(&conn);
+
+        cluster_conn_closing_subscription_t conn_closer(&conn);
+        conn_closer.reset(lanes_lock.get_drain_signal());
+
+        peer_id_t other_id;
+        peer_address_t other_address;
+        int32_t other_lane, other_lanes_per_peer;
+        cluster_compression_t other_compression;
+        if (!exchange_headers(&conn, peerstr.c_str(), lane, &other_id, &other_address, &other_lane, &other_lanes_per_peer, &other_compression)) {
+            lanes->fail();
+            return;
+        }
+        if (other_id != expected_id) {
+            logERR("received inconsistent routing information (wrong ID) from %s on an extra lane, closing connection", peerstr.c_str());
+            lanes->fail();
+            return;
+        }
+
+        /* From here on, `handle()` takes care of closing it. */
+        conn_closer.reset();
+        guarantee(lanes->add(lane, &conn));
+        lanes_lock.get_drain_signal()->wait_lazily_unordered();
+    } catch (tcp_conn_t::connect_failed_exc_t) {
+        lanes->fail();
+    } catch (interrupted_exc_t) {
+        /* Ignore */
+    }
+}
+
+void connectivity_cluster_t::run_t::receive_on_lane(
+        const std::vector<lane_t *> *lanes,
+        peer_id_t other_id,
+        const char *peername,
+        cond_t *stop_lanes,
+        int lane) THROWS_NOTHING {
+    tcp_conn_stream_t *primary_conn = (*lanes)[0]->conn;
+    tcp_conn_stream_t *conn = (*lanes)[lane]->conn;
+
+    cross_thread_signal_t stop(stop_lanes, conn->home_thread());
+    {
+        on_thread_t th(conn->home_thread());
+
+        cluster_conn_closing_subscription_t conn_closer(conn);
+        if (lane != 0) {
+            conn_closer.reset(&stop);
+        }
+
         try {
             while (true) {
-                /* For now, we use `std::string` for messages on the wire: it's
-                just a length and a byte vector. This is obviously slow and we
-                should change it when we care about performance. */
-                std::string message;
-                if (deserialize_and_check(conn, &message, peername))
+                /* Messages are framed as a length and then the bytes, which
+                we read straight into the vector we hand to the message
+                handler. See `lane_t::outgoing_message_t`. */
+                int64_t header;
+                if (deserialize_and_check(conn, &header, peername))
                     break;
+                if (header < 0) {
+                    logERR("could not deserialize data received from %s, closing connection", peername);
+                    conn->shutdown_read();
+                    break;
+                }
+                const bool compressed = (header & COMPRESSED_MESSAGE_FLAG) != 0;
+                const int64_t size = header & ~COMPRESSED_MESSAGE_FLAG;
+
+                std::vector<char> vec(size);
+                if (force_read(conn, vec.data(), size) != size)
+                    break;
+
+                if (compressed) {
+                    std::vector<char> decompressed;
+                    if (!decompress_message(vec.data(), vec.size(), &decompressed)) {
+                        logERR("received a corrupt compressed message from %s, closing connection", peername);
+                        conn->shutdown_read();
+                        break;
+                    }
+                    vec.swap(decompressed);
+                }
 
-                std::vector<char> vec(message.begin(), message.end());
                 vector_read_stream_t stream(&vec);
                 message_handler->on_message(other_id, &stream); // might raise fake_archive_exc_t
             }
@@ -703,9 +1136,14 @@ void connectivity_cluster_t::run_t::handle(
         guarantee(!conn->is_read_open(), "the connection is still open for "
             "read, which means we had a problem other than the TCP "
             "connection closing or dying");
+    }
 
-        /* The `conn_structure` destructor removes us from the connection map
-        and notifies any disconnect listeners. */
+    if (lane == 0) {
+        stop_lanes->pulse();
+    } else if (primary_conn->is_read_open()) {
+        /* This lane died on its own; take the rest of the connection down with
+        it. (We're back on the first lane's thread.) */
+        primary_conn->shutdown_read();
     }
 }
 
@@ -714,6 +1152,20 @@ connectivity_cluster_t::connectivity_cluster_t() THROWS_NOTHING :
     current_run(NULL),
     connectivity_collection(),
     stats_membership(&get_global_perfmon_collection(), &connectivity_collection, "connectivity")
+{
+    for (int p = 0; p < NUM_MESSAGE_PRIORITIES; ++p) {
+        priority_stats[p].init(new priority_stats_t(&connectivity_collection,
+            message_priority_name(static_cast<message_priority_t>(p))));
+    }
+}
+
+connectivity_cluster_t::priority_stats_t::priority_stats_t(perfmon_collection_t *parent, const char *name) :
+    collection(),
+    bytes_sent(secs_to_ticks(1), true),
+    send_latency(secs_to_ticks(1)),
+    collection_membership(parent, &collection, strprintf("priority_%s", name).c_str()),
+    bytes_sent_membership(&collection, &bytes_sent, "bytes_sent"),
+    send_latency_membership(&collection, &send_latency, "send_latency")
     { }
 
 connectivity_cluster_t::~connectivity_cluster_t() THROWS_NOTHING {
@@ -759,10 +1211,9 @@ void connectivity_cluster_t::send_message(peer_id_t dest, send_message_write_cal
 
     guarantee(!dest.is_nil());
 
-    /* We currently write the message to a vector_stream_t, then
-       serialize that as a string. It's horribly inefficient, of course. */
-    // TODO: If we don't do it this way, we (or the caller) will need
-    // to worry about having the writer run on the connection thread.
+    /* We write the message to a vector_stream_t here, so that the writer
+    doesn't have to run on the connection thread. The connection's flusher
+    then writes the vector out directly, without copying it again. */
     vector_stream_t buffer;
     {
         ASSERT_FINITE_CORO_WAITING;
@@ -818,27 +1269,37 @@ void connectivity_cluster_t::send_message(peer_id_t dest, send_message_write_cal
 
     } else {
         guarantee(dest != me);
-        on_thread_t threader(conn_structure->conn->home_thread());
+        message_priority_t priority = callback->priority();
+        if (priority == MESSAGE_PRIORITY_DEFAULT) {
+            priority = MESSAGE_PRIORITY_QUERY;
+        }
+        priority_stats_t *stats = priority_stats[priority].get();
+
+        /* Compress here rather than in the lane's flusher, so the work is
+        spread over the senders' threads. */
+        std::vector<char> compressed_buffer;
+        bool compressed = false;
+        if (should_compress(conn_structure->compression, priority, buffer.vector().size())) {
+            compressed = compress_message(buffer.vector().data(), buffer.vector().size(), &compressed_buffer);
+            if (compressed) {
+                conn_structure->pm_bytes_saved_by_compression.record(
+                    buffer.vector().size() - compressed_buffer.size());
+            }
+        }
 
-        /* Acquire the send-mutex so we don't collide with other things trying
-        to send on the same connection. */
-        mutex_t::acq_t acq(&conn_structure->send_mutex);
+        run_t::lane_t *lane = conn_structure->lane_for_hint(callback->lane_hint());
+        on_thread_t threader(lane->conn->home_thread());
 
+        /* Hand the message to the lane's flusher, which writes it out together
+        with whatever else is queued up on the lane. */
+        run_t::lane_t::outgoing_message_t msg(compressed ? &compressed_buffer : &buffer.vector(),
+                                              priority, compressed);
         {
-            write_message_t msg;
-            std::string buffer_str(buffer.vector().begin(), buffer.vector().end());
-            msg << buffer_str;
-            int res = send_write_message(conn_structure->conn, &msg);
-            conn_structure->pm_bytes_sent.record(buffer.vector().size());
-            if (res) {
-                /* Close the other half of the connection to make sure that
-                   `connectivity_cluster_t::run_t::handle()` notices that something is
-                   up */
-                if (conn_structure->conn->is_read_open()) {
-                    conn_structure->conn->shutdown_read();
-                }
-            }
+            block_pm_duration send_timer(&stats->send_latency);
+            lane->send(&msg);
         }
+        conn_structure->pm_bytes_sent.record(msg.size);
+        stats->bytes_sent.record(msg.size);
     }
 }
 
@@ -9,11 +9,14 @@
 
 #include "arch/types.hpp"
 #include "concurrency/auto_drainer.hpp"
+#include "concurrency/cond_var.hpp"
 #include "concurrency/one_per_thread.hpp"
 #include "concurrency/semaphore.hpp"
 #include "containers/archive/tcp_conn_stream.hpp"
+#include "containers/intrusive_list.hpp"
 #include "containers/map_sentries.hpp"
 #include "perfmon/perfmon.hpp"
+#include "rpc/connectivity/compression.hpp"
 #include "rpc/connectivity/connectivity.hpp"
 #include "rpc/connectivity/messages.hpp"
 #include "rpc/connectivity/heartbeat.hpp"
@@ -106,7 +109,9 @@ public:
               int port,
               message_handler_t *message_handler,
               int client_port,
-              heartbeat_manager_t *_heartbeat_manager) THROWS_ONLY(address_in_use_exc_t);
+              heartbeat_manager_t *_heartbeat_manager,
+              int lanes_per_peer = 1,
+              cluster_compression_t compression = CLUSTER_COMPRESSION_NONE) THROWS_ONLY(address_in_use_exc_t);
 
         ~run_t();
 
@@ -119,29 +124,108 @@ public:
     private:
         friend class connectivity_cluster_t;
 
+        /* The sending half of one TCP connection to a peer. We normally have
+        one connection to each peer, but if `lanes_per_peer` is more than one,
+        we open that many, each homed on a different thread. Lane 0 is the
+        connection that did the handshake. */
+        class lane_t : public home_thread_mixin_debug_only_t {
+        public:
+            /* Must be constructed on `conn`'s home thread. */
+            explicit lane_t(tcp_conn_stream_t *conn);
+            ~lane_t();
+
+            /* A message that `send_message()` has handed off to be written to
+            `conn`. It lives on the sender's stack; the sender blocks on `sent`
+            until the flusher is done with it. */
+            class outgoing_message_t : public intrusive_list_node_t<outgoing_message_t> {
+            public:
+                outgoing_message_t(const std::vector<char> *d, message_priority_t p, bool compressed) :
+                    size(d->size()),
+                    header(compressed ? size | COMPRESSED_MESSAGE_FLAG : size),
+                    data(d), priority(p) { }
+
+                /* How many bytes the message takes up on the wire */
+                int64_t wire_size() const { return sizeof(header) + size; }
+
+                int64_t size;
+                /* On the wire each message is preceded by its length. If it
+                was compressed with `compress_message()`, that has
+                `COMPRESSED_MESSAGE_FLAG` set. */
+                int64_t header;
+                const std::vector<char> *data;
+                message_priority_t priority;
+                cond_t sent;
+            };
+
+            /* Queues `msg` to be written to `conn` and blocks until it has
+            been, or until the connection has died. Must be called on the
+            connection's thread. */
+            void send(outgoing_message_t *msg);
+
+            tcp_conn_stream_t *const conn;
+
+        private:
+            /* Runs while any of the `send_queues` is non-empty. Each pass takes
+            a batch with `take_send_batch()` and writes it out with a single
+            `writev()`, then goes back for more. */
+            void flush_send_queue(auto_drainer_t::lock_t keepalive);
+
+            /* Picks the next batch of messages to write. Control messages all
+            go first; the other classes share the rest of the batch by deficit
+            round robin, in proportion to their weights. */
+            void take_send_batch(std::vector<outgoing_message_t *> *batch_out);
+
+            bool send_queues_empty();
+
+            intrusive_list_t<outgoing_message_t> send_queues[NUM_MESSAGE_PRIORITIES];
+            /* How many bytes each class may still send before it has to wait
+            for the next round. */
+            int64_t send_deficits[NUM_MESSAGE_PRIORITIES];
+            bool flusher_running;
+            auto_drainer_t send_drainer;
+
+            DISABLE_COPYING(lane_t);
+        };
+
+        /* Collects a peer's extra lanes while its first connection is being
+        set up. Defined in `cluster.cc`. */
+        class lane_set_t;
+
         class connection_entry_t : public home_thread_mixin_debug_only_t {
         public:
             /* The constructor registers us in every thread's `connection_map`;
             the destructor deregisters us. Both also notify all subscribers. */
-            connection_entry_t(run_t *, peer_id_t, tcp_conn_stream_t *, peer_address_t) THROWS_NOTHING;
+            connection_entry_t(run_t *, peer_id_t, tcp_conn_stream_t *, const std::vector<lane_t *> &, peer_address_t, cluster_compression_t) THROWS_NOTHING;
             ~connection_entry_t() THROWS_NOTHING;
 
+            /* Picks the lane for a message with the given
+            `send_message_write_callback_t::lane_hint()`. Hint 0 always goes
+            to lane 0; other hints are spread over the remaining lanes, so that
+            bulk traffic doesn't hold up the control traffic on lane 0. */
+            lane_t *lane_for_hint(int hint);
+
             /* NULL for our "connection" to ourself */
             tcp_conn_stream_t *conn;
 
+            /* Empty for our connection to ourself. Each lane is only accessed
+            on its own connection's thread. */
+            std::vector<lane_t *> lanes;
+
             /* `connection_t` contains a `peer_address_t` so that we can call
             `get_peers_list()` on any thread. Otherwise, we would have to go
             cross-thread to access the routing table. */
             peer_address_t address;
 
-            /* Unused for our connection to ourself */
-            mutex_t send_mutex;
+            /* What we agreed on with the peer in the handshake */
+            cluster_compression_t compression;
 
             uuid_u session_id;
 
             perfmon_collection_t pm_collection;
             perfmon_sampler_t pm_bytes_sent;
-            perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership;
+            /* How much smaller compression made the messages we sent */
+            perfmon_sampler_t pm_bytes_saved_by_compression;
+            perfmon_membership_t pm_collection_membership, pm_bytes_sent_membership, pm_bytes_saved_by_compression_membership;
 
         private:
             /* We only hold this information so we can deregister ourself */
@@ -202,6 +286,32 @@ public:
         peer we are connected to. */
         void join_blocking(peer_address_t address, boost::optional<peer_id_t>, auto_drainer_t::lock_t) THROWS_NOTHING;
 
+        /* Sends our half of the handshake that starts every connection, and
+        receives and checks the other side's. `our_lane` is 0 for a new
+        connection and the lane number for an extra lane. Returns false if the
+        connection should be dropped. */
+        bool exchange_headers(keepalive_tcp_conn_stream_t *conn,
+            const char *peername,
+            int32_t our_lane,
+            peer_id_t *other_id_out,
+            peer_address_t *other_address_out,
+            int32_t *other_lane_out,
+            int32_t *other_lanes_per_peer_out,
+            cluster_compression_t *other_compression_out) THROWS_NOTHING;
+
+        /* Spawned by `handle()` on the side that opens a peer's extra lanes.
+        Connects lane number `lane` and hands it to `lanes`. */
+        void connect_lane(ip_address_t ip, int port, peer_id_t expected_id, int lane,
+            lane_set_t *lanes, auto_drainer_t::lock_t lanes_lock) THROWS_NOTHING;
+
+        /* Reads messages off lane number `lane` of `lanes` until it's closed;
+        run by `handle()` for each lane once the connection is registered. */
+        void receive_on_lane(const std::vector<lane_t *> *lanes,
+            peer_id_t other_id,
+            const char *peername,
+            cond_t *stop_lanes,
+            int lane) THROWS_NOTHING;
+
         /* `handle()` takes an `auto_drainer_t::lock_t` so that we never shut
         down while there are still running instances of `handle()`. It's
         responsible for the entire lifetime of an intra-cluster TCP connection.
@@ -219,6 +329,18 @@ public:
 
         message_handler_t *message_handler;
 
+        /* How many TCP connections to open to each peer. The two sides of a
+        connection use the smaller of their two values. */
+        int lanes_per_peer;
+
+        /* Which messages we'd like to have compressed. See
+        `cluster_compression_t`. */
+        cluster_compression_t compression;
+
+        /* The lane sets of connections that are waiting for the other side to
+        open their extra lanes, indexed by peer. */
+        std::map<peer_id_t, lane_set_t *> pending_lane_sets;
+
         heartbeat_manager_t *heartbeat_manager;
 
         /* `attempt_table` is a table of all the host:port pairs we're currently
@@ -316,6 +438,18 @@ private:
     perfmon_collection_t connectivity_collection;
     perfmon_membership_t stats_membership;
 
+    /* Traffic to other peers, by priority class. `send_latency` covers the
+    time a message spends queued as well as the time it takes to write it. */
+    struct priority_stats_t {
+        priority_stats_t(perfmon_collection_t *parent, const char *name);
+
+        perfmon_collection_t collection;
+        perfmon_sampler_t bytes_sent;
+        perfmon_duration_sampler_t send_latency;
+        perfmon_membership_t collection_membership, bytes_sent_membership, send_latency_membership;
+    };
+    scoped_ptr_t<priority_stats_t> priority_stats[NUM_MESSAGE_PRIORITIES];
+
     DISABLE_COPYING(connectivity_cluster_t);
 };
 
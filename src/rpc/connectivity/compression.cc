@@ -0,0 +1,49 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "rpc/connectivity/compression.hpp"
+
+#include <stdint.h>
+#include <string.h>
+#include <zlib.h>
+
+/* A compressed message is the length of the original message followed by a
+zlib stream. */
+
+bool compress_message(const char *data, size_t size, std::vector<char> *out) {
+    const uint64_t original_size = size;
+    uLongf bound = compressBound(size);
+    out->resize(sizeof(original_size) + bound);
+    memcpy(out->data(), &original_size, sizeof(original_size));
+
+    int res = compress2(reinterpret_cast<Bytef *>(out->data() + sizeof(original_size)), &bound,
+                        reinterpret_cast<const Bytef *>(data), size,
+                        Z_BEST_SPEED);
+    guarantee(res == Z_OK, "zlib could not compress a message (error %d)", res);
+
+    if (sizeof(original_size) + bound >= size) {
+        return false;
+    }
+    out->resize(sizeof(original_size) + bound);
+    return true;
+}
+
+bool decompress_message(const char *data, size_t size, std::vector<char> *out) {
+    uint64_t original_size;
+    if (size < sizeof(original_size)) {
+        return false;
+    }
+    memcpy(&original_size, data, sizeof(original_size));
+
+    /* zlib can't do better than about 1000:1, so anything claiming more than
+    that is corrupt. This also keeps us from allocating some absurd amount of
+    memory on the word of a bad length. */
+    if (original_size / 1032 > size) {
+        return false;
+    }
+
+    out->resize(original_size);
+    uLongf out_size = original_size;
+    int res = uncompress(reinterpret_cast<Bytef *>(out->data()), &out_size,
+                         reinterpret_cast<const Bytef *>(data + sizeof(original_size)),
+                         size - sizeof(original_size));
+    return res == Z_OK && out_size == original_size;
+}
@@ -0,0 +1,39 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#ifndef RPC_CONNECTIVITY_COMPRESSION_HPP_
+#define RPC_CONNECTIVITY_COMPRESSION_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "errors.hpp"
+
+/* Which messages `connectivity_cluster_t` compresses on the wire. Each side of
+a connection says what it would like during the handshake, and the connection
+uses whichever of the two compresses more, so it's enough to turn compression
+on at one end of a slow link. */
+enum cluster_compression_t {
+    CLUSTER_COMPRESSION_NONE = 0,
+    /* Only messages sent at `MESSAGE_PRIORITY_BULK`, i.e. backfills */
+    CLUSTER_COMPRESSION_BULK,
+    /* Everything except control messages */
+    CLUSTER_COMPRESSION_ALL
+};
+
+/* Set in the length that precedes a compressed message on the wire. Lengths
+never get anywhere near this big. */
+const int64_t COMPRESSED_MESSAGE_FLAG = 1LL << 62;
+
+/* Messages shorter than this aren't worth compressing. */
+const size_t MIN_COMPRESSED_MESSAGE_SIZE = 512;
+
+/* Compresses `size` bytes at `data` into `out`, using a fast setting. Returns
+false if the result wouldn't be any smaller, in which case the message should
+be sent as is. */
+MUST_USE bool compress_message(const char *data, size_t size, std::vector<char> *out);
+
+/* Undoes `compress_message()`. Returns false if `data` is corrupt. */
+MUST_USE bool decompress_message(const char *data, size_t size, std::vector<char> *out);
+
+#endif /* RPC_CONNECTIVITY_COMPRESSION_HPP_ */
@@ -45,10 +45,36 @@ no further messages are delivered. This gives a natural way to make sure that no
 messages are still being delivered at the time that the `application_t`
 destructor is called. */
 
+/* Outgoing messages are queued by priority class, and the classes share each
+connection by weighted fair queueing, so that a backfill can't starve queries
+and nothing can hold up the heartbeats. */
+enum message_priority_t {
+    /* Use the priority of the `message_multiplexer_t::client_t` that the
+    message goes through, or `MESSAGE_PRIORITY_QUERY` if there is none. */
+    MESSAGE_PRIORITY_DEFAULT = -1,
+
+    /* Always sent first. Keep these messages small. */
+    MESSAGE_PRIORITY_CONTROL = 0,
+    MESSAGE_PRIORITY_QUERY,
+    MESSAGE_PRIORITY_METADATA,
+    MESSAGE_PRIORITY_BULK,
+
+    NUM_MESSAGE_PRIORITIES
+};
+
 class send_message_write_callback_t {
 public:
     virtual ~send_message_write_callback_t() { }
     virtual void write(write_stream_t *stream) = 0;
+
+    /* Messages to the same peer with the same lane hint and the same priority
+    are delivered in the order they were sent. Messages with different hints
+    may be sent over different connections, and messages with different
+    priorities may overtake each other, so either may be reordered. Hint 0 is
+    for control traffic; hints must not be negative. */
+    virtual int lane_hint() { return 0; }
+
+    virtual message_priority_t priority() { return MESSAGE_PRIORITY_DEFAULT; }
 };
 
 class message_service_t  {
@@ -48,9 +48,10 @@ message_multiplexer_t::client_t::run_t::~run_t() {
     parent->run = NULL;
 }
 
-message_multiplexer_t::client_t::client_t(message_multiplexer_t *p, tag_t t) :
-    parent(p), tag(t), run(NULL)
+message_multiplexer_t::client_t::client_t(message_multiplexer_t *p, tag_t t, message_priority_t pr) :
+    parent(p), tag(t), priority(pr), run(NULL)
 {
+    guarantee(priority >= 0 && priority < NUM_MESSAGE_PRIORITIES);
     guarantee(parent->run == NULL);
     guarantee(parent->clients[tag] == NULL);
     parent->clients[tag] = this;
@@ -68,8 +69,8 @@ connectivity_service_t *message_multiplexer_t::client_t::get_connectivity_servic
 
 class tagged_message_writer_t : public send_message_write_callback_t {
 public:
-    tagged_message_writer_t(message_multiplexer_t::tag_t _tag, send_message_write_callback_t *_subwriter) :
-        tag(_tag), subwriter(_subwriter) { }
+    tagged_message_writer_t(message_multiplexer_t::tag_t _tag, message_priority_t _priority, send_message_write_callback_t *_subwriter) :
+        tag(_tag), priority_(_priority), subwriter(_subwriter) { }
     virtual ~tagged_message_writer_t() { }
 
     void write(write_stream_t *os) {
@@ -80,13 +81,23 @@ public:
         subwriter->write(os);
     }
 
+    int lane_hint() {
+        return subwriter->lane_hint();
+    }
+
+    message_priority_t priority() {
+        message_priority_t p = subwriter->priority();
+        return p == MESSAGE_PRIORITY_DEFAULT ? priority_ : p;
+    }
+
 private:
     message_multiplexer_t::tag_t tag;
+    message_priority_t priority_;
     send_message_write_callback_t *subwriter;
 };
 
 void message_multiplexer_t::client_t::send_message(peer_id_t dest, send_message_write_callback_t *callback) {
-    tagged_message_writer_t writer(tag, callback);
+    tagged_message_writer_t writer(tag, priority, callback);
     parent->message_service->send_message(dest, &writer);
 }
 
@@ -15,7 +15,7 @@
     app_x_t app_x(&app_x_client);
     message_multiplexer_t::client_t::run_t app_x_run(&app_x_client, &app_x);
 
-    message_multiplexer_t::client_t app_y_client(&multiplexer, 'Y');
+    message_multiplexer_t::client_t app_y_client(&multiplexer, 'Y', MESSAGE_PRIORITY_BULK);
     app_y_t app_y(&app_y_client);
     message_multiplexer_t::client_t::run_t app_y_run(&app_y_client, &app_y);
 
@@ -51,7 +51,9 @@ public:
             client_t *const parent;
             message_handler_t *const message_handler;
         };
-        client_t(message_multiplexer_t *, tag_t tag);
+        /* Messages sent through the client go out at `priority`, unless
+        their `send_message_write_callback_t` asks for something else. */
+        client_t(message_multiplexer_t *, tag_t tag, message_priority_t priority = MESSAGE_PRIORITY_QUERY);
         ~client_t();
         connectivity_service_t *get_connectivity_service();
         void send_message(peer_id_t, send_message_write_callback_t *callback);
@@ -60,6 +62,7 @@ public:
         friend class message_multiplexer_t;
         message_multiplexer_t *const parent;
         const tag_t tag;
+        const message_priority_t priority;
         run_t *run;
     };
     explicit message_multiplexer_t(message_service_t *super_ms);
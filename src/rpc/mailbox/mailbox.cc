@@ -62,8 +62,8 @@ raw_mailbox_t::address_t raw_mailbox_t::get_address() const {
 
 class raw_mailbox_writer_t : public send_message_write_callback_t {
 public:
-    raw_mailbox_writer_t(int _dest_thread, raw_mailbox_t::id_t _dest_mailbox_id, mailbox_write_callback_t *_subwriter) :
-        dest_thread(_dest_thread), dest_mailbox_id(_dest_mailbox_id), subwriter(_subwriter) { }
+    raw_mailbox_writer_t(int _dest_thread, raw_mailbox_t::id_t _dest_mailbox_id, mailbox_write_callback_t *_subwriter, message_priority_t _priority) :
+        dest_thread(_dest_thread), dest_mailbox_id(_dest_mailbox_id), subwriter(_subwriter), priority_(_priority) { }
     virtual ~raw_mailbox_writer_t() { }
 
     void write(write_stream_t *stream) {
@@ -77,13 +77,25 @@ public:
 
         subwriter->write(stream);
     }
+
+    /* Messages for the same thread share a lane, and with enough lanes, the
+    lane for each thread is homed on that thread on the receiving end. Messages
+    for `ANY_THREAD` mailboxes go with the control traffic. */
+    int lane_hint() {
+        return dest_thread == raw_mailbox_t::address_t::ANY_THREAD ? 0 : dest_thread + 1;
+    }
+
+    message_priority_t priority() {
+        return priority_;
+    }
 private:
     int32_t dest_thread;
     raw_mailbox_t::id_t dest_mailbox_id;
     mailbox_write_callback_t *subwriter;
+    message_priority_t priority_;
 };
 
-void send(mailbox_manager_t *src, raw_mailbox_t::address_t dest, mailbox_write_callback_t *callback) {
+void send(mailbox_manager_t *src, raw_mailbox_t::address_t dest, mailbox_write_callback_t *callback, message_priority_t priority) {
     guarantee(src);
     guarantee(!dest.is_nil());
 
@@ -100,7 +112,7 @@ void send(mailbox_manager_t *src, raw_mailbox_t::address_t dest, mailbox_write_c
             mbox->callback->read(callback);
         }
     } else {
-        raw_mailbox_writer_t writer(dest.thread, dest.mailbox_id, callback);
+        raw_mailbox_writer_t writer(dest.thread, dest.mailbox_id, callback, priority);
         src->message_service->send_message(dest.peer, &writer);
     }
 }
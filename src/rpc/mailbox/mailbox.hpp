@@ -39,7 +39,7 @@ public:
 private:
     friend struct mailbox_manager_t;
     friend class raw_mailbox_writer_t;
-    friend void send(mailbox_manager_t *, address_t, mailbox_write_callback_t *);
+    friend void send(mailbox_manager_t *, address_t, mailbox_write_callback_t *, message_priority_t);
 
     mailbox_manager_t *manager;
     const mailbox_thread_mode_t thread_mode;
@@ -72,9 +72,10 @@ public:
         std::string human_readable() const;
 
     private:
-        friend void send(mailbox_manager_t *, raw_mailbox_t::address_t, mailbox_write_callback_t *callback);
+        friend void send(mailbox_manager_t *, raw_mailbox_t::address_t, mailbox_write_callback_t *callback, message_priority_t);
         friend struct raw_mailbox_t;
         friend struct mailbox_manager_t;
+        friend class raw_mailbox_writer_t;
 
         RDB_MAKE_ME_SERIALIZABLE_3(peer, thread, mailbox_id);
 
@@ -97,11 +98,13 @@ public:
 
 /* `send()` sends a message to a mailbox. It is safe to call `send()` outside of
 a coroutine; it does not block. If the mailbox does not exist or the peer is
-inaccessible, `send()` will silently fail. */
+inaccessible, `send()` will silently fail. `priority` only matters if the
+mailbox is on another peer. */
 
 void send(mailbox_manager_t *src,
           raw_mailbox_t::address_t dest,
-          mailbox_write_callback_t *callback);
+          mailbox_write_callback_t *callback,
+          message_priority_t priority = MESSAGE_PRIORITY_DEFAULT);
 
 /* `mailbox_manager_t` uses a `message_service_t` to provide mailbox capability.
 Usually you will split a `message_service_t` into several sub-services using
@@ -121,7 +124,7 @@ public:
 
 private:
     friend struct raw_mailbox_t;
-    friend void send(mailbox_manager_t *, raw_mailbox_t::address_t, mailbox_write_callback_t *callback);
+    friend void send(mailbox_manager_t *, raw_mailbox_t::address_t, mailbox_write_callback_t *callback, message_priority_t);
 
     message_service_t *message_service;
 
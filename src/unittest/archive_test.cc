@@ -36,6 +36,19 @@ TEST(WriteMessageTest, Variant) {
     ASSERT_EQ(22u, u.size());
 }
 
+TEST(WriteMessageTest, CountOnly) {
+    std::vector<std::string> v(3, std::string(5000, 'x'));
+
+    write_message_t msg;
+    msg << v;
+
+    write_message_t counter(write_message_t::COUNT_ONLY);
+    counter << v;
+
+    ASSERT_EQ(msg.size(), counter.size());
+    ASSERT_TRUE(counter.unsafe_expose_buffers()->empty());
+}
+
 
 
 }  // namespace unittest
@@ -1,4 +1,7 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
+#include <set>
+#include <string>
+
 #include "unittest/gtest.hpp"
 #include "clustering/immediate_consistency/branch/backfiller.hpp"
 #include "clustering/immediate_consistency/branch/backfillee.hpp"
@@ -22,7 +25,9 @@ boost::optional<boost::optional<backfiller_business_card_t<dummy_protocol_t> > >
 
 }   /* anonymous namespace */
 
-void run_backfill_test() {
+/* `value_size` pads out the values, so that the backfill outgrows its window and
+has to wait for the backfillee to hand some of it back. */
+void run_backfill_test(size_t value_size) {
 
     order_source_t order_source;
 
@@ -70,6 +75,7 @@ void run_backfill_test() {
         dummy_protocol_t::write_response_t response;
         std::string key = std::string(1, 'a' + randint(26));
         w.values[key] = strprintf("%d", i);
+        w.values[key].resize(std::max(value_size, w.values[key].size()), 'x');
 
         for (int j = 0; j < (i < 10 ? 2 : 1); j++) {
             transition_timestamp_t ts = transition_timestamp_t::starting_from(timestamp);
@@ -160,8 +166,194 @@ void run_backfill_test() {
     //EXPECT_TRUE(backfillee_metadata[0].second.is_coherent());
     //EXPECT_EQ(timestamp, backfillee_metadata[0].second.earliest.timestamp);
 }
+/* Remembers which keys it was sent chunks for, and pulses `interruptor` once
+it has been given `metainfo_writes_before_interrupt` more metainfos. */
+class interrupting_store_t : public dummy_protocol_t::store_t {
+public:
+    interrupting_store_t() : metainfo_writes_before_interrupt(-1), interruptor(NULL) { }
+
+    void set_metainfo(const metainfo_t &new_metainfo,
+                      order_token_t order_token,
+                      object_buffer_t<fifo_enforcer_sink_t::exit_write_t> *token,
+                      signal_t *interruptor_) THROWS_ONLY(interrupted_exc_t) {
+        dummy_protocol_t::store_t::set_metainfo(new_metainfo, order_token, token, interruptor_);
+        if (interruptor != NULL && --metainfo_writes_before_interrupt == 0) {
+            interruptor->pulse_if_not_already_pulsed();
+        }
+    }
+
+    void receive_backfill(const dummy_protocol_t::backfill_chunk_t &chunk,
+                          object_buffer_t<fifo_enforcer_sink_t::exit_write_t> *token,
+                          signal_t *interruptor_) THROWS_ONLY(interrupted_exc_t) {
+        received.insert(chunk.key);
+        dummy_protocol_t::store_t::receive_backfill(chunk, token, interruptor_);
+    }
+
+    int metainfo_writes_before_interrupt;
+    cond_t *interruptor;
+    std::set<std::string> received;
+};
+
+/* Interrupts a backfill right after it has checkpointed its progress, then
+checks that the checkpoint only claims keys that really were backfilled, and
+that a second backfill picks up where the first one left off. */
+void run_interrupted_backfill_test() {
+    order_source_t order_source;
+
+    dummy_protocol_t::region_t region;
+    for (char c = 'a'; c <= 'z'; c++) {
+        region.keys.insert(std::string(&c, 1));
+    }
+
+    dummy_protocol_t::store_t backfiller_store;
+    interrupting_store_t backfillee_store;
+
+    mock::in_memory_branch_history_manager_t<mock::dummy_protocol_t> branch_history_manager;
+    branch_id_t dummy_branch_id = generate_uuid();
+    {
+        branch_birth_certificate_t<dummy_protocol_t> dummy_branch;
+        dummy_branch.region = region;
+        dummy_branch.initial_timestamp = state_timestamp_t::zero();
+        dummy_branch.origin = region_map_t<dummy_protocol_t, version_range_t>(
+            region, version_range_t(version_t(nil_uuid(), state_timestamp_t::zero())));
+        cond_t non_interruptor;
+        branch_history_manager.create_branch(dummy_branch_id, dummy_branch, &non_interruptor);
+    }
+
+    state_timestamp_t timestamp = state_timestamp_t::zero();
+
+    store_view_t<dummy_protocol_t> *stores[] = { &backfiller_store, &backfillee_store };
+    for (size_t i = 0; i < sizeof(stores) / sizeof(stores[0]); i++) {
+        cond_t non_interruptor;
+        object_buffer_t<fifo_enforcer_sink_t::exit_write_t> token;
+        stores[i]->new_write_token(&token);
+        stores[i]->set_metainfo(
+            region_map_t<dummy_protocol_t, binary_blob_t>(region,
+                                                          binary_blob_t(version_range_t(version_t(dummy_branch_id, timestamp)))),
+            order_source.check_in(strprintf("set_metainfo(i=%zu)", i)),
+            &token,
+            &non_interruptor);
+    }
+
+    /* Each of 'a' to 'j' gets its own chunk. */
+    for (int i = 0; i < 10; i++) {
+        dummy_protocol_t::write_t w;
+        dummy_protocol_t::write_response_t response;
+        w.values[std::string(1, 'a' + i)] = strprintf("%d", i);
+
+        transition_timestamp_t ts = transition_timestamp_t::starting_from(timestamp);
+        timestamp = ts.timestamp_after();
+
+        cond_t non_interruptor;
+        object_buffer_t<fifo_enforcer_sink_t::exit_write_t> token;
+        backfiller_store.new_write_token(&token);
+
+#ifndef NDEBUG
+        mock::equality_metainfo_checker_callback_t<dummy_protocol_t>
+            metainfo_checker_callback(binary_blob_t(version_range_t(version_t(dummy_branch_id, ts.timestamp_before()))));
+        metainfo_checker_t<dummy_protocol_t> metainfo_checker(&metainfo_checker_callback, region);
+#endif
+
+        backfiller_store.write(
+            DEBUG_ONLY(metainfo_checker, )
+            region_map_t<dummy_protocol_t, binary_blob_t>(
+                region,
+                binary_blob_t(version_range_t(version_t(dummy_branch_id, timestamp)))
+            ),
+            w, &response, ts,
+            order_source.check_in(strprintf("backfiller_store.write(i=%d)", i)),
+            &token,
+            &non_interruptor);
+    }
+    const version_range_t end_point(version_t(dummy_branch_id, timestamp));
+
+    mock::simple_mailbox_cluster_t cluster;
+
+    backfiller_t<dummy_protocol_t> backfiller(
+        cluster.get_mailbox_manager(),
+        &branch_history_manager,
+        &backfiller_store);
+
+    watchable_variable_t<boost::optional<backfiller_business_card_t<dummy_protocol_t> > > pseudo_directory(
+        boost::optional<backfiller_business_card_t<dummy_protocol_t> >(backfiller.get_business_card()));
+
+    /* The first metainfo the backfillee writes marks the whole region as being
+    backfilled; the second is the first checkpoint. With a one-byte threshold,
+    that comes right after the first chunk that finishes after a checkpoint
+    message arrives. */
+    cond_t first_interruptor;
+    backfillee_store.interruptor = &first_interruptor;
+    backfillee_store.metainfo_writes_before_interrupt = 2;
+    try {
+        backfillee<dummy_protocol_t>(
+            cluster.get_mailbox_manager(),
+            &branch_history_manager,
+            &backfillee_store,
+            backfillee_store.get_region(),
+            pseudo_directory.get_watchable()->subview(&wrap_in_optional),
+            generate_uuid(),
+            &first_interruptor,
+            1);
+    } catch (const interrupted_exc_t &) {
+        /* The checkpoint may have come after the last chunk, in which case the
+        backfill finishes anyway; either way the checks below must hold. */
+    }
+    backfillee_store.interruptor = NULL;
+
+    std::set<std::string> done, left;
+    {
+        cond_t non_interruptor;
+        object_buffer_t<fifo_enforcer_sink_t::exit_read_t> token;
+        backfillee_store.new_read_token(&token);
+        region_map_t<dummy_protocol_t, binary_blob_t> metainfo;
+        backfillee_store.do_get_metainfo(order_source.check_in("backfillee_store.do_get_metainfo").with_read_mode(),
+                                         &token, &non_interruptor, &metainfo);
+        for (region_map_t<dummy_protocol_t, binary_blob_t>::iterator it = metainfo.begin(); it != metainfo.end(); ++it) {
+            std::set<std::string> *keys = binary_blob_t::get<version_range_t>(it->second) == end_point ? &done : &left;
+            keys->insert(it->first.keys.begin(), it->first.keys.end());
+        }
+    }
+
+    /* The checkpoint can only have claimed keys whose chunks were applied. */
+    EXPECT_FALSE(done.empty());
+    for (std::set<std::string>::iterator it = done.begin(); it != done.end(); ++it) {
+        EXPECT_EQ(backfiller_store.values[*it], backfillee_store.values[*it]);
+        EXPECT_TRUE(backfiller_store.timestamps[*it] == backfillee_store.timestamps[*it]);
+    }
+
+    /* The next backfill only sends what is left. */
+    backfillee_store.received.clear();
+    cond_t second_interruptor;
+    backfillee<dummy_protocol_t>(
+        cluster.get_mailbox_manager(),
+        &branch_history_manager,
+        &backfillee_store,
+        backfillee_store.get_region(),
+        pseudo_directory.get_watchable()->subview(&wrap_in_optional),
+        generate_uuid(),
+        &second_interruptor,
+        1);
+
+    for (std::set<std::string>::iterator it = backfillee_store.received.begin(); it != backfillee_store.received.end(); ++it) {
+        EXPECT_EQ(0u, done.count(*it)) << "resent " << *it;
+    }
+    for (char c = 'a'; c <= 'z'; c++) {
+        std::string key(1, c);
+        EXPECT_EQ(backfiller_store.values[key], backfillee_store.values[key]);
+        EXPECT_TRUE(backfiller_store.timestamps[key] == backfillee_store.timestamps[key]);
+    }
+}
+
 TEST(ClusteringBackfill, BackfillTest) {
-    mock::run_in_thread_pool(&run_backfill_test);
+    mock::run_in_thread_pool(boost::bind(&run_backfill_test, 0));
+}
+
+TEST(ClusteringBackfill, BackfillLargeValues) {
+    mock::run_in_thread_pool(boost::bind(&run_backfill_test, BACKFILL_WINDOW_BYTES / 5));
+}
+
+TEST(ClusteringBackfill, ResumeAfterCheckpoint) {
+    mock::run_in_thread_pool(&run_interrupted_backfill_test);
 }
 
 }   /* namespace unittest */
@@ -1,9 +1,17 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "arch/runtime/context_switching.hpp"
 
+#include <stdio.h>
+#include <string.h>
+
 #include <stdexcept>
 
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
 #include "containers/scoped.hpp"
+#include "mock/unittest_utils.hpp"
 #include "unittest/gtest.hpp"
 
 namespace unittest {
@@ -89,6 +97,149 @@ TEST(ContextSwitchingTest, SwitchBetweenContexts) {
     original_context = NULL;
 }
 
+static void use_lots_of_stack() {
+    /* Touch a good part of the stack, then go back and check it's intact. */
+    char buffer[256 * 1024];
+    memset(buffer, 'x', sizeof(buffer));
+    context_switch(artificial_stack_1_context, original_context);
+    for (size_t i = 0; i < sizeof(buffer); i += 4096) {
+        if (buffer[i] == 'x') {
+            test_int++;
+        }
+    }
+}
+
+static void reuse_stack_test(void) {
+    while (true) {
+        use_lots_of_stack();
+        context_switch(artificial_stack_1_context, original_context);
+    }
+}
+
+TEST(ContextSwitchingTest, ReleaseUnusedPages) {
+    scoped_ptr_t<context_ref_t> orig_context_local(new context_ref_t);
+    original_context = orig_context_local.get();
+    test_int = 0;
+    {
+        artificial_stack_t a(&reuse_stack_test, 1024*1024);
+        artificial_stack_1_context = &a.context;
+
+        for (int i = 0; i < 3; ++i) {
+            /* Run `use_lots_of_stack()` up to its switch and then to the end,
+            which leaves us parked at the top of the stack again. */
+            context_switch(original_context, artificial_stack_1_context);
+            context_switch(original_context, artificial_stack_1_context);
+
+            /* Everything but the top of the stack is dead now, so giving the
+            pages back must not break anything. */
+            a.release_unused_pages(8 * 1024);
+        }
+        EXPECT_FALSE(a.context.is_nil());
+    }
+    EXPECT_EQ(3 * 64, test_int);
+    original_context = NULL;
+}
+
+static void ping_pong(void) {
+    while (true) {
+        ++test_int;
+        context_switch(artificial_stack_1_context, original_context);
+    }
+}
+
+/* Switching back and forth many times must always land where it left off,
+without the stacks drifting. */
+TEST(ContextSwitchingTest, ManyRoundTrips) {
+    scoped_ptr_t<context_ref_t> orig_context_local(new context_ref_t);
+    original_context = orig_context_local.get();
+    test_int = 0;
+    {
+        artificial_stack_t a(&ping_pong, 128*1024);
+        artificial_stack_1_context = &a.context;
+
+        const int round_trips = 100000;
+        for (int i = 0; i < round_trips; ++i) {
+            context_switch(original_context, artificial_stack_1_context);
+            ASSERT_EQ(i + 1, test_int);
+        }
+        EXPECT_FALSE(a.context.is_nil());
+    }
+    original_context = NULL;
+}
+
+static void count_coroutine(int *count) {
+    ++*count;
+}
+
+void run_coroutine_spawn_waves_test() {
+    /* Spawn in waves wider than the number of stacks kept resident, so both
+    warm and released stacks get reused. Every coroutine must still run. */
+    const int waves = 20;
+    const int coros_per_wave = 2 * COROUTINE_IDLE_STACKS_RESIDENT;
+    int count = 0;
+
+    for (int i = 0; i < waves; ++i) {
+        for (int j = 0; j < coros_per_wave; ++j) {
+            coro_t::spawn_sometime(boost::bind(&count_coroutine, &count));
+        }
+        while (count < (i + 1) * coros_per_wave) {
+            coro_t::yield();
+        }
+        EXPECT_EQ((i + 1) * coros_per_wave, count);
+    }
+}
+
+TEST(ContextSwitchingTest, CoroutineSpawnWaves) {
+    mock::run_in_thread_pool(&run_coroutine_spawn_waves_test);
+}
+
+/* The benchmarks below only print how fast things are, so they are disabled;
+run them with `--gtest_also_run_disabled_tests --gtest_filter=*Benchmark*`. */
+
+TEST(ContextSwitchingTest, DISABLED_SwitchBenchmark) {
+    scoped_ptr_t<context_ref_t> orig_context_local(new context_ref_t);
+    original_context = orig_context_local.get();
+    {
+        artificial_stack_t a(&ping_pong, 128*1024);
+        artificial_stack_1_context = &a.context;
+
+        const int round_trips = 1000000;
+        ticks_t start = get_ticks();
+        for (int i = 0; i < round_trips; ++i) {
+            context_switch(original_context, artificial_stack_1_context);
+        }
+        double secs = ticks_to_secs(get_ticks() - start);
+        printf("Context switching: %d round trips in %.3fs, %.1f ns per switch\n",
+               round_trips, secs, secs * 1e9 / (2 * round_trips));
+    }
+    original_context = NULL;
+}
+
+void run_coroutine_spawn_benchmark() {
+    const int waves = 100;
+    const int coros_per_wave = 2 * COROUTINE_IDLE_STACKS_RESIDENT;
+    int count = 0;
+
+    ticks_t start = get_ticks();
+    for (int i = 0; i < waves; ++i) {
+        for (int j = 0; j < coros_per_wave; ++j) {
+            coro_t::spawn_sometime(boost::bind(&count_coroutine, &count));
+        }
+        while (count < (i + 1) * coros_per_wave) {
+            coro_t::yield();
+        }
+    }
+    double secs = ticks_to_secs(get_ticks() - start);
+
+    EXPECT_EQ(waves * coros_per_wave, count);
+    printf("Coroutine spawn: %d coroutines in %.3fs, %.0f per second\n",
+           count, secs, count / secs);
+}
+
+TEST(ContextSwitchingTest, DISABLED_CoroutineSpawnBenchmark) {
+    mock::run_in_thread_pool(&run_coroutine_spawn_benchmark);
+}
+
 __attribute__((noreturn)) static void throw_an_exception() {
     throw std::runtime_error("This is a test exception");
 }
@@ -14,15 +14,18 @@
 // ----- Infrastructure
 typedef void (*test_t)(extproc::pool_t *pool);
 
-static void run_extproc_test(extproc::spawner_t::info_t *spawner_info, test_t func) {
-    extproc::pool_group_t pool_group(spawner_info, extproc::pool_group_t::DEFAULTS);
+static void run_extproc_test(extproc::spawner_t::info_t *spawner_info, test_t func,
+                             bool use_shared_memory) {
+    extproc::pool_group_t::config_t config;
+    config.use_shared_memory = use_shared_memory;
+    extproc::pool_group_t pool_group(spawner_info, config);
     func(pool_group.get());
 }
 
-static void main_extproc_test(test_t func) {
+static void main_extproc_test(test_t func, bool use_shared_memory = false) {
     extproc::spawner_t::info_t spawner_info;
     extproc::spawner_t::create(&spawner_info);
-    mock::run_in_thread_pool(boost::bind(run_extproc_test, &spawner_info, func));
+    mock::run_in_thread_pool(boost::bind(run_extproc_test, &spawner_info, func, use_shared_memory));
 }
 
 int fib(int n) {
@@ -88,6 +91,21 @@ struct collatz_job_t : extproc::auto_job_t<collatz_job_t> {
     }
 };
 
+struct echo_job_t : extproc::auto_job_t<echo_job_t> {
+    // Sends back a string it receives.
+    echo_job_t() {}
+
+    RDB_MAKE_ME_SERIALIZABLE_0();
+
+    void run_job(control_t *control, UNUSED void *extra) {
+        std::string s;
+        guarantee(ARCHIVE_SUCCESS == deserialize(control, &s));
+        write_message_t msg;
+        msg << s;
+        guarantee(0 == send_write_message(control, &msg));
+    }
+};
+
 struct job_loop_t : extproc::auto_job_t<job_loop_t> {
     // Receives a job and runs it.
     job_loop_t() {}
@@ -122,6 +140,7 @@ void run_simplejob_test(extproc::pool_t *pool) {
 }
 
 TEST(ExtProc, SimpleJob) { main_extproc_test(run_simplejob_test); }
+TEST(ExtProc, SimpleJobSharedMemory) { main_extproc_test(run_simplejob_test, true); }
 
 void run_talkativejob_test(extproc::pool_t *pool) {
     int n = 78;                 // takes 35 iterations to reach 1
@@ -145,6 +164,33 @@ void run_talkativejob_test(extproc::pool_t *pool) {
 }
 
 TEST(ExtProc, TalkativeJob) { main_extproc_test(run_talkativejob_test); }
+TEST(ExtProc, TalkativeJobSharedMemory) { main_extproc_test(run_talkativejob_test, true); }
+
+void run_bigmessage_test(extproc::pool_t *pool) {
+    // Bigger than a shared memory ring, so that both sides have to wait for
+    // each other.
+    std::string big(3 * extproc::shm_channel_t::RING_SIZE + 17, 'x');
+    for (size_t i = 0; i < big.size(); i += 4093) {
+        big[i] = 'a' + i % 26;
+    }
+
+    extproc::job_handle_t handle;
+    ASSERT_EQ(0, handle.begin(pool, echo_job_t()));
+    {
+        write_message_t msg;
+        msg << big;
+        ASSERT_EQ(0, send_write_message(&handle, &msg));
+    }
+
+    std::string result;
+    ASSERT_EQ(ARCHIVE_SUCCESS, deserialize(&handle, &result));
+    ASSERT_TRUE(big == result);
+
+    handle.release();
+}
+
+TEST(ExtProc, BigMessage) { main_extproc_test(run_bigmessage_test); }
+TEST(ExtProc, BigMessageSharedMemory) { main_extproc_test(run_bigmessage_test, true); }
 
 void run_serialjob_test(extproc::pool_t *pool) {
     extproc::job_handle_t handle;
@@ -184,6 +230,7 @@ void run_serialjob_test(extproc::pool_t *pool) {
 }
 
 TEST(ExtProc, SerialJob) { main_extproc_test(run_serialjob_test); }
+TEST(ExtProc, SerialJobSharedMemory) { main_extproc_test(run_serialjob_test, true); }
 
 void run_interruptjob_test(extproc::pool_t *pool) {
     const int n = 78;           // takes 35 iterations to reach 1
@@ -210,6 +257,7 @@ void run_interruptjob_test(extproc::pool_t *pool) {
 }
 
 TEST(ExtProc, InterruptJob) { main_extproc_test(run_interruptjob_test); }
+TEST(ExtProc, InterruptJobSharedMemory) { main_extproc_test(run_interruptjob_test, true); }
 
 void run_multijob_test(extproc::spawner_t::info_t *spawner_info) {
     extproc::pool_group_t::config_t config;
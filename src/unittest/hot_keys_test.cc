@@ -0,0 +1,58 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "btree/hot_keys.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+static void record(top_keys_t *top, const std::string &key, int times) {
+    for (int i = 0; i < times; ++i) {
+        top->record(reinterpret_cast<const uint8_t *>(key.data()), key.size());
+    }
+}
+
+static std::string key_string(const store_key_t &key) {
+    return std::string(reinterpret_cast<const char *>(key.contents()), key.size());
+}
+
+TEST(HotKeysTest, FindsMostFrequent) {
+    top_keys_t top;
+    for (int i = 0; i < 1000; ++i) {
+        record(&top, strprintf("cold%d", i), 1);
+    }
+    record(&top, "hot", 500);
+    record(&top, "warm", 100);
+    for (int i = 1000; i < 2000; ++i) {
+        record(&top, strprintf("cold%d", i), 1);
+    }
+
+    std::vector<hot_key_t> hot;
+    top.get_top(2, &hot);
+    ASSERT_EQ(2u, hot.size());
+    EXPECT_EQ("hot", key_string(hot[0].key));
+    EXPECT_LE(500u, hot[0].count);
+    EXPECT_EQ("warm", key_string(hot[1].key));
+    EXPECT_LE(100u, hot[1].count);
+}
+
+TEST(HotKeysTest, SlowOps) {
+    hot_key_tracker_t tracker;
+    key_range_t range(key_range_t::closed, store_key_t("a"), key_range_t::closed, store_key_t("a"));
+
+    tracker.record_op(false, range, 0, 0, 1, 0);
+    hot_keys_report_t report;
+    tracker.get_report(HOT_KEYS_TRACKED, &report);
+    EXPECT_TRUE(report.slow_ops.empty());
+
+    ticks_t slow = secs_to_ticks(1);
+    for (int i = 0; i < SLOW_OP_LOG_SIZE + 1; ++i) {
+        tracker.record_op(i % 2 == 0, range, 0, slow / 4, slow, slow / 2);
+    }
+    tracker.get_report(HOT_KEYS_TRACKED, &report);
+    ASSERT_EQ(static_cast<size_t>(SLOW_OP_LOG_SIZE), report.slow_ops.size());
+    EXPECT_TRUE(report.slow_ops.back().is_write);
+    EXPECT_DOUBLE_EQ(1.0, report.slow_ops.back().duration);
+    EXPECT_DOUBLE_EQ(0.25, report.slow_ops.back().lock_wait);
+    EXPECT_DOUBLE_EQ(0.5, report.slow_ops.back().io);
+}
+
+}  // namespace unittest
@@ -3,6 +3,7 @@
 
 #include "unittest/gtest.hpp"
 #include "http/http.hpp"
+#include "http/json.hpp"
 
 namespace unittest {
 
@@ -14,4 +15,34 @@ TEST(Http, FormatTime) {
 
 }
 
+TEST(Http, CacheableJsonRes) {
+    http_req_t req("/");
+    scoped_cJSON_t json(cJSON_Parse("{\"a\": [1, 2]}"));
+    http_res_t res = http_cacheable_json_res(req, &json);
+    EXPECT_EQ(HTTP_OK, res.code);
+    ASSERT_TRUE(res.json_body);
+
+    std::string etag;
+    for (size_t i = 0; i < res.header_lines.size(); ++i) {
+        if (res.header_lines[i].key == "ETag") {
+            etag = res.header_lines[i].val;
+        }
+    }
+    ASSERT_EQ(0u, etag.find("W/\""));
+
+    header_line_t if_none_match;
+    if_none_match.key = "If-None-Match";
+    if_none_match.val = etag;
+    req.header_lines.push_back(if_none_match);
+
+    json.reset(cJSON_Parse("{\"a\": [1, 2]}"));
+    res = http_cacheable_json_res(req, &json);
+    EXPECT_EQ(HTTP_NOT_MODIFIED, res.code);
+    EXPECT_FALSE(res.json_body);
+
+    json.reset(cJSON_Parse("{\"a\": [2, 1]}"));
+    res = http_cacheable_json_res(req, &json);
+    EXPECT_EQ(HTTP_OK, res.code);
+}
+
 }
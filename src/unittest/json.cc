@@ -1,12 +1,16 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
 #include "unittest/gtest.hpp"
 
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
 #include "http/json.hpp"
 #include "rdb_protocol/rdb_protocol_json.hpp"
 #include "utils.hpp"
 #include "http/json/json_adapter.hpp"
 
 using query_language::json_cmp;
+using query_language::json_hash;
 
 int sign(int x) {
     return (0 < x) - (x < 0);
@@ -223,4 +227,66 @@ namespace unittest {
             }
         }
     }
+
+    TEST(JSON, Hash) {
+        //values that compare equal must hash equal
+        scoped_cJSON_t l(cJSON_Parse("{\"a\": [1, 2, {\"b\": null}], \"c\": \"d\", \"e\": true}"));
+        scoped_cJSON_t r(cJSON_Parse("{\"e\": true, \"c\": \"d\", \"a\": [1.0, 2, {\"b\": null}]}"));
+        ASSERT_EQ(0, json_cmp(l.get(), r.get()));
+        ASSERT_EQ(json_hash(l.get()), json_hash(r.get()));
+
+        scoped_cJSON_t zero(cJSON_CreateNumber(0)), negative_zero(cJSON_CreateNumber(-0.0));
+        ASSERT_EQ(json_hash(zero.get()), json_hash(negative_zero.get()));
+
+        //array order matters
+        scoped_cJSON_t a1(cJSON_Parse("[1, 2]")), a2(cJSON_Parse("[2, 1]"));
+        ASSERT_NE(json_hash(a1.get()), json_hash(a2.get()));
+
+        //distinct strings rarely collide
+        std::set<uint64_t> hashes;
+        for (int i = 0; i < 10000; ++i) {
+            scoped_cJSON_t s(cJSON_CreateString(strprintf("%d", i).c_str()));
+            hashes.insert(json_hash(s.get()));
+        }
+        ASSERT_EQ(10000u, hashes.size());
+    }
+
+    void append_piece(std::vector<std::string> *pieces, const std::string &piece) {
+        pieces->push_back(piece);
+    }
+
+    TEST(JSON, PrintStreamed) {
+        scoped_cJSON_t json(cJSON_Parse("{\"a\": [1, 2.5, {\"b\": null}], \"c\\\"\": \"d\\n\", \"e\": true, \"f\": {}, \"g\": []}"));
+        ASSERT_TRUE(json.get() != NULL);
+        std::string expected = json.PrintUnformatted();
+
+        for (size_t chunk_size = 1; chunk_size <= expected.size() + 1; ++chunk_size) {
+            std::vector<std::string> pieces;
+            cJSON_print_streamed(json.get(), chunk_size, boost::bind(&append_piece, &pieces, _1));
+            std::string joined;
+            for (size_t i = 0; i < pieces.size(); ++i) {
+                ASSERT_FALSE(pieces[i].empty());
+                joined += pieces[i];
+            }
+            ASSERT_EQ(expected, joined);
+        }
+    }
+
+    TEST(JSON, Diff) {
+        scoped_cJSON_t from(cJSON_Parse("{\"a\": {\"b\": 1, \"c\": [1, 2], \"d\": {\"e\": null}}, \"f\": \"g\", \"h\": 3}"));
+        scoped_cJSON_t to(cJSON_Parse("{\"h\": 3, \"a\": {\"c\": [1, 2, 3], \"b\": 1, \"d\": {}}, \"f\": {\"i\": true}, \"j\": false}"));
+        scoped_cJSON_t changed, deleted;
+        ASSERT_TRUE(json_diff(from.get(), to.get(), &changed, &deleted));
+
+        scoped_cJSON_t expected_changed(cJSON_Parse("{\"a\": {\"c\": [1, 2, 3]}, \"f\": {\"i\": true}, \"j\": false}"));
+        scoped_cJSON_t expected_deleted(cJSON_Parse("[[\"a\", \"d\", \"e\"]]"));
+        EXPECT_TRUE(json_equal(expected_changed.get(), changed.get()));
+        EXPECT_TRUE(json_equal(expected_deleted.get(), deleted.get()));
+
+        // The order of object members doesn't matter.
+        scoped_cJSON_t reordered(cJSON_Parse("{\"f\": {\"i\": true}, \"j\": false, \"h\": 3, \"a\": {\"d\": {}, \"b\": 1, \"c\": [1, 2, 3]}}"));
+        EXPECT_FALSE(json_diff(to.get(), reordered.get(), &changed, &deleted));
+        EXPECT_EQ(0, changed.GetArraySize());
+        EXPECT_EQ(0, deleted.GetArraySize());
+    }
 } //namespace unittest
@@ -1,6 +1,9 @@
 // Copyright 2010-2012 RethinkDB, all rights reserved.
+#include <stdio.h>
+
 #include "errors.hpp"
 #include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
 
 #include "mock/unittest_utils.hpp"
 
@@ -59,3 +62,116 @@ void run_timeout_test(js::runner_t *runner) {
 }
 
 TEST(JSProc, Timeout) { main_jsproc_test(run_timeout_test); }
+
+static boost::shared_ptr<scoped_cJSON_t> make_number(double x) {
+    return boost::make_shared<scoped_cJSON_t>(cJSON_CreateNumber(x));
+}
+
+void run_compile_cache_test(js::runner_t *runner) {
+    std::vector<std::string> args(1, "x");
+    std::string errmsg;
+
+    id_t id = runner->compile(args, "x + 1", &errmsg);
+    ASSERT_NE(js::INVALID_ID, id);
+
+    // Compiling the same function again shouldn't give us a new one.
+    ASSERT_EQ(id, runner->compile(args, "x + 1", &errmsg));
+    ASSERT_NE(id, runner->compile(args, "x + 2", &errmsg));
+}
+
+TEST(JSProc, CompileCache) { main_jsproc_test(run_compile_cache_test); }
+
+// Workers cache compiled functions between jobs, but a function must not see
+// globals that another job's function wrote on the same worker.
+static void run_isolation_test(extproc::spawner_t::info_t *spawner_info) {
+    extproc::pool_group_t pool_group(spawner_info, extproc::pool_group_t::DEFAULTS);
+    extproc::worker_affinity_t affinity;
+    const std::string src = "leaked = (typeof leaked == 'undefined' ? 0 : leaked) + 1";
+    for (int i = 0; i < 2; ++i) {
+        js::runner_t runner(&affinity);
+        runner.begin(pool_group.get());
+        std::string errmsg;
+        id_t id = runner.compile(std::vector<std::string>(), src, &errmsg);
+        ASSERT_NE(js::INVALID_ID, id);
+        boost::shared_ptr<scoped_cJSON_t> res = runner.call(id,
+                                                            boost::shared_ptr<scoped_cJSON_t>(),
+                                                            std::vector<boost::shared_ptr<scoped_cJSON_t> >(),
+                                                            &errmsg);
+        ASSERT_TRUE(res.get() != NULL) << errmsg;
+        ASSERT_EQ(cJSON_Number, res->type());
+        ASSERT_EQ(1, res->get()->valuedouble);
+        runner.finish();
+    }
+}
+
+TEST(JSProc, Isolation) {
+    extproc::spawner_t::info_t spawner_info;
+    extproc::spawner_t::create(&spawner_info);
+    mock::run_in_thread_pool(boost::bind(run_isolation_test, &spawner_info));
+}
+
+void run_call_batch_test(js::runner_t *runner) {
+    std::string errmsg;
+    id_t id = runner->compile(std::vector<std::string>(1, "x"), "x * 2", &errmsg);
+    ASSERT_NE(js::INVALID_ID, id);
+
+    const size_t n = 10;
+    std::vector<boost::shared_ptr<scoped_cJSON_t> > objects(n);
+    std::vector<std::vector<boost::shared_ptr<scoped_cJSON_t> > > args(n);
+    for (size_t i = 0; i < n; ++i) {
+        args[i].push_back(make_number(i));
+    }
+
+    std::vector<boost::shared_ptr<scoped_cJSON_t> > results;
+    ASSERT_TRUE(runner->call_batch(id, objects, args, &results, &errmsg)) << errmsg;
+    ASSERT_EQ(n, results.size());
+    for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(cJSON_Number, results[i]->type());
+        ASSERT_EQ(static_cast<double>(2 * i), results[i]->get()->valuedouble);
+    }
+
+    // One failing call fails the whole batch.
+    id_t bad_id = runner->compile(std::vector<std::string>(1, "x"), "if (x == 5) { throw 'five'; } x", &errmsg);
+    ASSERT_NE(js::INVALID_ID, bad_id);
+    ASSERT_FALSE(runner->call_batch(bad_id, objects, args, &results, &errmsg));
+    ASSERT_TRUE(runner->connected());
+}
+
+TEST(JSProc, CallBatch) { main_jsproc_test(run_call_batch_test); }
+
+// Not a pass/fail test; prints how many calls per second we get when calling
+// a function once per document compared to batching the documents. It is
+// disabled; run it with `--gtest_also_run_disabled_tests --gtest_filter=*Benchmark*`.
+void run_throughput_test(js::runner_t *runner) {
+    const size_t num_docs = 10000;
+    const size_t batch_size = 100;
+
+    std::string errmsg;
+    id_t id = runner->compile(std::vector<std::string>(1, "x"), "x + 1", &errmsg);
+    ASSERT_NE(js::INVALID_ID, id);
+
+    ticks_t start = get_ticks();
+    for (size_t i = 0; i < num_docs; ++i) {
+        std::vector<boost::shared_ptr<scoped_cJSON_t> > args(1, make_number(i));
+        ASSERT_TRUE(NULL != runner->call(id, boost::shared_ptr<scoped_cJSON_t>(), args, &errmsg).get());
+    }
+    double single_secs = ticks_to_secs(get_ticks() - start);
+
+    start = get_ticks();
+    for (size_t i = 0; i < num_docs; i += batch_size) {
+        std::vector<boost::shared_ptr<scoped_cJSON_t> > objects(batch_size);
+        std::vector<std::vector<boost::shared_ptr<scoped_cJSON_t> > > args(batch_size);
+        for (size_t j = 0; j < batch_size; ++j) {
+            args[j].push_back(make_number(i + j));
+        }
+        std::vector<boost::shared_ptr<scoped_cJSON_t> > results;
+        ASSERT_TRUE(runner->call_batch(id, objects, args, &results, &errmsg));
+    }
+    double batch_secs = ticks_to_secs(get_ticks() - start);
+
+    printf("JSProc throughput: %zu calls one at a time: %.0f calls/sec; "
+           "in batches of %zu: %.0f calls/sec\n",
+           num_docs, num_docs / single_secs, batch_size, num_docs / batch_secs);
+}
+
+TEST(JSProc, DISABLED_ThroughputBenchmark) { main_jsproc_test(run_throughput_test); }
@@ -4,6 +4,7 @@
 
 #include "buffer_cache/buffer_cache.hpp"
 #include "containers/iterators.hpp"
+#include "memcached/parser.hpp"
 #include "memcached/protocol.hpp"
 #include "serializer/config.hpp"
 #include "serializer/translator.hpp"
@@ -139,5 +140,241 @@ TEST(MemcachedProtocol, GetSet) {
     run_in_thread_pool_with_namespace_interface(&run_get_set_test);
 }
 
-}   /* namespace unittest */
+/* `MultiGet` checks that a multi-get spanning both shards comes back in the order
+the keys were asked for */
+void run_multi_get_test(namespace_interface_t<memcached_protocol_t> *nsi, order_source_t *order_source) {
+    const char *keys_to_set[] = { "a", "z" };
+    for (int i = 0; i < 2; ++i) {
+        sarc_mutation_t set;
+        set.key = store_key_t(keys_to_set[i]);
+        set.data = data_buffer_t::create(1);
+        set.data->buf()[0] = keys_to_set[i][0];
+        set.flags = i;
+        set.exptime = 0;
+        set.add_policy = add_policy_yes;
+        set.replace_policy = replace_policy_yes;
+        memcached_protocol_t::write_t write(set, time(NULL), 12345);
+
+        cond_t interruptor;
+        memcached_protocol_t::write_response_t result;
+        nsi->write(write, &result, order_source->check_in("unittest::run_multi_get_test(memcached_protocol.cc-A)"), &interruptor);
+    }
+
+    std::vector<store_key_t> keys;
+    keys.push_back(store_key_t("z"));
+    keys.push_back(store_key_t("m"));
+    keys.push_back(store_key_t("a"));
+    memcached_protocol_t::read_t read(multi_get_query_t(keys), time(NULL));
+
+    cond_t interruptor;
+    memcached_protocol_t::read_response_t result;
+    nsi->read(read, &result, order_source->check_in("unittest::run_multi_get_test(memcached_protocol.cc-B)").with_read_mode(), &interruptor);
+
+    if (multi_get_result_t *maybe_multi_get_result = boost::get<multi_get_result_t>(&result.result)) {
+        ASSERT_EQ(3u, maybe_multi_get_result->results.size());
+        ASSERT_TRUE(maybe_multi_get_result->results[0].value.get() != NULL);
+        EXPECT_EQ('z', maybe_multi_get_result->results[0].value->buf()[0]);
+        EXPECT_EQ(1u, maybe_multi_get_result->results[0].flags);
+        EXPECT_TRUE(maybe_multi_get_result->results[1].value.get() == NULL);
+        ASSERT_TRUE(maybe_multi_get_result->results[2].value.get() != NULL);
+        EXPECT_EQ('a', maybe_multi_get_result->results[2].value->buf()[0]);
+    } else {
+        ADD_FAILURE() << "got wrong type of result back";
+    }
+}
+TEST(MemcachedProtocol, MultiGet) {
+    run_in_thread_pool_with_namespace_interface(&run_multi_get_test);
+}
+
+/* A `memcached_interface_t` that reads requests from a string and collects the
+responses in another. */
+class string_memcached_interface_t : public memcached_interface_t {
+public:
+    explicit string_memcached_interface_t(const std::string &_input) : input(_input), position(0) { }
+
+    void write(const char *buffer, size_t bytes, UNUSED signal_t *interruptor) {
+        output.append(buffer, bytes);
+    }
+    void write_unbuffered(const char *buffer, size_t bytes, UNUSED signal_t *interruptor) {
+        output.append(buffer, bytes);
+    }
+    void flush_buffer(UNUSED signal_t *interruptor) { }
+    bool is_write_open() { return true; }
+
+    void read(void *buf, size_t nbytes, UNUSED signal_t *interruptor) {
+        if (input.size() - position < nbytes) throw no_more_data_exc_t();
+        memcpy(buf, input.data() + position, nbytes);
+        position += nbytes;
+    }
+    void read_line(std::vector<char> *dest, UNUSED signal_t *interruptor) {
+        size_t crlf = input.find("\r\n", position);
+        if (crlf == std::string::npos) throw no_more_data_exc_t();
+        dest->assign(input.begin() + position, input.begin() + crlf + 2);
+        position = crlf + 2;
+    }
+
+    std::string output;
+
+private:
+    std::string input;
+    size_t position;
+};
+
+void append_be(uint64_t x, int bytes, std::string *out) {
+    for (int i = bytes - 1; i >= 0; --i) {
+        out->push_back(static_cast<char>(x >> (8 * i)));
+    }
+}
+
+uint64_t decode_be(const std::string &s, size_t offset, int bytes) {
+    uint64_t x = 0;
+    for (int i = 0; i < bytes; ++i) {
+        x = (x << 8) | static_cast<uint8_t>(s[offset + i]);
+    }
+    return x;
+}
+
+/* Appends a binary request to `out`; `opaque` tells the responses apart. */
+void append_binary_request(uint8_t opcode, uint32_t opaque, uint64_t cas, const std::string &extras,
+                           const std::string &key, const std::string &value, std::string *out) {
+    append_be(MEMCACHED_BINARY_REQUEST_MAGIC, 1, out);
+    append_be(opcode, 1, out);
+    append_be(key.size(), 2, out);
+    append_be(extras.size(), 1, out);
+    append_be(0, 1, out);   // data type
+    append_be(0, 2, out);   // vbucket
+    append_be(extras.size() + key.size() + value.size(), 4, out);
+    append_be(opaque, 4, out);
+    append_be(cas, 8, out);
+    *out += extras + key + value;
+}
 
+struct binary_response_t {
+    uint64_t status;
+    std::string value;
+};
+
+/* `BinaryCas` checks that a binary set or replace with a CAS only goes through
+if the CAS matches, and that an add, append or prepend with one is refused
+rather than carried out */
+void run_binary_cas_test(namespace_interface_t<memcached_protocol_t> *nsi, UNUSED order_source_t *order_source) {
+    const uint8_t get = 0x00, set = 0x01, add = 0x02, replace = 0x03, append = 0x0e, prepend = 0x0f;
+    const std::string flags_and_exptime(8, '\0');
+
+    std::string requests;
+    append_binary_request(set, 1, 0, flags_and_exptime, "a", "x", &requests);
+    append_binary_request(set, 2, 12345, flags_and_exptime, "a", "y", &requests);
+    append_binary_request(replace, 3, 12345, flags_and_exptime, "b", "y", &requests);
+    append_binary_request(add, 4, 12345, flags_and_exptime, "b", "y", &requests);
+    append_binary_request(append, 5, 12345, "", "a", "z", &requests);
+    append_binary_request(prepend, 6, 12345, "", "a", "z", &requests);
+    append_binary_request(get, 7, 0, "", "a", "", &requests);
+    append_binary_request(get, 8, 0, "", "b", "", &requests);
+
+    string_memcached_interface_t interface(requests);
+    perfmon_collection_t stats_collection;
+    memcached_stats_t stats(&stats_collection);
+    cond_t interruptor;
+    handle_memcache_binary(&interface, nsi, 16, &stats, &interruptor);
+
+    std::map<uint64_t, binary_response_t> responses;
+    const std::string &out = interface.output;
+    for (size_t offset = 0; offset + 24 <= out.size();) {
+        ASSERT_EQ(0x81u, decode_be(out, offset, 1));
+        size_t key_size = decode_be(out, offset + 2, 2);
+        size_t extras_size = decode_be(out, offset + 4, 1);
+        size_t body_size = decode_be(out, offset + 8, 4);
+        ASSERT_LE(offset + 24 + body_size, out.size());
+        binary_response_t *response = &responses[decode_be(out, offset + 12, 4)];
+        response->status = decode_be(out, offset + 6, 2);
+        response->value = out.substr(offset + 24 + extras_size + key_size, body_size - extras_size - key_size);
+        offset += 24 + body_size;
+    }
+
+    ASSERT_EQ(8u, responses.size());
+    EXPECT_EQ(0x0000u, responses[1].status);
+    // "Key exists": the CAS didn't match.
+    EXPECT_EQ(0x0002u, responses[2].status);
+    // "Key not found": there was nothing to compare the CAS with.
+    EXPECT_EQ(0x0001u, responses[3].status);
+    // "Invalid arguments"
+    EXPECT_EQ(0x0004u, responses[4].status);
+    EXPECT_EQ(0x0004u, responses[5].status);
+    EXPECT_EQ(0x0004u, responses[6].status);
+    EXPECT_EQ(0x0000u, responses[7].status);
+    EXPECT_EQ("x", responses[7].value);
+    EXPECT_EQ(0x0001u, responses[8].status);
+}
+TEST(MemcachedProtocol, BinaryCas) {
+    run_in_thread_pool_with_namespace_interface(&run_binary_cas_test);
+}
+
+/* A namespace interface whose shard from "n" up can't be reached. */
+class shard_down_namespace_interface_t : public namespace_interface_t<memcached_protocol_t> {
+public:
+    explicit shard_down_namespace_interface_t(namespace_interface_t<memcached_protocol_t> *_inner) :
+        inner(_inner),
+        up(key_range_t(key_range_t::none, store_key_t(), key_range_t::open, store_key_t("n"))),
+        down(key_range_t(key_range_t::closed, store_key_t("n"), key_range_t::none, store_key_t())) { }
+
+    void read(const memcached_protocol_t::read_t &read, memcached_protocol_t::read_response_t *response, order_token_t tok, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+        if (region_overlaps(read.get_region(), down)) throw cannot_perform_query_exc_t("shard is down");
+        inner->read(read, response, tok, interruptor);
+    }
+    void read_outdated(const memcached_protocol_t::read_t &read, memcached_protocol_t::read_response_t *response, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+        if (region_overlaps(read.get_region(), down)) throw cannot_perform_query_exc_t("shard is down");
+        inner->read_outdated(read, response, interruptor);
+    }
+    void write(const memcached_protocol_t::write_t &write, memcached_protocol_t::write_response_t *response, order_token_t tok, signal_t *interruptor) THROWS_ONLY(interrupted_exc_t, cannot_perform_query_exc_t) {
+        if (region_overlaps(write.get_region(), down)) throw cannot_perform_query_exc_t("shard is down");
+        inner->write(write, response, tok, interruptor);
+    }
+
+    std::set<memcached_protocol_t::region_t> get_sharding_scheme() THROWS_ONLY(cannot_perform_query_exc_t) {
+        std::set<memcached_protocol_t::region_t> scheme;
+        scheme.insert(up);
+        scheme.insert(down);
+        return scheme;
+    }
+
+private:
+    namespace_interface_t<memcached_protocol_t> *inner;
+    memcached_protocol_t::region_t up, down;
+};
+
+/* `MultiGetShardDown` checks that a text "get" still answers the keys on the
+shards that are up, and only fails when none of its keys can be read */
+void run_multi_get_shard_down_test(namespace_interface_t<memcached_protocol_t> *nsi, order_source_t *order_source) {
+    const char *keys_to_set[] = { "a", "z" };
+    for (int i = 0; i < 2; ++i) {
+        sarc_mutation_t set;
+        set.key = store_key_t(keys_to_set[i]);
+        set.data = data_buffer_t::create(1);
+        set.data->buf()[0] = keys_to_set[i][0];
+        set.flags = 0;
+        set.exptime = 0;
+        set.add_policy = add_policy_yes;
+        set.replace_policy = replace_policy_yes;
+        memcached_protocol_t::write_t write(set, time(NULL), 12345);
+
+        cond_t interruptor;
+        memcached_protocol_t::write_response_t result;
+        nsi->write(write, &result, order_source->check_in("unittest::run_multi_get_shard_down_test(memcached_protocol.cc)"), &interruptor);
+    }
+
+    shard_down_namespace_interface_t shard_down_nsi(nsi);
+    string_memcached_interface_t interface("get a z\r\nget z\r\n");
+    perfmon_collection_t stats_collection;
+    memcached_stats_t stats(&stats_collection);
+    cond_t interruptor;
+    handle_memcache(&interface, &shard_down_nsi, 16, &stats, &interruptor);
+
+    const std::string answer = "VALUE a 0 1\r\na\r\nEND\r\n";
+    ASSERT_EQ(answer, interface.output.substr(0, answer.size()));
+    EXPECT_EQ(answer.size(), interface.output.find("SERVER_ERROR"));
+}
+TEST(MemcachedProtocol, MultiGetShardDown) {
+    run_in_thread_pool_with_namespace_interface(&run_multi_get_shard_down_test);
+}
+
+}   /* namespace unittest */
@@ -0,0 +1,64 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "concurrency/pmap.hpp"
+#include "mock/unittest_utils.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+void hop_back_and_forth(int other_thread, int round_trips, int *completed) {
+    int home = get_thread_id();
+    for (int i = 0; i < round_trips; ++i) {
+        on_thread_t th(other_thread);
+        EXPECT_EQ(other_thread, get_thread_id());
+        ++*completed;
+    }
+    EXPECT_EQ(home, get_thread_id());
+}
+
+void hop_back_and_forth_with_counter(int other_thread, int round_trips, std::vector<int> *completed, int i) {
+    hop_back_and_forth(other_thread, round_trips, &(*completed)[i]);
+}
+
+/* Every coroutine must make every one of its round trips, and always be on
+the thread it asked for, however many of them share the queues. */
+void run_ping_pong_test(int num_coroutines) {
+    const int round_trips = 10000 / num_coroutines;
+    std::vector<int> completed(num_coroutines, 0);
+
+    pmap(num_coroutines, boost::bind(&hop_back_and_forth_with_counter, 1, round_trips, &completed, _1));
+
+    for (int i = 0; i < num_coroutines; ++i) {
+        EXPECT_EQ(round_trips, completed[i]);
+    }
+}
+
+TEST(MessageHubTest, PingPong) {
+    mock::run_in_thread_pool(boost::bind(&run_ping_pong_test, 1), 2);
+}
+
+TEST(MessageHubTest, PingPongManyCoroutines) {
+    mock::run_in_thread_pool(boost::bind(&run_ping_pong_test, 100), 2);
+}
+
+void run_fan_out_test() {
+    // Coroutines on thread 0 bounce off every other thread at once, so thread 0
+    // takes messages from all of them concurrently.
+    std::vector<int> completed(4, 0);
+    pmap(4, boost::bind(&hop_back_and_forth_with_counter, _1, 10000, &completed, _1));
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(10000, completed[i]);
+    }
+}
+
+TEST(MessageHubTest, FanOut) {
+    mock::run_in_thread_pool(&run_fan_out_test, 4);
+}
+
+}  // namespace unittest
@@ -3,7 +3,10 @@
 #include <stdint.h>
 #include <math.h>
 
+#include <algorithm>
 #include <cmath>  // for std::isnan -- read the comment below.
+#include <string>
+#include <vector>
 
 #include "perfmon/perfmon.hpp"
 #include "unittest/gtest.hpp"
@@ -57,4 +60,97 @@ TEST(PerfmonTest, StddevComputation) {
     }
 }
 
+TEST(PerfmonTest, HistogramPercentiles) {
+    typedef perfmon_histogram::histogram_t t;
+
+    // Every value lands in a bucket that holds it.
+    for (ticks_t v = 0; v < 100000; v = v * 1.01 + 1) {
+        int index = t::bucket_index(v);
+        EXPECT_LE(v, t::bucket_max(index));
+        if (index > 0) {
+            EXPECT_LT(t::bucket_max(index - 1), v);
+        }
+    }
+
+    t hist;
+    EXPECT_EQ(0u, hist.count);
+
+    // 1..1000 microseconds, one of each.
+    for (ticks_t us = 1; us <= 1000; ++us) {
+        hist.record(us * 1000);
+    }
+    EXPECT_EQ(1000u, hist.count);
+    EXPECT_EQ(1000000u, hist.max);
+
+    // Buckets are 1/16th of a power of two wide, so that's how far off we can be.
+    const double precision = 1.0 / perfmon_histogram::SUB_BUCKETS;
+    EXPECT_NEAR(500000.0, hist.percentile(0.5), 500000.0 * precision);
+    EXPECT_NEAR(990000.0, hist.percentile(0.99), 990000.0 * precision);
+    EXPECT_EQ(1000000u, hist.percentile(1.0));
+
+    // Adding a histogram to itself leaves the percentiles where they were.
+    t doubled = hist;
+    doubled.aggregate(hist);
+    EXPECT_EQ(2000u, doubled.count);
+    EXPECT_EQ(hist.percentile(0.5), doubled.percentile(0.5));
+
+    // Huge values are clamped into the last bucket, but the max is exact.
+    t huge;
+    huge.record(static_cast<ticks_t>(1) << 50);
+    EXPECT_EQ(perfmon_histogram::NUM_BUCKETS - 1, t::bucket_index(huge.max));
+    EXPECT_EQ(static_cast<ticks_t>(1) << 50, huge.percentile(0.5));
+}
+
+TEST(PerfmonTest, RemoveUnchanged) {
+    perfmon_result_t before = perfmon_result_t::make_map();
+    before.insert("same", new perfmon_result_t(static_cast<int64_t>(5)));
+    before.insert("changed", new perfmon_result_t(1.5));
+    before.insert("text", new perfmon_result_t(std::string("abc")));
+    perfmon_result_t *sub = new perfmon_result_t(perfmon_result_t::make_map());
+    sub->insert("same", new perfmon_result_t(2.0));
+    before.insert("sub", sub);
+
+    perfmon_result_t after = perfmon_result_t::make_map();
+    after.insert("same", new perfmon_result_t(static_cast<int64_t>(5)));
+    after.insert("changed", new perfmon_result_t(2.5));
+    // Numbers that came over the wire are strings; they compare as such.
+    after.insert("text", new perfmon_result_t(std::string("abc")));
+    after.insert("new", new perfmon_result_t(static_cast<int64_t>(0)));
+    sub = new perfmon_result_t(perfmon_result_t::make_map());
+    sub->insert("same", new perfmon_result_t(2.0));
+    after.insert("sub", sub);
+
+    EXPECT_EQ("2.50000000", *after.get_map()->find("changed")->second->get_string());
+
+    after.remove_unchanged(before);
+    ASSERT_EQ(2u, after.get_map()->size());
+    EXPECT_EQ(1u, after.get_map()->count("changed"));
+    EXPECT_EQ(1u, after.get_map()->count("new"));
+}
+
+TEST(PerfmonTest, FindRemoved) {
+    perfmon_result_t before = perfmon_result_t::make_map();
+    before.insert("kept", new perfmon_result_t(static_cast<int64_t>(1)));
+    before.insert("gone", new perfmon_result_t(static_cast<int64_t>(2)));
+    perfmon_result_t *sub = new perfmon_result_t(perfmon_result_t::make_map());
+    sub->insert("kept", new perfmon_result_t(static_cast<int64_t>(3)));
+    sub->insert("gone", new perfmon_result_t(static_cast<int64_t>(4)));
+    before.insert("sub", sub);
+    before.insert("gone_map", new perfmon_result_t(perfmon_result_t::make_map()));
+
+    perfmon_result_t after = perfmon_result_t::make_map();
+    after.insert("kept", new perfmon_result_t(static_cast<int64_t>(1)));
+    sub = new perfmon_result_t(perfmon_result_t::make_map());
+    sub->insert("kept", new perfmon_result_t(static_cast<int64_t>(5)));
+    after.insert("sub", sub);
+
+    std::vector<std::string> removed;
+    after.find_removed(before, "", &removed);
+    std::sort(removed.begin(), removed.end());
+    ASSERT_EQ(3u, removed.size());
+    EXPECT_EQ("gone", removed[0]);
+    EXPECT_EQ("gone_map", removed[1]);
+    EXPECT_EQ("sub/gone", removed[2]);
+}
+
 }  // namespace unittest
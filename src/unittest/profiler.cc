@@ -0,0 +1,74 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include <map>
+#include <string>
+#include <vector>
+
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/coroutines.hpp"
+#include "arch/runtime/profiler.hpp"
+#include "arch/timing.hpp"
+#include "concurrency/cond_var.hpp"
+#include "mock/unittest_utils.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+uint64_t total_cycles() {
+    std::map<std::string, uint64_t> cycles;
+    get_coroutine_cycles(&cycles);
+    uint64_t total = 0;
+    for (std::map<std::string, uint64_t>::iterator it = cycles.begin(); it != cycles.end(); ++it) {
+        total += it->second;
+    }
+    return total;
+}
+
+void spin_then_pulse(ticks_t ticks, cond_t *done) {
+    ticks_t start = get_ticks();
+    while (get_ticks() - start < ticks) { }
+    done->pulse();
+}
+
+void spin_in_coroutine(ticks_t ticks) {
+    cond_t done;
+    coro_t::spawn_sometime(boost::bind(&spin_then_pulse, ticks, &done));
+    done.wait();
+}
+
+void run_coroutine_cycles_test() {
+    uint64_t before = total_cycles();
+    spin_in_coroutine(secs_to_ticks(1) / 100);
+    EXPECT_LT(before, total_cycles());
+}
+
+TEST(ProfilerTest, CoroutineCycles) {
+    mock::run_in_thread_pool(&run_coroutine_cycles_test);
+}
+
+void run_sampling_test() {
+    ASSERT_TRUE(start_sampling_profiler(1000));
+    // Only one profile at a time.
+    EXPECT_FALSE(start_sampling_profiler(1000));
+
+    spin_in_coroutine(secs_to_ticks(1) / 10);
+
+    std::vector<sampled_stack_t> stacks;
+    stop_sampling_profiler(&stacks);
+    ASSERT_LT(0u, stacks.size());
+    for (size_t i = 1; i < stacks.size(); ++i) {
+        EXPECT_LE(stacks[i].count, stacks[i - 1].count);
+    }
+
+    // And now another one can start.
+    EXPECT_TRUE(start_sampling_profiler(1000));
+    stop_sampling_profiler(&stacks);
+}
+
+TEST(ProfilerTest, Sampling) {
+    mock::run_in_thread_pool(&run_sampling_test);
+}
+
+}  // namespace unittest
@@ -4,6 +4,7 @@
 
 #include "arch/runtime/thread_pool.hpp"
 #include "arch/timing.hpp"
+#include "concurrency/pmap.hpp"
 #include "containers/scoped.hpp"
 #include "mock/unittest_utils.hpp"
 #include "rpc/connectivity/cluster.hpp"
@@ -13,7 +14,8 @@
 namespace unittest {
 
 /* `recording_test_application_t` sends and receives integers over a
-`message_service_t`. It keeps track of the integers it has received.
+`message_service_t`. It keeps track of the integers it has received. Messages
+can be padded out to make them take longer to send.
 */
 
 class recording_test_application_t : public home_thread_mixin_t, public message_handler_t {
@@ -22,19 +24,27 @@ public:
         service(s),
         sequence_number(0)
         { }
-    void send(int message, peer_id_t peer) {
+    void send(int message, peer_id_t peer, int lane_hint = 0,
+              message_priority_t priority = MESSAGE_PRIORITY_DEFAULT, int64_t padding = 0) {
         class writer_t : public send_message_write_callback_t {
         public:
-            explicit writer_t(int _data) : data(_data) { }
+            writer_t(int _data, int _hint, message_priority_t _priority, int64_t _padding) :
+                data(_data), hint(_hint), prio(_priority), padding(_padding) { }
             virtual ~writer_t() { }
             void write(write_stream_t *stream) {
                 write_message_t msg;
                 msg << data;
+                msg << std::string(padding, 'x');
                 int res = send_write_message(stream, &msg);
                 if (res) { throw fake_archive_exc_t(); }
             }
+            int lane_hint() { return hint; }
+            message_priority_t priority() { return prio; }
             int32_t data;
-        } writer(message);
+            int hint;
+            message_priority_t prio;
+            int64_t padding;
+        } writer(message, lane_hint, priority, padding);
         service->send_message(peer, &writer);
     }
     void expect(int message, peer_id_t peer) {
@@ -56,12 +66,21 @@ public:
         assert_thread();
         EXPECT_LT(timing[first], timing[second]);
     }
+    /* How many messages were delivered before `message` */
+    int delivery_position(int message) {
+        expect_delivered(message);
+        assert_thread();
+        return timing[message];
+    }
 
 private:
     void on_message(peer_id_t peer, read_stream_t *stream) {
         int i;
         int res = deserialize(stream, &i);
         if (res) { throw fake_archive_exc_t(); }
+        std::string padding;
+        res = deserialize(stream, &padding);
+        if (res) { throw fake_archive_exc_t(); }
         on_thread_t th(home_thread());
         inbox[i] = peer;
         timing[i] = sequence_number++;
@@ -200,6 +219,52 @@ TEST(RPCConnectivityTest, OrderingMultiThread) {
     mock::run_in_thread_pool(&run_ordering_test, 3);
 }
 
+/* `Lanes` tests that when there are several connections between two peers,
+messages get through and messages with the same lane hint stay in order. It
+also makes sure that a peer that wants fewer lanes gets its way. */
+
+void run_lanes_test() {
+    int port = mock::randport();
+    connectivity_cluster_t c1, c2, c3;
+    recording_test_application_t a1(&c1), a2(&c2), a3(&c3);
+    connectivity_cluster_t::run_t cr1(&c1, mock::get_unittest_addresses(), port, &a1, 0, NULL, 4);
+    connectivity_cluster_t::run_t cr2(&c2, mock::get_unittest_addresses(), port+1, &a2, 0, NULL, 4);
+    connectivity_cluster_t::run_t cr3(&c3, mock::get_unittest_addresses(), port+2, &a3, 0, NULL, 1);
+
+    cr1.join(c2.get_peer_address(c2.get_me()));
+    cr3.join(c1.get_peer_address(c1.get_me()));
+
+    mock::let_stuff_happen();
+
+    EXPECT_TRUE(c1.get_peers_list().count(c2.get_me()) == 1);
+    EXPECT_TRUE(c1.get_peers_list().count(c3.get_me()) == 1);
+    EXPECT_TRUE(c2.get_peers_list().count(c3.get_me()) == 1);
+
+    const int num_hints = 5;
+    for (int i = 0; i < 40; i++) {
+        a1.send(i, c2.get_me(), i % num_hints);
+        a2.send(i, c1.get_me(), i % num_hints);
+        a3.send(1000 + i, c1.get_me(), i % num_hints);
+    }
+
+    mock::let_stuff_happen();
+
+    for (int i = 0; i + num_hints < 40; i++) {
+        a1.expect_order(i, i + num_hints);
+        a2.expect_order(i, i + num_hints);
+    }
+    for (int i = 0; i < 40; i++) {
+        a2.expect(i, c1.get_me());
+        a1.expect(1000 + i, c3.get_me());
+    }
+}
+TEST(RPCConnectivityTest, Lanes) {
+    mock::run_in_thread_pool(&run_lanes_test);
+}
+TEST(RPCConnectivityTest, LanesMultiThread) {
+    mock::run_in_thread_pool(&run_lanes_test, 3);
+}
+
 /* `GetPeersList` confirms that the behavior of `cluster_t::get_peers_list()` is
 correct. */
 
@@ -315,7 +380,7 @@ struct watcher_t : private peers_list_callback_t {
         /* Make sure messages sent from connection events are delivered
         properly. We must use `coro_t::spawn_now_dangerously()` because `send_message()`
         may block. */
-        coro_t::spawn_now_dangerously(boost::bind(&recording_test_application_t::send, application, 89765, p));
+        coro_t::spawn_now_dangerously(boost::bind(&recording_test_application_t::send, application, 89765, p, 0, MESSAGE_PRIORITY_DEFAULT, 0));
     }
 
     void on_disconnect(peer_id_t p) {
@@ -459,6 +524,105 @@ TEST(RPCConnectivityTest, BlobJoinMultiThread) {
     mock::run_in_thread_pool(&run_blob_join_test, 3);
 }
 
+/* `Priorities` checks that a control message and a query message don't have
+to wait behind a backlog of bulk messages. */
+
+void run_priorities_test() {
+    int port = mock::randport();
+    connectivity_cluster_t c1, c2;
+    recording_test_application_t a1(&c1), a2(&c2);
+    connectivity_cluster_t::run_t cr1(&c1, mock::get_unittest_addresses(), port, &a1, 0, NULL);
+    connectivity_cluster_t::run_t cr2(&c2, mock::get_unittest_addresses(), port+1, &a2, 0, NULL);
+
+    cr1.join(c2.get_peer_address(c2.get_me()));
+    mock::let_stuff_happen();
+
+    /* About 25MB of bulk traffic, all queued up before the flusher gets to
+    run. */
+    const int num_bulk = 400;
+    for (int i = 0; i < num_bulk; i++) {
+        coro_t::spawn_sometime(boost::bind(&recording_test_application_t::send, &a1,
+            1000 + i, c2.get_me(), 0, MESSAGE_PRIORITY_BULK, 64 * KILOBYTE));
+    }
+    coro_t::spawn_sometime(boost::bind(&recording_test_application_t::send, &a1,
+        1, c2.get_me(), 0, MESSAGE_PRIORITY_CONTROL, 0));
+    coro_t::spawn_sometime(boost::bind(&recording_test_application_t::send, &a1,
+        2, c2.get_me(), 0, MESSAGE_PRIORITY_QUERY, 0));
+
+    /* Give the bulk messages plenty of time to all get through */
+    nap(2000);
+
+    for (int i = 0; i < num_bulk; i++) {
+        a2.expect(1000 + i, c1.get_me());
+    }
+    EXPECT_LT(a2.delivery_position(1), num_bulk / 2);
+    EXPECT_LT(a2.delivery_position(2), num_bulk / 2);
+}
+TEST(RPCConnectivityTest, Priorities) {
+    mock::run_in_thread_pool(&run_priorities_test);
+}
+TEST(RPCConnectivityTest, PrioritiesMultiThread) {
+    mock::run_in_thread_pool(&run_priorities_test, 3);
+}
+
+/* `Compression` checks that messages get through when one end of a connection
+asks for compression, including over extra lanes. */
+
+void run_compression_test(cluster_compression_t compression) {
+    int port = mock::randport();
+    connectivity_cluster_t c1, c2;
+    recording_test_application_t a1(&c1), a2(&c2);
+    connectivity_cluster_t::run_t cr1(&c1, mock::get_unittest_addresses(), port, &a1, 0, NULL, 2, compression);
+    connectivity_cluster_t::run_t cr2(&c2, mock::get_unittest_addresses(), port+1, &a2, 0, NULL, 2);
+
+    cr1.join(c2.get_peer_address(c2.get_me()));
+    mock::let_stuff_happen();
+
+    for (int i = 0; i < 20; i++) {
+        message_priority_t priority = i % 2 == 0 ? MESSAGE_PRIORITY_BULK : MESSAGE_PRIORITY_QUERY;
+        a1.send(i, c2.get_me(), i % 3, priority, i * 1000);
+        a2.send(i, c1.get_me(), i % 3, priority, i * 1000);
+    }
+
+    mock::let_stuff_happen();
+
+    for (int i = 0; i < 20; i++) {
+        a2.expect(i, c1.get_me());
+        a1.expect(i, c2.get_me());
+    }
+}
+TEST(RPCConnectivityTest, CompressionBulk) {
+    mock::run_in_thread_pool(boost::bind(&run_compression_test, CLUSTER_COMPRESSION_BULK));
+}
+TEST(RPCConnectivityTest, CompressionAllMultiThread) {
+    mock::run_in_thread_pool(boost::bind(&run_compression_test, CLUSTER_COMPRESSION_ALL), 3);
+}
+
+TEST(RPCConnectivityTest, CompressMessage) {
+    std::vector<char> original(100000);
+    for (size_t i = 0; i < original.size(); ++i) {
+        original[i] = "abcdefgh"[i % 8];
+    }
+
+    std::vector<char> compressed, decompressed;
+    ASSERT_TRUE(compress_message(original.data(), original.size(), &compressed));
+    EXPECT_LT(compressed.size(), original.size());
+    ASSERT_TRUE(decompress_message(compressed.data(), compressed.size(), &decompressed));
+    EXPECT_TRUE(original == decompressed);
+
+    /* Truncated and garbled messages are rejected. */
+    EXPECT_FALSE(decompress_message(compressed.data(), compressed.size() / 2, &decompressed));
+    compressed[compressed.size() / 2] ^= 0x55;
+    EXPECT_FALSE(decompress_message(compressed.data(), compressed.size(), &decompressed));
+
+    /* Incompressible data isn't worth sending compressed. */
+    rng_t rng;
+    for (size_t i = 0; i < original.size(); ++i) {
+        original[i] = rng.randint(256);
+    }
+    EXPECT_FALSE(compress_message(original.data(), original.size(), &compressed));
+}
+
 /* `Multiplexer` tests `message_multiplexer_t`. */
 
 void run_multiplexer_test() {
@@ -558,6 +722,95 @@ TEST(RPCConnectivityTest, BinaryDataMultiThread) {
     mock::run_in_thread_pool(&run_binary_data_test, 3);
 }
 
+/* `Throughput` has many coroutines send messages to one peer at once, which
+is the pattern replication traffic follows, and reports how fast they go. */
+
+class counting_test_application_t : public home_thread_mixin_t, public message_handler_t {
+public:
+    counting_test_application_t(message_service_t *s, int _expected) :
+        service(s), expected(_expected), received(0), bytes_received(0) { }
+    void send(size_t size, peer_id_t peer, int lane_hint) {
+        class writer_t : public send_message_write_callback_t {
+        public:
+            writer_t(size_t _size, int _hint) : size(_size), hint(_hint) { }
+            virtual ~writer_t() { }
+            void write(write_stream_t *stream) {
+                std::vector<char> data(size, 'x');
+                int64_t res = stream->write(data.data(), data.size());
+                if (res != static_cast<int64_t>(data.size())) { throw fake_archive_exc_t(); }
+            }
+            int lane_hint() { return hint; }
+            size_t size;
+            int hint;
+        } writer(size, lane_hint);
+        service->send_message(peer, &writer);
+    }
+    void on_message(peer_id_t, read_stream_t *stream) {
+        char buf[4096];
+        int64_t res;
+        int64_t total = 0;
+        while ((res = stream->read(buf, sizeof(buf))) > 0) {
+            total += res;
+        }
+        if (res < 0) { throw fake_archive_exc_t(); }
+        __sync_fetch_and_add(&bytes_received, total);
+        if (__sync_add_and_fetch(&received, 1) == expected) {
+            on_thread_t th(home_thread());
+            all_received.pulse();
+        }
+    }
+    message_service_t *service;
+    int expected;
+    int received;
+    int64_t bytes_received;
+    cond_t all_received;
+};
+
+void throughput_sender(counting_test_application_t *app, peer_id_t peer, int messages, size_t size, int i) {
+    /* Spread the senders over the lanes the way mailboxes on different
+    threads would be. */
+    for (int j = 0; j < messages; ++j) {
+        app->send(size, peer, i % 8 + 1);
+    }
+}
+
+void run_throughput_test(int lanes) {
+    const int num_senders = 64;
+    const int messages_per_sender = 500;
+    const size_t message_size = 1024;
+
+    int port = mock::randport();
+    connectivity_cluster_t c1, c2;
+    counting_test_application_t a1(&c1, 0), a2(&c2, num_senders * messages_per_sender);
+    connectivity_cluster_t::run_t cr1(&c1, mock::get_unittest_addresses(), port, &a1, 0, NULL, lanes);
+    connectivity_cluster_t::run_t cr2(&c2, mock::get_unittest_addresses(), port+1, &a2, 0, NULL, lanes);
+    cr1.join(c2.get_peer_address(c2.get_me()));
+
+    mock::let_stuff_happen();
+
+    ticks_t start = get_ticks();
+    pmap(num_senders, boost::bind(&throughput_sender, &a1, c2.get_me(), messages_per_sender, message_size, _1));
+    a2.all_received.wait();
+    double secs = ticks_to_secs(get_ticks() - start);
+
+    EXPECT_EQ(num_senders * messages_per_sender, a2.received);
+    EXPECT_EQ(static_cast<int64_t>(num_senders * messages_per_sender * message_size), a2.bytes_received);
+
+    printf("RPC connectivity throughput: %d lane(s), %d senders, %d messages of %zu bytes: "
+           "%.0f messages/sec, %.1f MB/sec\n",
+           lanes, num_senders, num_senders * messages_per_sender, message_size,
+           a2.received / secs, a2.bytes_received / secs / MEGABYTE);
+}
+TEST(RPCConnectivityTest, Throughput) {
+    mock::run_in_thread_pool(boost::bind(&run_throughput_test, 1));
+}
+TEST(RPCConnectivityTest, ThroughputMultiThread) {
+    mock::run_in_thread_pool(boost::bind(&run_throughput_test, 1), 3);
+}
+TEST(RPCConnectivityTest, ThroughputLanesMultiThread) {
+    mock::run_in_thread_pool(boost::bind(&run_throughput_test, 4), 3);
+}
+
 /* `PeerIDSemantics` makes sure that `peer_id_t::is_nil()` works as expected. */
 
 void run_peer_id_semantics_test() {
@@ -0,0 +1,88 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "config/args.hpp"
+#include "mock/unittest_utils.hpp"
+#include "perfmon/trace.hpp"
+#include "unittest/gtest.hpp"
+
+namespace unittest {
+
+void run_spans_test() {
+    EXPECT_TRUE(current_trace() == NULL);
+
+    trace_t trace;
+    {
+        trace_scope_t trace_scope(&trace);
+        EXPECT_EQ(&trace, current_trace());
+        traced_span_t outer("outer");
+        {
+            traced_span_t inner("inner");
+            traced_span_t disabled("disabled", false);
+        }
+        {
+            trace_scope_t no_trace(NULL);
+            traced_span_t untraced("untraced");
+        }
+        EXPECT_EQ(&trace, current_trace());
+    }
+    EXPECT_TRUE(current_trace() == NULL);
+
+    std::vector<trace_span_t> spans = trace.get_spans();
+    ASSERT_EQ(2u, spans.size());
+    EXPECT_EQ("outer", spans[0].name);
+    EXPECT_EQ("inner", spans[1].name);
+    EXPECT_LE(spans[0].start, spans[1].start);
+    EXPECT_LE(spans[1].duration, spans[0].duration);
+}
+
+TEST(TraceTest, Spans) {
+    mock::run_in_thread_pool(&run_spans_test);
+}
+
+TEST(TraceTest, RemoteSpans) {
+    trace_t trace;
+
+    std::vector<trace_span_t> remote(1);
+    remote[0].name = "remote";
+    remote[0].start = 0;
+    remote[0].duration = 0;
+    trace.add_remote_spans(remote);
+
+    std::vector<trace_span_t> spans = trace.get_spans();
+    ASSERT_EQ(1u, spans.size());
+    EXPECT_EQ("remote", spans[0].name);
+    EXPECT_LE(spans[0].start, trace.elapsed());
+}
+
+TEST(TraceTest, MergesSpansPastLimit) {
+    trace_t trace;
+
+    for (int i = 0; i < TRACE_MAX_SPANS; ++i) {
+        trace.add_span("first", 0, 0);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        trace.add_span("row", 0, 0);
+        trace.add_span("block", 0, 0);
+    }
+
+    std::vector<trace_span_t> remote(1);
+    remote[0].name = "row";
+    remote[0].count = 5;
+    trace.add_remote_spans(remote);
+
+    std::vector<trace_span_t> spans = trace.get_spans();
+    ASSERT_EQ(static_cast<size_t>(TRACE_MAX_SPANS + 2), spans.size());
+    int64_t rows = 0, blocks = 0;
+    for (size_t i = 0; i < spans.size(); ++i) {
+        if (spans[i].name == "row") {
+            rows += spans[i].count;
+        } else if (spans[i].name == "block") {
+            blocks += spans[i].count;
+        } else {
+            EXPECT_EQ(1, spans[i].count);
+        }
+    }
+    EXPECT_EQ(1005, rows);
+    EXPECT_EQ(1000, blocks);
+}
+
+}  // namespace unittest
@@ -0,0 +1,80 @@
+// Copyright 2010-2012 RethinkDB, all rights reserved.
+#include "errors.hpp"
+#include <boost/bind.hpp>
+
+#include "arch/runtime/thread_pool.hpp"
+#include "arch/runtime/work_stealing.hpp"
+#include "arch/timing.hpp"
+#include "mock/unittest_utils.hpp"
+#include "rdb_protocol/query_language.hpp"
+#include "unittest/gtest.hpp"
+#include "utils.hpp"
+
+namespace unittest {
+
+void spin_for(ticks_t ticks) {
+    ticks_t start = get_ticks();
+    while (get_ticks() - start < ticks) { }
+}
+
+void stealable_task(volatile int *done, volatile int *ran_elsewhere, int home_thread) {
+    spin_for(secs_to_ticks(1) / 1000);
+    if (get_thread_id() != home_thread) {
+        __sync_fetch_and_add(ran_elsewhere, 1);
+    }
+    __sync_fetch_and_add(done, 1);
+}
+
+void run_steal_test() {
+    const int num_tasks = 100;
+    volatile int done = 0, ran_elsewhere = 0;
+    for (int i = 0; i < num_tasks; ++i) {
+        spawn_stealable(boost::bind(&stealable_task, &done, &ran_elsewhere, get_thread_id()));
+    }
+
+    // Keep this thread busy, so the only way the tasks get run right now is if
+    // other threads take them.
+    spin_for(secs_to_ticks(1) / 20);
+
+    while (done != num_tasks) {
+        nap(1);
+    }
+    EXPECT_LT(0, ran_elsewhere);
+}
+
+TEST(WorkStealingTest, IdleThreadsSteal) {
+    mock::run_in_thread_pool(&run_steal_test, 4);
+}
+
+void set_flag(int *flag) {
+    *flag = 1;
+}
+
+void run_stealable_waits_test() {
+    int flag = 0;
+    run_stealable(boost::bind(&set_flag, &flag));
+    EXPECT_EQ(1, flag);
+}
+
+TEST(WorkStealingTest, RunStealableWaits) {
+    mock::run_in_thread_pool(&run_stealable_waits_test, 2);
+}
+
+void throw_runtime_exc() {
+    throw query_language::runtime_exc_t("stolen", query_language::backtrace_t());
+}
+
+void run_stealable_evaluation_rethrows_test() {
+    try {
+        query_language::run_stealable_evaluation(&throw_runtime_exc);
+        ADD_FAILURE() << "the error got lost";
+    } catch (const query_language::runtime_exc_t &e) {
+        EXPECT_EQ("stolen", e.message);
+    }
+}
+
+TEST(WorkStealingTest, StealableEvaluationRethrows) {
+    mock::run_in_thread_pool(&run_stealable_evaluation_rethrows_test, 2);
+}
+
+}  // namespace unittest
@@ -0,0 +1,133 @@
+#!/usr/bin/python
+# Copyright 2010-2012 RethinkDB, all rights reserved.
+
+# Speaks the memcached binary protocol directly, so that we can check the quiet
+# commands and the packet layout without depending on a client library.
+
+import struct, sys, os
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), os.path.pardir, 'common')))
+import memcached_workload_common
+from vcoptparse import *
+
+GET, SET, ADD, REPLACE, DELETE, INCREMENT = 0x00, 0x01, 0x02, 0x03, 0x04, 0x05
+GETQ, NOOP, VERSION, GETK, GETKQ, APPEND = 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e
+SETQ = 0x11
+
+NO_ERROR, KEY_NOT_FOUND, KEY_EXISTS, NOT_STORED, UNKNOWN_COMMAND = 0x00, 0x01, 0x02, 0x05, 0x81
+
+HEADER = ">BBHBBHIIQ"
+
+def request(opcode, key = "", value = "", extras = "", opaque = 0, cas = 0):
+    body = extras + key + value
+    return struct.pack(HEADER, 0x80, opcode, len(key), len(extras), 0, 0, len(body), opaque, cas) + body
+
+def recv_exactly(sock, n):
+    data = ""
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise ValueError("Connection closed early")
+        data += chunk
+    return data
+
+def response(sock):
+    magic, opcode, key_len, extras_len, _, status, body_len, opaque, cas = \
+        struct.unpack(HEADER, recv_exactly(sock, struct.calcsize(HEADER)))
+    if magic != 0x81:
+        raise ValueError("Bad response magic: %x" % magic)
+    body = recv_exactly(sock, body_len)
+    extras = body[:extras_len]
+    key = body[extras_len:extras_len + key_len]
+    value = body[extras_len + key_len:]
+    return opcode, status, opaque, extras, key, value
+
+def expect(sock, opcode, status, value = None, key = None):
+    got_opcode, got_status, _, _, got_key, got_value = response(sock)
+    if got_opcode != opcode or got_status != status:
+        raise ValueError("Expected opcode %x status %x, got opcode %x status %x (%r)" %
+                         (opcode, status, got_opcode, got_status, got_value))
+    if value is not None and got_value != value:
+        raise ValueError("Expected value %r, got %r" % (value, got_value))
+    if key is not None and got_key != key:
+        raise ValueError("Expected key %r, got %r" % (key, got_key))
+    return got_value
+
+op = memcached_workload_common.option_parser_for_socket()
+op["num_keys"] = IntFlag("--num-keys", 100)
+opts = op.parse(sys.argv)
+
+with memcached_workload_common.make_socket_connection(opts) as s:
+    flags_exptime = struct.pack(">II", 0, 0)
+
+    print "Testing set, get and flags"
+    s.sendall(request(SET, "a", "hello", struct.pack(">II", 42, 0)))
+    expect(s, SET, NO_ERROR)
+    s.sendall(request(GET, "a"))
+    _, _, _, extras, _, value = response(s)
+    if value != "hello" or struct.unpack(">I", extras)[0] != 42:
+        raise ValueError("Got %r with extras %r" % (value, extras))
+
+    print "Testing empty values"
+    s.sendall(request(SET, "empty", "", flags_exptime))
+    expect(s, SET, NO_ERROR)
+    s.sendall(request(GET, "empty"))
+    expect(s, GET, NO_ERROR, value = "")
+    s.sendall(request(APPEND, "empty", ""))
+    expect(s, APPEND, NO_ERROR)
+    s.sendall(request(GET, "empty"))
+    expect(s, GET, NO_ERROR, value = "")
+
+    print "Testing add and replace"
+    s.sendall(request(ADD, "a", "x", flags_exptime))
+    expect(s, ADD, KEY_EXISTS)
+    s.sendall(request(REPLACE, "nonexistent", "x", flags_exptime))
+    expect(s, REPLACE, KEY_NOT_FOUND)
+
+    print "Testing append"
+    s.sendall(request(APPEND, "a", " world"))
+    expect(s, APPEND, NO_ERROR)
+    s.sendall(request(GETK, "a"))
+    expect(s, GETK, NO_ERROR, value = "hello world", key = "a")
+
+    print "Testing incr with an initial value"
+    s.sendall(request(INCREMENT, "counter", extras = struct.pack(">QQI", 5, 10, 0)))
+    if struct.unpack(">Q", expect(s, INCREMENT, NO_ERROR))[0] != 10:
+        raise ValueError("Counter wasn't created with its initial value")
+    s.sendall(request(INCREMENT, "counter", extras = struct.pack(">QQI", 5, 10, 0)))
+    if struct.unpack(">Q", expect(s, INCREMENT, NO_ERROR))[0] != 15:
+        raise ValueError("Counter wasn't incremented")
+
+    print "Testing quiet sets and multi-get"
+    batch = ""
+    for i in xrange(opts["num_keys"]):
+        if i % 2 == 0:
+            batch += request(SETQ, "key%d" % i, "value%d" % i, flags_exptime)
+    batch += request(NOOP)
+    s.sendall(batch)
+    expect(s, NOOP, NO_ERROR)
+
+    batch = ""
+    for i in xrange(opts["num_keys"]):
+        batch += request(GETKQ, "key%d" % i, opaque = i)
+    batch += request(NOOP)
+    s.sendall(batch)
+    for i in xrange(0, opts["num_keys"], 2):
+        opcode, status, opaque, _, key, value = response(s)
+        if (opcode, status, opaque, key, value) != (GETKQ, NO_ERROR, i, "key%d" % i, "value%d" % i):
+            raise ValueError("Unexpected response to GETKQ %d: %r" % (i, (opcode, status, opaque, key, value)))
+    expect(s, NOOP, NO_ERROR)
+
+    print "Testing delete"
+    s.sendall(request(DELETE, "a"))
+    expect(s, DELETE, NO_ERROR)
+    s.sendall(request(GET, "a"))
+    expect(s, GET, KEY_NOT_FOUND)
+
+    print "Testing version and unknown commands"
+    s.sendall(request(VERSION))
+    if not expect(s, VERSION, NO_ERROR).startswith("rethinkdb-"):
+        raise ValueError("Bad version string")
+    s.sendall(request(0x42))
+    expect(s, 0x42, UNKNOWN_COMMAND)
+
+print "Done"
@@ -0,0 +1,61 @@
+#!/usr/bin/python
+# Copyright 2010-2012 RethinkDB, all rights reserved.
+
+# Times distinct() over a low-cardinality column of a large table. Each shard
+# drops duplicates before sending its values back, so little data should
+# reach the parsing node.
+
+# Environment variables:
+# HOST: location of server (default = "localhost")
+# PORT: port that server listens for RDB protocol traffic on (default = 28015)
+# DB_NAME: database to create the benchmark table in (default = "test")
+# TABLE_NAME: table to run the benchmark against (default = "distinct_bench")
+# NUM_ROWS: number of rows (default = 10000000)
+# CARDINALITY: number of distinct values in the column (default = 100)
+# BATCH_SIZE: number of rows per insert query (default = 1000)
+
+import os
+import sys
+import time
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..', 'drivers', 'python')))
+
+from rethinkdb import *
+
+def main():
+    conn = connect(os.environ.get('HOST', 'localhost'), int(os.environ.get('PORT', 28015)))
+    database = db(os.environ.get('DB_NAME', 'test'))
+    table_name = os.environ.get('TABLE_NAME', 'distinct_bench')
+    num_rows = int(os.environ.get('NUM_ROWS', 10000000))
+    cardinality = int(os.environ.get('CARDINALITY', 100))
+    batch_size = int(os.environ.get('BATCH_SIZE', 1000))
+
+    try:
+        conn.run(database.table_drop(table_name))
+    except:
+        pass
+    conn.run(database.table_create(table_name))
+    table = database.table(table_name)
+
+    print "Inserting %d rows with %d distinct values" % (num_rows, cardinality)
+    start = time.time()
+    batch = []
+    for row_id in xrange(num_rows):
+        batch.append({'id': row_id, 'value': row_id % cardinality})
+        if len(batch) == batch_size:
+            conn.run(table.insert(batch))
+            batch = []
+    if batch:
+        conn.run(table.insert(batch))
+    print "Inserted in %.2fs" % (time.time() - start)
+
+    start = time.time()
+    res = conn.run(table.map(lambda row: row['value']).distinct().stream_to_array())
+    elapsed = time.time() - start
+
+    if len(res) != cardinality:
+        raise ValueError("Expected %d distinct values but got %d" % (cardinality, len(res)))
+    print "distinct over %d rows took %.2fs" % (num_rows, elapsed)
+
+if __name__ == '__main__':
+    main()
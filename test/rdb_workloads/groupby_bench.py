@@ -0,0 +1,69 @@
+#!/usr/bin/python
+# Copyright 2010-2012 RethinkDB, all rights reserved.
+
+# Times a grouped_map_reduce over a table with a large number of distinct
+# groups. This stresses the per-shard combine step and the hash-partitioned
+# merge of shard results on the parsing node.
+
+# Environment variables:
+# HOST: location of server (default = "localhost")
+# PORT: port that server listens for RDB protocol traffic on (default = 28015)
+# DB_NAME: database to create the benchmark table in (default = "test")
+# TABLE_NAME: table to run the benchmark against (default = "groupby_bench")
+# NUM_GROUPS: number of distinct groups (default = 1000000)
+# ROWS_PER_GROUP: number of rows inserted for each group (default = 1)
+# BATCH_SIZE: number of rows per insert query (default = 1000)
+
+import os
+import sys
+import time
+
+sys.path.append(os.path.abspath(os.path.join(os.path.dirname(__file__), '..', '..', 'drivers', 'python')))
+
+from rethinkdb import *
+
+def main():
+    conn = connect(os.environ.get('HOST', 'localhost'), int(os.environ.get('PORT', 28015)))
+    database = db(os.environ.get('DB_NAME', 'test'))
+    table_name = os.environ.get('TABLE_NAME', 'groupby_bench')
+    num_groups = int(os.environ.get('NUM_GROUPS', 1000000))
+    rows_per_group = int(os.environ.get('ROWS_PER_GROUP', 1))
+    batch_size = int(os.environ.get('BATCH_SIZE', 1000))
+
+    try:
+        conn.run(database.table_drop(table_name))
+    except:
+        pass
+    conn.run(database.table_create(table_name))
+    table = database.table(table_name)
+
+    print "Inserting %d rows in %d groups" % (num_groups * rows_per_group, num_groups)
+    start = time.time()
+    batch = []
+    row_id = 0
+    for rep in xrange(rows_per_group):
+        for group in xrange(num_groups):
+            batch.append({'id': row_id, 'group': group, 'value': row_id % 100})
+            row_id += 1
+            if len(batch) == batch_size:
+                conn.run(table.insert(batch))
+                batch = []
+    if batch:
+        conn.run(table.insert(batch))
+    print "Inserted in %.2fs" % (time.time() - start)
+
+    start = time.time()
+    res = conn.run(table.grouped_map_reduce(
+        lambda row: row['group'],
+        lambda row: row['value'],
+        0,
+        lambda acc, val: acc + val
+        ))
+    elapsed = time.time() - start
+
+    if len(res) != num_groups:
+        raise ValueError("Expected %d groups but got %d" % (num_groups, len(res)))
+    print "grouped_map_reduce over %d groups took %.2fs" % (num_groups, elapsed)
+
+if __name__ == '__main__':
+    main()